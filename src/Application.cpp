@@ -1,15 +1,35 @@
 #include "Application.h"
 
+#include <optional>
 #include <QKeyEvent>
 
 #include "Input.h"
-#include "glm/ext/matrix_transform.hpp"
+#include "scene/SceneLibrary.h"
+#include "utils/Profiler.h"
 
 float ROTATION_SPEED = 0.05f;
 float CAMERA_MOVE_SPEED = 0.02f;
 float CAMERA_ROTATION_SPEED = 0.002f;
 
-Application::Application(int argc, char *argv[]) : m_RenderTimeMs(0) {
+namespace {
+    std::optional<Input::Key> toInputKey(const int qtKey) {
+        switch (qtKey) {
+            case Qt::Key_A: return Input::Key::A;
+            case Qt::Key_S: return Input::Key::S;
+            case Qt::Key_D: return Input::Key::D;
+            case Qt::Key_W: return Input::Key::W;
+            case Qt::Key_Q: return Input::Key::Q;
+            case Qt::Key_E: return Input::Key::E;
+            case Qt::Key_Left: return Input::Key::ArrowLeft;
+            case Qt::Key_Right: return Input::Key::ArrowRight;
+            case Qt::Key_Down: return Input::Key::ArrowDown;
+            case Qt::Key_Up: return Input::Key::ArrowUp;
+            default: return std::nullopt;
+        }
+    }
+}
+
+Application::Application(int argc, char *argv[]) {
     m_QtApplication = std::make_unique<QApplication>(argc, argv);
     QApplication::setApplicationName("Dazhbog");
     QApplication::setOrganizationName("Mythological Worlds");
@@ -20,41 +40,68 @@ Application::Application(int argc, char *argv[]) : m_RenderTimeMs(0) {
     m_Window->resize(1024, 768);
     m_Window->show();
 
-    m_RenderTimer = std::make_unique<QTimer>(m_Window.get());
-    connect(m_RenderTimer.get(), &QTimer::timeout, this, &Application::OnRender);
-    m_RenderTimer->start();
+    // The first argument names a built-in scene or a .dzs file; QApplication has taken its own by now.
+    SceneLibrary::Entry entry = SceneLibrary::Create(argc > 1 ? argv[1] : "demo");
+    if (!entry.Scene) {
+        entry = SceneLibrary::Create("demo");
+    }
+    m_Scene = std::move(entry.Scene);
 
-    m_Camera = std::make_unique<Camera>(45.0, 0.1, 100.0, m_Window->GetCanvasSize());
-    m_Camera->PlaceInWorld({0.4, 2.0, 11}, {-0.4, 0.0, -11.0});
+    m_Camera = std::make_unique<Camera>(entry.VerticalFOV, 0.1, 100.0, m_Window->GetCanvasSize());
+    m_Camera->PlaceInWorld(entry.CameraPosition, entry.CameraDirection);
     m_Window->UpdateCameraLocation(m_Camera->GetPosition(), m_Camera->GetDirection());
     m_Window->SetButtonHandler([this](const MainWindow::ButtonAction action)
     {
         if (action == MainWindow::ButtonAction::Dump)
         {
             const std::string homeDir = getenv("HOME");
-            m_Renderer->DumpFramesToDisc(homeDir + "/CLionProjects/Dazhbog/dump");
+            m_RenderThread->Submit(RenderThread::DumpFramesCommand{homeDir + "/CLionProjects/Dazhbog/dump"});
+        }
+    });
+    Renderer::Settings settings;
+    settings.Integrator.SamplesPerPixel = entry.SamplesPerPixel > 0 ? entry.SamplesPerPixel : 16;
+    settings.FramesToAccumulate = entry.Frames > 0 ? entry.Frames : 50;
+    settings.Display.HDREnabled = true;
+    settings.Display.Bloom.Enabled = true;
+    settings.Display.GammaCorrectionEnabled = true;
+    settings.Display.TonemapEnabled = true;
+    settings.Display.Exposure = -0.5f;
+    settings.Display.Gamma = 2.2f;
+    settings.Integrator.RayBounces = entry.RayBounces > 0 ? entry.RayBounces : 5;
+    settings.Display.Bloom.Threshold = 1.0f;
+    settings.Display.Bloom.Levels = 8;
+    settings.Display.Bloom.Radius = 4;
+    settings.Display.Bloom.Sigma = 2.0f;
+    settings.Display.Bloom.Intensity = 0.2f;
+    m_Window->SetRenderSettings(settings);
+
+    m_RenderThread = std::make_unique<RenderThread>(*m_Camera, m_Scene.get(), m_Window->GetCanvasSize(), settings);
+    m_RenderThread->SetFrameReadyHandler([this] {
+        // Coalesce notifications: the UI only ever shows the latest frame anyway.
+        if (!m_IsFramePresentPending.exchange(true)) {
+            QMetaObject::invokeMethod(this, &Application::OnFrameReady, Qt::QueuedConnection);
         }
     });
-    SetupScene();
-    m_Renderer = std::make_unique<Renderer>(m_Camera.get(), m_Scene.get(), m_Window->GetCanvasSize());
-    m_Renderer->GetSettings().SamplesPerPixel = 16;
-    m_Renderer->GetSettings().FramesToAccumulate = 50;
-    m_Renderer->GetSettings().HDREnabled = true;
-    m_Renderer->GetSettings().BloomEnabled = true;
-    m_Renderer->GetSettings().GammaCorrectionEnabled = true;
-    m_Renderer->GetSettings().TonemapEnabled = true;
-    m_Renderer->GetSettings().Exposure = -0.5f;
-    m_Renderer->GetSettings().Gamma = 2.2f;
-    m_Renderer->GetSettings().RayBounces = 5;
-    m_Renderer->GetSettings().BloomThreshold = 1.0f;
-    m_Renderer->GetSettings().BloomLevels = 8;
-    m_Renderer->GetSettings().BloomRadius = 4;
-    m_Renderer->GetSettings().BloomSigma = 2.0f;
-    m_Renderer->GetSettings().BloomIntensity = 0.2f;
-    m_Window->SetRenderSettings(m_Renderer->GetSettings());
     m_Window->SetRenderSettingsChangedHandler([this](Renderer::Settings settings) {
-        m_Renderer->SetSettings(settings);
+        m_RenderThread->Submit(RenderThread::SetSettingsCommand{settings});
     });
+    m_RenderThread->Start();
+
+    m_InputTimer = std::make_unique<QTimer>(m_Window.get());
+    m_InputTimer->setInterval(16);
+    connect(m_InputTimer.get(), &QTimer::timeout, this, [this] {
+        OnUpdate(static_cast<float>(m_InputClock.restart()));
+    });
+    m_InputClock.start();
+    m_InputTimer->start();
+}
+
+Application::~Application() {
+    // With a profiling build, DAZHBOG_TRACE names the Chrome trace written on exit.
+    if (const char* tracePath = getenv("DAZHBOG_TRACE")) {
+        m_RenderThread.reset();
+        Utils::Profiler::WriteChromeTrace(tracePath);
+    }
 }
 
 int Application::Run() {
@@ -62,50 +109,21 @@ int Application::Run() {
     return QApplication::exec();
 }
 
-void Application::SetupScene() {
-    m_Scene = std::make_unique<Scene>();
-    const auto greenMat = m_Scene->Add(new LambertMaterial({0.8, 0.8, 0.0}));
-    const auto blueMat = m_Scene->Add(new LambertMaterial({0.1, 0.2, 0.5}));
-    const auto greenShinyMat = m_Scene->Add(new DiffuseLightMaterial({0.0, 1.0, 0.0}, 10.0f));
-    const auto silverMat = m_Scene->Add(new MetalMaterial({0.8, 0.8, 0.8}, 0.04));
-    const auto goldenMat = m_Scene->Add(new MetalMaterial({0.8, 0.6, 0.2}, 0.0));
-    const auto lightMat = m_Scene->Add(new DiffuseLightMaterial({1.0, 0.706, 0.422}, 20.0));
-    const auto glass = m_Scene->Add(new DielectricMaterial(1.5f));
-
-    //Floor
-    m_Scene->Add(new Triangle(
-        {-1000.0f, 0.0f, 1000.0f},
-        {1000.0f, 0.0f, -1000.0f},
-        {-1000.0f, 0.0f, -1000.0f},
-        greenMat));
-    m_Scene->Add(new Triangle(
-        {-1000.0f, 0.0f, 1000.0f},
-        {1000.0f, 0.0f, 1000.0f},
-        {1000.0f, 0.0f, -1000.0f},
-        greenMat));
-
-    m_Scene->Add(new Sphere(2.0f, blueMat, glm::vec3(0.0f, 2.0f, 0.0f)));
-    m_Scene->Add(new Sphere(2.0f, glass, glm::vec3(-4.2f, 2.0f, 0.0f)));
-    m_Scene->Add(new Sphere(4.0f, lightMat, glm::vec3(0.0f, 40.0f, -10.0f)));
-
-    const glm::mat4 scale = glm::scale(glm::mat4(1.0), {10.0f, 10.0f, 10.0f});
-    constexpr glm::mat4 translateSilver = glm::translate(glm::mat4(1.0), {20.0f, 5.0f, 20.0f});
-    constexpr glm::mat4 translateGold = glm::translate(glm::mat4(1.0), {-20.0f, 5.0f, 20.0f});
-    m_Scene->Add(new Cube(translateSilver * scale, silverMat));
-    m_Scene->Add(new Cube(translateGold * scale, goldenMat));
-}
+void Application::OnFrameReady() {
+    m_IsFramePresentPending.store(false);
 
-void Application::OnRender() {
-    QElapsedTimer timer;
-    timer.start();
-    const Renderer::RenderingStatus renderingStatus = m_Renderer->Render();
-    m_RenderTimeMs = renderingStatus.FrameRenderTime;
-    m_Window->UpdateRenderTime(renderingStatus.FrameRenderTime, renderingStatus.SceneRenderTime);
-    m_Window->UpdateFrame(renderingStatus.FrameIndex);
-
-    const auto imageData = m_Renderer->GetFinalImageData();
-    m_Window->ShowImage(imageData);
-    OnUpdate(static_cast<float>(renderingStatus.FrameRenderTime));
+    if (Renderer::RenderingStatus renderingStatus; m_RenderThread->AcquireStatus(renderingStatus)) {
+        m_Window->UpdateRenderTime(renderingStatus.FrameRenderTime, renderingStatus.SceneRenderTime);
+        m_Window->UpdateFrame(renderingStatus.FrameIndex);
+        // Finished and cancelled frames trace nothing; keep showing the last traced frame.
+        if (renderingStatus.Statistics.PrimaryRays > 0) {
+            m_Window->UpdateRayStatistics(renderingStatus.Statistics, renderingStatus.FrameRenderTime);
+        }
+    }
+    if (const Renderer::FinalImage* image = m_RenderThread->AcquireFinalImage()) {
+        m_Window->ShowImage(image->Pixels.data(), image->Width, image->Height,
+            image->CostHeatmap.empty() ? nullptr : image->CostHeatmap.data());
+    }
 }
 
 void Application::OnUpdate(const float deltaTime) const {
@@ -153,13 +171,26 @@ void Application::OnUpdate(const float deltaTime) const {
 
     if (cameraMoved) {
         m_Window->UpdateCameraLocation(m_Camera->GetPosition(), m_Camera->GetDirection());
-        m_Renderer->ResetFrameIndex();
+        m_RenderThread->Submit(RenderThread::PlaceCameraCommand{m_Camera->GetPosition(), m_Camera->GetDirection()});
+    }
+}
+
+bool Application::eventFilter(QObject* watched, QEvent* event) {
+    if (event->type() == QEvent::KeyPress || event->type() == QEvent::KeyRelease) {
+        const auto* keyEvent = static_cast<const QKeyEvent*>(event);
+        if (const std::optional<Input::Key> key = toInputKey(keyEvent->key()); key && !keyEvent->isAutoRepeat()) {
+            Input::SetKeyPressed(*key, event->type() == QEvent::KeyPress);
+        }
+    } else if (event->type() == QEvent::ApplicationDeactivate) {
+        Input::ReleaseAllKeys();
     }
+    return QObject::eventFilter(watched, event);
 }
 
 void Application::OnCanvasResize(const int width, const int height) const {
-    if (m_Renderer) {
-        m_Renderer->OnResize(width, height);
+    if (m_RenderThread) {
         m_Camera->OnResize(width, height);
+        m_RenderThread->Submit(RenderThread::ResizeCommand{
+            static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
     }
 }
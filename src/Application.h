@@ -1,11 +1,14 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QTimer>
 
 #include "ui/MainWindow.h"
 #include "render/Camera.h"
 #include "render/Renderer.h"
+#include "render/RenderThread.h"
 #include "scene/Scene.h"
 
 class Application : public QObject {
@@ -13,30 +16,35 @@ class Application : public QObject {
 public:
     Application(int argc, char *argv[]);
 
-    ~Application() override = default;
+    ~Application() override;
 
     int Run();
 
-    void SetupScene();
-
-    void OnRender();
+    void OnFrameReady();
 
     void OnUpdate(float deltaTime) const;
 
     void OnCanvasResize(int width, int height) const;
 
+protected:
+    // Passes key presses and releases on to Input, which can't poll the keyboard outside macOS.
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private:
     std::unique_ptr<QApplication> m_QtApplication;
 
     std::unique_ptr<MainWindow> m_Window;
 
-    std::unique_ptr<Renderer> m_Renderer;
-
     std::unique_ptr<Camera> m_Camera;
 
     std::unique_ptr<Scene> m_Scene;
 
-    std::unique_ptr<QTimer> m_RenderTimer;
+    std::unique_ptr<QTimer> m_InputTimer;
+
+    QElapsedTimer m_InputClock;
+
+    std::atomic<bool> m_IsFramePresentPending = false;
 
-    int64_t m_RenderTimeMs;
+    // Declared last so the render thread is stopped before anything it references is destroyed.
+    std::unique_ptr<RenderThread> m_RenderThread;
 };
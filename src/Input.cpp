@@ -1,6 +1,31 @@
 #include "Input.h"
 
+#include <bitset>
+
+#if defined(__APPLE__)
+#include <ApplicationServices/ApplicationServices.h>
+#endif
+
+namespace {
+    // Indexed by key code; only touched from the GUI thread.
+    std::bitset<128> s_PressedKeys;
+}
+
 bool Input::IsKeyPressed(const Key code)
 {
+#if defined(__APPLE__)
     return CGEventSourceKeyState(kCGEventSourceStateCombinedSessionState, static_cast<CGKeyCode>(code));
+#else
+    return s_PressedKeys.test(static_cast<size_t>(code));
+#endif
+}
+
+void Input::SetKeyPressed(const Key code, const bool isPressed)
+{
+    s_PressedKeys.set(static_cast<size_t>(code), isPressed);
+}
+
+void Input::ReleaseAllKeys()
+{
+    s_PressedKeys.reset();
 }
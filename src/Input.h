@@ -1,7 +1,5 @@
 #pragma once
 
-#include <ApplicationServices/ApplicationServices.h>
-
 class Input {
 public:
     enum class Key {
@@ -18,5 +16,12 @@ public:
         ArrowUp    = 126
     };
 
+    // Key codes are macOS virtual key codes. macOS polls the keyboard; other platforms report the
+    // state last given to SetKeyPressed().
     static bool IsKeyPressed(Key code);
+
+    // Key events from the window system, for platforms that can't poll the keyboard.
+    static void SetKeyPressed(Key code, bool isPressed);
+    // Forgets every pressed key, e.g. when the window loses focus and won't see the releases.
+    static void ReleaseAllKeys();
 };
@@ -0,0 +1,48 @@
+#include "Benchmark.h"
+
+#include <utility>
+
+namespace Bench
+{
+    Runner::Runner(const double minTimeSeconds, std::string filter)
+        : m_MinTimeSeconds(minTimeSeconds), m_Filter(std::move(filter))
+    {
+    }
+
+    bool Runner::IsEnabled(const std::string& name) const
+    {
+        return m_Filter.empty() || name.find(m_Filter) != std::string::npos;
+    }
+
+    void Runner::report(Result result)
+    {
+        std::fprintf(stderr, "%-36s %10llu %14.1f ns/op", result.Name.c_str(),
+            static_cast<unsigned long long>(result.Size), result.NsPerOp);
+        if (!result.Unit.empty()) {
+            std::fprintf(stderr, " %12.3f M%s/s", result.Throughput, result.Unit.c_str());
+        }
+        std::fprintf(stderr, "\n");
+        m_Results.push_back(std::move(result));
+    }
+
+    bool Runner::WriteJson(const std::string& fileName) const
+    {
+        FILE* file = std::fopen(fileName.c_str(), "w");
+        if (!file) return false;
+
+        std::fprintf(file, "{\n  \"results\": [\n");
+        for (size_t i = 0; i < m_Results.size(); i++) {
+            const Result& result = m_Results[i];
+            std::fprintf(file,
+                "    {\"name\": \"%s\", \"size\": %llu, \"iterations\": %llu, \"ns_per_op\": %.3f",
+                result.Name.c_str(), static_cast<unsigned long long>(result.Size),
+                static_cast<unsigned long long>(result.Iterations), result.NsPerOp);
+            if (!result.Unit.empty()) {
+                std::fprintf(file, ", \"throughput\": %.6f, \"unit\": \"M%s/s\"", result.Throughput, result.Unit.c_str());
+            }
+            std::fprintf(file, "}%s\n", i + 1 < m_Results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        return std::fclose(file) == 0;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+    // Keeps the compiler from optimizing away a value that is computed only to be measured.
+    template<typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Result
+    {
+        std::string Name;
+        // Primitive count of the scene, or pixel count of the image, the operation ran on.
+        uint64_t Size = 0;
+        uint64_t Iterations = 0;
+        double NsPerOp = 0.0;
+        // Millions of Unit per second; empty Unit when an operation has no natural throughput.
+        double Throughput = 0.0;
+        std::string Unit;
+    };
+
+    // Repeats each operation, doubling the iteration count until a run takes at least the minimum time,
+    // and reports the per-operation time of that run. Results are printed to stderr as they come in.
+    class Runner
+    {
+    public:
+        Runner(double minTimeSeconds, std::string filter);
+
+        // op() performs one operation that processes itemsPerOp items of the given unit.
+        template<typename Operation>
+        void Run(const std::string& name, uint64_t size, double itemsPerOp, const std::string& unit, Operation&& op);
+
+        [[nodiscard]] bool IsEnabled(const std::string& name) const;
+
+        [[nodiscard]] const std::vector<Result>& GetResults() const { return m_Results; }
+
+        // One JSON object with a "results" array, for tracking regressions across releases.
+        bool WriteJson(const std::string& fileName) const;
+
+    private:
+        void report(Result result);
+
+        double m_MinTimeSeconds;
+        std::string m_Filter;
+        std::vector<Result> m_Results;
+    };
+
+    template<typename Operation>
+    void Runner::Run(const std::string& name, const uint64_t size, const double itemsPerOp, const std::string& unit,
+        Operation&& op)
+    {
+        if (!IsEnabled(name)) return;
+
+        using Clock = std::chrono::steady_clock;
+        op(); // warm-up
+        for (uint64_t iterations = 1;; iterations *= 2) {
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                op();
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (seconds >= m_MinTimeSeconds || iterations >= (1ull << 40)) {
+                const double nsPerOp = seconds * 1e9 / static_cast<double>(iterations);
+                report({
+                    .Name = name,
+                    .Size = size,
+                    .Iterations = iterations,
+                    .NsPerOp = nsPerOp,
+                    .Throughput = unit.empty() ? 0.0 : itemsPerOp * 1e3 / nsPerOp,
+                    .Unit = unit,
+                });
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,247 @@
+// Time-to-quality benchmark: renders canonical scenes with several integrator configurations and
+// records how the error against a high-spp reference falls over wall-clock time. Comparing the
+// curves at equal time shows whether a sampling change actually makes renders cheaper.
+//
+//   DazhbogConvergence [--scenes a,b] [--width <px>] [--height <px>] [--time <seconds>]
+//                      [--reference-dir <dir>] [--reference-spp <n>] [--threads <n>] [--csv <file>]
+//
+// References are rendered on first use and stored as PFM files in the reference directory.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "render/FloatImageIO.h"
+#include "render/RenderJob.h"
+#include "scene/SceneLibrary.h"
+
+namespace {
+    struct Options
+    {
+        std::vector<std::string> Scenes = SceneLibrary::GetNames();
+        uint32_t Width = 320;
+        uint32_t Height = 180;
+        double TimeSeconds = 10.0;
+        std::string ReferenceDir = "references";
+        uint32_t ReferenceSamples = 4096;
+        int Threads = 0;
+        std::string CsvPath;
+    };
+
+    struct Configuration
+    {
+        const char* Name;
+        Renderer::RenderMode Mode;
+        int SamplesPerPixel;
+        bool Denoise;
+    };
+
+    constexpr Configuration Configurations[] = {
+        { "hp-1spp", Renderer::RenderMode::HighPerformance, 1, false },
+        { "hq-4spp", Renderer::RenderMode::HighQuality, 4, false },
+        { "hq-16spp", Renderer::RenderMode::HighQuality, 16, false },
+        { "hq-4spp-denoised", Renderer::RenderMode::HighQuality, 4, true },
+    };
+
+    struct ErrorSample
+    {
+        uint64_t ElapsedTime = 0;
+        uint32_t Frames = 0;
+        double RMSE = 0.0;
+        double RelMSE = 0.0;
+    };
+
+    std::vector<std::string> split(const std::string& list) {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= list.size()) {
+            const size_t end = std::min(list.find(',', start), list.size());
+            if (end > start) items.push_back(list.substr(start, end - start));
+            start = end + 1;
+        }
+        return items;
+    }
+
+    template<typename T>
+    bool parseNumber(const char* text, T& value) {
+        const char* end = text + std::strlen(text);
+        const auto [ptr, error] = std::from_chars(text, end, value);
+        return error == std::errc() && ptr == end;
+    }
+
+    bool parseOptions(const int argc, char* argv[], Options& options) {
+        if (argc % 2 == 0) return false;
+        for (int i = 1; i < argc; i += 2) {
+            const std::string arg = argv[i];
+            const char* value = argv[i + 1];
+            bool isValid = true;
+            if (arg == "--scenes") {
+                options.Scenes = split(value);
+            } else if (arg == "--width") {
+                isValid = parseNumber(value, options.Width) && options.Width > 0;
+            } else if (arg == "--height") {
+                isValid = parseNumber(value, options.Height) && options.Height > 0;
+            } else if (arg == "--time") {
+                options.TimeSeconds = std::strtod(value, nullptr);
+                isValid = options.TimeSeconds > 0.0;
+            } else if (arg == "--reference-dir") {
+                options.ReferenceDir = value;
+            } else if (arg == "--reference-spp") {
+                isValid = parseNumber(value, options.ReferenceSamples) && options.ReferenceSamples > 0;
+            } else if (arg == "--threads") {
+                isValid = parseNumber(value, options.Threads) && options.Threads >= 0;
+            } else if (arg == "--csv") {
+                options.CsvPath = value;
+            } else {
+                isValid = false;
+            }
+            if (!isValid) return false;
+        }
+        return true;
+    }
+
+    ErrorSample measureError(const Image& image, const Image& reference) {
+        // relMSE divides by the squared reference plus this, so dark pixels don't dominate.
+        constexpr double relativeEpsilon = 1e-2;
+        double squaredError = 0.0;
+        double relativeError = 0.0;
+        for (int y = 0; y < reference.Height; y++) {
+            for (int x = 0; x < reference.Width; x++) {
+                const glm::vec3 value = glm::vec3(image.GetPixel(x, y));
+                const glm::vec3 expected = glm::vec3(reference.GetPixel(x, y));
+                for (int c = 0; c < 3; c++) {
+                    const double difference = static_cast<double>(value[c]) - expected[c];
+                    squaredError += difference * difference;
+                    relativeError += difference * difference / (static_cast<double>(expected[c]) * expected[c] + relativeEpsilon);
+                }
+            }
+        }
+        const double count = 3.0 * reference.Width * reference.Height;
+        return { .RMSE = std::sqrt(squaredError / count), .RelMSE = relativeError / count };
+    }
+
+    RenderJob::Description makeDescription(const SceneLibrary::Entry& entry, const Options& options) {
+        RenderJob::Description description;
+        description.Scene = entry.Scene.get();
+        description.CameraPosition = entry.CameraPosition;
+        description.CameraDirection = entry.CameraDirection;
+        description.Width = options.Width;
+        description.Height = options.Height;
+        description.Settings.Deterministic = true;
+        description.Settings.ThreadCount = options.Threads;
+        description.CaptureRadiance = true;
+        return description;
+    }
+
+    bool loadOrRenderReference(const std::string& sceneName, const SceneLibrary::Entry& entry, const Options& options,
+        Image& reference) {
+        const std::string fileName = options.ReferenceDir + "/" + sceneName + "_" + std::to_string(options.Width) + "x"
+            + std::to_string(options.Height) + "_" + std::to_string(options.ReferenceSamples) + "spp.pfm";
+        if (ReadPfm(fileName, reference)
+            && reference.Width == static_cast<int>(options.Width) && reference.Height == static_cast<int>(options.Height)) {
+            return true;
+        }
+
+        constexpr int samplesPerFrame = 16;
+        RenderJob::Description description = makeDescription(entry, options);
+        description.Settings.Integrator.RenderMode = Renderer::RenderMode::HighQuality;
+        description.Settings.Integrator.SamplesPerPixel = samplesPerFrame;
+        description.Settings.FramesToAccumulate = static_cast<int>(
+            (options.ReferenceSamples + samplesPerFrame - 1) / samplesPerFrame);
+
+        std::fprintf(stderr, "Rendering reference %s\n", fileName.c_str());
+        RenderJob job(description);
+        job.Start();
+        job.Wait();
+        if (!job.IsFinished()) return false;
+        reference = job.GetResult().Radiance;
+
+        std::error_code error;
+        std::filesystem::create_directories(options.ReferenceDir, error);
+        if (!WritePfm(fileName, reference)) {
+            std::fprintf(stderr, "Failed to store reference %s\n", fileName.c_str());
+        }
+        return true;
+    }
+
+    std::vector<ErrorSample> measureConvergence(const SceneLibrary::Entry& entry, const Configuration& configuration,
+        const Options& options, const Image& reference) {
+        RenderJob::Description description = makeDescription(entry, options);
+        description.Settings.Integrator.RenderMode = configuration.Mode;
+        description.Settings.Integrator.SamplesPerPixel = configuration.SamplesPerPixel;
+        description.Settings.Display.Denoise.Enabled = configuration.Denoise;
+        // Never converges on its own, the time budget ends the run.
+        description.Settings.FramesToAccumulate = 1 << 30;
+
+        std::mutex samplesMutex;
+        std::vector<ErrorSample> samples;
+        RenderJob job(description);
+        job.SetProgressHandler([&](const RenderJob::Progress& progress, const Renderer::FinalImage& image) {
+            ErrorSample sample = measureError(image.Radiance, reference);
+            sample.ElapsedTime = progress.ElapsedTime;
+            sample.Frames = progress.FrameIndex;
+            std::lock_guard lock(samplesMutex);
+            samples.push_back(sample);
+        });
+        job.Start();
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.TimeSeconds));
+        job.Cancel();
+        job.Wait();
+        return samples;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+            "Usage: %s [--scenes a,b] [--width <px>] [--height <px>] [--time <seconds>]\n"
+            "          [--reference-dir <dir>] [--reference-spp <n>] [--threads <n>] [--csv <file>]\n",
+            argv[0]);
+        return 1;
+    }
+
+    FILE* csv = options.CsvPath.empty() ? stdout : std::fopen(options.CsvPath.c_str(), "w");
+    if (!csv) {
+        std::fprintf(stderr, "Failed to open %s\n", options.CsvPath.c_str());
+        return 2;
+    }
+    std::fprintf(csv, "scene,configuration,elapsed_ms,frames,rmse,relmse\n");
+
+    for (const std::string& sceneName : options.Scenes) {
+        const SceneLibrary::Entry entry = SceneLibrary::Create(sceneName);
+        if (!entry.Scene) {
+            std::fprintf(stderr, "Unknown scene '%s'\n", sceneName.c_str());
+            return 1;
+        }
+        Image reference;
+        if (!loadOrRenderReference(sceneName, entry, options, reference)) {
+            std::fprintf(stderr, "Failed to render the reference of '%s'\n", sceneName.c_str());
+            return 2;
+        }
+        for (const Configuration& configuration : Configurations) {
+            const std::vector<ErrorSample> samples = measureConvergence(entry, configuration, options, reference);
+            for (const ErrorSample& sample : samples) {
+                std::fprintf(csv, "%s,%s,%llu,%u,%.6g,%.6g\n", sceneName.c_str(), configuration.Name,
+                    static_cast<unsigned long long>(sample.ElapsedTime), sample.Frames, sample.RMSE, sample.RelMSE);
+            }
+            if (!samples.empty()) {
+                std::fprintf(stderr, "%-10s %-18s %6u frames  RMSE %.5f  relMSE %.5f\n", sceneName.c_str(),
+                    configuration.Name, samples.back().Frames, samples.back().RMSE, samples.back().RelMSE);
+            }
+        }
+    }
+    if (csv != stdout && std::fclose(csv) != 0) {
+        std::fprintf(stderr, "Failed to write %s\n", options.CsvPath.c_str());
+        return 2;
+    }
+    return 0;
+}
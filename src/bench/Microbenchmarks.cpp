@@ -0,0 +1,214 @@
+// Microbenchmarks for the hot paths of the tracer and the post-processing chain.
+//
+//   DazhbogBench [--filter <substring>] [--min-time <seconds>] [--max-primitives <n>] [--json <file>]
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <glm/ext/matrix_transform.hpp>
+
+#include "Benchmark.h"
+#include "ProceduralScenes.h"
+#include "math/Geometry.h"
+#include "math/Random.h"
+#include "render/Camera.h"
+#include "render/ImagePostProcessors.h"
+#include "scene/CompressedMesh.h"
+
+namespace {
+    constexpr uint32_t RayPoolSize = 4096;
+    constexpr int ImageWidth = 1280;
+    constexpr int ImageHeight = 720;
+
+    struct Options
+    {
+        std::string Filter;
+        std::string JsonPath;
+        double MinTimeSeconds = 0.2;
+        uint32_t MaxPrimitives = 1000000;
+    };
+
+    bool parseOptions(const int argc, char* argv[], Options& options) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const std::string arg = argv[i];
+            const char* value = argv[i + 1];
+            const char* end = value + std::strlen(value);
+            if (arg == "--filter") {
+                options.Filter = value;
+            } else if (arg == "--json") {
+                options.JsonPath = value;
+            } else if (arg == "--min-time") {
+                options.MinTimeSeconds = std::strtod(value, nullptr);
+            } else if (arg == "--max-primitives") {
+                if (std::from_chars(value, end, options.MaxPrimitives).ec != std::errc()) return false;
+            } else {
+                return false;
+            }
+        }
+        return argc % 2 == 1;
+    }
+
+    void benchPrimitives(Bench::Runner& runner, const std::vector<Ray>& rays) {
+        uint32_t next = 0;
+        const auto nextRay = [&]() -> const Ray& { return rays[next++ % RayPoolSize]; };
+
+        const Sphere sphere(5.0f, 0, glm::vec3(0.0f));
+        runner.Run("Sphere::Hit", 1, 1.0, "rays", [&] {
+            Bench::DoNotOptimize(sphere.Hit(nextRay(), Interval(0.0f, 1e30f)));
+        });
+
+        const Triangle triangle({-10.0f, -10.0f, 0.0f}, {10.0f, -10.0f, 0.0f}, {0.0f, 10.0f, 0.0f}, 0);
+        runner.Run("Triangle::Hit", 1, 1.0, "rays", [&] {
+            Bench::DoNotOptimize(triangle.Hit(nextRay(), Interval(0.0f, 1e30f)));
+        });
+
+        const Cube cube(glm::scale(glm::mat4(1.0f), glm::vec3(5.0f)), 0);
+        runner.Run("Cube::Hit", 1, 1.0, "rays", [&] {
+            Bench::DoNotOptimize(cube.Hit(nextRay(), Interval(0.0f, 1e30f)));
+        });
+    }
+
+    void benchTraversal(Bench::Runner& runner, const std::vector<Ray>& rays, const uint32_t maxPrimitives) {
+        for (uint32_t count = 10; count <= maxPrimitives; count *= 10) {
+            for (const bool spheres : {true, false}) {
+                const std::string name = std::string("Scene::Intersect/") + (spheres ? "spheres" : "triangles");
+                if (!runner.IsEnabled(name)) continue;
+
+                const auto scene = spheres ? Bench::MakeSphereScene(count) : Bench::MakeTriangleScene(count);
+                uint32_t next = 0;
+                runner.Run(name, count, 1.0, "rays", [&] {
+                    Bench::DoNotOptimize(scene->Intersect(rays[next++ % RayPoolSize]));
+                });
+            }
+        }
+    }
+
+    // Mesh against CompressedMesh at both bound widths: the time per ray next to the bytes per triangle
+    // each one takes.
+    void benchMeshes(Bench::Runner& runner, const std::vector<Ray>& rays, const uint32_t maxPrimitives) {
+        for (uint32_t count = 1000; count <= maxPrimitives; count *= 10) {
+            double meshNsPerOp = 0.0;
+            for (const uint32_t bits : {0u, 8u, 16u}) {
+                const std::string name = bits == 0 ? "Mesh::Hit" : "CompressedMesh::Hit/" + std::to_string(bits);
+                if (!runner.IsEnabled(name)) continue;
+
+                MeshCompression compression;
+                compression.BoundsBits = bits;
+                MeshData data = Bench::MakeMesh(count);
+                const auto triangleCount = static_cast<double>(data.Triangles.size());
+                size_t memoryUsage = 0;
+                const auto mesh = CreateMesh(std::move(data), 0, bits == 0 ? nullptr : &compression, memoryUsage);
+                uint32_t next = 0;
+                runner.Run(name, count, 1.0, "rays", [&] {
+                    Bench::DoNotOptimize(mesh->Hit(rays[next++ % RayPoolSize], Interval(0.0f, 1e30f)));
+                });
+                const double nsPerOp = runner.GetResults().back().NsPerOp;
+                std::fprintf(stderr, "%-36s %.1f bytes/triangle", "", static_cast<double>(memoryUsage) / triangleCount);
+                if (bits == 0) {
+                    meshNsPerOp = nsPerOp;
+                } else if (meshNsPerOp > 0.0) {
+                    std::fprintf(stderr, ", %.2fx the time of Mesh", nsPerOp / meshNsPerOp);
+                }
+                std::fprintf(stderr, "\n");
+            }
+        }
+    }
+
+    void benchSampling(Bench::Runner& runner) {
+        uint32_t seed = 1;
+        runner.Run("Random::RandomFloat", 1, 1.0, "samples", [&] {
+            Bench::DoNotOptimize(Utils::Random::RandomFloat(seed));
+        });
+        runner.Run("Random::InUnitSphere", 1, 1.0, "samples", [&] {
+            Bench::DoNotOptimize(Utils::Random::InUnitSphere(seed));
+        });
+        uint32_t pixel = 0;
+        runner.Run("Random::SeedHash", 1, 1.0, "samples", [&] {
+            Bench::DoNotOptimize(Utils::Random::SeedHash(pixel % ImageWidth, pixel / ImageWidth, 0, 1));
+            pixel++;
+        });
+
+        Camera camera(45.0f, 0.1f, 100.0f, glm::vec2(ImageWidth, ImageHeight));
+        camera.PlaceInWorld({0.0f, 0.0f, 10.0f}, {0.0f, 0.0f, -1.0f});
+        runner.Run("Camera::GetRay", 1, 1.0, "rays", [&] {
+            Bench::DoNotOptimize(camera.GetRay(static_cast<float>(pixel % ImageWidth),
+                static_cast<float>(pixel / ImageWidth % ImageHeight)));
+            pixel++;
+        });
+    }
+
+    void benchPostProcessing(Bench::Runner& runner) {
+        constexpr uint64_t pixelCount = static_cast<uint64_t>(ImageWidth) * ImageHeight;
+        Image input;
+        input.Resize(ImageWidth, ImageHeight);
+        Image albedo;
+        albedo.Resize(ImageWidth, ImageHeight);
+        Image normalDepth;
+        normalDepth.Resize(ImageWidth, ImageHeight);
+        uint32_t seed = 1;
+        for (int y = 0; y < ImageHeight; y++) {
+            for (int x = 0; x < ImageWidth; x++) {
+                // An accumulation of 16 frames of HDR radiance.
+                input.SetPixel(x, y, glm::vec4(16.0f * 4.0f * Utils::Random::RandomFloat(seed),
+                    16.0f * Utils::Random::RandomFloat(seed), 16.0f * Utils::Random::RandomFloat(seed), 16.0f));
+                albedo.SetPixel(x, y, glm::vec4(8.0f, 8.0f, 8.0f, 16.0f));
+                normalDepth.SetPixel(x, y, glm::vec4(0.0f, 0.0f, 16.0f, 160.0f));
+            }
+        }
+        Image output;
+
+        AverageFramesProcessor average;
+        runner.Run("AverageFramesProcessor", pixelCount, pixelCount, "pixels", [&] {
+            average.ProcessImage(input, output);
+        });
+        GammaCorrectionProcessor gamma(2.2f);
+        runner.Run("GammaCorrectionProcessor", pixelCount, pixelCount, "pixels", [&] {
+            gamma.ProcessImage(input, output);
+        });
+        HDRProcessor hdr(-0.5f);
+        runner.Run("HDRProcessor", pixelCount, pixelCount, "pixels", [&] {
+            hdr.ProcessImage(input, output);
+        });
+        TonemapACESProcessor tonemap;
+        runner.Run("TonemapACESProcessor", pixelCount, pixelCount, "pixels", [&] {
+            tonemap.ProcessImage(input, output);
+        });
+        BloomProcessor bloom;
+        runner.Run("BloomProcessor", pixelCount, pixelCount, "pixels", [&] {
+            // The bloom layer is cached between calls; measure the full rebuild.
+            bloom.Invalidate();
+            bloom.ProcessImage(input, output);
+        });
+        DenoiseProcessor denoise;
+        runner.Run("DenoiseProcessor", pixelCount, pixelCount, "pixels", [&] {
+            denoise.SetFeatures(albedo, normalDepth);
+            denoise.ProcessImage(input, output);
+        });
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+            "Usage: %s [--filter <substring>] [--min-time <seconds>] [--max-primitives <n>] [--json <file>]\n",
+            argv[0]);
+        return 1;
+    }
+
+    Bench::Runner runner(options.MinTimeSeconds, options.Filter);
+    const std::vector<Ray> rays = Bench::MakeRays(RayPoolSize);
+
+    benchPrimitives(runner, rays);
+    benchTraversal(runner, rays, options.MaxPrimitives);
+    benchMeshes(runner, rays, options.MaxPrimitives);
+    benchSampling(runner);
+    benchPostProcessing(runner);
+
+    if (!options.JsonPath.empty() && !runner.WriteJson(options.JsonPath)) {
+        std::fprintf(stderr, "Failed to write %s\n", options.JsonPath.c_str());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "ProceduralScenes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/scalar_constants.hpp>
+
+#include "math/Geometry.h"
+#include "math/Random.h"
+#include "render/Material.h"
+
+namespace Bench
+{
+    namespace
+    {
+        glm::vec3 randomPoint(uint32_t& seed, const float extent)
+        {
+            return {
+                Utils::Random::RandomFloat(seed, -extent, extent),
+                Utils::Random::RandomFloat(seed, -extent, extent),
+                Utils::Random::RandomFloat(seed, -extent, extent),
+            };
+        }
+
+        // Keeps the total surface roughly constant as the count grows.
+        float primitiveSize(const uint32_t count)
+        {
+            return 2.0f * SceneExtent / std::cbrt(static_cast<float>(std::max(count, 1u))) * 0.25f;
+        }
+    }
+
+    std::unique_ptr<Scene> MakeSphereScene(const uint32_t count, uint32_t seed)
+    {
+        auto scene = std::make_unique<Scene>();
+        const auto material = scene->Add(new LambertMaterial({0.5f, 0.5f, 0.5f}));
+        const float radius = primitiveSize(count);
+        std::vector<Sphere> spheres;
+        spheres.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            spheres.emplace_back(radius, material, randomPoint(seed, SceneExtent));
+        }
+        scene->AddSpheres(std::move(spheres));
+        scene->Commit();
+        return scene;
+    }
+
+    std::unique_ptr<Scene> MakeTriangleScene(const uint32_t count, uint32_t seed)
+    {
+        auto scene = std::make_unique<Scene>();
+        const auto material = scene->Add(new LambertMaterial({0.5f, 0.5f, 0.5f}));
+        const float size = primitiveSize(count);
+        std::vector<Triangle> triangles;
+        triangles.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const glm::vec3 a = randomPoint(seed, SceneExtent);
+            triangles.emplace_back(a, a + randomPoint(seed, size), a + randomPoint(seed, size), material);
+        }
+        scene->AddTriangles(std::move(triangles));
+        scene->Commit();
+        return scene;
+    }
+
+    MeshData MakeMesh(const uint32_t count, uint32_t seed)
+    {
+        // Rings from pole to pole and twice as many segments around, 4 * rings^2 triangles; the pole
+        // quads degenerate into zero-area triangles, which the mesh tolerates.
+        const auto rings = static_cast<uint32_t>(std::max(2.0f, std::round(std::sqrt(static_cast<float>(count) / 4.0f))));
+        const uint32_t segments = 2 * rings;
+        MeshData data;
+        data.Positions.reserve(static_cast<size_t>(rings + 1) * (segments + 1));
+        for (uint32_t ring = 0; ring <= rings; ring++) {
+            const float theta = glm::pi<float>() * static_cast<float>(ring) / static_cast<float>(rings);
+            const size_t first = data.Positions.size();
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                const float phi = 2.0f * glm::pi<float>() * static_cast<float>(segment) / static_cast<float>(segments);
+                const float radius = SceneExtent * (0.8f + 0.02f * Utils::Random::RandomFloat(seed));
+                data.Positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta),
+                    std::sin(theta) * std::sin(phi)));
+            }
+            // The seam column repeats the first one exactly, so the surface stays closed.
+            data.Positions.push_back(data.Positions[first]);
+        }
+        data.Triangles.reserve(static_cast<size_t>(4) * rings * rings);
+        for (uint32_t ring = 0; ring < rings; ring++) {
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                const uint32_t a = ring * (segments + 1) + segment;
+                const uint32_t b = a + segments + 1;
+                data.Triangles.emplace_back(a, b, a + 1);
+                data.Triangles.emplace_back(a + 1, b, b + 1);
+            }
+        }
+        return data;
+    }
+
+    std::vector<Ray> MakeRays(const uint32_t count, uint32_t seed)
+    {
+        std::vector<Ray> rays;
+        rays.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const glm::vec3 origin = 2.0f * SceneExtent * glm::normalize(Utils::Random::InUnitSphere(seed) + glm::vec3(1e-4f));
+            rays.emplace_back(origin, randomPoint(seed, SceneExtent) - origin);
+        }
+        return rays;
+    }
+}
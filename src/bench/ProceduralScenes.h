@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "math/Hittable.h"
+#include "scene/Mesh.h"
+#include "scene/Scene.h"
+
+// Reproducible synthetic scenes for benchmarks. Primitives are scattered through a cube of the given
+// half extent around the origin and sized so that the scene stays about equally dense at every count.
+// The scenes come committed, so Scene::Intersect() goes through the BVH.
+namespace Bench
+{
+    inline constexpr float SceneExtent = 20.0f;
+
+    std::unique_ptr<Scene> MakeSphereScene(uint32_t count, uint32_t seed = 1);
+
+    std::unique_ptr<Scene> MakeTriangleScene(uint32_t count, uint32_t seed = 1);
+
+    // A closed sphere of about count triangles filling the scene cube, its surface randomly displaced
+    // like a scanned model.
+    MeshData MakeMesh(uint32_t count, uint32_t seed = 1);
+
+    // Rays from points around the scene towards random points inside it.
+    std::vector<Ray> MakeRays(uint32_t count, uint32_t seed = 1);
+}
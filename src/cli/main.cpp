@@ -0,0 +1,581 @@
+// Headless batch renderer: renders one scene to convergence and writes the post-processed image.
+// Meant for render farms and scripts, so it needs neither Qt nor a display.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tbb/global_control.h>
+
+#include "render/FloatImageIO.h"
+#include "render/ImagePostProcessors.h"
+#include "render/RenderJob.h"
+#include "render/Texture.h"
+#include "scene/SceneCache.h"
+#include "scene/SceneLibrary.h"
+#include "utils/Profiler.h"
+
+#if DAZHBOG_DISTRIBUTED
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "distributed/TileCoordinator.h"
+#include "distributed/TileWorker.h"
+
+extern char** environ;
+#endif
+
+namespace {
+#if DAZHBOG_DISTRIBUTED
+    // A distributed render gives up when no worker is connected for this long.
+    constexpr int WorkerTimeoutMs = 30000;
+#endif
+
+
+    struct Options
+    {
+        std::string SceneName = "demo";
+        std::string OutputPath = "render.png";
+        std::string TracePath;
+        std::string CheckpointPath;
+        int CheckpointInterval = 32;
+        // 0 takes the value from the scene file, or the default below if it has none.
+        int Width = 0;
+        int Height = 0;
+        int SamplesPerPixel = 0;
+        int RayBounces = 0;
+        int Frames = 0;
+        int Threads = 0;
+        // BVH bound bits of a compressed .obj/.ply mesh; 0 keeps it uncompressed.
+        int MeshCompressionBits = 0;
+        // Megabytes of a streamed .obj/.ply mesh kept resident; 0 loads it whole.
+        int MeshStreamingBudgetMb = 0;
+        // Megabytes of decoded texture tiles each thread keeps; 0 leaves TextureCache's default.
+        int TextureCacheMb = 0;
+        bool Quiet = false;
+        bool UseSceneCache = true;
+        bool VerifyDeterminism = false;
+        bool ShowHelp = false;
+        // Run as a worker of the coordinator at this address.
+        std::string WorkerAddress;
+        // Render as a coordinator listening at this address, and start this many workers locally.
+        std::string CoordinatorAddress;
+        int LocalWorkers = 0;
+    };
+
+    void printUsage(const char* program, FILE* stream) {
+        std::fprintf(stream,
+            "Usage: %s [options]\n"
+            "  --scene <name>      built-in scene, .dzs scene file or .obj/.ply mesh to render\n"
+            "                      (default: demo); the options below override the settings in the file\n"
+            "  --no-scene-cache    parse the scene file even if its binary cache (.dzc) is current,\n"
+            "                      and don't write one\n"
+            "  --compress-meshes <bits>  store an .obj/.ply mesh quantized, with 8 or 16-bit BVH bounds\n"
+            "  --stream-meshes <MB>      stream an .obj/.ply mesh from its page file (.dzp), keeping at\n"
+            "                            most this much of it in memory\n"
+            "  --texture-cache <MB>      decoded texture tiles each thread keeps (default: 16)\n"
+            "  --width <px>        image width (default: 1280)\n"
+            "  --height <px>       image height (default: 720)\n"
+            "  --spp <n>           samples per pixel per frame (default: 16)\n"
+            "  --bounces <n>       maximum ray bounces (default: 5)\n"
+            "  --frames <n>        frames to accumulate (default: 50)\n"
+            "  --threads <n>       worker threads, 0 uses every core (default: 0)\n"
+            "  --output <path>     file to write (default: render.png); .exr and .pfm keep the linear\n"
+            "                      radiance before bloom and tone mapping\n"
+            "  --checkpoint <path> save progress there and resume from it when restarted\n"
+            "  --checkpoint-interval <n>  frames between checkpoints (default: 32)\n"
+            "  --trace <path>      write a Chrome trace (needs a DAZHBOG_PROFILING build)\n"
+            "  --verify-determinism  render with 1, 4 and every core and check the images are\n"
+            "                      bit-identical instead of writing one\n"
+#if DAZHBOG_DISTRIBUTED
+            "  --distribute <address>  hand tiles to worker processes connecting to unix:<path>\n"
+            "                      or <host>:<port>\n"
+            "  --local-workers <n> start n workers on this machine (default address: a Unix socket)\n"
+            "  --worker <address>  render tiles for the coordinator at address\n"
+#endif
+            "  --quiet             don't print progress\n"
+            "  -h, --help          print this help\n",
+            program);
+    }
+
+    bool parseInt(const char* text, int& value, const int minValue) {
+        const char* end = text + std::strlen(text);
+        const auto [ptr, error] = std::from_chars(text, end, value);
+        return error == std::errc() && ptr == end && value >= minValue;
+    }
+
+    bool parseOptions(const int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--quiet") {
+                options.Quiet = true;
+                continue;
+            }
+            if (arg == "--no-scene-cache") {
+                options.UseSceneCache = false;
+                continue;
+            }
+            if (arg == "--verify-determinism") {
+                options.VerifyDeterminism = true;
+                continue;
+            }
+            if (arg == "-h" || arg == "--help") {
+                options.ShowHelp = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+                return false;
+            }
+            const char* value = argv[++i];
+            bool isValid = true;
+            if (arg == "--scene") {
+                options.SceneName = value;
+            } else if (arg == "--output") {
+                options.OutputPath = value;
+            } else if (arg == "--checkpoint") {
+                options.CheckpointPath = value;
+            } else if (arg == "--checkpoint-interval") {
+                isValid = parseInt(value, options.CheckpointInterval, 1);
+            } else if (arg == "--trace") {
+#if DAZHBOG_PROFILING
+                options.TracePath = value;
+#else
+                // Without the zones compiled in the trace would be empty.
+                std::fprintf(stderr, "--trace needs a build with -DDAZHBOG_PROFILING=ON\n");
+                return false;
+#endif
+            } else if (arg == "--width") {
+                isValid = parseInt(value, options.Width, 1);
+            } else if (arg == "--height") {
+                isValid = parseInt(value, options.Height, 1);
+            } else if (arg == "--spp") {
+                isValid = parseInt(value, options.SamplesPerPixel, 1);
+            } else if (arg == "--bounces") {
+                isValid = parseInt(value, options.RayBounces, 1);
+            } else if (arg == "--frames") {
+                isValid = parseInt(value, options.Frames, 1);
+            } else if (arg == "--threads") {
+                isValid = parseInt(value, options.Threads, 0);
+            } else if (arg == "--compress-meshes") {
+                isValid = parseInt(value, options.MeshCompressionBits, 8) &&
+                    (options.MeshCompressionBits == 8 || options.MeshCompressionBits == 16);
+            } else if (arg == "--stream-meshes") {
+                isValid = parseInt(value, options.MeshStreamingBudgetMb, 1);
+            } else if (arg == "--texture-cache") {
+                isValid = parseInt(value, options.TextureCacheMb, 1);
+#if DAZHBOG_DISTRIBUTED
+            } else if (arg == "--worker") {
+                options.WorkerAddress = value;
+            } else if (arg == "--distribute") {
+                options.CoordinatorAddress = value;
+            } else if (arg == "--local-workers") {
+                isValid = parseInt(value, options.LocalWorkers, 1);
+#endif
+            } else {
+                std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+                return false;
+            }
+            if (!isValid) {
+                std::fprintf(stderr, "Invalid value '%s' for %s\n", value, arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // How an .obj/.ply scene is kept, from --compress-meshes and --stream-meshes.
+    SceneLibrary::MeshOptions getMeshOptions(const Options& options) {
+        SceneLibrary::MeshOptions meshOptions;
+        if (options.MeshCompressionBits > 0) {
+            meshOptions.Compression.emplace().BoundsBits = static_cast<uint32_t>(options.MeshCompressionBits);
+        }
+        meshOptions.StreamingBudget = static_cast<uint64_t>(options.MeshStreamingBudgetMb) << 20;
+        return meshOptions;
+    }
+
+    void printLoadStatistics(const std::string& fileName, const SceneCache::Statistics& statistics,
+        const Scene& scene) {
+        constexpr double Megabyte = 1024.0 * 1024.0;
+        const auto primitives = static_cast<unsigned long long>(scene.GetPrimitiveCount());
+        if (statistics.IsHit) {
+            std::fprintf(stderr, "Loaded %s from its cache: %llu primitives, %.1f MB mapped, hash %.1f ms, map %.1f ms\n",
+                fileName.c_str(), primitives, static_cast<double>(statistics.CacheSize) / Megabyte,
+                statistics.HashTimeMs, statistics.MapTimeMs);
+            return;
+        }
+        const SceneFile::LoadStatistics& parse = statistics.Parse;
+        std::fprintf(stderr, "Loaded %s: %llu primitives, %.1f MB, read %.1f ms, parse %.1f ms, BVH %.1f ms\n",
+            fileName.c_str(), primitives, static_cast<double>(parse.FileSize) / Megabyte,
+            statistics.HashTimeMs + parse.ReadTimeMs, parse.ParseTimeMs, parse.BuildTimeMs);
+        if (parse.MeshTriangleCount > 0) {
+            std::fprintf(stderr, "Imported %llu mesh triangles in %.1f ms, %.1f bytes per triangle\n",
+                static_cast<unsigned long long>(parse.MeshTriangleCount), parse.MeshImportTimeMs,
+                static_cast<double>(parse.MeshMemoryUsage) / static_cast<double>(parse.MeshTriangleCount));
+        }
+        if (parse.TextureCount > 0) {
+            std::fprintf(stderr, "Loaded %u textures in %.1f ms\n", parse.TextureCount, parse.TextureLoadTimeMs);
+        }
+        if (statistics.IsWritten) {
+            std::fprintf(stderr, "Wrote %s (%.1f MB) for the next load\n", SceneCache::GetCachePath(fileName).c_str(),
+                static_cast<double>(statistics.CacheSize) / Megabyte);
+        }
+    }
+
+    void printImportStatistics(const std::string& fileName, const SceneLibrary::MeshStatistics& statistics) {
+        constexpr double Megabyte = 1024.0 * 1024.0;
+        const MeshImporter::Statistics& import = statistics.Import;
+        std::fprintf(stderr, "Imported %s: %llu triangles, %llu vertices, %.1f MB in %.1f ms (%.1f Mtris/s), BVH %.1f ms\n",
+            fileName.c_str(), static_cast<unsigned long long>(import.TriangleCount),
+            static_cast<unsigned long long>(import.VertexCount), static_cast<double>(import.FileSize) / Megabyte,
+            import.ParseTimeMs, static_cast<double>(import.TriangleCount) / (import.ParseTimeMs * 1000.0),
+            statistics.BuildTimeMs);
+        std::fprintf(stderr, "Mesh data: %.1f MB, %.1f bytes per triangle\n",
+            static_cast<double>(statistics.MemoryUsage) / Megabyte,
+            static_cast<double>(statistics.MemoryUsage) / static_cast<double>(import.TriangleCount));
+        if (statistics.PageFileSize > 0) {
+            std::fprintf(stderr, "%s %s (%.1f MB)\n", statistics.IsPageFileWritten ? "Wrote" : "Mapped",
+                PagedMesh::GetPageFilePath(fileName).c_str(), static_cast<double>(statistics.PageFileSize) / Megabyte);
+        }
+    }
+
+    void printTextureStatistics() {
+        constexpr double Megabyte = 1024.0 * 1024.0;
+        const TextureCache::Statistics statistics = TextureCache::GetStatistics();
+        if (statistics.Lookups == 0) return;
+        std::fprintf(stderr, "Texture tiles: %llu lookups, %.2f%% misses, %llu evictions, %.1f MB decoded over %u threads\n",
+            static_cast<unsigned long long>(statistics.Lookups),
+            100.0 * static_cast<double>(statistics.Misses) / static_cast<double>(statistics.Lookups),
+            static_cast<unsigned long long>(statistics.Evictions),
+            static_cast<double>(statistics.ResidentBytes) / Megabyte, statistics.ThreadCount);
+    }
+
+    void printStreamingStatistics(const MeshPageCache& pageCache) {
+        constexpr double Megabyte = 1024.0 * 1024.0;
+        const MeshPageCache::Statistics statistics = pageCache.GetStatistics();
+        std::fprintf(stderr, "Mesh pages: %llu of %.1f MB, peak %.1f MB resident",
+            static_cast<unsigned long long>(statistics.PageCount), static_cast<double>(statistics.MappedBytes) / Megabyte,
+            static_cast<double>(statistics.PeakResidentBytes) / Megabyte);
+        if (statistics.ResidentBudget > 0) {
+            std::fprintf(stderr, " of %.1f MB", static_cast<double>(statistics.ResidentBudget) / Megabyte);
+        }
+        std::fprintf(stderr, ", %llu faults (%llu prefetched), %llu evictions\n",
+            static_cast<unsigned long long>(statistics.PageFaults),
+            static_cast<unsigned long long>(statistics.PrefetchHits),
+            static_cast<unsigned long long>(statistics.Evictions));
+    }
+
+    // The command line wins over the scene file, which wins over the built-in default; 0 means unset.
+    int chooseSetting(const int option, const int sceneValue, const int defaultValue) {
+        return option > 0 ? option : sceneValue > 0 ? sceneValue : defaultValue;
+    }
+
+    bool hasExtension(const std::string& path, const std::string& extension) {
+        return path.size() >= extension.size()
+            && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    }
+
+    bool writeOutput(const std::string& path, const Renderer::FinalImage& image) {
+        if (hasExtension(path, ".exr")) {
+            std::vector<ExrChannel> channels;
+            AddExrChannels(channels, image.Radiance, {"R", "G", "B"});
+            return WriteExr(path, channels);
+        }
+        if (hasExtension(path, ".pfm")) {
+            return WritePfm(path, image.Radiance);
+        }
+        return WritePngRGBA8(path, image.Pixels.data(), image.Width, image.Height);
+    }
+
+    // Index of the first pixel that differs bit-wise, or -1.
+    int64_t findMismatch(const Renderer::FinalImage& reference, const Renderer::FinalImage& image) {
+        const size_t pixelCount = static_cast<size_t>(reference.Width) * reference.Height;
+        for (size_t i = 0; i < pixelCount; i++) {
+            if (reference.Pixels[i] != image.Pixels[i]
+                || std::memcmp(&reference.Radiance.Data[i], &image.Radiance.Data[i], sizeof(glm::vec4)) != 0) {
+                return static_cast<int64_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Renders the same job with different thread counts; any difference means some result depends on
+    // scheduling. Checkpoints are left out, a resumed run would not render anything.
+    int verifyDeterminism(RenderJob::Description description, const bool isQuiet) {
+        description.Settings.Deterministic = true;
+        description.CaptureRadiance = true;
+        description.CheckpointPath.clear();
+
+        // TBB caps every arena at the core count, which would run all three renders on one thread on a
+        // single-core machine. Lifting the cap oversubscribes small machines, so 4 threads really interleave.
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        const tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism,
+            static_cast<size_t>(std::max(cores, 4)));
+        std::vector<int> threadCounts{1, 4};
+        if (cores > 4) {
+            threadCounts.push_back(cores);
+        }
+        Renderer::FinalImage reference;
+        bool isIdentical = true;
+        for (const int threads : threadCounts) {
+            description.Settings.ThreadCount = threads;
+            RenderJob job(description);
+            job.Start();
+            job.Wait();
+            if (!job.IsFinished()) {
+                std::fprintf(stderr, "Rendering with %d threads failed\n", threads);
+                return 2;
+            }
+            const Renderer::FinalImage& image = job.GetResult();
+            if (threads == 1) {
+                reference = image;
+                continue;
+            }
+            const int64_t mismatch = image.Width == reference.Width && image.Height == reference.Height
+                ? findMismatch(reference, image) : 0;
+            if (mismatch >= 0) {
+                std::fprintf(stderr, "%d threads: differs from 1 thread at pixel (%lld, %lld)\n", threads,
+                    static_cast<long long>(mismatch % reference.Width), static_cast<long long>(mismatch / reference.Width));
+                isIdentical = false;
+            } else if (!isQuiet) {
+                std::fprintf(stderr, "%d threads: identical to 1 thread\n", threads);
+            }
+        }
+        return isIdentical ? 0 : 3;
+    }
+
+#if DAZHBOG_DISTRIBUTED
+    // Starts this executable again as workers of the coordinator at address, sharing the cores.
+    std::vector<pid_t> spawnLocalWorkers(const char* program, const std::string& address, const int count,
+        const int threads) {
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        const std::string threadsText = std::to_string(threads > 0 ? threads : std::max(1, cores / count));
+        std::vector<pid_t> workers;
+        for (int i = 0; i < count; i++) {
+            const char* arguments[] = {program, "--worker", address.c_str(), "--threads", threadsText.c_str(), nullptr};
+            pid_t pid = 0;
+            if (posix_spawnp(&pid, program, nullptr, nullptr, const_cast<char* const*>(arguments), environ) == 0) {
+                workers.push_back(pid);
+            } else {
+                std::fprintf(stderr, "Failed to start worker %d\n", i);
+            }
+        }
+        return workers;
+    }
+
+    // Renders the job's tiles on workers, then post-processes the merged accumulation here. The
+    // accumulation is the one a local deterministic render of the same frames produces, bit for bit.
+    bool renderDistributed(const RenderJob::Description& description, const Options& options, const char* program,
+        Renderer::FinalImage& result) {
+        TileProtocol::JobDescription job;
+        job.SceneName = options.SceneName;
+        job.SceneHash = description.Scene->Hash();
+        job.MeshOptions = getMeshOptions(options);
+        job.CameraPosition = description.CameraPosition;
+        job.CameraDirection = description.CameraDirection;
+        job.VerticalFOV = description.VerticalFOV;
+        job.Width = description.Width;
+        job.Height = description.Height;
+        job.Integrator = description.Settings.Integrator;
+        job.FrameCount = static_cast<uint32_t>(description.Settings.FramesToAccumulate);
+
+        const std::string address = !options.CoordinatorAddress.empty() ? options.CoordinatorAddress
+            : "unix:/tmp/dazhbog-" + std::to_string(getpid()) + ".sock";
+        TileCoordinator coordinator(job);
+        if (!coordinator.Listen(address)) {
+            std::fprintf(stderr, "Can't listen at %s\n", address.c_str());
+            return false;
+        }
+        if (!options.Quiet) {
+            const auto startTime = std::chrono::steady_clock::now();
+            coordinator.SetProgressHandler([startTime](const TileCoordinator::Progress& progress) {
+                const auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime).count();
+                const double raysPerSecond = static_cast<double>(progress.Statistics.GetRays())
+                    / (static_cast<double>(std::max<int64_t>(elapsedTime, 1)) / 1000.0);
+                std::fprintf(stderr, "\rTile %u/%u (%u workers, %.2f Mrays/s)", progress.MergedTiles,
+                    progress.TileCount, progress.Workers, raysPerSecond / 1e6);
+            });
+            std::fprintf(stderr, "Waiting for workers at %s\n", address.c_str());
+        }
+        const std::vector<pid_t> workers = options.LocalWorkers > 0
+            ? spawnLocalWorkers(program, address, options.LocalWorkers, options.Threads) : std::vector<pid_t>();
+        const bool isRendered = coordinator.Run(WorkerTimeoutMs);
+        for (const pid_t worker : workers) {
+            waitpid(worker, nullptr, 0);
+        }
+        if (!isRendered) {
+            std::fprintf(stderr, "\nNo workers left to render the remaining tiles\n");
+            return false;
+        }
+
+        const glm::vec2 size(static_cast<float>(description.Width), static_cast<float>(description.Height));
+        Camera camera(description.VerticalFOV, 0.1f, 100.0f, size);
+        camera.PlaceInWorld(description.CameraPosition, description.CameraDirection);
+        Renderer renderer(&camera, description.Scene, size);
+        renderer.SetSettings(description.Settings);
+        renderer.SetRadianceOutput(description.CaptureRadiance);
+        const Renderer::RegionAccumulation& accumulation = coordinator.GetResult();
+        if (!renderer.SetAccumulation(accumulation.Accumulation, accumulation.Albedo, accumulation.NormalDepth,
+            job.FrameCount)) {
+            return false;
+        }
+        renderer.Render();
+        renderer.WaitForPostProcessing();
+        const Renderer::FinalImage* image = renderer.AcquireFinalImage();
+        if (!image) {
+            return false;
+        }
+        result = *image;
+        return true;
+    }
+#endif
+}
+
+int main(const int argc, char* argv[]) {
+    // Startup covers loading the scene and preparing the renderer, which dominate short renders.
+    const auto processStartTime = std::chrono::steady_clock::now();
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0], stderr);
+        return 1;
+    }
+    if (options.ShowHelp) {
+        printUsage(argv[0], stdout);
+        return 0;
+    }
+
+#if DAZHBOG_DISTRIBUTED
+    if (!options.WorkerAddress.empty()) {
+        // The coordinator sends the scene's name and hash, the camera and the integrator settings; the
+        // worker builds the scene itself.
+        TileWorker worker(options.WorkerAddress, options.Threads);
+        return worker.Run() ? 0 : 2;
+    }
+#endif
+
+    if (options.TextureCacheMb > 0) {
+        TextureCache::SetThreadBudget(static_cast<uint64_t>(options.TextureCacheMb) << 20);
+    }
+
+    SceneLibrary::Entry entry;
+    if (SceneFile::IsSceneFile(options.SceneName)) {
+        SceneCache::Statistics statistics;
+        std::string error;
+        const bool isLoaded = options.UseSceneCache
+            ? SceneCache::Load(options.SceneName, entry, error, &statistics)
+            : SceneFile::Load(options.SceneName, entry, error, &statistics.Parse);
+        if (!isLoaded) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!options.Quiet) {
+            printLoadStatistics(options.SceneName, statistics, *entry.Scene);
+        }
+    } else if (MeshImporter::IsMeshFile(options.SceneName)) {
+        SceneLibrary::MeshStatistics statistics;
+        std::string error;
+        if (!SceneLibrary::CreateFromMesh(options.SceneName, entry, error, getMeshOptions(options), &statistics)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!options.Quiet) {
+            printImportStatistics(options.SceneName, statistics);
+        }
+    } else {
+        entry = SceneLibrary::Create(options.SceneName);
+    }
+    if (!entry.Scene) {
+        std::fprintf(stderr, "Unknown scene '%s', available:", options.SceneName.c_str());
+        for (const std::string& name : SceneLibrary::GetNames()) {
+            std::fprintf(stderr, " %s", name.c_str());
+        }
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+
+    const bool isFloatOutput = hasExtension(options.OutputPath, ".exr") || hasExtension(options.OutputPath, ".pfm");
+
+    RenderJob::Description description;
+    description.Scene = entry.Scene.get();
+    description.CameraPosition = entry.CameraPosition;
+    description.CameraDirection = entry.CameraDirection;
+    description.VerticalFOV = entry.VerticalFOV;
+    description.Width = static_cast<uint32_t>(chooseSetting(options.Width, static_cast<int>(entry.Width), 1280));
+    description.Height = static_cast<uint32_t>(chooseSetting(options.Height, static_cast<int>(entry.Height), 720));
+    description.Settings.Integrator.RenderMode = Renderer::RenderMode::HighQuality;
+    description.Settings.Integrator.SamplesPerPixel = chooseSetting(options.SamplesPerPixel, entry.SamplesPerPixel, 16);
+    description.Settings.Integrator.RayBounces = chooseSetting(options.RayBounces, entry.RayBounces, 5);
+    description.Settings.FramesToAccumulate = chooseSetting(options.Frames, entry.Frames, 50);
+    description.Settings.Deterministic = true;
+    description.Settings.ThreadCount = options.Threads;
+    description.CaptureRadiance = isFloatOutput;
+    description.CheckpointPath = options.CheckpointPath;
+    description.CheckpointInterval = static_cast<uint32_t>(options.CheckpointInterval);
+    if (options.VerifyDeterminism) {
+        return verifyDeterminism(description, options.Quiet);
+    }
+#if DAZHBOG_DISTRIBUTED
+    if (!options.CoordinatorAddress.empty() || options.LocalWorkers > 0) {
+        const auto startTime = std::chrono::steady_clock::now();
+        Renderer::FinalImage image;
+        if (!renderDistributed(description, options, argv[0], image) || !writeOutput(options.OutputPath, image)) {
+            std::fprintf(stderr, "\nFailed to write %s\n", options.OutputPath.c_str());
+            return 2;
+        }
+        if (!options.Quiet) {
+            std::fprintf(stderr, "\nRendered %s in %lld ms\n", options.OutputPath.c_str(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime).count()));
+        }
+        return 0;
+    }
+#endif
+
+    RenderJob job(description);
+    if (!options.Quiet) {
+        if (job.IsResumed()) {
+            std::fprintf(stderr, "Resuming from %s\n", options.CheckpointPath.c_str());
+        }
+        std::fprintf(stderr, "Startup took %lld ms\n", static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - processStartTime).count()));
+    }
+    if (!options.Quiet) {
+        job.SetProgressHandler([](const RenderJob::Progress& progress, const Renderer::FinalImage&) {
+            const double raysPerSecond = static_cast<double>(progress.Statistics.GetRays())
+                / (static_cast<double>(std::max<uint64_t>(progress.ElapsedTime, 1)) / 1000.0);
+            std::fprintf(stderr, "\rFrame %u (%3.0f%%, %llu ms/frame, %.2f Mrays/s, %.1f tests/ray)", progress.FrameIndex,
+                100.0f * progress.Convergence, static_cast<unsigned long long>(progress.FrameRenderTime),
+                raysPerSecond / 1e6, progress.Statistics.GetTestsPerRay());
+        });
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+    job.Start();
+    job.Wait();
+    const auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime);
+
+    const Renderer::FinalImage& image = job.GetResult();
+    if (!job.IsFinished() || !writeOutput(options.OutputPath, image)) {
+        std::fprintf(stderr, "\nFailed to write %s\n", options.OutputPath.c_str());
+        return 2;
+    }
+    if (!options.TracePath.empty() && !Utils::Profiler::WriteChromeTrace(options.TracePath)) {
+        std::fprintf(stderr, "\nFailed to write %s\n", options.TracePath.c_str());
+        return 2;
+    }
+    if (!options.Quiet) {
+        std::fprintf(stderr, "\nRendered %s in %lld ms\n", options.OutputPath.c_str(),
+            static_cast<long long>(elapsedTime.count()));
+        if (entry.MeshPages) {
+            printStreamingStatistics(*entry.MeshPages);
+        }
+        printTextureStatistics();
+    }
+    return 0;
+}
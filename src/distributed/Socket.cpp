@@ -0,0 +1,228 @@
+#include "Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    constexpr const char* UnixPrefix = "unix:";
+    constexpr int Backlog = 64;
+
+#if defined(MSG_NOSIGNAL)
+    constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int SendFlags = 0;
+#endif
+
+    bool isUnixAddress(const std::string& address) {
+        return address.rfind(UnixPrefix, 0) == 0;
+    }
+
+    bool unixSocketAddress(const std::string& address, sockaddr_un& result) {
+        const std::string path = address.substr(std::strlen(UnixPrefix));
+        if (path.empty() || path.size() >= sizeof(result.sun_path)) {
+            return false;
+        }
+        result = {};
+        result.sun_family = AF_UNIX;
+        std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    // Resolves "<host>:<port>"; an empty host means every interface when listening.
+    addrinfo* resolve(const std::string& address, const bool isPassive) {
+        const size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            return nullptr;
+        }
+        const std::string host = address.substr(0, colon);
+        const std::string port = address.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = isPassive ? AI_PASSIVE : 0;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0) {
+            return nullptr;
+        }
+        return result;
+    }
+
+    // Tiles are answered as soon as they arrive, so small messages must not wait for Nagle's algorithm.
+    void configure(const int handle, const bool isTcp) {
+        if (isTcp) {
+            const int noDelay = 1;
+            setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+#if defined(SO_NOSIGPIPE)
+        const int noSigPipe = 1;
+        setsockopt(handle, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+    }
+}
+
+Socket::~Socket() {
+    close();
+}
+
+Socket::Socket(Socket&& other) noexcept : m_Handle(std::exchange(other.m_Handle, -1)) {
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_Handle = std::exchange(other.m_Handle, -1);
+    }
+    return *this;
+}
+
+Socket Socket::Connect(const std::string& address) {
+    if (isUnixAddress(address)) {
+        sockaddr_un unixAddress{};
+        if (!unixSocketAddress(address, unixAddress)) {
+            return {};
+        }
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.IsValid()
+            || connect(socket.m_Handle, reinterpret_cast<const sockaddr*>(&unixAddress), sizeof(unixAddress)) != 0) {
+            return {};
+        }
+        configure(socket.m_Handle, false);
+        return socket;
+    }
+
+    addrinfo* addresses = resolve(address, false);
+    Socket socket;
+    for (const addrinfo* candidate = addresses; candidate; candidate = candidate->ai_next) {
+        Socket attempt(::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol));
+        if (attempt.IsValid() && connect(attempt.m_Handle, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+            configure(attempt.m_Handle, true);
+            socket = std::move(attempt);
+            break;
+        }
+    }
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    return socket;
+}
+
+bool Socket::Send(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t sent = ::send(m_Handle, bytes, size, SendFlags);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool Socket::Receive(void* data, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t received = ::recv(m_Handle, bytes, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+void Socket::Shutdown() {
+    if (IsValid()) {
+        shutdown(m_Handle, SHUT_RDWR);
+    }
+}
+
+bool Socket::SendMessage(const uint32_t type, const std::vector<uint8_t>& payload) {
+    // Native byte order, like checkpoints: workers are expected to run the same build.
+    const uint32_t header[2] = {type, static_cast<uint32_t>(payload.size())};
+    return Send(header, sizeof(header)) && (payload.empty() || Send(payload.data(), payload.size()));
+}
+
+bool Socket::ReceiveMessage(uint32_t& type, std::vector<uint8_t>& payload, const size_t maxSize) {
+    uint32_t header[2] = {};
+    if (!Receive(header, sizeof(header)) || header[1] > maxSize) {
+        return false;
+    }
+    type = header[0];
+    payload.resize(header[1]);
+    return payload.empty() || Receive(payload.data(), payload.size());
+}
+
+void Socket::close() {
+    if (m_Handle >= 0) {
+        ::close(m_Handle);
+        m_Handle = -1;
+    }
+}
+
+SocketListener::~SocketListener() {
+    if (m_Handle >= 0) {
+        ::close(m_Handle);
+    }
+    if (!m_UnixPath.empty()) {
+        unlink(m_UnixPath.c_str());
+    }
+}
+
+bool SocketListener::Listen(const std::string& address) {
+    if (m_Handle >= 0) {
+        return false;
+    }
+    m_Address = address;
+    if (isUnixAddress(address)) {
+        sockaddr_un unixAddress{};
+        if (!unixSocketAddress(address, unixAddress)) {
+            return false;
+        }
+        unlink(unixAddress.sun_path);
+        m_Handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_Handle < 0
+            || bind(m_Handle, reinterpret_cast<const sockaddr*>(&unixAddress), sizeof(unixAddress)) != 0) {
+            return false;
+        }
+        m_UnixPath = unixAddress.sun_path;
+        return listen(m_Handle, Backlog) == 0;
+    }
+
+    addrinfo* addresses = resolve(address, true);
+    for (const addrinfo* candidate = addresses; candidate && m_Handle < 0; candidate = candidate->ai_next) {
+        const int handle = ::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (handle < 0) continue;
+        const int reuse = 1;
+        setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(handle, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(handle, Backlog) == 0) {
+            m_Handle = handle;
+        } else {
+            ::close(handle);
+        }
+    }
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    return m_Handle >= 0;
+}
+
+Socket SocketListener::Accept(const int timeoutMs) {
+    pollfd request{.fd = m_Handle, .events = POLLIN, .revents = 0};
+    if (m_Handle < 0 || poll(&request, 1, timeoutMs) <= 0) {
+        return {};
+    }
+    Socket socket(accept(m_Handle, nullptr, nullptr));
+    if (socket.IsValid()) {
+        configure(socket.GetHandle(), !isUnixAddress(m_Address));
+    }
+    return socket;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blocking stream sockets for distributed rendering. An address is either "unix:<path>" for a
+// Unix-domain socket or "<host>:<port>" for TCP, e.g. "127.0.0.1:7100" for workers on the same box.
+class Socket {
+public:
+    Socket() = default;
+
+    explicit Socket(int handle) : m_Handle(handle) {}
+
+    ~Socket();
+
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // Returns an invalid socket if nothing listens at address.
+    static Socket Connect(const std::string& address);
+
+    [[nodiscard]] bool IsValid() const { return m_Handle >= 0; }
+
+    [[nodiscard]] int GetHandle() const { return m_Handle; }
+
+    bool Send(const void* data, size_t size);
+
+    // Fails on errors and if the peer closes the connection before size bytes arrived.
+    bool Receive(void* data, size_t size);
+
+    // Wakes up a Receive() blocked on another thread; the socket stays open until it is destroyed.
+    void Shutdown();
+
+    // Messages are a type, a payload size and the payload; see TileProtocol for the types.
+    bool SendMessage(uint32_t type, const std::vector<uint8_t>& payload);
+
+    // Payloads above maxSize are rejected, so a broken peer can't make us allocate arbitrary amounts.
+    bool ReceiveMessage(uint32_t& type, std::vector<uint8_t>& payload, size_t maxSize);
+
+private:
+    void close();
+
+    int m_Handle = -1;
+};
+
+class SocketListener {
+public:
+    SocketListener() = default;
+
+    ~SocketListener();
+
+    SocketListener(const SocketListener&) = delete;
+    SocketListener& operator=(const SocketListener&) = delete;
+
+    // Binds and listens; a stale Unix socket file at the path is replaced.
+    bool Listen(const std::string& address);
+
+    // Waits up to timeoutMs for a connection; returns an invalid socket if none arrived.
+    Socket Accept(int timeoutMs);
+
+    [[nodiscard]] const std::string& GetAddress() const { return m_Address; }
+
+private:
+    int m_Handle = -1;
+    std::string m_Address;
+    std::string m_UnixPath;
+};
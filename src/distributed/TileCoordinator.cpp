@@ -0,0 +1,220 @@
+#include "TileCoordinator.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr int AcceptPollMs = 100;
+}
+
+TileCoordinator::TileCoordinator(const TileProtocol::JobDescription& job, const uint32_t tileSize)
+    : m_Job(job), m_JobPayload(TileProtocol::EncodeJob(job)) {
+    const uint32_t size = std::max(tileSize, 1u);
+    for (uint32_t y = 0; y < job.Height; y += size) {
+        for (uint32_t x = 0; x < job.Width; x += size) {
+            const auto index = static_cast<uint32_t>(m_Tiles.size());
+            TileState tile;
+            tile.Region = {
+                .Index = index,
+                .X0 = x, .Y0 = y,
+                .X1 = std::min(x + size, job.Width), .Y1 = std::min(y + size, job.Height),
+            };
+            m_Tiles.push_back(tile);
+            m_PendingTiles.push_back(index);
+        }
+    }
+    const auto width = static_cast<int>(job.Width);
+    const auto height = static_cast<int>(job.Height);
+    m_Result.Accumulation.Resize(width, height);
+    m_Result.Albedo.Resize(width, height);
+    m_Result.NormalDepth.Resize(width, height);
+}
+
+bool TileCoordinator::Listen(const std::string& address) {
+    return m_Listener.Listen(address);
+}
+
+bool TileCoordinator::Run(const int workerTimeoutMs) {
+    DAZHBOG_PROFILE_ZONE("DistributedRender");
+    std::thread acceptThread([this] { acceptWorkers(); });
+
+    const auto workerTimeout = std::chrono::milliseconds(workerTimeoutMs);
+    auto lastWorkerTime = Clock::now();
+    uint32_t reportedTiles = 0;
+    std::unique_lock lock(m_Mutex);
+    while (m_MergedTiles < m_Tiles.size()) {
+        m_Changed.wait_for(lock, std::chrono::milliseconds(AcceptPollMs));
+        if (m_Workers > 0) {
+            lastWorkerTime = Clock::now();
+        } else if (Clock::now() - lastWorkerTime > workerTimeout) {
+            break;
+        }
+        if (m_ProgressHandler && m_MergedTiles != reportedTiles) {
+            reportedTiles = m_MergedTiles;
+            const Progress progress = {
+                .MergedTiles = m_MergedTiles,
+                .TileCount = static_cast<uint32_t>(m_Tiles.size()),
+                .Workers = m_Workers,
+                .Statistics = m_Statistics,
+            };
+            lock.unlock();
+            m_ProgressHandler(progress);
+            lock.lock();
+        }
+    }
+    const bool isComplete = m_MergedTiles == m_Tiles.size();
+    m_Result.Statistics = m_Statistics;
+    // Idle workers are told they are done; the ones still rendering a duplicate or stalled tile are cut off.
+    m_IsStopping = true;
+    for (WorkerConnection* connection : m_Connections) {
+        if (connection->IsBusy) {
+            connection->Stream.Shutdown();
+        }
+    }
+    lock.unlock();
+    m_Changed.notify_all();
+
+    acceptThread.join();
+    for (std::thread& thread : m_WorkerThreads) {
+        thread.join();
+    }
+    m_WorkerThreads.clear();
+    return isComplete;
+}
+
+void TileCoordinator::acceptWorkers() {
+    DAZHBOG_PROFILE_THREAD("Tile coordinator");
+    while (!m_IsStopping.load(std::memory_order_acquire)) {
+        Socket socket = m_Listener.Accept(AcceptPollMs);
+        if (!socket.IsValid()) continue;
+        m_WorkerThreads.emplace_back([this, socket = std::move(socket)]() mutable {
+            WorkerConnection connection{.Stream = std::move(socket)};
+            serveWorker(connection);
+        });
+    }
+}
+
+void TileCoordinator::serveWorker(WorkerConnection& connection) {
+    {
+        std::lock_guard lock(m_Mutex);
+        if (m_IsStopping) return;
+        m_Connections.push_back(&connection);
+    }
+    uint32_t type = 0;
+    std::vector<uint8_t> payload;
+    const bool isRegistered = connection.Stream.ReceiveMessage(type, payload, TileProtocol::MaxPayloadSize)
+        && type == TileProtocol::Hello && TileProtocol::DecodeHello(payload)
+        && connection.Stream.SendMessage(TileProtocol::Job, m_JobPayload);
+    if (isRegistered) {
+        std::lock_guard lock(m_Mutex);
+        m_Workers++;
+    }
+
+    Renderer::RegionAccumulation result;
+    bool isConnected = isRegistered;
+    while (isConnected) {
+        const std::optional<uint32_t> index = takeTile(connection);
+        if (!index) {
+            connection.Stream.SendMessage(TileProtocol::Done, {});
+            break;
+        }
+        const TileProtocol::TileRegion& region = m_Tiles[*index].Region;
+        const auto width = static_cast<int>(region.X1 - region.X0);
+        const auto height = static_cast<int>(region.Y1 - region.Y0);
+        uint32_t resultIndex = 0;
+        isConnected = connection.Stream.SendMessage(TileProtocol::Tile, TileProtocol::EncodeTile(region))
+            && connection.Stream.ReceiveMessage(type, payload, TileProtocol::MaxPayloadSize)
+            && type == TileProtocol::TileResult
+            && TileProtocol::DecodeTileResult(payload, resultIndex, result)
+            && resultIndex == *index
+            && std::ranges::all_of(std::initializer_list<const Image*>{
+                &result.Accumulation, &result.Albedo, &result.NormalDepth}, [&](const Image* image) {
+                return image->Width == width && image->Height == height;
+            });
+        if (isConnected) {
+            mergeTile(*index, result);
+        } else {
+            releaseTile(*index);
+        }
+    }
+
+    std::lock_guard lock(m_Mutex);
+    std::erase(m_Connections, &connection);
+    if (isRegistered) {
+        m_Workers--;
+    }
+    m_Changed.notify_all();
+}
+
+std::optional<uint32_t> TileCoordinator::takeTile(WorkerConnection& connection) {
+    std::unique_lock lock(m_Mutex);
+    connection.IsBusy = false;
+    while (!m_IsStopping && m_MergedTiles < m_Tiles.size()) {
+        std::optional<uint32_t> index;
+        while (!m_PendingTiles.empty() && !index) {
+            if (!m_Tiles[m_PendingTiles.front()].IsMerged) {
+                index = m_PendingTiles.front();
+            }
+            m_PendingTiles.pop_front();
+        }
+        if (!index) {
+            // Nothing left to hand out: help with the tile that has been in flight the longest.
+            for (const TileState& tile : m_Tiles) {
+                if (!tile.IsMerged && tile.Assignments > 0 && tile.Assignments < MaxTileAssignments
+                    && (!index || tile.AssignedTime < m_Tiles[*index].AssignedTime)) {
+                    index = tile.Region.Index;
+                }
+            }
+        }
+        if (index) {
+            TileState& tile = m_Tiles[*index];
+            if (tile.Assignments == 0) {
+                tile.AssignedTime = Clock::now();
+            }
+            tile.Assignments++;
+            connection.IsBusy = true;
+            return index;
+        }
+        m_Changed.wait(lock);
+    }
+    return std::nullopt;
+}
+
+void TileCoordinator::releaseTile(const uint32_t index) {
+    {
+        std::lock_guard lock(m_Mutex);
+        TileState& tile = m_Tiles[index];
+        tile.Assignments--;
+        if (tile.IsMerged || tile.Assignments > 0) return;
+        m_PendingTiles.push_front(index);
+    }
+    m_Changed.notify_all();
+}
+
+void TileCoordinator::mergeTile(const uint32_t index, const Renderer::RegionAccumulation& result) {
+    const TileProtocol::TileRegion& region = m_Tiles[index].Region;
+    {
+        std::lock_guard lock(m_Mutex);
+        TileState& tile = m_Tiles[index];
+        tile.Assignments--;
+        m_Statistics += result.Statistics;
+        if (tile.IsMerged) return;
+        // Claimed before copying, so a duplicate arriving meanwhile is dropped; the copy itself doesn't
+        // need the lock, nobody else writes these pixels.
+        tile.IsMerged = true;
+    }
+    for (uint32_t y = region.Y0; y < region.Y1; y++) {
+        for (uint32_t x = region.X0; x < region.X1; x++) {
+            m_Result.Accumulation.SetPixel(x, y, result.Accumulation.GetPixel(x - region.X0, y - region.Y0));
+            m_Result.Albedo.SetPixel(x, y, result.Albedo.GetPixel(x - region.X0, y - region.Y0));
+            m_Result.NormalDepth.SetPixel(x, y, result.NormalDepth.GetPixel(x - region.X0, y - region.Y0));
+        }
+    }
+    {
+        std::lock_guard lock(m_Mutex);
+        m_MergedTiles++;
+    }
+    m_Changed.notify_all();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Socket.h"
+#include "TileProtocol.h"
+#include "render/Renderer.h"
+
+// Coordinator side of a distributed render: splits the image into tiles, hands them to the TileWorkers
+// that connect and copies their accumulations into the full image.
+//
+// Workers pull one tile at a time, so fast workers simply take more of them. Once no tile is left to
+// hand out, an idle worker also takes the oldest tile still being rendered elsewhere; the first result
+// wins, which keeps a slow or stalled worker from holding up the end of the render. Results are
+// deterministic, so it doesn't matter which copy arrives first. The tile of a worker that disconnects
+// goes back to the queue.
+class TileCoordinator {
+public:
+    struct Progress
+    {
+        uint32_t MergedTiles = 0;
+        uint32_t TileCount = 0;
+        uint32_t Workers = 0;
+        // Everything the workers traced, including tiles that were rendered twice.
+        Renderer::RenderStatistics Statistics;
+    };
+
+    using ProgressHandler = std::function<void(const Progress& progress)>;
+
+    explicit TileCoordinator(const TileProtocol::JobDescription& job, uint32_t tileSize = DefaultTileSize);
+
+    TileCoordinator(const TileCoordinator&) = delete;
+    TileCoordinator& operator=(const TileCoordinator&) = delete;
+
+    bool Listen(const std::string& address);
+
+    // Called from Run()'s thread whenever tiles were merged. Must be set before Run().
+    void SetProgressHandler(const ProgressHandler& handler) { m_ProgressHandler = handler; }
+
+    // Serves workers until every tile is merged. Fails if no worker is connected for workerTimeoutMs
+    // while tiles remain.
+    bool Run(int workerTimeoutMs);
+
+    // The accumulation of the whole image, FrameCount frames per pixel. Complete once Run() succeeded.
+    [[nodiscard]] const Renderer::RegionAccumulation& GetResult() const { return m_Result; }
+
+private:
+    static constexpr uint32_t DefaultTileSize = 64;
+    // A tile is rendered by at most this many workers at once.
+    static constexpr uint32_t MaxTileAssignments = 2;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct TileState
+    {
+        TileProtocol::TileRegion Region;
+        // Workers currently rendering the tile.
+        uint32_t Assignments = 0;
+        Clock::time_point AssignedTime{};
+        bool IsMerged = false;
+    };
+
+    struct WorkerConnection
+    {
+        Socket Stream;
+        // Set while the worker is expected to answer; Run() shuts these connections down once it is done.
+        bool IsBusy = true;
+    };
+
+    void acceptWorkers();
+
+    void serveWorker(WorkerConnection& connection);
+
+    // Next tile for a worker, or nothing once the render is complete or stopped.
+    std::optional<uint32_t> takeTile(WorkerConnection& connection);
+
+    // Gives up a tile the worker didn't finish; it is queued again unless another worker has it.
+    void releaseTile(uint32_t index);
+
+    void mergeTile(uint32_t index, const Renderer::RegionAccumulation& result);
+
+    TileProtocol::JobDescription m_Job;
+    std::vector<uint8_t> m_JobPayload;
+    SocketListener m_Listener;
+    ProgressHandler m_ProgressHandler;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    std::vector<TileState> m_Tiles;
+    std::deque<uint32_t> m_PendingTiles;
+    uint32_t m_MergedTiles = 0;
+    uint32_t m_Workers = 0;
+    std::vector<WorkerConnection*> m_Connections;
+    Renderer::RenderStatistics m_Statistics;
+    std::atomic<bool> m_IsStopping = false;
+
+    // Written by the accept thread only, joined by Run() after it.
+    std::vector<std::thread> m_WorkerThreads;
+
+    Renderer::RegionAccumulation m_Result;
+};
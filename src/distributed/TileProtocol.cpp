@@ -0,0 +1,188 @@
+#include "TileProtocol.h"
+
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace {
+    class PayloadWriter {
+    public:
+        template<typename T>
+        void Add(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            AddBytes(&value, sizeof(T));
+        }
+
+        void AddBytes(const void* data, const size_t size) {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            m_Payload.insert(m_Payload.end(), bytes, bytes + size);
+        }
+
+        void AddString(const std::string& value) {
+            Add(static_cast<uint32_t>(value.size()));
+            AddBytes(value.data(), value.size());
+        }
+
+        void AddImage(const Image& image) {
+            Add(image.Width);
+            Add(image.Height);
+            AddBytes(image.Data, static_cast<size_t>(image.Width) * image.Height * sizeof(glm::vec4));
+        }
+
+        std::vector<uint8_t> Take() { return std::move(m_Payload); }
+
+    private:
+        std::vector<uint8_t> m_Payload;
+    };
+
+    // Every read checks the remaining size; IsComplete() also requires the payload to be used up.
+    class PayloadReader {
+    public:
+        explicit PayloadReader(const std::vector<uint8_t>& payload) : m_Payload(payload) {}
+
+        template<typename T>
+        bool Read(T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            return ReadBytes(&value, sizeof(T));
+        }
+
+        bool ReadBytes(void* data, const size_t size) {
+            if (size > m_Payload.size() - m_Position) {
+                return false;
+            }
+            std::memcpy(data, m_Payload.data() + m_Position, size);
+            m_Position += size;
+            return true;
+        }
+
+        bool ReadString(std::string& value) {
+            uint32_t size = 0;
+            if (!Read(size) || size > m_Payload.size() - m_Position) {
+                return false;
+            }
+            value.assign(reinterpret_cast<const char*>(m_Payload.data() + m_Position), size);
+            m_Position += size;
+            return true;
+        }
+
+        bool ReadImage(Image& image) {
+            int width = 0, height = 0;
+            if (!Read(width) || !Read(height) || width < 0 || height < 0
+                || static_cast<size_t>(width) * height * sizeof(glm::vec4) > m_Payload.size() - m_Position) {
+                return false;
+            }
+            image.Resize(width, height);
+            return ReadBytes(image.Data, static_cast<size_t>(width) * height * sizeof(glm::vec4));
+        }
+
+        [[nodiscard]] bool IsComplete() const { return m_Position == m_Payload.size(); }
+
+    private:
+        const std::vector<uint8_t>& m_Payload;
+        size_t m_Position = 0;
+    };
+}
+
+namespace TileProtocol
+{
+    std::vector<uint8_t> EncodeHello() {
+        PayloadWriter writer;
+        writer.Add(Version);
+        return writer.Take();
+    }
+
+    bool DecodeHello(const std::vector<uint8_t>& payload) {
+        PayloadReader reader(payload);
+        uint32_t version = 0;
+        return reader.Read(version) && reader.IsComplete() && version == Version;
+    }
+
+    std::vector<uint8_t> EncodeJob(const JobDescription& job) {
+        PayloadWriter writer;
+        writer.AddString(job.SceneName);
+        writer.Add(job.SceneHash);
+        const std::optional<MeshCompression>& compression = job.MeshOptions.Compression;
+        writer.Add(static_cast<uint8_t>(compression.has_value()));
+        writer.Add(compression ? compression->BoundsBits : 0u);
+        writer.Add(static_cast<uint8_t>(compression && compression->QuantizeVertices));
+        writer.Add(static_cast<uint8_t>(compression && compression->PackIndices));
+        writer.Add(job.MeshOptions.StreamingBudget);
+        writer.Add(job.CameraPosition);
+        writer.Add(job.CameraDirection);
+        writer.Add(job.VerticalFOV);
+        writer.Add(job.Width);
+        writer.Add(job.Height);
+        writer.Add(job.Integrator.RenderMode);
+        writer.Add(job.Integrator.RayBounces);
+        writer.Add(job.Integrator.SamplesPerPixel);
+        writer.Add(job.FrameCount);
+        return writer.Take();
+    }
+
+    bool DecodeJob(const std::vector<uint8_t>& payload, JobDescription& job) {
+        PayloadReader reader(payload);
+        uint8_t hasCompression = 0, quantizeVertices = 0, packIndices = 0;
+        uint32_t boundsBits = 0;
+        if (!reader.ReadString(job.SceneName)
+            || !reader.Read(job.SceneHash)
+            || !reader.Read(hasCompression)
+            || !reader.Read(boundsBits)
+            || !reader.Read(quantizeVertices)
+            || !reader.Read(packIndices)) {
+            return false;
+        }
+        job.MeshOptions.Compression.reset();
+        if (hasCompression) {
+            if (boundsBits != 8 && boundsBits != 16) return false;
+            job.MeshOptions.Compression = MeshCompression{
+                .BoundsBits = boundsBits,
+                .QuantizeVertices = quantizeVertices != 0,
+                .PackIndices = packIndices != 0,
+            };
+        }
+        return reader.Read(job.MeshOptions.StreamingBudget)
+            && reader.Read(job.CameraPosition)
+            && reader.Read(job.CameraDirection)
+            && reader.Read(job.VerticalFOV)
+            && reader.Read(job.Width)
+            && reader.Read(job.Height)
+            && reader.Read(job.Integrator.RenderMode)
+            && reader.Read(job.Integrator.RayBounces)
+            && reader.Read(job.Integrator.SamplesPerPixel)
+            && reader.Read(job.FrameCount)
+            && reader.IsComplete()
+            && job.Width > 0 && job.Height > 0 && job.FrameCount > 0;
+    }
+
+    std::vector<uint8_t> EncodeTile(const TileRegion& tile) {
+        PayloadWriter writer;
+        writer.Add(tile);
+        return writer.Take();
+    }
+
+    bool DecodeTile(const std::vector<uint8_t>& payload, const JobDescription& job, TileRegion& tile) {
+        PayloadReader reader(payload);
+        return reader.Read(tile) && reader.IsComplete() && tile.X0 < tile.X1 && tile.Y0 < tile.Y1
+            && tile.X1 <= job.Width && tile.Y1 <= job.Height;
+    }
+
+    std::vector<uint8_t> EncodeTileResult(const uint32_t index, const Renderer::RegionAccumulation& result) {
+        PayloadWriter writer;
+        writer.Add(index);
+        writer.Add(result.Statistics);
+        writer.AddImage(result.Accumulation);
+        writer.AddImage(result.Albedo);
+        writer.AddImage(result.NormalDepth);
+        return writer.Take();
+    }
+
+    bool DecodeTileResult(const std::vector<uint8_t>& payload, uint32_t& index, Renderer::RegionAccumulation& result) {
+        PayloadReader reader(payload);
+        return reader.Read(index)
+            && reader.Read(result.Statistics)
+            && reader.ReadImage(result.Accumulation)
+            && reader.ReadImage(result.Albedo)
+            && reader.ReadImage(result.NormalDepth)
+            && reader.IsComplete();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "render/Renderer.h"
+#include "scene/SceneLibrary.h"
+
+// Messages between a TileCoordinator and its TileWorkers. A worker connects and sends Hello, receives
+// the Job, and then answers every Tile with a TileResult until it gets Done. Tiles are split by pixels,
+// never by frames: each result is the exact accumulation of its pixels, so merging is a copy and the
+// image is bit-identical to a single-process deterministic render.
+//
+// Workers build the scene themselves and refuse a job whose scene hashes differently from the
+// coordinator's.
+namespace TileProtocol
+{
+    constexpr uint32_t Version = 1;
+
+    enum MessageType : uint32_t {
+        Hello = 1,
+        Job,
+        Tile,
+        TileResult,
+        Done,
+    };
+
+    // Far above any tile, but keeps a corrupt size from allocating gigabytes.
+    constexpr size_t MaxPayloadSize = 256u << 20;
+
+    struct JobDescription
+    {
+        // Scene the workers create, see SceneLibrary::Create().
+        std::string SceneName;
+        // Scene::Hash() of the coordinator's scene.
+        uint64_t SceneHash = 0;
+        // How a mesh file is loaded, as the coordinator loaded it.
+        SceneLibrary::MeshOptions MeshOptions;
+        glm::vec3 CameraPosition{0.0f};
+        glm::vec3 CameraDirection{0.0f, 0.0f, -1.0f};
+        float VerticalFOV = 45.0f;
+        uint32_t Width = 0, Height = 0;
+        Renderer::IntegratorSettings Integrator;
+        // Frames every pixel accumulates.
+        uint32_t FrameCount = 0;
+    };
+
+    // Pixels [X0, X1) x [Y0, Y1).
+    struct TileRegion
+    {
+        uint32_t Index = 0;
+        uint32_t X0 = 0, Y0 = 0, X1 = 0, Y1 = 0;
+    };
+
+    std::vector<uint8_t> EncodeHello();
+    bool DecodeHello(const std::vector<uint8_t>& payload);
+
+    std::vector<uint8_t> EncodeJob(const JobDescription& job);
+    bool DecodeJob(const std::vector<uint8_t>& payload, JobDescription& job);
+
+    std::vector<uint8_t> EncodeTile(const TileRegion& tile);
+    // Rejects regions that are empty or reach outside the job's image.
+    bool DecodeTile(const std::vector<uint8_t>& payload, const JobDescription& job, TileRegion& tile);
+
+    std::vector<uint8_t> EncodeTileResult(uint32_t index, const Renderer::RegionAccumulation& result);
+    bool DecodeTileResult(const std::vector<uint8_t>& payload, uint32_t& index, Renderer::RegionAccumulation& result);
+}
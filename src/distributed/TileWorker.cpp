@@ -0,0 +1,71 @@
+#include "TileWorker.h"
+
+#include <cstdio>
+#include <utility>
+
+#include "Socket.h"
+#include "TileProtocol.h"
+#include "render/Camera.h"
+#include "render/Renderer.h"
+#include "scene/SceneLibrary.h"
+#include "utils/Profiler.h"
+
+TileWorker::TileWorker(std::string coordinatorAddress, const int threadCount)
+    : m_CoordinatorAddress(std::move(coordinatorAddress)), m_ThreadCount(threadCount) {
+}
+
+bool TileWorker::Run() {
+    DAZHBOG_PROFILE_THREAD("Tile worker");
+    Socket socket = Socket::Connect(m_CoordinatorAddress);
+    if (!socket.IsValid()) {
+        std::fprintf(stderr, "Can't connect to %s\n", m_CoordinatorAddress.c_str());
+        return false;
+    }
+    uint32_t type = 0;
+    std::vector<uint8_t> payload;
+    TileProtocol::JobDescription job;
+    if (!socket.SendMessage(TileProtocol::Hello, TileProtocol::EncodeHello())
+        || !socket.ReceiveMessage(type, payload, TileProtocol::MaxPayloadSize)
+        || type != TileProtocol::Job || !TileProtocol::DecodeJob(payload, job)) {
+        std::fprintf(stderr, "No job from %s\n", m_CoordinatorAddress.c_str());
+        return false;
+    }
+
+    SceneLibrary::Entry entry = SceneLibrary::Create(job.SceneName, job.MeshOptions);
+    if (!entry.Scene) {
+        std::fprintf(stderr, "Unknown scene '%s'\n", job.SceneName.c_str());
+        return false;
+    }
+    // A different version of the scene would merge tiles of another image.
+    if (entry.Scene->Hash() != job.SceneHash) {
+        std::fprintf(stderr, "Scene '%s' differs from the coordinator's, refusing the job\n", job.SceneName.c_str());
+        return false;
+    }
+    const glm::vec2 size(static_cast<float>(job.Width), static_cast<float>(job.Height));
+    Camera camera(job.VerticalFOV, 0.1f, 100.0f, size);
+    camera.PlaceInWorld(job.CameraPosition, job.CameraDirection);
+    Renderer renderer(&camera, entry.Scene.get(), size);
+    Renderer::Settings settings;
+    settings.Integrator = job.Integrator;
+    settings.Deterministic = true;
+    settings.ThreadCount = m_ThreadCount;
+    renderer.SetSettings(settings);
+
+    Renderer::RegionAccumulation result;
+    while (socket.ReceiveMessage(type, payload, TileProtocol::MaxPayloadSize)) {
+        if (type == TileProtocol::Done) {
+            return true;
+        }
+        TileProtocol::TileRegion tile;
+        if (type != TileProtocol::Tile || !TileProtocol::DecodeTile(payload, job, tile)) {
+            break;
+        }
+        renderer.AccumulateRegion(tile.X0, tile.Y0, tile.X1, tile.Y1, job.FrameCount, result);
+        if (!socket.SendMessage(TileProtocol::TileResult, TileProtocol::EncodeTileResult(tile.Index, result))) {
+            break;
+        }
+        m_TileCount++;
+    }
+    std::fprintf(stderr, "Lost the connection to %s\n", m_CoordinatorAddress.c_str());
+    return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Worker side of a distributed render: connects to a TileCoordinator, builds the scene of its job, checks
+// it is the coordinator's, and renders the tiles it is handed until the coordinator is done.
+class TileWorker {
+public:
+    // threadCount as in Renderer::Settings, 0 uses every hardware thread.
+    TileWorker(std::string coordinatorAddress, int threadCount);
+
+    // Blocks until the coordinator sends Done (true) or the connection or the job fails (false).
+    bool Run();
+
+    // Tiles rendered so far.
+    [[nodiscard]] uint32_t GetTileCount() const { return m_TileCount; }
+
+private:
+    std::string m_CoordinatorAddress;
+    int m_ThreadCount;
+    uint32_t m_TileCount = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box. The default box is empty: growing it by anything gives that thing's bounds.
+struct Aabb
+{
+    glm::vec3 Min{std::numeric_limits<float>::max()};
+    glm::vec3 Max{-std::numeric_limits<float>::max()};
+
+    void Grow(const glm::vec3& point) {
+        Min = glm::min(Min, point);
+        Max = glm::max(Max, point);
+    }
+
+    void Grow(const Aabb& other) {
+        Min = glm::min(Min, other.Min);
+        Max = glm::max(Max, other.Max);
+    }
+
+    [[nodiscard]] bool IsEmpty() const { return Min.x > Max.x; }
+
+    [[nodiscard]] glm::vec3 GetCenter() const { return 0.5f * (Min + Max); }
+
+    [[nodiscard]] glm::vec3 GetExtent() const { return Max - Min; }
+
+    // Half the surface area, which is all the SAH needs.
+    [[nodiscard]] float GetHalfArea() const {
+        if (IsEmpty()) return 0.0f;
+        const glm::vec3 extent = GetExtent();
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // Slab test against a ray given by its origin and 1 / direction. Returns the entry distance, or
+    // infinity if the ray misses the box or only reaches it beyond tMax.
+    [[nodiscard]] float Intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, const float tMax) const {
+        float entry = 0.0f;
+        float exit = tMax;
+        for (int axis = 0; axis < 3; axis++) {
+            const float t0 = (Min[axis] - origin[axis]) * inverseDirection[axis];
+            const float t1 = (Max[axis] - origin[axis]) * inverseDirection[axis];
+            // A ray running in the plane of a face gets 0 * inf = NaN here; it is inside that slab. Meshes
+            // have many faces on round coordinates, which axis-aligned rays would otherwise slip through.
+            if (std::isnan(t0) || std::isnan(t1)) continue;
+            entry = std::max(entry, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+        }
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+    }
+};
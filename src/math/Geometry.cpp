@@ -36,6 +36,10 @@ HitPayload Sphere::Hit(const Ray &ray, Interval tBoundaries) const {
     return hitRecord;
 }
 
+Aabb Sphere::GetBounds() const {
+    return {.Min = m_Center - glm::vec3(m_Radius), .Max = m_Center + glm::vec3(m_Radius)};
+}
+
 glm::vec3 Sphere::NormalAtPoint(const glm::vec3 &point) const {
     return (point - m_Center) / m_Radius;
 }
@@ -44,6 +48,13 @@ void Sphere::MoveTo(const glm::vec3 &point) {
     m_Center = point;
 }
 
+void Sphere::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('S');
+    hash.Add(m_Center);
+    hash.Add(m_Radius);
+    hash.Add(m_MaterialIndex);
+}
+
 Triangle::Triangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, const uint32_t materialIndex)
     : m_A(a), m_B(b), m_C(c), m_MaterialIndex(materialIndex) {
 }
@@ -86,6 +97,14 @@ HitPayload Triangle::Hit(const Ray &ray, Interval tBoundaries) const {
     return hitRecord;
 }
 
+Aabb Triangle::GetBounds() const {
+    Aabb bounds;
+    bounds.Grow(m_A);
+    bounds.Grow(m_B);
+    bounds.Grow(m_C);
+    return bounds;
+}
+
 glm::vec3 Triangle::Normal() const {
     return glm::cross(m_B - m_A, m_C - m_A);
 }
@@ -94,7 +113,19 @@ uint32_t Triangle::GetMaterialIndex() const {
     return m_MaterialIndex;
 }
 
-Cube::Cube(const glm::mat4 &transform, const uint32_t materialIndex) : m_MaterialIndex(materialIndex) {
+void Triangle::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('T');
+    hash.Add(m_A);
+    hash.Add(m_B);
+    hash.Add(m_C);
+    hash.Add(m_MaterialIndex);
+}
+
+Cube::Cube(const glm::mat4 &transform, const uint32_t materialIndex)
+    : m_MaterialIndex(materialIndex), m_Triangles(MakeTriangles(transform, materialIndex)) {
+}
+
+std::array<Triangle, 12> Cube::MakeTriangles(const glm::mat4 &transform, const uint32_t materialIndex) {
     constexpr float s = 0.5f;
     auto v000 = glm::vec3(transform * glm::vec4(-s, -s, -s, 1.0));
     auto v001 = glm::vec3(transform * glm::vec4(-s, -s, s, 1.0));
@@ -105,27 +136,45 @@ Cube::Cube(const glm::mat4 &transform, const uint32_t materialIndex) : m_Materia
     auto v110 = glm::vec3(transform * glm::vec4(s, s, -s, 1.0));
     auto v111 = glm::vec3(transform * glm::vec4(s, s, s, 1.0));
 
-    m_Triangles.emplace_back(Triangle(v100, v101, v001, materialIndex));
-    m_Triangles.emplace_back(Triangle(v100, v001, v000, materialIndex));
-    m_Triangles.emplace_back(Triangle(v011, v111, v110, materialIndex));
-    m_Triangles.emplace_back(Triangle(v011, v110, v010, materialIndex));
-    m_Triangles.emplace_back(Triangle(v001, v011, v010, materialIndex));
-    m_Triangles.emplace_back(Triangle(v001, v010, v000, materialIndex));
-    m_Triangles.emplace_back(Triangle(v110, v111, v101, materialIndex));
-    m_Triangles.emplace_back(Triangle(v110, v101, v100, materialIndex));
-    m_Triangles.emplace_back(Triangle(v010, v110, v100, materialIndex));
-    m_Triangles.emplace_back(Triangle(v010, v100, v000, materialIndex));
-    m_Triangles.emplace_back(Triangle(v101, v111, v011, materialIndex));
-    m_Triangles.emplace_back(Triangle(v101, v011, v001, materialIndex));
+    return {
+        Triangle(v100, v101, v001, materialIndex),
+        Triangle(v100, v001, v000, materialIndex),
+        Triangle(v011, v111, v110, materialIndex),
+        Triangle(v011, v110, v010, materialIndex),
+        Triangle(v001, v011, v010, materialIndex),
+        Triangle(v001, v010, v000, materialIndex),
+        Triangle(v110, v111, v101, materialIndex),
+        Triangle(v110, v101, v100, materialIndex),
+        Triangle(v010, v110, v100, materialIndex),
+        Triangle(v010, v100, v000, materialIndex),
+        Triangle(v101, v111, v011, materialIndex),
+        Triangle(v101, v011, v001, materialIndex),
+    };
 }
 
 uint32_t Cube::GetMaterialIndex() const {
     return m_MaterialIndex;
 }
 
+void Cube::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('C');
+    for (const Triangle& triangle : m_Triangles) {
+        triangle.Hash(hash);
+    }
+}
+
+Aabb Cube::GetBounds() const {
+    Aabb bounds;
+    for (const Triangle& triangle : m_Triangles) {
+        bounds.Grow(triangle.GetBounds());
+    }
+    return bounds;
+}
+
 HitPayload Cube::Hit(const Ray &ray, const Interval tBoundaries) const {
     for (auto &triangle : m_Triangles) {
-        if (const HitPayload payload = triangle.Hit(ray, tBoundaries); payload.DidCollide) {
+        if (HitPayload payload = triangle.Hit(ray, tBoundaries); payload.DidCollide) {
+            payload.MaterialIndex = m_MaterialIndex;
             return payload;
         }
     }
@@ -1,25 +1,31 @@
 #pragma once
 
+#include <array>
+#include <type_traits>
 #include <glm/glm.hpp>
 
 #include "Hittable.h"
 
-class Sphere final : public Hittable {
+// Spheres and triangles are plain values rather than Hittables: Scene keeps them in flat arrays, which
+// the scene cache maps from disk as they are, so they must stay trivially copyable.
+class Sphere {
 public:
-    explicit Sphere(float radius, uint32_t materialIndex = 0, const glm::vec3 &center = glm::vec3(0.0f));
+    explicit Sphere(float radius = 1.0f, uint32_t materialIndex = 0, const glm::vec3 &center = glm::vec3(0.0f));
 
-    ~Sphere() override = default;
+    HitPayload Hit(const Ray& ray, Interval tBoundaries) const;
 
-    HitPayload Hit(const Ray& ray, Interval tBoundaries) const override;
+    [[nodiscard]] Aabb GetBounds() const;
 
     [[nodiscard]] glm::vec3 NormalAtPoint(const glm::vec3 &point) const;
 
-    uint32_t GetMaterialIndex() const override { return m_MaterialIndex; }
+    uint32_t GetMaterialIndex() const { return m_MaterialIndex; }
 
     [[nodiscard]] glm::vec4 GetCenter() const { return {m_Center, 1.0f}; }
 
     void MoveTo(const glm::vec3 &point);
 
+    void Hash(Utils::Fnv1a& hash) const;
+
 private:
     glm::vec3 m_Center;
     float m_Radius;
@@ -27,17 +33,21 @@ private:
 };
 
 
-class Triangle final : public Hittable {
+class Triangle {
 public:
+    Triangle() : Triangle(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0) {}
+
     explicit Triangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, uint32_t materialIndex);
 
-    ~Triangle() override = default;
+    HitPayload Hit(const Ray& ray, Interval tBoundaries) const;
 
-    HitPayload Hit(const Ray& ray, Interval tBoundaries) const override;
+    [[nodiscard]] Aabb GetBounds() const;
 
     [[nodiscard]] glm::vec3 Normal() const;
 
-    uint32_t GetMaterialIndex() const override;
+    uint32_t GetMaterialIndex() const;
+
+    void Hash(Utils::Fnv1a& hash) const;
 
 private:
     glm::vec3 m_A;
@@ -50,10 +60,19 @@ class Cube final : public Hittable {
 public:
     explicit Cube(const glm::mat4 &transform, uint32_t materialIndex);
 
-    uint32_t GetMaterialIndex() const override;
+    // The unit cube's faces under transform, facing outwards; scenes built in bulk add these instead of a Cube.
+    static std::array<Triangle, 12> MakeTriangles(const glm::mat4 &transform, uint32_t materialIndex);
+
+    uint32_t GetMaterialIndex() const;
 
     HitPayload Hit(const Ray &ray, Interval tBoundaries) const override;
+
+    [[nodiscard]] Aabb GetBounds() const override;
+
+    void Hash(Utils::Fnv1a& hash) const override;
 private:
     uint32_t m_MaterialIndex;
-    std::vector<Triangle> m_Triangles;
-};
\ No newline at end of file
+    std::array<Triangle, 12> m_Triangles;
+};
+
+static_assert(std::is_trivially_copyable_v<Sphere> && std::is_trivially_copyable_v<Triangle>);
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
+#include <span>
+
+#include "Aabb.h"
 #include "Interval.h"
 #include "glm/glm.hpp"
+#include "utils/Hash.h"
 
 struct Ray {
     glm::vec3 Origin;
@@ -23,8 +27,17 @@ struct HitPayload
     float HitDistance = 0.0;
     glm::vec3 WorldPosition{0.0};
     glm::vec3 WorldNormal{0.0};
-
-    uint32_t ObjectIndex = 0;
+    // Zero for surfaces without texture coordinates.
+    glm::vec2 TextureCoordinates{0.0f};
+    // Texture coordinate units per world unit along the surface, for picking mip levels; zero without
+    // texture coordinates.
+    float TextureDensity = 0.0f;
+    // Width of the ray's footprint on the surface in texture coordinate units, set by the renderer
+    // before shading; zero samples textures at full resolution.
+    float TextureFootprint = 0.0f;
+
+    // Set by Hittable::Hit(), and by Scene::Intersect() for spheres and triangles.
+    uint32_t MaterialIndex = 0;
 
     void SetFaceNormal(const Ray& ray, const glm::vec3& outwardNormal);
 };
@@ -33,7 +46,15 @@ class Hittable {
 public:
     virtual ~Hittable() = default;
 
-    virtual uint32_t GetMaterialIndex() const = 0;
-
+    // Objects may consist of parts with different materials, so the hit names the material.
     virtual HitPayload Hit(const Ray& ray, Interval tBoundaries) const = 0;
+
+    [[nodiscard]] virtual Aabb GetBounds() const = 0;
+
+    // Adds everything that affects the hits, so equal hashes mean equal geometry.
+    virtual void Hash(Utils::Fnv1a& hash) const = 0;
+
+    // Hint that rays like these are about to be traced. Objects that stream their data from disk start
+    // reading what the rays will reach; the others ignore it.
+    virtual void Prefetch([[maybe_unused]] std::span<const Ray> rays) const {}
 };
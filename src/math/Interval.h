@@ -13,6 +13,10 @@ public:
 
     bool Surrounds(float x) const;
 
+    [[nodiscard]] float GetMin() const { return m_Min; }
+
+    [[nodiscard]] float GetMax() const { return m_Max; }
+
     static const Interval empty, universe;
 
 private:
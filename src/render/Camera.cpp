@@ -1,5 +1,6 @@
 #include "Camera.h"
 
+#include <cmath>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
@@ -38,6 +39,11 @@ void Camera::RecalculateView() {
     m_InverseView = glm::inverse(m_View);
 }
 
+float Camera::GetPixelSpreadAngle() const {
+    if (m_ViewportHeight == 0) return 0.0f;
+    return std::atan(2.0f * std::tan(glm::radians(m_VerticalFOV) * 0.5f) / static_cast<float>(m_ViewportHeight));
+}
+
 Ray Camera::GetRay(const float pixelX, const float pixelY) const {
     const float u = pixelX / static_cast<float>(m_ViewportWidth);
     const float v = pixelY / static_cast<float>(m_ViewportHeight);
@@ -52,6 +58,16 @@ Ray Camera::GetRay(const float pixelX, const float pixelY) const {
     return ray;
 }
 
+bool Camera::WorldToPixel(const glm::vec3& position, glm::vec2& pixel) const {
+    const glm::vec4 clip = m_Projection * m_View * glm::vec4(position, 1.0f);
+    if (clip.w <= 0.0f) {
+        return false;
+    }
+    const glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+    pixel = (ndc * 0.5f + 0.5f) * glm::vec2(static_cast<float>(m_ViewportWidth), static_cast<float>(m_ViewportHeight));
+    return true;
+}
+
 void Camera::MoveForward(const float stepAmount)
 {
     m_Position += glm::normalize(m_ForwardDirection) * stepAmount;
@@ -20,8 +20,17 @@ public:
 
     [[nodiscard]] const glm::vec3& GetDirection() const { return m_ForwardDirection; }
 
+    [[nodiscard]] float GetVerticalFOV() const { return m_VerticalFOV; }
+
+    // Angle a pixel spans at the centre of the view: the spread of the cone a camera ray stands for.
+    [[nodiscard]] float GetPixelSpreadAngle() const;
+
     [[nodiscard]] Ray GetRay(float pixelX, float pixelY) const;
 
+    // Inverse of GetRay: projects a world position to pixel coordinates. Returns false for
+    // positions behind the camera.
+    [[nodiscard]] bool WorldToPixel(const glm::vec3& position, glm::vec2& pixel) const;
+
     void MoveForward(float stepAmount);
 
     void MoveRight(float stepAmount);
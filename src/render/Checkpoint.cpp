@@ -0,0 +1,97 @@
+#include "Checkpoint.h"
+
+#include <array>
+#include <cstdio>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr std::array<char, 4> Magic = {'D', 'Z', 'C', 'K'};
+    constexpr uint32_t Version = 1;
+
+    // Native byte order: checkpoints are meant to be resumed on the machine, or at least the kind of
+    // machine, that wrote them.
+    template<typename T>
+    bool write(FILE* file, const T& value) {
+        return std::fwrite(&value, sizeof(T), 1, file) == 1;
+    }
+
+    template<typename T>
+    bool read(FILE* file, T& value) {
+        return std::fread(&value, sizeof(T), 1, file) == 1;
+    }
+
+    bool writeImage(FILE* file, const Image& image) {
+        const size_t count = static_cast<size_t>(image.Width) * image.Height;
+        return write(file, image.Width) && write(file, image.Height)
+            && std::fwrite(image.Data, sizeof(glm::vec4), count, file) == count;
+    }
+
+    // Images after the first must have the size of the first one.
+    bool readImage(FILE* file, Image& image, const Image* sizeOf = nullptr) {
+        int width = 0, height = 0;
+        if (!read(file, width) || !read(file, height) || width <= 0 || height <= 0
+            || (sizeOf && (width != sizeOf->Width || height != sizeOf->Height))) {
+            return false;
+        }
+        image.Resize(width, height);
+        const size_t count = static_cast<size_t>(width) * height;
+        return std::fread(image.Data, sizeof(glm::vec4), count, file) == count;
+    }
+}
+
+bool WriteCheckpoint(const std::string& fileName, const Checkpoint& checkpoint)
+{
+    DAZHBOG_PROFILE_ZONE("WriteCheckpoint");
+    const std::string temporaryName = fileName + ".tmp";
+    FILE* file = std::fopen(temporaryName.c_str(), "wb");
+    if (!file) return false;
+    bool isWritten = std::fwrite(Magic.data(), 1, Magic.size(), file) == Magic.size()
+        && write(file, Version)
+        && write(file, checkpoint.RenderHash)
+        && write(file, checkpoint.FrameIndex)
+        && write(file, checkpoint.SeedFrameOffset)
+        && writeImage(file, checkpoint.Accumulation)
+        && writeImage(file, checkpoint.Albedo)
+        && writeImage(file, checkpoint.NormalDepth)
+        && std::fflush(file) == 0;
+#if !defined(_WIN32)
+    // The data has to be on disk before the rename is, or a power loss could leave an empty checkpoint.
+    isWritten = isWritten && fsync(fileno(file)) == 0;
+#endif
+    isWritten = std::fclose(file) == 0 && isWritten;
+
+    std::error_code error;
+    if (isWritten) {
+        std::filesystem::rename(temporaryName, fileName, error);
+    }
+    if (!isWritten || error) {
+        std::filesystem::remove(temporaryName, error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadCheckpoint(const std::string& fileName, Checkpoint& checkpoint)
+{
+    FILE* file = std::fopen(fileName.c_str(), "rb");
+    if (!file) return false;
+    std::array<char, 4> magic{};
+    uint32_t version = 0;
+    bool isValid = std::fread(magic.data(), 1, magic.size(), file) == magic.size() && magic == Magic
+        && read(file, version) && version == Version
+        && read(file, checkpoint.RenderHash)
+        && read(file, checkpoint.FrameIndex)
+        && read(file, checkpoint.SeedFrameOffset)
+        && readImage(file, checkpoint.Accumulation)
+        && readImage(file, checkpoint.Albedo, &checkpoint.Accumulation)
+        && readImage(file, checkpoint.NormalDepth, &checkpoint.Accumulation)
+        && std::fgetc(file) == EOF;
+    std::fclose(file);
+    return isValid;
+}
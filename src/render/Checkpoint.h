@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ImagePostProcessors.h"
+
+// Everything needed to continue an accumulation where it stopped. Samples are seeded from the pixel,
+// the sample and FrameIndex + SeedFrameOffset only, so these two numbers are the whole sampler state.
+struct Checkpoint
+{
+    // Identifies the scene, camera, integrator settings and size the accumulation belongs to.
+    uint64_t RenderHash = 0;
+    // Frames accumulated so far.
+    uint32_t FrameIndex = 0;
+    uint32_t SeedFrameOffset = 0;
+    Image Accumulation;
+    Image Albedo;
+    Image NormalDepth;
+};
+
+// Writes to fileName + ".tmp" and renames it over fileName, so an interrupted write leaves the previous
+// checkpoint intact.
+bool WriteCheckpoint(const std::string& fileName, const Checkpoint& checkpoint);
+
+bool ReadCheckpoint(const std::string& fileName, Checkpoint& checkpoint);
@@ -0,0 +1,241 @@
+#include "FloatImageIO.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <tbb/parallel_for.h>
+
+#include "utils/Profiler.h"
+
+namespace {
+    // Rows per block for ZIP_COMPRESSION, fixed by the format.
+    constexpr int ExrRowsPerBlock = 16;
+    // Blocks compressed together before they are written; bounds the memory a large frame needs.
+    constexpr int ExrBlocksPerBatch = 64;
+    constexpr uint8_t ExrZipCompression = 3;
+    constexpr int32_t ExrPixelTypeFloat = 2;
+
+    // EXR is little-endian throughout; like the PFM code this assumes a little-endian host.
+    template<typename T>
+    void append(std::vector<uint8_t>& out, const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void appendString(std::vector<uint8_t>& out, const std::string& value) {
+        out.insert(out.end(), value.begin(), value.end());
+        out.push_back(0);
+    }
+
+    void appendAttribute(std::vector<uint8_t>& out, const std::string& name, const std::string& type,
+        const std::vector<uint8_t>& value) {
+        appendString(out, name);
+        appendString(out, type);
+        append(out, static_cast<int32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    std::vector<uint8_t> exrHeader(const std::vector<ExrChannel>& channels, const int width, const int height) {
+        std::vector<uint8_t> header;
+        append(header, static_cast<int32_t>(20000630));
+        append(header, static_cast<int32_t>(2));
+
+        std::vector<uint8_t> value;
+        for (const ExrChannel& channel : channels) {
+            appendString(value, channel.Name);
+            append(value, ExrPixelTypeFloat);
+            append(value, static_cast<uint32_t>(0));  // pLinear and reserved
+            append(value, static_cast<int32_t>(1));   // x sampling
+            append(value, static_cast<int32_t>(1));   // y sampling
+        }
+        value.push_back(0);
+        appendAttribute(header, "channels", "chlist", value);
+
+        appendAttribute(header, "compression", "compression", {ExrZipCompression});
+
+        value.clear();
+        for (const int32_t coordinate : {0, 0, width - 1, height - 1}) {
+            append(value, coordinate);
+        }
+        appendAttribute(header, "dataWindow", "box2i", value);
+        appendAttribute(header, "displayWindow", "box2i", value);
+
+        appendAttribute(header, "lineOrder", "lineOrder", {0});
+
+        value.clear();
+        append(value, 1.0f);
+        appendAttribute(header, "pixelAspectRatio", "float", value);
+        appendAttribute(header, "screenWindowWidth", "float", value);
+
+        value.clear();
+        append(value, 0.0f);
+        append(value, 0.0f);
+        appendAttribute(header, "screenWindowCenter", "v2f", value);
+
+        header.push_back(0);
+        return header;
+    }
+
+    // One ZIP block as EXR stores it: channel-interleaved rows, split into even and odd bytes,
+    // delta-encoded and deflated. Blocks that don't get smaller are stored raw.
+    std::vector<uint8_t> compressExrBlock(const std::vector<ExrChannel>& channels, const int width, const int height,
+        const int firstRow, const int compressionLevel) {
+        const int rows = std::min(ExrRowsPerBlock, height - firstRow);
+        const size_t rawSize = static_cast<size_t>(rows) * channels.size() * width * sizeof(float);
+
+        std::vector<uint8_t> raw(rawSize);
+        auto* values = reinterpret_cast<float*>(raw.data());
+        for (int row = firstRow; row < firstRow + rows; row++) {
+            // EXR rows go top to bottom.
+            const size_t imageRow = static_cast<size_t>(height - 1 - row) * width;
+            for (const ExrChannel& channel : channels) {
+                const glm::vec4* pixels = channel.Source->Data + imageRow;
+                for (int x = 0; x < width; x++) {
+                    *values++ = pixels[x][channel.Component];
+                }
+            }
+        }
+
+        std::vector<uint8_t> reordered(rawSize);
+        uint8_t* even = reordered.data();
+        uint8_t* odd = reordered.data() + (rawSize + 1) / 2;
+        for (size_t i = 0; i < rawSize; i++) {
+            *((i & 1) ? odd++ : even++) = raw[i];
+        }
+        int previous = rawSize > 0 ? reordered[0] : 0;
+        for (size_t i = 1; i < rawSize; i++) {
+            const int current = reordered[i];
+            reordered[i] = static_cast<uint8_t>(current - previous + (128 + 256));
+            previous = current;
+        }
+
+        uLongf packedSize = compressBound(static_cast<uLong>(rawSize));
+        std::vector<uint8_t> packed(packedSize);
+        if (compress2(packed.data(), &packedSize, reordered.data(), static_cast<uLong>(rawSize), compressionLevel) != Z_OK
+            || packedSize >= rawSize) {
+            return raw;
+        }
+        packed.resize(packedSize);
+        return packed;
+    }
+}
+
+bool WritePfm(const std::string& fileName, const Image& image, const int channels)
+{
+    DAZHBOG_PROFILE_ZONE("WritePfm");
+    if (channels != 1 && channels != 3) {
+        return false;
+    }
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (!file) return false;
+    std::fprintf(file, "%s\n%d %d\n-1.0\n", channels == 3 ? "PF" : "Pf", image.Width, image.Height);
+    std::vector<float> row(static_cast<size_t>(image.Width) * channels);
+    bool isWritten = true;
+    for (int y = 0; y < image.Height && isWritten; y++) {
+        for (int x = 0; x < image.Width; x++) {
+            const glm::vec4 color = image.GetPixel(x, y);
+            for (int c = 0; c < channels; c++) {
+                row[channels * x + c] = color[c];
+            }
+        }
+        isWritten = std::fwrite(row.data(), sizeof(float), row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && isWritten;
+}
+
+bool ReadPfm(const std::string& fileName, Image& image)
+{
+    FILE* file = std::fopen(fileName.c_str(), "rb");
+    if (!file) return false;
+    int width = 0, height = 0;
+    float scale = 0.0f;
+    char magic[3] = {};
+    bool isValid = std::fscanf(file, "%2s %d %d %f", magic, &width, &height, &scale) == 4
+        && (std::strcmp(magic, "PF") == 0 || std::strcmp(magic, "Pf") == 0)
+        && width > 0 && height > 0 && scale < 0.0f && std::fgetc(file) != EOF;
+    if (isValid) {
+        const int channels = magic[1] == 'F' ? 3 : 1;
+        image.Resize(width, height);
+        std::vector<float> row(static_cast<size_t>(width) * channels);
+        for (int y = 0; y < height && isValid; y++) {
+            isValid = std::fread(row.data(), sizeof(float), row.size(), file) == row.size();
+            for (int x = 0; x < width && isValid; x++) {
+                const float* pixel = &row[static_cast<size_t>(x) * channels];
+                image.SetPixel(x, y, channels == 3
+                    ? glm::vec4(pixel[0], pixel[1], pixel[2], 1.0f)
+                    : glm::vec4(pixel[0], pixel[0], pixel[0], 1.0f));
+            }
+        }
+    }
+    std::fclose(file);
+    return isValid;
+}
+
+bool WriteExr(const std::string& fileName, std::vector<ExrChannel> channels, const int compressionLevel)
+{
+    DAZHBOG_PROFILE_ZONE("WriteExr");
+    if (channels.empty() || !channels.front().Source) {
+        return false;
+    }
+    const int width = channels.front().Source->Width;
+    const int height = channels.front().Source->Height;
+    for (const ExrChannel& channel : channels) {
+        if (!channel.Source || channel.Source->Width != width || channel.Source->Height != height
+            || channel.Component < 0 || channel.Component > 3 || channel.Name.empty()) {
+            return false;
+        }
+    }
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    // Readers expect the channel list, and thus every block's data, sorted by name.
+    std::sort(channels.begin(), channels.end(), [](const ExrChannel& a, const ExrChannel& b) {
+        return a.Name < b.Name;
+    });
+
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (!file) return false;
+
+    const std::vector<uint8_t> header = exrHeader(channels, width, height);
+    const int blockCount = (height + ExrRowsPerBlock - 1) / ExrRowsPerBlock;
+    // The offset table comes before the blocks; it is filled in once they are written.
+    std::vector<uint64_t> offsets(blockCount);
+    bool isWritten = std::fwrite(header.data(), 1, header.size(), file) == header.size()
+        && std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    uint64_t position = header.size() + offsets.size() * sizeof(uint64_t);
+
+    std::vector<std::vector<uint8_t>> batch(ExrBlocksPerBatch);
+    const int level = std::clamp(compressionLevel, 0, 9);
+    for (int first = 0; first < blockCount && isWritten; first += ExrBlocksPerBatch) {
+        const int count = std::min(ExrBlocksPerBatch, blockCount - first);
+        tbb::parallel_for(0, count, [&](const int i) {
+            batch[i] = compressExrBlock(channels, width, height, (first + i) * ExrRowsPerBlock, level);
+        });
+        for (int i = 0; i < count && isWritten; i++) {
+            const auto firstRow = static_cast<int32_t>((first + i) * ExrRowsPerBlock);
+            const auto size = static_cast<int32_t>(batch[i].size());
+            offsets[first + i] = position;
+            isWritten = std::fwrite(&firstRow, sizeof(firstRow), 1, file) == 1
+                && std::fwrite(&size, sizeof(size), 1, file) == 1
+                && std::fwrite(batch[i].data(), 1, batch[i].size(), file) == batch[i].size();
+            position += sizeof(firstRow) + sizeof(size) + batch[i].size();
+        }
+    }
+    isWritten = isWritten
+        && std::fseek(file, static_cast<long>(header.size()), SEEK_SET) == 0
+        && std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    return std::fclose(file) == 0 && isWritten;
+}
+
+void AddExrChannels(std::vector<ExrChannel>& channels, const Image& source, const std::vector<std::string>& names)
+{
+    for (size_t i = 0; i < names.size() && i < 4; i++) {
+        if (!names[i].empty()) {
+            channels.push_back({.Name = names[i], .Source = &source, .Component = static_cast<int>(i)});
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ImagePostProcessors.h"
+
+// Lossless float output, written straight from Image without any 8-bit conversion. Files are
+// streamed: only a row (PFM) or a batch of compressed blocks (EXR) is held in memory at a time.
+
+// Little-endian PFM, bottom row first like Image. channels is 3 ("PF", RGB) or 1 ("Pf", the red channel).
+bool WritePfm(const std::string& fileName, const Image& image, int channels = 3);
+
+// Reads an RGB or grayscale PFM written by a little-endian host; alpha is set to 1.
+bool ReadPfm(const std::string& fileName, Image& image);
+
+// One channel of an EXR file: component Component (0 to 3) of Source.
+struct ExrChannel
+{
+    std::string Name;
+    const Image* Source = nullptr;
+    int Component = 0;
+};
+
+// Scanline OpenEXR with 32-bit float channels and ZIP compression (blocks of 16 rows, compressed in
+// parallel). Every source must have the same size; channels may come from different images, e.g.
+// "R", "G", "B" from the radiance and "albedo.R" ... from an AOV. compressionLevel is zlib's, 0 to 9.
+bool WriteExr(const std::string& fileName, std::vector<ExrChannel> channels, int compressionLevel = 4);
+
+// Names components of an image, empty names are skipped: {"R", "G", "B"} or {"N.X", "N.Y", "N.Z", "Z"}.
+void AddExrChannels(std::vector<ExrChannel>& channels, const Image& source, const std::vector<std::string>& names);
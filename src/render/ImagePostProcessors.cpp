@@ -3,59 +3,72 @@
 #include <png.h>
 #include <cstdio>
 
-void Image::WritePng(const std::string& fileName) const
+#include <tbb/parallel_for.h>
+
+#include "ImageWriter.h"
+#include "utils/Profiler.h"
+
+bool WritePngRGBA8(const std::string& fileName, const uint32_t* pixels, const uint32_t width, const uint32_t height)
 {
+    DAZHBOG_PROFILE_ZONE("WritePng");
     FILE* fp = fopen(fileName.c_str(), "wb");
-    if (!fp) { /* handle error */ }
+    if (!fp) {
+        return false;
+    }
 
     png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (!png_ptr) { /* handle error */ }
+    png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : nullptr;
+    if (!info_ptr) {
+        png_destroy_write_struct(&png_ptr, nullptr);
+        fclose(fp);
+        return false;
+    }
 
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr) { /* handle error */ }
+    std::vector<png_byte> imageBytes(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+        const uint32_t p = pixels[i];
+
+        imageBytes[4*i + 0] = static_cast<png_byte>((p      ) & 0xFF);
+        imageBytes[4*i + 1] = static_cast<png_byte>((p >>  8) & 0xFF);
+        imageBytes[4*i + 2] = static_cast<png_byte>((p >> 16) & 0xFF);
+        imageBytes[4*i + 3] = static_cast<png_byte>((p >> 24) & 0xFF);
+    }
 
-    if (setjmp(png_jmpbuf(png_ptr))) { /* handle error */ }
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
 
     png_init_io(png_ptr, fp);
 
-    png_set_IHDR(png_ptr, info_ptr, Width, Height, 8, PNG_COLOR_TYPE_RGBA,
+    png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGBA,
                  PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
     png_write_info(png_ptr, info_ptr);
 
-    std::vector<uint32_t> pixels32(Width * Height);
-    ToRGBA8(pixels32.data());
-
-    std::vector<png_byte> imageBytes(static_cast<size_t>(Width) * Height * 4);
-    for (size_t i = 0; i < pixels32.size(); ++i) {
-        uint32_t p = pixels32[i];
-
-        imageBytes[4*i + 0] = static_cast<png_byte>((p      ) & 0xFF);
-        imageBytes[4*i + 1] = static_cast<png_byte>((p >>  8) & 0xFF);
-        imageBytes[4*i + 2] = static_cast<png_byte>((p >> 16) & 0xFF);
-        imageBytes[4*i + 3] = static_cast<png_byte>((p >> 24) & 0xFF);
-    }
-
-    for (int y = Height - 1; y >= 0; --y) {
-        const png_bytep row = &imageBytes[static_cast<size_t>(y) * Width * 4];
+    for (int y = static_cast<int>(height) - 1; y >= 0; --y) {
+        const png_bytep row = &imageBytes[static_cast<size_t>(y) * width * 4];
         png_write_row(png_ptr, row);
     }
 
     png_write_end(png_ptr, nullptr);
     png_destroy_write_struct(&png_ptr, &info_ptr);
-    fclose(fp);
+    return fclose(fp) == 0;
 }
 
-AverageFramesProcessor::AverageFramesProcessor(const uint32_t frameIndex) : m_FrameIndex(frameIndex) {
+void Image::WritePng(const std::string& fileName) const
+{
+    WritePngParallel(fileName, *this);
 }
 
 void AverageFramesProcessor::ProcessImage(Image &input, Image &output) {
     output.Resize(input.Width, input.Height);
     for (uint32_t y = 0; y < input.Height; y++) {
         for (uint32_t x = 0; x < input.Width; x++) {
-            glm::vec4 accumulatedColor = input.GetPixel(x, y);
-            accumulatedColor /= static_cast<float>(m_FrameIndex);
-            output.SetPixel(x, y, accumulatedColor);
+            const glm::vec4 accumulatedColor = input.GetPixel(x, y);
+            const float sampleCount = std::max(accumulatedColor.a, 1.0f);
+            output.SetPixel(x, y, accumulatedColor / sampleCount);
         }
     }
 }
@@ -104,35 +117,196 @@ void TonemapACESProcessor::ProcessImage(Image &input, Image &output) {
     }
 }
 
+FalseColorProcessor::FalseColorProcessor(const int channel) : m_Channel(channel) {
+}
+
+void FalseColorProcessor::ProcessImage(Image &input, Image &output) {
+    float maxValue = 0.0f;
+    for (int i = 0; i < input.Width * input.Height; i++) {
+        maxValue = std::max(maxValue, input.Data[i][m_Channel]);
+    }
+    const float scale = maxValue > 0.0f ? 1.0f / maxValue : 0.0f;
+    output.Resize(input.Width, input.Height);
+    for (int i = 0; i < input.Width * input.Height; i++) {
+        const float t = input.Data[i][m_Channel] * scale;
+        // Blue -> green over the lower half, green -> red over the upper half.
+        const glm::vec3 color = t < 0.5f
+            ? glm::mix(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), t * 2.0f)
+            : glm::mix(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), t * 2.0f - 1.0f);
+        output.Data[i] = glm::vec4(color, 1.0f);
+    }
+}
+
+void DenoiseProcessor::SetParameters(const int iterations, const float colorSigma, const float normalSigma,
+    const float depthSigma) {
+    m_Iterations = iterations;
+    m_ColorSigma = colorSigma;
+    m_NormalSigma = normalSigma;
+    m_DepthSigma = depthSigma;
+}
+
+void DenoiseProcessor::SetFeatures(const Image& albedo, const Image& normalDepth) {
+    m_Albedo.Resize(albedo.Width, albedo.Height);
+    m_NormalDepth.Resize(normalDepth.Width, normalDepth.Height);
+    tbb::parallel_for(0, albedo.Height, [&](const int y) {
+        for (int x = 0; x < albedo.Width; x++) {
+            const glm::vec4 albedoSum = albedo.GetPixel(x, y);
+            const float invSampleCount = 1.0f / std::max(albedoSum.a, 1.0f);
+            m_Albedo.SetPixel(x, y, glm::vec4(glm::vec3(albedoSum) * invSampleCount, 1.0f));
+            m_NormalDepth.SetPixel(x, y, normalDepth.GetPixel(x, y) * invSampleCount);
+        }
+    });
+}
+
+void DenoiseProcessor::ProcessImage(Image &input, Image &output) {
+    if (m_Albedo.Width != input.Width || m_Albedo.Height != input.Height) {
+        output = input;
+        return;
+    }
+    constexpr float minAlbedo = 0.01f;
+    m_Irradiance.Resize(input.Width, input.Height);
+    m_Temp.Resize(input.Width, input.Height);
+    tbb::parallel_for(0, input.Height, [&](const int y) {
+        for (int x = 0; x < input.Width; x++) {
+            const glm::vec4 color = input.GetPixel(x, y);
+            const glm::vec3 albedo = glm::max(glm::vec3(m_Albedo.GetPixel(x, y)), glm::vec3(minAlbedo));
+            m_Irradiance.SetPixel(x, y, glm::vec4(glm::vec3(color) / albedo, color.a));
+        }
+    });
+
+    // The color tolerance halves every iteration, as the coarser levels have less noise left to remove.
+    float colorPhi = m_ColorSigma * m_ColorSigma;
+    for (int i = 0; i < m_Iterations; i++) {
+        filterPass(m_Irradiance, m_Temp, 1 << i, colorPhi);
+        std::swap(m_Irradiance, m_Temp);
+        colorPhi *= 0.5f;
+    }
+
+    output.Resize(input.Width, input.Height);
+    tbb::parallel_for(0, input.Height, [&](const int y) {
+        for (int x = 0; x < input.Width; x++) {
+            const glm::vec4 irradiance = m_Irradiance.GetPixel(x, y);
+            const glm::vec3 albedo = glm::max(glm::vec3(m_Albedo.GetPixel(x, y)), glm::vec3(minAlbedo));
+            output.SetPixel(x, y, glm::vec4(glm::vec3(irradiance) * albedo, irradiance.a));
+        }
+    });
+}
+
+void DenoiseProcessor::filterPass(const Image& input, Image& output, const int step, const float colorPhi) const {
+    constexpr float kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+    const float invColorPhi = 1.0f / std::max(colorPhi, 1e-6f);
+    const float invNormalPhi = 1.0f / std::max(m_NormalSigma * m_NormalSigma, 1e-6f);
+    const float invDepthSigma = 1.0f / std::max(m_DepthSigma, 1e-6f);
+
+    tbb::parallel_for(0, input.Height, [&](const int y) {
+        for (int x = 0; x < input.Width; x++) {
+            const glm::vec4 color = input.GetPixel(x, y);
+            const glm::vec4 normalDepth = m_NormalDepth.GetPixel(x, y);
+            const glm::vec3 normal = glm::vec3(normalDepth);
+            const float depth = normalDepth.w;
+
+            glm::vec3 sum(0.0f);
+            float weightSum = 0.0f;
+            for (int ky = 0; ky < 5; ky++) {
+                const int qy = y + (ky - 2) * step;
+                if (qy < 0 || qy >= input.Height) continue;
+                for (int kx = 0; kx < 5; kx++) {
+                    const int qx = x + (kx - 2) * step;
+                    if (qx < 0 || qx >= input.Width) continue;
+
+                    const glm::vec4 sampleColor = input.GetPixel(qx, qy);
+                    const glm::vec4 sampleNormalDepth = m_NormalDepth.GetPixel(qx, qy);
+                    const glm::vec3 colorDelta = glm::vec3(sampleColor) - glm::vec3(color);
+                    const glm::vec3 normalDelta = glm::vec3(sampleNormalDepth) - normal;
+                    const float depthDelta = std::abs(sampleNormalDepth.w - depth) / std::max(depth, 1e-3f);
+
+                    const float weight = kernel[kx] * kernel[ky]
+                        * std::exp(-glm::dot(colorDelta, colorDelta) * invColorPhi
+                            - glm::dot(normalDelta, normalDelta) * invNormalPhi
+                            - depthDelta * invDepthSigma);
+                    sum += weight * glm::vec3(sampleColor);
+                    weightSum += weight;
+                }
+            }
+            // The center tap always has weight kernel[2]^2, so weightSum is never zero.
+            output.SetPixel(x, y, glm::vec4(sum / weightSum, color.a));
+        }
+    });
+}
+
 BloomProcessor::BloomProcessor(const float threshold, const int levels, const int radius, const float sigma,
     const float intensity, bool dumpFramesToDisc, const std::string& dumpFolder)
     : m_Threshold(threshold), m_Levels(levels), m_Radius(radius), m_Sigma(sigma), m_Intensity(intensity),
     m_DumpFramesToDisc(dumpFramesToDisc), m_DumpFolder(dumpFolder) {
 }
 
+void BloomProcessor::SetParameters(const float threshold, const int levels, const int radius, const float sigma,
+    const float intensity) {
+    if (threshold != m_Threshold || levels != m_Levels || radius != m_Radius || sigma != m_Sigma) {
+        m_Threshold = threshold;
+        m_Levels = levels;
+        m_Radius = radius;
+        m_Sigma = sigma;
+        Invalidate();
+    }
+    m_Intensity = intensity;
+}
+
+void BloomProcessor::SetDumpFramesToDisc(const bool dumpFramesToDisc, const std::string &dumpFolder,
+    ImageWriter* writer) {
+    m_DumpFramesToDisc = dumpFramesToDisc;
+    m_DumpFolder = dumpFolder;
+    m_ImageWriter = writer;
+}
+
+void BloomProcessor::dumpImage(const Image &image, const std::string &fileName) const {
+    if (m_ImageWriter) {
+        m_ImageWriter->Enqueue(m_DumpFolder + "/" + fileName, image);
+    } else {
+        image.WritePng(m_DumpFolder + "/" + fileName);
+    }
+}
+
 void BloomProcessor::ProcessImage(Image &input, Image &output) {
+    // Dumps need every intermediate level, so they always rebuild the pyramid.
+    if (!m_IsBloomLayerValid || m_DumpFramesToDisc
+        || m_BloomLayer.Width != input.Width || m_BloomLayer.Height != input.Height)
+    {
+        buildBloomLayer(input);
+        m_IsBloomLayerValid = true;
+    }
+
     output.Resize(input.Width, input.Height);
+    for (uint32_t y = 0; y < output.Height; y++)
+    {
+        for (uint32_t x = 0; x < output.Width; x++)
+        {
+            output.SetPixel(x, y, input.GetPixel(x, y) + m_Intensity * m_BloomLayer.GetPixel(x, y));
+        }
+    }
+}
 
+void BloomProcessor::buildBloomLayer(const Image &input) {
     Image bright {};
     bright.Resize(input.Width, input.Height);
     brightPass(input, bright);
     if (m_DumpFramesToDisc)
     {
-        bright.WritePng(m_DumpFolder + "/2.1. BloomBright.png");
+        dumpImage(bright, "2.1. BloomBright.png");
     }
 
     std::vector<Image> pyramid;
     pyramid.reserve(std::max(m_Levels, 1));
-    pyramid.push_back(bright);
+    pyramid.push_back(std::move(bright));
 
     for (int i = 1; i < m_Levels; ++i) {
         Image current {};
         downsample2x(pyramid.back(), current);
-        pyramid.push_back(current);
         if (m_DumpFramesToDisc)
         {
-            current.WritePng(m_DumpFolder + "/2.2. BloomDownsamples_Level" + std::to_string(i+1) + ".png");
+            dumpImage(current, "2.2. BloomDownsamples_Level" + std::to_string(i+1) + ".png");
         }
+        pyramid.push_back(std::move(current));
     }
 
     int i = 1;
@@ -141,7 +315,7 @@ void BloomProcessor::ProcessImage(Image &input, Image &output) {
         gaussianBlurSeparable(level);
         if (m_DumpFramesToDisc)
         {
-            level.WritePng(m_DumpFolder + "/2.2. BloomGaussianBlur_Level" + std::to_string(i++) + ".png");
+            dumpImage(level, "2.2. BloomGaussianBlur_Level" + std::to_string(i++) + ".png");
         }
     }
 
@@ -150,17 +324,11 @@ void BloomProcessor::ProcessImage(Image &input, Image &output) {
         upsampleAdd(pyramid[i - 1], pyramid[i], 1.0f);
         if (m_DumpFramesToDisc)
         {
-            pyramid[i - 1].WritePng(m_DumpFolder + "/2.2. BloomUpsampledAdd_Level" + std::to_string(i) + ".png");
+            dumpImage(pyramid[i - 1], "2.2. BloomUpsampledAdd_Level" + std::to_string(i) + ".png");
         }
     }
 
-    for (uint32_t y = 0; y < output.Height; y++)
-    {
-        for (uint32_t x = 0; x < output.Width; x++)
-        {
-            output.AddColor(x, y, m_Intensity * pyramid[0].GetPixel(x, y));
-        }
-    }
+    m_BloomLayer = std::move(pyramid[0]);
 }
 
 float BloomProcessor::luminance(const glm::vec3 &color) {
@@ -1,11 +1,55 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
 #include <glm/glm.hpp>
 
+// Writes packed RGBA8 pixels (as produced by Image::ToRGBA8) bottom row first, matching the
+// renderer's y-up images. Returns false if the file couldn't be written.
+bool WritePngRGBA8(const std::string& fileName, const uint32_t* pixels, uint32_t width, uint32_t height);
+
+class ImageWriter;
+
 struct Image {
     int Width = 0, Height = 0;
     glm::vec4* Data = nullptr;
 
+    Image() = default;
+
+    Image(const Image& other) {
+        *this = other;
+    }
+
+    Image(Image&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    ~Image() {
+        delete[] Data;
+    }
+
+    Image& operator=(const Image& other) {
+        if (this != &other) {
+            Resize(other.Width, other.Height);
+            std::copy_n(other.Data, Width * Height, Data);
+        }
+        return *this;
+    }
+
+    Image& operator=(Image&& other) noexcept {
+        if (this != &other) {
+            delete[] Data;
+            Data = std::exchange(other.Data, nullptr);
+            Width = std::exchange(other.Width, 0);
+            Height = std::exchange(other.Height, 0);
+        }
+        return *this;
+    }
+
     void Resize(const int width, const int height) {
         if (width != Width || height != Height) {
             delete[] Data;
@@ -15,6 +59,7 @@ struct Image {
         }
     }
 
+    // Synchronous; frame dumps go through an ImageWriter instead.
     void WritePng(const std::string& fileName) const;
 
     [[nodiscard]] glm::vec4 GetPixel(const uint32_t x, const uint32_t y) const {
@@ -59,13 +104,12 @@ public:
     virtual void ProcessImage(Image &input, Image &output) = 0;
 };
 
+// Divides every accumulated pixel by its sample count, kept in the alpha channel.
 class AverageFramesProcessor final : public ImagePostProcessor {
 public:
-    explicit AverageFramesProcessor(uint32_t frameIndex);
+    AverageFramesProcessor() = default;
 
     void ProcessImage(Image &input, Image &output) override;
-private:
-    uint32_t m_FrameIndex = 0;
 };
 
 class GammaCorrectionProcessor final : public ImagePostProcessor {
@@ -93,13 +137,71 @@ public:
     void ProcessImage(Image &input, Image &output) override;
 };
 
+// Maps one channel of the input to a blue-green-red ramp, scaled so that the largest value is red.
+class FalseColorProcessor final : public ImagePostProcessor {
+public:
+    explicit FalseColorProcessor(int channel);
+
+    void ProcessImage(Image &input, Image &output) override;
+private:
+    int m_Channel;
+};
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010). The radiance is divided by the first-hit
+// albedo, so only lighting is blurred and texture detail survives, and the filter stops at normal and
+// depth discontinuities. Each iteration doubles the step of the 5x5 kernel.
+class DenoiseProcessor final : public ImagePostProcessor {
+public:
+    DenoiseProcessor() = default;
+
+    void SetParameters(int iterations, float colorSigma, float normalSigma, float depthSigma);
+
+    // Accumulated feature buffers: albedo sums with the sample count in alpha, and normal and depth
+    // sums in xyz and w. Must be set before every ProcessImage with an updated input.
+    void SetFeatures(const Image& albedo, const Image& normalDepth);
+
+    // The features given to SetFeatures(), divided by the sample count.
+    [[nodiscard]] const Image& GetAlbedo() const { return m_Albedo; }
+    [[nodiscard]] const Image& GetNormalDepth() const { return m_NormalDepth; }
+
+    void ProcessImage(Image &input, Image &output) override;
+private:
+    void filterPass(const Image& input, Image& output, int step, float colorPhi) const;
+
+    int m_Iterations = 5;
+    float m_ColorSigma = 0.5f;
+    float m_NormalSigma = 0.1f;
+    float m_DepthSigma = 0.1f;
+
+    Image m_Albedo;
+    Image m_NormalDepth;
+    Image m_Irradiance;
+    Image m_Temp;
+};
+
+// Keeps the blurred bloom layer between calls: as long as the input and the pyramid parameters are
+// unchanged, only the final composite (and thus Intensity) is re-applied.
 class BloomProcessor final : public ImagePostProcessor {
 public:
+    BloomProcessor() = default;
+
     explicit BloomProcessor(float threshold, int levels, int radius, float sigma, float intensity,
         bool dumpFramesToDisc, const std::string& dumpFolder);
 
+    void SetParameters(float threshold, int levels, int radius, float sigma, float intensity);
+
+    // Intermediate levels are queued on writer if given, written right away otherwise.
+    void SetDumpFramesToDisc(bool dumpFramesToDisc, const std::string& dumpFolder, ImageWriter* writer = nullptr);
+
+    // Must be called whenever the input image changes.
+    void Invalidate() { m_IsBloomLayerValid = false; }
+
     void ProcessImage(Image &input, Image &output) override;
 private:
+    void buildBloomLayer(const Image &input);
+
+    void dumpImage(const Image &image, const std::string &fileName) const;
+
     float luminance(const glm::vec3& color);
 
     void brightPass(const Image &input, const Image &output);
@@ -112,11 +214,15 @@ private:
 
     void upsampleAdd(Image& big, const Image& small, float gain = 1.0f);
 
-    float m_Threshold;
-    int m_Levels;
-    int m_Radius;
-    float m_Sigma;
-    float m_Intensity;
-    bool m_DumpFramesToDisc;
+    float m_Threshold = 1.0f;
+    int m_Levels = 4;
+    int m_Radius = 6;
+    float m_Sigma = 4.0f;
+    float m_Intensity = 0.6f;
+    bool m_DumpFramesToDisc = false;
     std::string m_DumpFolder;
+    ImageWriter* m_ImageWriter = nullptr;
+
+    Image m_BloomLayer;
+    bool m_IsBloomLayerValid = false;
 };
@@ -0,0 +1,236 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include <zlib.h>
+
+#include <tbb/parallel_for.h>
+
+#include "utils/Profiler.h"
+
+namespace {
+    // Rows deflated together; every strip ends with a sync flush so the strips concatenate into one stream.
+    constexpr uint32_t RowsPerStrip = 64;
+    // Deflate's window: each strip is primed with this much of the data before it, so splitting into
+    // strips costs almost no compression.
+    constexpr size_t DeflateWindow = 32768;
+    constexpr uint8_t FilterUp = 2;
+
+    struct Strip
+    {
+        std::vector<uint8_t> Deflated;
+        uLong Adler = 1;
+        size_t Size = 0;
+    };
+
+    uint8_t toByte(const float value) {
+        return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+    }
+
+    void putUint32(uint8_t* out, const uint32_t value) {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    bool writeChunk(FILE* file, const char* type, const uint8_t* data, const size_t size) {
+        std::array<uint8_t, 4> length{};
+        putUint32(length.data(), static_cast<uint32_t>(size));
+        uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+        if (size > 0) {
+            crc = crc32(crc, data, static_cast<uInt>(size));
+        }
+        std::array<uint8_t, 4> crcBytes{};
+        putUint32(crcBytes.data(), static_cast<uint32_t>(crc));
+        return std::fwrite(length.data(), 1, 4, file) == 4
+            && std::fwrite(type, 1, 4, file) == 4
+            && (size == 0 || std::fwrite(data, 1, size, file) == size)
+            && std::fwrite(crcBytes.data(), 1, 4, file) == 4;
+    }
+
+    // Raw deflate of one strip. Only the last strip finishes the stream.
+    bool deflateStrip(const uint8_t* data, const size_t size, const uint8_t* dictionary, const size_t dictionarySize,
+        const int compressionLevel, const bool isLast, Strip& strip) {
+        z_stream stream{};
+        if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        if (dictionarySize > 0) {
+            deflateSetDictionary(&stream, dictionary, static_cast<uInt>(dictionarySize));
+        }
+        // A sync flush adds an empty stored block on top of the bound.
+        strip.Deflated.resize(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = strip.Deflated.data();
+        stream.avail_out = static_cast<uInt>(strip.Deflated.size());
+        const int result = deflate(&stream, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+        const bool isComplete = isLast ? result == Z_STREAM_END : result == Z_OK && stream.avail_in == 0;
+        strip.Deflated.resize(stream.total_out);
+        deflateEnd(&stream);
+        strip.Adler = adler32(1, data, static_cast<uInt>(size));
+        strip.Size = size;
+        return isComplete;
+    }
+}
+
+bool WritePngParallel(const std::string& fileName, const Image& image, const int compressionLevel)
+{
+    DAZHBOG_PROFILE_ZONE("WritePng");
+    const auto width = static_cast<uint32_t>(image.Width);
+    const auto height = static_cast<uint32_t>(image.Height);
+    if (width == 0 || height == 0) {
+        return false;
+    }
+    const size_t rowSize = static_cast<size_t>(width) * 4 + 1;
+    const uint32_t stripCount = (height + RowsPerStrip - 1) / RowsPerStrip;
+
+    // PNG rows go top to bottom, the image is stored bottom row first. Every row is "up" filtered
+    // against the row above it in the file, computed from the float pixels again rather than kept.
+    std::vector<uint8_t> filtered(rowSize * height);
+    tbb::parallel_for<uint32_t>(0, height, [&](const uint32_t row) {
+        uint8_t* out = &filtered[row * rowSize];
+        const glm::vec4* pixels = &image.Data[static_cast<size_t>(height - 1 - row) * width];
+        const glm::vec4* above = row > 0 ? pixels + width : nullptr;
+        out[0] = FilterUp;
+        for (uint32_t x = 0; x < width; x++) {
+            for (int c = 0; c < 4; c++) {
+                const uint8_t value = toByte(pixels[x][c]);
+                out[1 + x * 4 + c] = above ? static_cast<uint8_t>(value - toByte(above[x][c])) : value;
+            }
+        }
+    });
+
+    std::vector<Strip> strips(stripCount);
+    std::atomic<bool> isDeflated = true;
+    tbb::parallel_for<uint32_t>(0, stripCount, [&](const uint32_t i) {
+        const size_t begin = static_cast<size_t>(i) * RowsPerStrip * rowSize;
+        const size_t end = std::min(filtered.size(), begin + RowsPerStrip * rowSize);
+        const size_t dictionarySize = std::min(begin, DeflateWindow);
+        if (!deflateStrip(&filtered[begin], end - begin, &filtered[begin - dictionarySize], dictionarySize,
+            compressionLevel, i + 1 == stripCount, strips[i])) {
+            isDeflated = false;
+        }
+    });
+    if (!isDeflated) {
+        return false;
+    }
+
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    constexpr std::array<uint8_t, 8> Signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::array<uint8_t, 13> header{};
+    putUint32(&header[0], width);
+    putUint32(&header[4], height);
+    header[8] = 8;  // bit depth
+    header[9] = 6;  // RGBA
+    // Compression, filter and interlace methods stay 0.
+
+    // The zlib header, FLEVEL following the compression level as zlib itself does.
+    const uint8_t level = compressionLevel < 2 ? 0 : compressionLevel < 6 ? 1 : compressionLevel == 6 ? 2 : 3;
+    std::array<uint8_t, 2> zlibHeader = {0x78, static_cast<uint8_t>(level << 6)};
+    zlibHeader[1] += static_cast<uint8_t>(31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31);
+
+    uLong adler = 1;
+    for (const Strip& strip : strips) {
+        adler = adler32_combine(adler, strip.Adler, static_cast<z_off_t>(strip.Size));
+    }
+    std::array<uint8_t, 4> adlerBytes{};
+    putUint32(adlerBytes.data(), static_cast<uint32_t>(adler));
+
+    // The zlib stream is split over IDAT chunks: the header, one chunk per strip, and the checksum.
+    bool isWritten = std::fwrite(Signature.data(), 1, Signature.size(), file) == Signature.size()
+        && writeChunk(file, "IHDR", header.data(), header.size())
+        && writeChunk(file, "IDAT", zlibHeader.data(), zlibHeader.size());
+    for (const Strip& strip : strips) {
+        isWritten = isWritten && writeChunk(file, "IDAT", strip.Deflated.data(), strip.Deflated.size());
+    }
+    isWritten = isWritten
+        && writeChunk(file, "IDAT", adlerBytes.data(), adlerBytes.size())
+        && writeChunk(file, "IEND", nullptr, 0);
+    return std::fclose(file) == 0 && isWritten;
+}
+
+ImageWriter::ImageWriter(const int compressionLevel) : m_CompressionLevel(std::clamp(compressionLevel, 0, 9)) {
+}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_IsStopping = true;
+    }
+    m_RequestAdded.notify_one();
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
+
+void ImageWriter::SetCompressionLevel(const int compressionLevel) {
+    std::lock_guard lock(m_Mutex);
+    m_CompressionLevel = std::clamp(compressionLevel, 0, 9);
+}
+
+void ImageWriter::Enqueue(std::string fileName, Image image) {
+    EnqueueWrite(std::move(fileName), [image = std::move(image)](const std::string& name, const int compressionLevel) {
+        return WritePngParallel(name, image, compressionLevel);
+    });
+}
+
+void ImageWriter::EnqueueExr(std::string fileName, std::vector<ExrLayer> layers) {
+    EnqueueWrite(std::move(fileName), [layers = std::move(layers)](const std::string& name, const int compressionLevel) {
+        std::vector<ExrChannel> channels;
+        for (const ExrLayer& layer : layers) {
+            AddExrChannels(channels, layer.Pixels, layer.ChannelNames);
+        }
+        return WriteExr(name, std::move(channels), compressionLevel);
+    });
+}
+
+void ImageWriter::EnqueueWrite(std::string fileName, WriteFunction write) {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Queue.push_back({std::move(fileName), std::move(write)});
+        if (!m_Thread.joinable()) {
+            m_Thread = std::thread([this] { run(); });
+        }
+    }
+    m_RequestAdded.notify_one();
+}
+
+void ImageWriter::Flush() {
+    std::unique_lock lock(m_Mutex);
+    m_QueueDrained.wait(lock, [this] { return m_Queue.empty() && !m_IsWriting; });
+}
+
+void ImageWriter::run() {
+    DAZHBOG_PROFILE_THREAD("Image writer");
+    std::unique_lock lock(m_Mutex);
+    while (true) {
+        m_RequestAdded.wait(lock, [this] { return !m_Queue.empty() || m_IsStopping; });
+        if (m_Queue.empty()) {
+            return;
+        }
+        Request request = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        m_IsWriting = true;
+        const int compressionLevel = m_CompressionLevel;
+        lock.unlock();
+
+        if (!request.Write(request.FileName, compressionLevel)) {
+            std::fprintf(stderr, "Failed to write %s\n", request.FileName.c_str());
+        }
+
+        lock.lock();
+        m_IsWriting = false;
+        if (m_Queue.empty()) {
+            m_QueueDrained.notify_all();
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FloatImageIO.h"
+#include "ImagePostProcessors.h"
+
+// Writes an image as an 8-bit RGBA PNG, bottom row first like Image::ToRGBA8. The rows are filtered
+// and deflated in parallel strips straight from the float pixels, without an intermediate RGBA8 copy.
+// compressionLevel is zlib's, 0 (stored) to 9.
+bool WritePngParallel(const std::string& fileName, const Image& image, int compressionLevel = 6);
+
+// Background queue for frame dumps and other large files: Enqueue() only moves the images in, they are
+// encoded and written on the writer's own thread, in order. Failed writes are reported on stderr.
+class ImageWriter {
+public:
+    using WriteFunction = std::function<bool(const std::string& fileName, int compressionLevel)>;
+
+    // An image of a multi-channel EXR; ChannelNames[i] names component i, see AddExrChannels().
+    struct ExrLayer
+    {
+        Image Pixels;
+        std::vector<std::string> ChannelNames;
+    };
+
+    explicit ImageWriter(int compressionLevel = 6);
+
+    // Writes everything still queued.
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    // Applies to images written from now on.
+    void SetCompressionLevel(int compressionLevel);
+
+    // As an 8-bit PNG.
+    void Enqueue(std::string fileName, Image image);
+
+    // As a float EXR with the channels of all layers, which must be of the same size.
+    void EnqueueExr(std::string fileName, std::vector<ExrLayer> layers);
+
+    // Any other file; write gets the file name and the compression level.
+    void EnqueueWrite(std::string fileName, WriteFunction write);
+
+    // Blocks until every queued image has been written.
+    void Flush();
+
+private:
+    struct Request
+    {
+        std::string FileName;
+        WriteFunction Write;
+    };
+
+    void run();
+
+    std::mutex m_Mutex;
+    std::condition_variable m_RequestAdded;
+    std::condition_variable m_QueueDrained;
+    std::deque<Request> m_Queue;
+    int m_CompressionLevel;
+    bool m_IsWriting = false;
+    bool m_IsStopping = false;
+    // Started with the first request, so renderers that never dump don't keep an idle thread.
+    std::thread m_Thread;
+};
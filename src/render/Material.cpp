@@ -5,8 +5,25 @@
 #include "math/ColorUtils.h"
 #include "math/Random.h"
 
-LambertMaterial::LambertMaterial(const glm::vec3 Albedo)
-    : m_Albedo(Albedo) {
+namespace {
+    glm::vec3 textureAlbedo(const glm::vec3& albedo, const Texture* texture, const HitPayload& hitPayload) {
+        return texture ? albedo * texture->Sample(hitPayload.TextureCoordinates, hitPayload.TextureFootprint) : albedo;
+    }
+
+    void hashTexture(Utils::Fnv1a& hash, const Texture* texture) {
+        hash.Add(texture != nullptr);
+        if (texture) {
+            texture->Hash(hash);
+        }
+    }
+}
+
+LambertMaterial::LambertMaterial(const glm::vec3 Albedo, std::shared_ptr<const Texture> albedoTexture)
+    : m_Albedo(Albedo), m_AlbedoTexture(std::move(albedoTexture)) {
+}
+
+glm::vec3 LambertMaterial::GetAlbedo(const HitPayload& hitPayload) const {
+    return textureAlbedo(m_Albedo, m_AlbedoTexture.get(), hitPayload);
 }
 
 ScatterRays LambertMaterial::Scatter(const Ray &ray, const HitPayload &hitPayload, uint32_t& randomSeed) const {
@@ -19,16 +36,27 @@ ScatterRays LambertMaterial::Scatter(const Ray &ray, const HitPayload &hitPayloa
 
     scattered.Ray.Origin = hitPayload.WorldPosition + hitPayload.WorldNormal * 0.0001f;
     scattered.Ray.Direction = scatterDirection;
-    scattered.Attenuation = m_Albedo;
+    scattered.Attenuation = GetAlbedo(hitPayload);
     scattered.Scattered = true;
     return scattered;
 }
 
-MetalMaterial::MetalMaterial(const glm::vec3 albedo, const float fuzziness)
-    : m_Albedo(albedo), m_Fuzziness(fuzziness < 1.0f ? fuzziness : 1.0f)
+void LambertMaterial::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('L');
+    hash.Add(m_Albedo);
+    hashTexture(hash, m_AlbedoTexture.get());
+}
+
+MetalMaterial::MetalMaterial(const glm::vec3 albedo, const float fuzziness, std::shared_ptr<const Texture> albedoTexture)
+    : m_Albedo(albedo), m_Fuzziness(fuzziness < 1.0f ? fuzziness : 1.0f), m_AlbedoTexture(std::move(albedoTexture))
 {
 }
 
+glm::vec3 MetalMaterial::GetAlbedo(const HitPayload& hitPayload) const
+{
+    return textureAlbedo(m_Albedo, m_AlbedoTexture.get(), hitPayload);
+}
+
 ScatterRays MetalMaterial::Scatter(const Ray& ray, const HitPayload& hitPayload, uint32_t& randomSeed) const
 {
     ScatterRays scattered{};
@@ -38,11 +66,18 @@ ScatterRays MetalMaterial::Scatter(const Ray& ray, const HitPayload& hitPayload,
 
     const auto normalWithOffset = hitPayload.WorldNormal;// * 0.0001f;
     scattered.Ray = Ray(hitPayload.WorldPosition + normalWithOffset, reflected);
-    scattered.Attenuation = m_Albedo;
+    scattered.Attenuation = GetAlbedo(hitPayload);
     scattered.Scattered = glm::dot(scattered.Ray.Direction, normalWithOffset) > 0.0f;
     return scattered;
 }
 
+void MetalMaterial::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('M');
+    hash.Add(m_Albedo);
+    hash.Add(m_Fuzziness);
+    hashTexture(hash, m_AlbedoTexture.get());
+}
+
 DiffuseLightMaterial::DiffuseLightMaterial(const glm::vec3 emissionColor, const float emissionPower)
     : m_EmissionColor(ColorUtils::SRGBToLinear(emissionColor)), m_EmissionPower(emissionPower) {
 }
@@ -54,6 +89,12 @@ ScatterRays DiffuseLightMaterial::Scatter(const Ray &ray, const HitPayload &hitP
     };
 }
 
+void DiffuseLightMaterial::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('E');
+    hash.Add(m_EmissionColor);
+    hash.Add(m_EmissionPower);
+}
+
 DielectricMaterial::DielectricMaterial(float refractionIndex): m_RefractionIndex(refractionIndex) {
 }
 
@@ -84,6 +125,11 @@ ScatterRays DielectricMaterial::Scatter(const Ray &ray, const HitPayload &hitPay
     return scattered;
 }
 
+void DielectricMaterial::Hash(Utils::Fnv1a &hash) const {
+    hash.Add('D');
+    hash.Add(m_RefractionIndex);
+}
+
 double DielectricMaterial::reflectance(const double cosine, const double refractionIndex) {
     // Use Schlick's approximation for reflectance.
     auto r0 = (1 - refractionIndex) / (1 + refractionIndex);
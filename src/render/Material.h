@@ -1,8 +1,11 @@
 #pragma once
+#include <memory>
+
+#include "Texture.h"
 #include "math/Hittable.h"
 
 struct ScatterRays {
-    Ray Ray{};
+    ::Ray Ray{};
     glm::vec3 Attenuation;
     bool Scattered = true;
     glm::vec3 Emission = { 0.0f, 0.0f, 0.0f };
@@ -13,27 +16,45 @@ public:
     virtual ~Material() = default;
 
     virtual ScatterRays Scatter(const Ray& ray, const HitPayload& hitPayload, uint32_t& randomSeed) const = 0;
+
+    // Surface color at the hit without lighting, used as a guide by the denoiser.
+    [[nodiscard]] virtual glm::vec3 GetAlbedo(const HitPayload& hitPayload) const = 0;
+
+    // Adds every parameter of the material, so equal hashes mean equal appearance.
+    virtual void Hash(Utils::Fnv1a& hash) const = 0;
 };
 
 class LambertMaterial final : public Material
 {
 public:
-    explicit LambertMaterial(glm::vec3 Albedo);
+    // With a texture, the albedo is its color at the hit's texture coordinates times Albedo.
+    explicit LambertMaterial(glm::vec3 Albedo, std::shared_ptr<const Texture> albedoTexture = nullptr);
 
     ScatterRays Scatter(const Ray &ray, const HitPayload &hitPayload, uint32_t& randomSeed) const override;
+
+    [[nodiscard]] glm::vec3 GetAlbedo(const HitPayload& hitPayload) const override;
+
+    void Hash(Utils::Fnv1a& hash) const override;
 private:
     glm::vec3 m_Albedo;
+    std::shared_ptr<const Texture> m_AlbedoTexture;
 };
 
 class MetalMaterial final : public Material
 {
 public:
-    explicit MetalMaterial(glm::vec3 albedo, float fuzziness);
+    // The texture tints the albedo like LambertMaterial's.
+    explicit MetalMaterial(glm::vec3 albedo, float fuzziness, std::shared_ptr<const Texture> albedoTexture = nullptr);
 
     ScatterRays Scatter(const Ray& ray, const HitPayload& hitPayload, uint32_t& randomSeed) const override;
+
+    [[nodiscard]] glm::vec3 GetAlbedo(const HitPayload& hitPayload) const override;
+
+    void Hash(Utils::Fnv1a& hash) const override;
 private:
     glm::vec3 m_Albedo;
     float m_Fuzziness;
+    std::shared_ptr<const Texture> m_AlbedoTexture;
 };
 
 class DiffuseLightMaterial final : public Material
@@ -42,6 +63,10 @@ public:
     explicit DiffuseLightMaterial(glm::vec3 emissionColor, float emissionPower);
 
     ScatterRays Scatter(const Ray& ray, const HitPayload& hitPayload, uint32_t& randomSeed) const override;
+
+    [[nodiscard]] glm::vec3 GetAlbedo(const HitPayload&) const override { return m_EmissionColor; }
+
+    void Hash(Utils::Fnv1a& hash) const override;
 private:
     glm::vec3 m_EmissionColor;
     float m_EmissionPower;
@@ -54,6 +79,10 @@ public:
 
     ScatterRays Scatter(const Ray &ray, const HitPayload &hitPayload, uint32_t &randomSeed) const override;
 
+    [[nodiscard]] glm::vec3 GetAlbedo(const HitPayload&) const override { return glm::vec3(1.0f); }
+
+    void Hash(Utils::Fnv1a& hash) const override;
+
 private:
     static double reflectance(double cosine, double refractionIndex);
 
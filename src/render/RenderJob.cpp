@@ -0,0 +1,82 @@
+#include "RenderJob.h"
+
+#include <algorithm>
+
+#include "utils/Profiler.h"
+
+RenderJob::RenderJob(const Description& description)
+    : m_Camera(description.VerticalFOV, 0.1f, 100.0f,
+        glm::vec2(static_cast<float>(description.Width), static_cast<float>(description.Height))),
+    m_FramesToAccumulate(description.Settings.FramesToAccumulate) {
+    m_Camera.PlaceInWorld(description.CameraPosition, description.CameraDirection);
+    m_Renderer = std::make_unique<Renderer>(&m_Camera, description.Scene,
+        glm::vec2(static_cast<float>(description.Width), static_cast<float>(description.Height)));
+    m_Renderer->SetSettings(description.Settings);
+    m_Renderer->SetRadianceOutput(description.CaptureRadiance);
+    m_Renderer->SetCancellationToken(&m_CancellationToken);
+    m_Renderer->SetFrameReadyHandler([this] { onFrameReady(); });
+    if (!description.CheckpointPath.empty()) {
+        m_IsResumed = m_Renderer->ResumeFromCheckpoint(description.CheckpointPath);
+        m_Renderer->SetCheckpoint(description.CheckpointPath, description.CheckpointInterval);
+    }
+}
+
+RenderJob::~RenderJob() {
+    Cancel();
+    Wait();
+}
+
+void RenderJob::Start() {
+    m_StartTime = Clock::now();
+    m_Thread = std::thread([this] { run(); });
+}
+
+void RenderJob::Cancel() {
+    m_CancellationToken.Cancel();
+}
+
+void RenderJob::Wait() {
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
+
+void RenderJob::run() {
+    DAZHBOG_PROFILE_THREAD("Render job");
+    while (!m_CancellationToken.IsCancelled()) {
+        const Renderer::RenderingStatus status = m_Renderer->Render();
+        if (status.Cancelled || status.RenderFinished) break;
+        m_FrameRenderTime.store(status.FrameRenderTime, std::memory_order_relaxed);
+        std::lock_guard lock(m_StatisticsMutex);
+        m_Statistics += status.Statistics;
+    }
+    // The final image is only complete once its post-processing is done.
+    m_Renderer->WaitForPostProcessing();
+}
+
+void RenderJob::onFrameReady() {
+    const Renderer::FinalImage* image = m_Renderer->AcquireFinalImage();
+    if (!image) return;
+
+    Renderer::RenderStatistics statistics;
+    {
+        std::lock_guard lock(m_StatisticsMutex);
+        statistics = m_Statistics;
+    }
+    const Progress progress = {
+        .FrameIndex = image->FrameIndex,
+        .Convergence = std::min(1.0f, static_cast<float>(image->FrameIndex) / static_cast<float>(std::max(m_FramesToAccumulate, 1))),
+        .FrameRenderTime = m_FrameRenderTime.load(std::memory_order_relaxed),
+        .ElapsedTime = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_StartTime).count()),
+        .Statistics = statistics,
+        .IsFinal = image->IsFinal,
+    };
+    if (image->IsFinal) {
+        m_Result = *image;
+        m_IsFinished.store(true, std::memory_order_release);
+    }
+    if (m_ProgressHandler) {
+        m_ProgressHandler(progress, *image);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Camera.h"
+#include "Renderer.h"
+#include "scene/Scene.h"
+#include "utils/CancellationToken.h"
+
+// A single render of a scene, from a fixed camera until the image converges. The job owns its camera
+// and renderer and runs them on a thread of its own, so any number of jobs can run side by side; they
+// only share the scene, which is read-only while rendering.
+class RenderJob {
+public:
+    struct Description
+    {
+        ::Scene* Scene = nullptr;
+        glm::vec3 CameraPosition{0.0f};
+        glm::vec3 CameraDirection{0.0f, 0.0f, -1.0f};
+        float VerticalFOV = 45.0f;
+        uint32_t Width = 1280, Height = 720;
+        Renderer::Settings Settings;
+        // Fill FinalImage::Radiance in every progressive image.
+        bool CaptureRadiance = false;
+        // If set, the job resumes from this checkpoint when it matches, and saves one every
+        // CheckpointInterval frames.
+        std::string CheckpointPath;
+        uint32_t CheckpointInterval = 32;
+    };
+    struct Progress
+    {
+        // Frames accumulated into the image, and the fraction of FramesToAccumulate this is.
+        uint32_t FrameIndex = 0;
+        float Convergence = 0.0f;
+        // Milliseconds spent tracing the latest frame, and since Start().
+        uint64_t FrameRenderTime = 0;
+        uint64_t ElapsedTime = 0;
+        // Rays and intersection tests of all frames traced so far.
+        Renderer::RenderStatistics Statistics;
+        bool IsFinal = false;
+    };
+
+    // Called from the job's post-processing stage with every progressive image. Intermediate images are
+    // dropped while the handler is busy, the final one never is.
+    using ProgressHandler = std::function<void(const Progress& progress, const Renderer::FinalImage& image)>;
+
+    explicit RenderJob(const Description& description);
+
+    // Cancels the job if it is still running.
+    ~RenderJob();
+
+    // Must be set before Start().
+    void SetProgressHandler(const ProgressHandler& handler) { m_ProgressHandler = handler; }
+
+    void Start();
+
+    // Stops at the next tile row; the job then finishes without a final image.
+    void Cancel();
+
+    // Blocks until the job has converged or was cancelled.
+    void Wait();
+
+    [[nodiscard]] bool IsFinished() const { return m_IsFinished.load(std::memory_order_acquire); }
+
+    // Set if the job continued from Description::CheckpointPath instead of starting over.
+    [[nodiscard]] bool IsResumed() const { return m_IsResumed; }
+
+    // The converged image. Only valid after Wait() if IsFinished().
+    [[nodiscard]] const Renderer::FinalImage& GetResult() const { return m_Result; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+
+    void onFrameReady();
+
+    Camera m_Camera;
+    std::unique_ptr<Renderer> m_Renderer;
+    int m_FramesToAccumulate;
+    Utils::CancellationToken m_CancellationToken;
+    ProgressHandler m_ProgressHandler;
+
+    Clock::time_point m_StartTime{};
+    std::atomic<uint64_t> m_FrameRenderTime = 0;
+    std::mutex m_StatisticsMutex;
+    Renderer::RenderStatistics m_Statistics;
+    std::atomic<bool> m_IsFinished = false;
+    bool m_IsResumed = false;
+    Renderer::FinalImage m_Result;
+
+    std::thread m_Thread;
+};
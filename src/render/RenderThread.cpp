@@ -0,0 +1,112 @@
+#include "RenderThread.h"
+
+#include "utils/Profiler.h"
+
+RenderThread::RenderThread(const Camera& camera, Scene* scene, const glm::vec2 viewportSize,
+    const Renderer::Settings& settings) : m_Camera(camera), m_SubmittedIntegratorSettings(settings.Integrator) {
+    m_Camera.OnResize(static_cast<uint32_t>(viewportSize.x), static_cast<uint32_t>(viewportSize.y));
+    m_Renderer = std::make_unique<Renderer>(&m_Camera, scene, viewportSize);
+    m_Renderer->SetSettings(settings);
+    m_Renderer->SetCancellationToken(&m_CancellationToken);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard lock(m_CommandsMutex);
+        m_IsStopRequested = true;
+        m_CancellationToken.Cancel();
+    }
+    m_CommandsAvailable.notify_one();
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
+
+void RenderThread::SetFrameReadyHandler(const FrameReadyHandler& handler) {
+    m_FrameReadyHandler = handler;
+    m_Renderer->SetFrameReadyHandler(handler);
+}
+
+void RenderThread::Start() {
+    m_Thread = std::thread([this] { run(); });
+}
+
+void RenderThread::Submit(Command command) {
+    {
+        std::lock_guard lock(m_CommandsMutex);
+        if (invalidatesFrame(command)) {
+            m_CancellationToken.Cancel();
+        }
+        if (const auto* setSettings = std::get_if<SetSettingsCommand>(&command)) {
+            m_SubmittedIntegratorSettings = setSettings->Settings.Integrator;
+        }
+        m_Commands.push_back(std::move(command));
+    }
+    m_CommandsAvailable.notify_one();
+}
+
+const Renderer::FinalImage* RenderThread::AcquireFinalImage() {
+    return m_Renderer->AcquireFinalImage();
+}
+
+bool RenderThread::AcquireStatus(Renderer::RenderingStatus& status) {
+    if (!m_Statuses.Acquire()) return false;
+    status = m_Statuses.Front();
+    return true;
+}
+
+void RenderThread::run() {
+    DAZHBOG_PROFILE_THREAD("Render thread");
+    std::vector<Command> commands;
+    bool isConverged = false;
+    while (true) {
+        {
+            std::unique_lock lock(m_CommandsMutex);
+            // Once converged there is nothing to do until something changes, so sleep instead of
+            // calling Render() in a loop.
+            m_CommandsAvailable.wait(lock, [&] {
+                return m_IsStopRequested || !m_Commands.empty() || !isConverged;
+            });
+            if (m_IsStopRequested) return;
+            commands.swap(m_Commands);
+            // Reset under the lock: a command submitted from here on cancels the frame below.
+            m_CancellationToken.Reset();
+        }
+        for (Command& command : commands) {
+            apply(command);
+        }
+        commands.clear();
+
+        m_Renderer->SetCameraMoving(Clock::now() - m_LastCameraMoveTime < CameraSettleTime);
+        const Renderer::RenderingStatus status = m_Renderer->Render();
+        isConverged = status.RenderFinished;
+        if (status.Cancelled) continue;
+        m_Statuses.Back() = status;
+        m_Statuses.Publish();
+        if (m_FrameReadyHandler) {
+            m_FrameReadyHandler();
+        }
+    }
+}
+
+bool RenderThread::invalidatesFrame(const Command& command) const {
+    if (const auto* setSettings = std::get_if<SetSettingsCommand>(&command)) {
+        return setSettings->Settings.Integrator != m_SubmittedIntegratorSettings;
+    }
+    return std::holds_alternative<PlaceCameraCommand>(command) || std::holds_alternative<ResizeCommand>(command);
+}
+
+void RenderThread::apply(Command& command) {
+    if (const auto* placeCamera = std::get_if<PlaceCameraCommand>(&command)) {
+        m_Camera.PlaceInWorld(placeCamera->Position, placeCamera->Direction);
+        m_Renderer->OnCameraMoved();
+        m_LastCameraMoveTime = Clock::now();
+    } else if (const auto* setSettings = std::get_if<SetSettingsCommand>(&command)) {
+        m_Renderer->SetSettings(setSettings->Settings);
+    } else if (const auto* resize = std::get_if<ResizeCommand>(&command)) {
+        m_Camera.OnResize(resize->Width, resize->Height);
+        m_Renderer->OnResize(resize->Width, resize->Height);
+    } else if (const auto* dumpFrames = std::get_if<DumpFramesCommand>(&command)) {
+        m_Renderer->DumpFramesToDisc(dumpFrames->Folder);
+    }
+}
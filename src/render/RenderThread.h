@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "Camera.h"
+#include "Renderer.h"
+#include "scene/Scene.h"
+#include "utils/CancellationToken.h"
+#include "utils/TripleBuffer.h"
+
+// Runs a Renderer on its own thread. Camera, settings and viewport changes are queued as commands and
+// applied between frames; finished images and per-frame statistics are published lock-free for a
+// single consumer (the UI) to pick up. Commands that invalidate the accumulation cancel the frame in
+// flight, so the new view starts within a tile row's worth of work. Once the image has converged the
+// thread sleeps until the next command arrives.
+class RenderThread {
+public:
+    struct PlaceCameraCommand
+    {
+        glm::vec3 Position;
+        glm::vec3 Direction;
+    };
+    struct SetSettingsCommand
+    {
+        Renderer::Settings Settings;
+    };
+    struct ResizeCommand
+    {
+        uint32_t Width;
+        uint32_t Height;
+    };
+    struct DumpFramesCommand
+    {
+        std::string Folder;
+    };
+    using Command = std::variant<PlaceCameraCommand, SetSettingsCommand, ResizeCommand, DumpFramesCommand>;
+
+    // Called from the render and post-processing threads whenever a new image or new statistics
+    // can be acquired.
+    using FrameReadyHandler = std::function<void()>;
+
+    RenderThread(const Camera& camera, Scene* scene, glm::vec2 viewportSize, const Renderer::Settings& settings);
+
+    ~RenderThread();
+
+    // Must be set before Start().
+    void SetFrameReadyHandler(const FrameReadyHandler& handler);
+
+    void Start();
+
+    void Submit(Command command);
+
+    // Consumer side. Both return nothing if no new data was published since the last call.
+    [[nodiscard]] const Renderer::FinalImage* AcquireFinalImage();
+
+    bool AcquireStatus(Renderer::RenderingStatus& status);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // The UI moves the camera in discrete steps; it only counts as stopped after this long without one.
+    static constexpr auto CameraSettleTime = std::chrono::milliseconds(150);
+
+    void run();
+
+    void apply(Command& command);
+
+    // Called with m_CommandsMutex held.
+    [[nodiscard]] bool invalidatesFrame(const Command& command) const;
+
+    Camera m_Camera;
+    std::unique_ptr<Renderer> m_Renderer;
+    Clock::time_point m_LastCameraMoveTime{};
+
+    std::mutex m_CommandsMutex;
+    std::condition_variable m_CommandsAvailable;
+    std::vector<Command> m_Commands;
+    bool m_IsStopRequested = false;
+    Renderer::IntegratorSettings m_SubmittedIntegratorSettings;
+    Utils::CancellationToken m_CancellationToken;
+
+    Utils::TripleBuffer<Renderer::RenderingStatus> m_Statuses;
+    FrameReadyHandler m_FrameReadyHandler;
+
+    std::thread m_Thread;
+};
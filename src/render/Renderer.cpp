@@ -1,5 +1,7 @@
 #include "Renderer.h"
 
+#include <array>
+
 #include "scene/Scene.h"
 #include "wallnut/Random.h"
 
@@ -8,32 +10,87 @@
 #  undef emit
 #endif
 #include <tbb/parallel_for.h>
-#include <oneapi/tbb/global_control.h>
 #endif
 
 #include "math/Random.h"
+#include "utils/Profiler.h"
 #include "utils/Timer.h"
 
+namespace {
+    constexpr std::array<std::pair<Renderer::CostChannel, const char*>, 4> CostChannelNames = {{
+        {Renderer::CostChannel::TraversalSteps, "TraversalSteps"},
+        {Renderer::CostChannel::PrimitiveTests, "PrimitiveTests"},
+        {Renderer::CostChannel::PathDepth, "PathDepth"},
+        {Renderer::CostChannel::Time, "Time"},
+    }};
+
+    // Index of the channel in the cost images.
+    int costChannelIndex(const Renderer::CostChannel channel) {
+        return static_cast<int>(channel) - static_cast<int>(Renderer::CostChannel::TraversalSteps);
+    }
+
+#if MT_RENDERING
+    int arenaConcurrency(const int threadCount) {
+        return threadCount > 0 ? threadCount : tbb::task_arena::automatic;
+    }
+#endif
+}
+
+template<typename Body>
+void Renderer::parallelFor(const uint32_t count, const Body& body) {
+#if MT_RENDERING
+    m_TraceArena.execute([&] {
+        tbb::parallel_for<uint32_t>(0, count, 1, body);
+    });
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        body(i);
+    }
+#endif
+}
 
 Renderer::Renderer(Camera* activeCamera, Scene* activeScene, const glm::vec2 viewportSize)
-    : m_ImageData(nullptr), m_Width(0), m_Height(0), m_ActiveCamera(activeCamera), m_ActiveScene(activeScene) {
+    : m_Width(0), m_Height(0), m_HistoryCamera(*activeCamera), m_ActiveCamera(activeCamera),
+    m_ActiveScene(activeScene) {
+    m_ActiveScene->Commit();
+#if MT_RENDERING
+    m_TraceArena.initialize(arenaConcurrency(m_Settings.ThreadCount));
+#endif
     OnResize(static_cast<uint32_t>(viewportSize.x), static_cast<uint32_t>(viewportSize.y));
     m_SceneRenderTimer = std::make_unique<Utils::Timer>();
     m_FrameRenderTimer = std::make_unique<Utils::Timer>();
 }
 
+Renderer::~Renderer() {
+    WaitForPostProcessing();
+}
+
 Renderer::RenderingStatus Renderer::Render() {
-    if (m_IsRenderingFinished && !m_DumpFramesToDisc) return{
-        .FrameIndex = m_FrameIndex,
-        .RenderFinished = true,
-        .SceneRenderTime = m_SceneRenderTimer->StopAndGetTime(),
-        .FrameRenderTime = 0,
-    };
+    DAZHBOG_PROFILE_ZONE("Render");
+    if (m_IsRenderingFinished && !m_DumpFramesToDisc) {
+        if (m_IsDisplayOutdated) {
+            publishSnapshot();
+        }
+        return {
+            .FrameIndex = m_FrameIndex,
+            .RenderFinished = true,
+            .SceneRenderTime = m_SceneRenderTimer->StopAndGetTime(),
+            .FrameRenderTime = 0,
+        };
+    }
 
-    if (m_FrameIndex >= m_Settings.FramesToAccumulate)
+    const uint32_t scale = m_IsCameraMoving && isDynamicResolutionEnabled() ? m_ResolutionController.GetScale() : 1;
+    if (scale != m_ResolutionScale) {
+        setResolutionScale(scale);
+        restartAccumulation();
+    }
+
+    // A reduced-resolution preview never counts as finished, so it is always replaced once the camera stops.
+    // m_FrameIndex is the frame about to be traced, so the frames before it are all accumulated.
+    if (m_FrameIndex > static_cast<uint32_t>(m_Settings.FramesToAccumulate) && m_ResolutionScale == 1)
     {
-        prepareFrame();
         m_IsRenderingFinished = true;
+        publishSnapshot();
         return {
             .FrameIndex = m_FrameIndex,
             .RenderFinished = true,
@@ -42,62 +99,267 @@ Renderer::RenderingStatus Renderer::Render() {
         };
     }
     if (m_FrameIndex == 1) {
-        m_AccumulationData.ZeroAll();
         m_SceneRenderTimer->Start();
     }
     m_FrameRenderTimer->Start();
 
-#if MT_RENDERING
-    tbb::global_control limit(tbb::global_control::max_allowed_parallelism, 4);
-    tbb::parallel_for<int>(0, m_Height, 1, [this](const int y) {
-#else
-    for (int y = 0; y < m_Height; y++) {
-#endif
-        for (int x = 0; x < m_Width; x++)
-        {
-            const glm::vec4 color = perPixel(x, y);
-            m_AccumulationData.AddColor(x, y, color);
-        }
+    // The primary hits of the first frame describe the whole accumulation, later frames are traced
+    // from the same camera.
+    const bool writePrimarySurfaces = m_FrameIndex == 1 && isTemporalReprojectionEnabled();
+    const bool captureFeatures = needsFeatures();
+    const bool recordCost = m_Settings.Display.CostHeatmap != CostChannel::None;
+    if (recordCost) {
+        m_FrameCost.Resize(static_cast<int>(m_TraceWidth), static_cast<int>(m_TraceHeight));
+    }
+    const uint32_t tilesX = (m_TraceWidth + TileSize - 1) / TileSize;
+    const uint32_t tilesY = (m_TraceHeight + TileSize - 1) / TileSize;
+    parallelFor(tilesX * tilesY, [&](const uint32_t tile) {
+        DAZHBOG_PROFILE_ZONE("RenderTile");
+        renderTile(tile % tilesX * TileSize, tile / tilesX * TileSize, writePrimarySurfaces, captureFeatures,
+            recordCost);
+    });
+
+    if (isCancelled()) {
+        collectStatistics();
+        return {
+            .FrameIndex = m_FrameIndex,
+            .RenderFinished = false,
+            .Cancelled = true,
+            .SceneRenderTime = 0,
+            .FrameRenderTime = m_FrameRenderTimer->StopAndGetTime(),
+        };
+    }
+    if (m_IsReprojectionPending) {
+        reprojectHistory(recordCost);
+    } else {
+        accumulateFrame(captureFeatures, recordCost);
+    }
+    if (writePrimarySurfaces) {
+        std::swap(m_HistorySurfaces, m_PrimarySurfaces);
+        m_PrimarySurfaces.resize(m_HistorySurfaces.size());
+        m_HistoryCamera = *m_ActiveCamera;
+        m_HistoryScale = m_ResolutionScale;
+        m_IsHistoryValid = true;
+    }
+    m_IsReprojectionPending = false;
+    m_AccumulationVersion++;
+    if (m_CheckpointInterval > 0 && m_Settings.Accumulate && m_ResolutionScale == 1
+        && m_FrameIndex % m_CheckpointInterval == 0) {
+        saveCheckpoint();
     }
-#if MT_RENDERING
-);
-#endif
 
-    if (m_FrameIndex % 10 == 0 || m_FrameIndex == 1) {
-        prepareFrame();
+    // Hand a snapshot over whenever the post-processing stage is idle, so it never holds up tracing.
+    if (m_FrameIndex == 1 || m_IsDisplayOutdated || m_DumpFramesToDisc
+        || !m_IsPostProcessing.load(std::memory_order_acquire)) {
+        publishSnapshot();
     }
     if (m_Settings.Accumulate) {
         m_FrameIndex++;
     } else {
         m_FrameIndex = 1;
     }
+    const uint64_t frameRenderTime = m_FrameRenderTimer->StopAndGetTime();
+    if (m_IsCameraMoving && isDynamicResolutionEnabled()) {
+        m_ResolutionController.SetTargetFrameTime(static_cast<float>(m_Settings.TargetFrameTimeMs));
+        m_ResolutionController.Update(static_cast<float>(frameRenderTime));
+    }
     return {
         .FrameIndex = m_FrameIndex,
         .RenderFinished = false,
         .SceneRenderTime = 0,
-        .FrameRenderTime = m_FrameRenderTimer->StopAndGetTime(),
+        .FrameRenderTime = frameRenderTime,
+        .ResolutionScale = m_ResolutionScale,
+        .Statistics = collectStatistics(),
     };
 }
 
-std::uint32_t* Renderer::GetFinalImageData() const {
-    return m_ImageData;
+const Renderer::FinalImage* Renderer::AcquireFinalImage() {
+    return m_FinalImages.Acquire() ? &m_FinalImages.Front() : nullptr;
 }
 
 void Renderer::OnResize(const uint32_t width, const uint32_t height) {
+    WaitForPostProcessing();
+
     m_Width = width;
     m_Height = height;
+    setResolutionScale(m_ResolutionScale);
+    ResetFrameIndex();
+}
 
-    delete[] m_ImageData;
-    m_ImageData = new std::uint32_t[width * height];
+void Renderer::OnCameraMoved() {
+    restartAccumulation();
+}
 
-    m_AccumulationData.Resize(width, height);
+void Renderer::restartAccumulation() {
+    if (!isTemporalReprojectionEnabled() || !m_IsHistoryValid) {
+        ResetFrameIndex();
+        return;
+    }
+    // Frames 1 .. m_FrameIndex - 1 are in the history; keep their seeds out of the frames that follow.
+    m_SeedFrameOffset += m_FrameIndex - 1;
+    m_FrameIndex = 1;
+    m_IsReprojectionPending = true;
+    m_IsRenderingFinished = false;
+}
 
-    ResetFrameIndex();
+// The accumulation keeps its size until the next traced frame replaces it, so it can still be
+// reprojected from the previous scale.
+void Renderer::setResolutionScale(const uint32_t scale) {
+    m_ResolutionScale = scale;
+    m_TraceWidth = (m_Width + scale - 1) / scale;
+    m_TraceHeight = (m_Height + scale - 1) / scale;
+    m_FrameData.Resize(static_cast<int>(m_TraceWidth), static_cast<int>(m_TraceHeight));
+    m_FrameAlbedo.Resize(static_cast<int>(m_TraceWidth), static_cast<int>(m_TraceHeight));
+    m_FrameNormalDepth.Resize(static_cast<int>(m_TraceWidth), static_cast<int>(m_TraceHeight));
+    m_PrimarySurfaces.resize(static_cast<size_t>(m_TraceWidth) * m_TraceHeight);
 }
 
-void Renderer::SetSettings(Settings settings) {
+void Renderer::SetSettings(const Settings& settings) {
+    const bool integratorChanged = settings.Integrator != m_Settings.Integrator;
+    const bool displayChanged = settings.Display != m_Settings.Display;
+    const bool accumulationTargetChanged = settings.FramesToAccumulate != m_Settings.FramesToAccumulate;
+    const bool threadCountChanged = settings.ThreadCount != m_Settings.ThreadCount;
+    // Frames reprojected from an earlier view would stay in the accumulation.
+    const bool determinismEnabled = settings.Deterministic && !m_Settings.Deterministic;
+    // The cost of the frames already accumulated is unknown, so the heatmap starts over with them.
+    const bool costRecordingStarted = settings.Display.CostHeatmap != CostChannel::None
+        && m_Settings.Display.CostHeatmap == CostChannel::None;
     m_Settings = settings;
+
+#if MT_RENDERING
+    if (threadCountChanged) {
+        m_TraceArena.terminate();
+        m_TraceArena.initialize(arenaConcurrency(m_Settings.ThreadCount));
+    }
+#endif
+
+    if (integratorChanged || costRecordingStarted || determinismEnabled) {
+        ResetFrameIndex();
+        return;
+    }
+    if (displayChanged) {
+        m_IsDisplayOutdated = true;
+    }
+    if (accumulationTargetChanged) {
+        // Render() either keeps accumulating towards the new target or finishes right away.
+        m_IsRenderingFinished = false;
+    }
+}
+
+void Renderer::SetCheckpoint(const std::string& fileName, const uint32_t intervalFrames) {
+    m_CheckpointFileName = fileName;
+    m_CheckpointInterval = fileName.empty() ? 0 : intervalFrames;
+}
+
+bool Renderer::ResumeFromCheckpoint(const std::string& fileName) {
+    Checkpoint checkpoint;
+    if (!ReadCheckpoint(fileName, checkpoint) || checkpoint.FrameIndex == 0) {
+        return false;
+    }
+    if (checkpoint.RenderHash != renderHash()
+        || !SetAccumulation(std::move(checkpoint.Accumulation), std::move(checkpoint.Albedo),
+            std::move(checkpoint.NormalDepth), checkpoint.FrameIndex)) {
+        return false;
+    }
+    m_SeedFrameOffset = checkpoint.SeedFrameOffset;
+    return true;
+}
+
+bool Renderer::SetAccumulation(Image accumulation, Image albedo, Image normalDepth, const uint32_t frameCount) {
+    // Accumulations always have the full size, traced with scale 1.
+    WaitForPostProcessing();
+    setResolutionScale(1);
+    for (const Image* image : {&accumulation, &albedo, &normalDepth}) {
+        if (image->Width != static_cast<int>(m_TraceWidth) || image->Height != static_cast<int>(m_TraceHeight)) {
+            return false;
+        }
+    }
+    m_AccumulationData = std::move(accumulation);
+    m_AlbedoData = std::move(albedo);
+    m_NormalDepthData = std::move(normalDepth);
     ResetFrameIndex();
+    m_FrameIndex = frameCount + 1;
+    m_CostFrameCount = 0;
+    m_AccumulationVersion++;
+    m_IsDisplayOutdated = true;
+    m_SceneRenderTimer->Start();
+    return true;
+}
+
+void Renderer::AccumulateRegion(const uint32_t x0, const uint32_t y0, uint32_t x1, uint32_t y1,
+    const uint32_t frameCount, RegionAccumulation& result) {
+    DAZHBOG_PROFILE_ZONE("AccumulateRegion");
+    x1 = std::min(x1, m_TraceWidth);
+    y1 = std::min(y1, m_TraceHeight);
+    const auto width = static_cast<int>(x1 > x0 ? x1 - x0 : 0);
+    const auto height = static_cast<int>(y1 > y0 ? y1 - y0 : 0);
+    result.Accumulation.Resize(width, height);
+    result.Albedo.Resize(width, height);
+    result.NormalDepth.Resize(width, height);
+    prefetchRegion(x0, y0, x1, y1);
+    // Every pixel runs through its frames on one thread: the first frame is stored and the others are
+    // added in order, the same float operations accumulateFrame() does one frame at a time.
+    parallelFor(static_cast<uint32_t>(height), [&](const uint32_t row) {
+        RenderStatistics& statistics = threadStatistics();
+        for (uint32_t x = x0; x < x1; x++) {
+            glm::vec4 color(0.0f), albedo(0.0f), normalDepth(0.0f);
+            for (uint32_t frame = 1; frame <= frameCount; frame++) {
+                PixelFeatures features;
+                const glm::vec4 sample = perPixel(x, y0 + row, frame + m_SeedFrameOffset, nullptr, &features, statistics);
+                if (frame == 1) {
+                    color = sample;
+                    albedo = features.Albedo;
+                    normalDepth = features.NormalDepth;
+                } else {
+                    color += sample;
+                    albedo += features.Albedo;
+                    normalDepth += features.NormalDepth;
+                }
+            }
+            result.Accumulation.SetPixel(x - x0, row, color);
+            result.Albedo.SetPixel(x - x0, row, albedo);
+            result.NormalDepth.SetPixel(x - x0, row, normalDepth);
+        }
+    });
+    result.Statistics = collectStatistics();
+}
+
+uint64_t Renderer::renderHash() {
+    if (!m_IsSceneHashValid) {
+        m_SceneHash = m_ActiveScene->Hash();
+        m_IsSceneHashValid = true;
+    }
+    Utils::Fnv1a hash;
+    hash.Add(m_SceneHash);
+    hash.Add(m_ActiveCamera->GetPosition());
+    hash.Add(m_ActiveCamera->GetDirection());
+    hash.Add(m_ActiveCamera->GetVerticalFOV());
+    hash.Add(m_Width);
+    hash.Add(m_Height);
+    hash.Add(m_Settings.Integrator.RenderMode);
+    hash.Add(m_Settings.Integrator.RayBounces);
+    hash.Add(m_Settings.Integrator.SamplesPerPixel);
+    return hash.Get();
+}
+
+void Renderer::saveCheckpoint() {
+    if (m_IsCheckpointPending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    DAZHBOG_PROFILE_ZONE("Checkpoint");
+    Checkpoint checkpoint;
+    checkpoint.RenderHash = renderHash();
+    checkpoint.FrameIndex = m_FrameIndex;
+    checkpoint.SeedFrameOffset = m_SeedFrameOffset;
+    checkpoint.Accumulation = m_AccumulationData;
+    checkpoint.Albedo = m_AlbedoData;
+    checkpoint.NormalDepth = m_NormalDepthData;
+    m_ImageWriter.EnqueueWrite(m_CheckpointFileName,
+        [this, checkpoint = std::move(checkpoint)](const std::string& fileName, int) {
+            const bool isWritten = WriteCheckpoint(fileName, checkpoint);
+            m_IsCheckpointPending.store(false, std::memory_order_release);
+            return isWritten;
+        });
 }
 
 void Renderer::DumpFramesToDisc(const std::string& folder)
@@ -106,114 +368,468 @@ void Renderer::DumpFramesToDisc(const std::string& folder)
     m_DumpFramesToDisc = true;
 }
 
-glm::vec4 Renderer::perPixel(const uint32_t x, const uint32_t y) const {
+void Renderer::renderTile(const uint32_t x0, const uint32_t y0, const bool writePrimarySurfaces,
+    const bool captureFeatures, const bool recordCost) {
+    const uint32_t x1 = std::min(x0 + TileSize, m_TraceWidth);
+    const uint32_t y1 = std::min(y0 + TileSize, m_TraceHeight);
+    RenderStatistics& statistics = threadStatistics();
+    const uint32_t seedFrame = m_FrameIndex + m_SeedFrameOffset;
+    prefetchRegion(x0, y0, x1, y1);
+    for (uint32_t y = y0; y < y1; y++) {
+        if (isCancelled()) return;
+        for (uint32_t x = x0; x < x1; x++)
+        {
+            PrimarySurface* primarySurface = writePrimarySurfaces ? &m_PrimarySurfaces[y * m_TraceWidth + x] : nullptr;
+            PixelFeatures features;
+            const RenderStatistics before = statistics;
+            const uint64_t start = recordCost ? Utils::Profiler::Now() : 0;
+            const glm::vec4 color = perPixel(x, y, seedFrame, primarySurface, captureFeatures ? &features : nullptr,
+                statistics);
+            if (recordCost) {
+                const auto duration = static_cast<float>(Utils::Profiler::Now() - start);
+                const auto primaryRays = static_cast<float>(statistics.PrimaryRays - before.PrimaryRays);
+                const auto segments = primaryRays + static_cast<float>(statistics.SecondaryRays - before.SecondaryRays);
+                m_FrameCost.SetPixel(x, y, glm::vec4(
+                    static_cast<float>(statistics.BoxTests - before.BoxTests),
+                    static_cast<float>(statistics.PrimitiveTests - before.PrimitiveTests),
+                    segments / primaryRays,
+                    duration));
+            }
+            m_FrameData.SetPixel(x, y, color);
+            if (captureFeatures) {
+                m_FrameAlbedo.SetPixel(x, y, features.Albedo);
+                m_FrameNormalDepth.SetPixel(x, y, features.NormalDepth);
+            }
+        }
+    }
+}
+
+void Renderer::prefetchRegion(const uint32_t x0, const uint32_t y0, const uint32_t x1, const uint32_t y1) const {
+    constexpr uint32_t GridSize = 4;
+    if (x1 <= x0 || y1 <= y0) return;
+    std::array<Ray, GridSize * GridSize> rays;
+    for (uint32_t j = 0; j < GridSize; j++) {
+        for (uint32_t i = 0; i < GridSize; i++) {
+            // Cell centres, in the full-resolution pixel coordinates of the camera.
+            const float px = (static_cast<float>(x0) + (static_cast<float>(i) + 0.5f) * static_cast<float>(x1 - x0) / GridSize)
+                * static_cast<float>(m_ResolutionScale);
+            const float py = (static_cast<float>(y0) + (static_cast<float>(j) + 0.5f) * static_cast<float>(y1 - y0) / GridSize)
+                * static_cast<float>(m_ResolutionScale);
+            rays[j * GridSize + i] = m_ActiveCamera->GetRay(px, py);
+        }
+    }
+    m_ActiveScene->Prefetch(rays);
+}
+
+void Renderer::accumulateFrame(const bool captureFeatures, const bool recordCost) {
+    DAZHBOG_PROFILE_ZONE("Accumulate");
+    if (!recordCost) {
+        m_CostFrameCount = 0;
+    } else if (m_FrameIndex == 1 || m_CostFrameCount == 0) {
+        m_CostData = m_FrameCost;
+        m_CostFrameCount = 1;
+    } else {
+        m_CostFrameCount++;
+    }
+    if (m_FrameIndex == 1) {
+        m_AccumulationData = m_FrameData;
+        m_AlbedoData = m_FrameAlbedo;
+        m_NormalDepthData = m_FrameNormalDepth;
+        return;
+    }
+    const bool accumulateCost = m_CostFrameCount > 1;
+    const float costWeight = accumulateCost ? 1.0f / static_cast<float>(m_CostFrameCount) : 0.0f;
+    parallelFor(m_TraceHeight, [&](const uint32_t y) {
+        for (uint32_t x = 0; x < m_TraceWidth; x++) {
+            m_AccumulationData.AddColor(x, y, m_FrameData.GetPixel(x, y));
+            if (captureFeatures) {
+                m_AlbedoData.AddColor(x, y, m_FrameAlbedo.GetPixel(x, y));
+                m_NormalDepthData.AddColor(x, y, m_FrameNormalDepth.GetPixel(x, y));
+            }
+            if (accumulateCost) {
+                m_CostData.SetPixel(x, y, glm::mix(m_CostData.GetPixel(x, y), m_FrameCost.GetPixel(x, y), costWeight));
+            }
+        }
+    });
+}
+
+// Every pixel of the new frame looks up where its primary hit was seen by the history camera. The
+// history sample is reused only if it shows the same surface there, which rejects disocclusions.
+void Renderer::reprojectHistory(const bool recordCost) {
+    DAZHBOG_PROFILE_ZONE("Reproject");
+    m_ReprojectedData.Resize(static_cast<int>(m_TraceWidth), static_cast<int>(m_TraceHeight));
+    const auto historyWidth = static_cast<uint32_t>(m_AccumulationData.Width);
+    const auto historyHeight = static_cast<uint32_t>(m_AccumulationData.Height);
+    parallelFor(m_TraceHeight, [&](const uint32_t y) {
+        for (uint32_t x = 0; x < m_TraceWidth; x++) {
+            const glm::vec4 sample = m_FrameData.GetPixel(x, y);
+            m_ReprojectedData.SetPixel(x, y, sample);
+
+            const PrimarySurface& surface = m_PrimarySurfaces[y * m_TraceWidth + x];
+            glm::vec2 pixel;
+            if (!surface.IsValid || !m_HistoryCamera.WorldToPixel(surface.Position, pixel)) {
+                continue;
+            }
+            pixel /= static_cast<float>(m_HistoryScale);
+            if (pixel.x < 0.0f || pixel.y < 0.0f) {
+                continue;
+            }
+            const auto hx = static_cast<uint32_t>(pixel.x);
+            const auto hy = static_cast<uint32_t>(pixel.y);
+            if (hx >= historyWidth || hy >= historyHeight) {
+                continue;
+            }
+            const PrimarySurface& history = m_HistorySurfaces[hy * historyWidth + hx];
+            if (!history.IsValid) {
+                continue;
+            }
+            const float depth = glm::distance(m_HistoryCamera.GetPosition(), surface.Position);
+            if (std::abs(depth - history.Depth) > ReprojectionDepthTolerance * history.Depth
+                || glm::dot(surface.Normal, history.Normal) < ReprojectionNormalTolerance) {
+                continue;
+            }
+            const glm::vec4 accumulated = m_AccumulationData.GetPixel(hx, hy);
+            const float frames = accumulated.a;
+            if (frames <= 0.0f) {
+                continue;
+            }
+            m_ReprojectedData.SetPixel(x, y, sample + accumulated * (std::min(frames, MaxReprojectedFrames) / frames));
+        }
+    });
+    std::swap(m_AccumulationData, m_ReprojectedData);
+    // The denoiser guides are cheap to converge, so they simply restart.
+    m_AlbedoData = m_FrameAlbedo;
+    m_NormalDepthData = m_FrameNormalDepth;
+    if (recordCost) {
+        m_CostData = m_FrameCost;
+        m_CostFrameCount = 1;
+    } else {
+        m_CostFrameCount = 0;
+    }
+}
+
+glm::vec4 Renderer::perPixel(const uint32_t x, const uint32_t y, const uint32_t seedFrame,
+    PrimarySurface* primarySurface, PixelFeatures* features, RenderStatistics& statistics) const {
 
     glm::vec3 accum(0.0f);
-    const int samplesPerPixel = m_Settings.RenderMode == RenderMode::HighPerformance ? 1 : m_Settings.SamplesPerPixel;
+    const int samplesPerPixel = m_Settings.Integrator.RenderMode == RenderMode::HighPerformance
+        ? 1 : m_Settings.Integrator.SamplesPerPixel;
+    // Traced pixels are m_ResolutionScale camera pixels wide.
+    const RayCone cone{.SpreadAngle = m_ActiveCamera->GetPixelSpreadAngle() * static_cast<float>(m_ResolutionScale)};
 
     for (int s = 0; s < samplesPerPixel; s++) {
-        uint32_t seed = Utils::Random::SeedHash(x, y, s, m_FrameIndex);
+        uint32_t seed = Utils::Random::SeedHash(x, y, s, seedFrame);
 
         const float jx = Utils::Random::RandomFloat(seed, 0.0f, 1.0f);
         const float jy = Utils::Random::RandomFloat(seed, 0.0f, 1.0f);
-        const float px = static_cast<float>(x) + jx;
-        const float py = static_cast<float>(y) + jy;
+        // The camera works in full-resolution pixel coordinates.
+        const float px = (static_cast<float>(x) + jx) * static_cast<float>(m_ResolutionScale);
+        const float py = (static_cast<float>(y) + jy) * static_cast<float>(m_ResolutionScale);
 
         Ray ray = m_ActiveCamera->GetRay(px, py);
 
-        accum += rayColor(ray, m_Settings.RayBounces, seed);
+        // The first hit costs a material lookup, so it is only recorded when something reads it.
+        PrimarySurface surface;
+        const bool needsSurface = features || (s == 0 && primarySurface);
+        statistics.PrimaryRays++;
+        accum += rayColor(ray, cone, m_Settings.Integrator.RayBounces, seed, statistics,
+            needsSurface ? &surface : nullptr);
+        if (features) {
+            features->Albedo += glm::vec4(surface.Albedo, 0.0f);
+            features->NormalDepth += glm::vec4(surface.Normal, surface.Depth);
+        }
+        if (s == 0 && primarySurface) {
+            *primarySurface = surface;
+        }
     }
 
     glm::vec3 avg = accum / static_cast<float>(samplesPerPixel);
+    if (features) {
+        features->Albedo /= static_cast<float>(samplesPerPixel);
+        features->Albedo.a = 1.0f;
+        features->NormalDepth /= static_cast<float>(samplesPerPixel);
+    }
     return { avg, 1.0f };
 }
 
-glm::vec3 Renderer::rayColor(const Ray &ray, const int depth, uint32_t &seed) const {
+glm::vec3 Renderer::rayColor(const Ray &ray, const RayCone& cone, const int depth, uint32_t &seed,
+    RenderStatistics& statistics, PrimarySurface* primarySurface) const {
+    if (primarySurface) {
+        *primarySurface = {};
+    }
     if (depth <= 0)
         return glm::vec3(0.0f, 0.0f, 0.0f);
 
-    if (const HitPayload hitPayload = traceRay(ray); hitPayload.DidCollide) {
-        const Hittable* hittable = m_ActiveScene->GetHittableObjects()[hitPayload.ObjectIndex].get();
-        const Material* material = m_ActiveScene->GetMaterials()[hittable->GetMaterialIndex()].get();
+    if (HitPayload hitPayload = traceRay(ray, statistics); hitPayload.DidCollide) {
+        const Material* material = m_ActiveScene->GetMaterials()[hitPayload.MaterialIndex].get();
+        // Scattered directions aren't always normalized, so distances are scaled to world units.
+        const float rayLength = glm::length(ray.Direction);
+        const float coneWidth = cone.Width + cone.SpreadAngle * hitPayload.HitDistance * rayLength;
+        if (hitPayload.TextureDensity > 0.0f) {
+            // Grazing rays cover more of the surface; the clamp keeps silhouettes from going to the
+            // coarsest level.
+            const float cosine = std::abs(glm::dot(hitPayload.WorldNormal, ray.Direction)) / rayLength;
+            hitPayload.TextureFootprint = coneWidth * hitPayload.TextureDensity / std::max(cosine, 0.1f);
+        }
+        if (primarySurface) {
+            *primarySurface = {
+                .Position = hitPayload.WorldPosition,
+                .Normal = hitPayload.WorldNormal,
+                .Albedo = material->GetAlbedo(hitPayload),
+                .Depth = hitPayload.HitDistance,
+                .IsValid = true,
+            };
+        }
 
         ScatterRays scatterRays = material->Scatter(ray, hitPayload, seed);
         if (scatterRays.Scattered) {
-            return scatterRays.Attenuation * rayColor(scatterRays.Ray, depth-1, seed);
+            statistics.SecondaryRays++;
+            // Surfaces are taken as flat, so the cone keeps its spread from the hit on.
+            return scatterRays.Attenuation * rayColor(scatterRays.Ray, {coneWidth, cone.SpreadAngle}, depth-1, seed,
+                statistics);
         }
         return scatterRays.Emission;
     }
 
+    statistics.EscapedRays++;
     const glm::vec3 dir = glm::normalize(ray.Direction);
     const auto a = 0.5f * (dir.y + 1.0f);
     return 0.1f * ((1.0f - a) * glm::vec3(1.0, 1.0, 1.0) + a * glm::vec3(0.5, 0.7, 1.0));
     // return {0.0f, 0.0f, 0.0f};
 }
 
-HitPayload Renderer::traceRay(const Ray& ray) const {
-    float closestSoFar = std::numeric_limits<float>::max();
-    HitPayload nearestHitPayload = {.DidCollide = false};
-    for (int i = 0; i < m_ActiveScene->GetHittableObjects().size(); i++) {
-        const Hittable* hittable = m_ActiveScene->GetHittableObjects()[i].get();
-        if (const HitPayload payload = hittable->Hit(ray, Interval(0.0f, closestSoFar)); payload.DidCollide) {
-            nearestHitPayload = payload;
-            nearestHitPayload.ObjectIndex = i;
-            closestSoFar = payload.HitDistance;
-        }
+HitPayload Renderer::traceRay(const Ray& ray, RenderStatistics& statistics) const {
+    IntersectionCounters counters;
+    const HitPayload payload = m_ActiveScene->Intersect(ray, &counters);
+    statistics.BoxTests += counters.BoxTests;
+    statistics.PrimitiveTests += counters.PrimitiveTests;
+    return payload;
+}
+
+Renderer::RenderStatistics& Renderer::threadStatistics() {
+#if MT_RENDERING
+    return m_ThreadStatistics.local().Statistics;
+#else
+    return m_ThreadStatistics.Statistics;
+#endif
+}
+
+Renderer::RenderStatistics Renderer::collectStatistics() {
+    RenderStatistics total;
+#if MT_RENDERING
+    for (ThreadStatistics& thread : m_ThreadStatistics) {
+        total += thread.Statistics;
+        thread.Statistics = {};
     }
-    return nearestHitPayload;
+#else
+    total = m_ThreadStatistics.Statistics;
+    m_ThreadStatistics.Statistics = {};
+#endif
+    return total;
 }
 
-void Renderer::prepareFrame() {
-    Image frameBuffer {};
-    frameBuffer.Resize(m_AccumulationData.Width, m_AccumulationData.Height);
+void Renderer::publishSnapshot() {
+    DAZHBOG_PROFILE_ZONE("PublishSnapshot");
+    FrameSnapshot& snapshot = m_Snapshots.Back();
+    snapshot.Accumulation = m_AccumulationData;
+    if (m_Settings.Display.Denoise.Enabled) {
+        snapshot.Albedo = m_AlbedoData;
+        snapshot.NormalDepth = m_NormalDepthData;
+    }
+    if (m_Settings.Display.CostHeatmap != CostChannel::None && m_CostFrameCount > 0) {
+        snapshot.Cost = m_CostData;
+    }
+    snapshot.AccumulationVersion = m_AccumulationVersion;
+    // Frames in the accumulation: a finished render has already moved past its last one.
+    snapshot.FrameIndex = m_IsRenderingFinished ? m_FrameIndex - 1 : m_FrameIndex;
+    snapshot.IsFinal = m_IsRenderingFinished;
+    snapshot.Display = m_Settings.Display;
+    snapshot.DumpFramesToDisc = m_DumpFramesToDisc;
+    snapshot.DumpFolder = m_DumpFolder;
+    m_Snapshots.Publish();
+
+    if (!m_IsPostProcessing.exchange(true, std::memory_order_acq_rel)) {
+#if MT_RENDERING
+        m_PostProcessArena.execute([this] {
+            m_PostProcessTasks.run([this] { postProcessSnapshots(); });
+        });
+#else
+        postProcessSnapshots();
+#endif
+    }
+
+    if (m_DumpFramesToDisc) {
+        // A newer snapshot must not replace this one before it has been written out.
+        WaitForPostProcessing();
+        m_DumpFramesToDisc = false;
+    }
+    m_IsDisplayOutdated = false;
+}
+
+void Renderer::postProcessSnapshots() {
+    do {
+        while (m_Snapshots.Acquire()) {
+            prepareFrame(m_Snapshots.Front(), m_FinalImages.Back());
+            m_FinalImages.Publish();
+            if (m_FrameReadyHandler) {
+                m_FrameReadyHandler();
+            }
+        }
+        m_IsPostProcessing.store(false, std::memory_order_release);
+        // A snapshot published after the last Acquire() but before the store above found the stage
+        // busy and didn't start a new task, so pick it up here.
+    } while (m_Snapshots.HasFresh() && !m_IsPostProcessing.exchange(true, std::memory_order_acq_rel));
+}
 
-    auto avgProcessor = AverageFramesProcessor(m_FrameIndex);
-    avgProcessor.ProcessImage(m_AccumulationData, frameBuffer);
-    if (m_DumpFramesToDisc)
+void Renderer::WaitForPostProcessing() {
+#if MT_RENDERING
+    m_PostProcessArena.execute([this] { m_PostProcessTasks.wait(); });
+#endif
+}
+
+void Renderer::prepareFrame(FrameSnapshot& snapshot, FinalImage& output) {
+    DAZHBOG_PROFILE_ZONE("PostProcess");
+    const DisplaySettings& display = snapshot.Display;
+    const bool dumpFramesToDisc = snapshot.DumpFramesToDisc;
+    const std::string& dumpFolder = snapshot.DumpFolder;
+    const uint32_t frameIndex = snapshot.FrameIndex;
+
+    if (snapshot.AccumulationVersion != m_AveragedFrameVersion || dumpFramesToDisc)
     {
-        frameBuffer.WritePng(m_DumpFolder + "/1. AccumulatedFrame_" + std::to_string(m_FrameIndex) + ".png");
+        DAZHBOG_PROFILE_ZONE("AverageFrames");
+        auto avgProcessor = AverageFramesProcessor();
+        avgProcessor.ProcessImage(snapshot.Accumulation, m_AveragedFrame);
+        m_AveragedFrameVersion = snapshot.AccumulationVersion;
+        m_BloomProcessor.Invalidate();
+        if (dumpFramesToDisc)
+        {
+            m_ImageWriter.Enqueue(dumpFolder + "/1. AccumulatedFrame_" + std::to_string(frameIndex) + ".png", m_AveragedFrame);
+        }
     }
+    if (display.Denoise.Enabled && (m_DenoisedFrameVersion != m_AveragedFrameVersion
+        || m_DenoisedFrameSettings != display.Denoise || dumpFramesToDisc))
+    {
+        DAZHBOG_PROFILE_ZONE("Denoise");
+        m_DenoiseProcessor.SetParameters(display.Denoise.Iterations, display.Denoise.ColorSigma,
+            display.Denoise.NormalSigma, display.Denoise.DepthSigma);
+        m_DenoiseProcessor.SetFeatures(snapshot.Albedo, snapshot.NormalDepth);
+        m_DenoiseProcessor.ProcessImage(m_AveragedFrame, m_DenoisedFrame);
+        m_DenoisedFrameVersion = m_AveragedFrameVersion;
+        m_DenoisedFrameSettings = display.Denoise;
+        m_BloomProcessor.Invalidate();
+        if (dumpFramesToDisc)
+        {
+            m_ImageWriter.Enqueue(dumpFolder + "/1.1. Denoised_" + std::to_string(frameIndex) + ".png", m_DenoisedFrame);
+        }
+    }
+    if (dumpFramesToDisc)
+    {
+        // Everything linear in one float file, for compositing without re-rendering.
+        std::vector<ImageWriter::ExrLayer> layers;
+        layers.push_back({m_AveragedFrame, {"R", "G", "B"}});
+        if (display.Denoise.Enabled)
+        {
+            layers.push_back({m_DenoisedFrame, {"denoised.R", "denoised.G", "denoised.B"}});
+            layers.push_back({m_DenoiseProcessor.GetAlbedo(), {"albedo.R", "albedo.G", "albedo.B"}});
+            layers.push_back({m_DenoiseProcessor.GetNormalDepth(), {"N.X", "N.Y", "N.Z", "Z"}});
+        }
+        if (display.CostHeatmap != CostChannel::None
+            && snapshot.Cost.Width == m_AveragedFrame.Width && snapshot.Cost.Height == m_AveragedFrame.Height)
+        {
+            layers.push_back({snapshot.Cost,
+                {"cost.traversalSteps", "cost.primitiveTests", "cost.pathDepth", "cost.timeNs"}});
+        }
+        m_ImageWriter.EnqueueExr(dumpFolder + "/1. AccumulatedFrame_" + std::to_string(frameIndex) + ".exr",
+            std::move(layers));
+    }
+    if (display.Denoise.Enabled != m_IsBloomInputDenoised)
+    {
+        m_BloomProcessor.Invalidate();
+        m_IsBloomInputDenoised = display.Denoise.Enabled;
+    }
+    Image& radiance = display.Denoise.Enabled ? m_DenoisedFrame : m_AveragedFrame;
+    if (m_IsRadianceOutputEnabled)
+    {
+        output.Radiance = radiance;
+    }
+    Image frameBuffer {};
 
-    if (m_Settings.BloomEnabled)
+    if (display.Bloom.Enabled)
     {
-        auto bloomFilter = BloomProcessor(m_Settings.BloomThreshold, m_Settings.BloomLevels, m_Settings.BloomRadius,
-            m_Settings.BloomSigma, m_Settings.BloomIntensity, m_DumpFramesToDisc, m_DumpFolder);
-        bloomFilter.ProcessImage(frameBuffer, frameBuffer);
-        if (m_DumpFramesToDisc)
+        DAZHBOG_PROFILE_ZONE("Bloom");
+        m_BloomProcessor.SetParameters(display.Bloom.Threshold, display.Bloom.Levels, display.Bloom.Radius,
+            display.Bloom.Sigma, display.Bloom.Intensity);
+        m_BloomProcessor.SetDumpFramesToDisc(dumpFramesToDisc, dumpFolder, &m_ImageWriter);
+        m_BloomProcessor.ProcessImage(radiance, frameBuffer);
+        if (dumpFramesToDisc)
         {
-            frameBuffer.WritePng(m_DumpFolder + "/2. BloomOutput_" + std::to_string(m_FrameIndex) + ".png");
+            m_ImageWriter.Enqueue(dumpFolder + "/2. BloomOutput_" + std::to_string(frameIndex) + ".png", frameBuffer);
         }
     }
+    else
+    {
+        frameBuffer = radiance;
+    }
 
-    if (m_Settings.HDREnabled)
+    if (display.HDREnabled)
     {
-        auto hdrProcessor = HDRProcessor(m_Settings.Exposure);
+        DAZHBOG_PROFILE_ZONE("HDR");
+        auto hdrProcessor = HDRProcessor(display.Exposure);
         hdrProcessor.ProcessImage(frameBuffer, frameBuffer);
-        if (m_DumpFramesToDisc)
+        if (dumpFramesToDisc)
         {
-            frameBuffer.WritePng(m_DumpFolder + "/3. HDR_" + std::to_string(m_FrameIndex) + ".png");
+            m_ImageWriter.Enqueue(dumpFolder + "/3. HDR_" + std::to_string(frameIndex) + ".png", frameBuffer);
         }
     }
 
-    if (m_Settings.TonemapEnabled)
+    if (display.TonemapEnabled)
     {
+        DAZHBOG_PROFILE_ZONE("Tonemap");
         auto toneMapper = TonemapACESProcessor();
         toneMapper.ProcessImage(frameBuffer, frameBuffer);
-        if (m_DumpFramesToDisc)
+        if (dumpFramesToDisc)
         {
-            frameBuffer.WritePng(m_DumpFolder + "/4. ToneMap_" + std::to_string(m_FrameIndex) + ".png");
+            m_ImageWriter.Enqueue(dumpFolder + "/4. ToneMap_" + std::to_string(frameIndex) + ".png", frameBuffer);
         }
     }
 
-    if (m_Settings.GammaCorrectionEnabled)
+    if (display.GammaCorrectionEnabled)
     {
-        auto gammaProcessor = GammaCorrectionProcessor(m_Settings.Gamma);
+        DAZHBOG_PROFILE_ZONE("GammaCorrection");
+        auto gammaProcessor = GammaCorrectionProcessor(display.Gamma);
         gammaProcessor.ProcessImage(frameBuffer, frameBuffer);
-        if (m_DumpFramesToDisc)
+        if (dumpFramesToDisc)
+        {
+            m_ImageWriter.Enqueue(dumpFolder + "/5. GammaCorrection_" + std::to_string(frameIndex) + ".png", frameBuffer);
+        }
+    }
+
+    output.CostHeatmap.clear();
+    // Left empty until the first frame with recorded cost has been accumulated.
+    if (display.CostHeatmap != CostChannel::None
+        && snapshot.Cost.Width == frameBuffer.Width && snapshot.Cost.Height == frameBuffer.Height)
+    {
+        DAZHBOG_PROFILE_ZONE("CostHeatmap");
+        Image heatmap;
+        auto falseColorProcessor = FalseColorProcessor(costChannelIndex(display.CostHeatmap));
+        falseColorProcessor.ProcessImage(snapshot.Cost, heatmap);
+        output.CostHeatmap.resize(static_cast<size_t>(heatmap.Width) * heatmap.Height);
+        heatmap.ToRGBA8(output.CostHeatmap.data());
+        if (dumpFramesToDisc)
         {
-            frameBuffer.WritePng(m_DumpFolder + "/5. GammaCorrection_" + std::to_string(m_FrameIndex) + ".png");
+            for (const auto& [channel, name] : CostChannelNames)
+            {
+                auto channelProcessor = FalseColorProcessor(costChannelIndex(channel));
+                channelProcessor.ProcessImage(snapshot.Cost, heatmap);
+                m_ImageWriter.Enqueue(dumpFolder + "/6. Cost" + name + "_" + std::to_string(frameIndex) + ".png", std::move(heatmap));
+            }
         }
     }
-    frameBuffer.ToRGBA8(m_ImageData);
-    m_DumpFramesToDisc = false;
+    output.Width = frameBuffer.Width;
+    output.Height = frameBuffer.Height;
+    output.FrameIndex = frameIndex;
+    output.IsFinal = snapshot.IsFinal;
+    output.Pixels.resize(static_cast<size_t>(frameBuffer.Width) * frameBuffer.Height);
+    DAZHBOG_PROFILE_ZONE("ToRGBA8");
+    frameBuffer.ToRGBA8(output.Pixels.data());
 }
@@ -1,85 +1,422 @@
 #pragma once
 
-#include <QTimer>
+#include <functional>
 #include <glm/glm.hpp>
 
 #include "Camera.h"
+#include "Checkpoint.h"
 #include "ImagePostProcessors.h"
+#include "ImageWriter.h"
+#include "ResolutionController.h"
 #include "scene/Scene.h"
+#include "utils/CancellationToken.h"
 #include "utils/Timer.h"
+#include "utils/TripleBuffer.h"
 
 #define MT_RENDERING 1
 
+#if MT_RENDERING
+#pragma push_macro("emit")
+#undef emit
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#pragma pop_macro("emit")
+#endif
+
 class Renderer {
 public:
     enum class RenderMode {
         HighPerformance,
         HighQuality
     };
-    struct Settings
+    // Per-pixel cost shown by the cost heatmap.
+    enum class CostChannel {
+        None,
+        TraversalSteps,
+        PrimitiveTests,
+        PathDepth,
+        Time
+    };
+    // Everything that changes the radiance the integrator produces. Changing any of these
+    // invalidates the accumulated samples.
+    struct IntegratorSettings
+    {
+        Renderer::RenderMode RenderMode = Renderer::RenderMode::HighPerformance;
+        int RayBounces = 5;
+        int SamplesPerPixel = 8;
+
+        bool operator==(const IntegratorSettings&) const = default;
+    };
+    struct BloomSettings
+    {
+        bool Enabled = true;
+        float Threshold = 1.0f;
+        int Levels = 4;
+        int Radius = 6;
+        float Sigma = 4.0f;
+        float Intensity = 0.6f;
+
+        bool operator==(const BloomSettings&) const = default;
+    };
+    struct DenoiseSettings
+    {
+        bool Enabled = false;
+        int Iterations = 5;
+        float ColorSigma = 0.5f;
+        float NormalSigma = 0.1f;
+        float DepthSigma = 0.1f;
+
+        bool operator==(const DenoiseSettings&) const = default;
+    };
+    // Everything that is applied on top of the accumulation buffer. Changing these only
+    // re-runs the post-processing chain.
+    struct DisplaySettings
     {
-        RenderMode RenderMode = RenderMode::HighPerformance;
-        bool Accumulate = true;
-        int FramesToAccumulate = 300;
         bool GammaCorrectionEnabled = true;
         float Gamma = 2.2f;
         bool HDREnabled = true;
         float Exposure = 0.0f;
         bool TonemapEnabled = true;
-        int RayBounces = 5;
-        int SamplesPerPixel = 8;
-        bool BloomEnabled = true;
-        float BloomThreshold = 1.0f;
-        int BloomLevels = 4;
-        int BloomRadius = 6;
-        float BloomSigma = 4.0f;
-        float BloomIntensity = 0.6f;
+        DenoiseSettings Denoise;
+        BloomSettings Bloom;
+        // False-color overlay of one cost channel. Anything but None also makes the tracer record the
+        // cost of every pixel, which restarts the accumulation.
+        CostChannel CostHeatmap = CostChannel::None;
+
+        bool operator==(const DisplaySettings&) const = default;
+    };
+    struct Settings
+    {
+        IntegratorSettings Integrator;
+        bool Accumulate = true;
+        int FramesToAccumulate = 300;
+        // While the camera moves, trace at a reduced internal resolution to stay close to this frame time.
+        bool DynamicResolution = true;
+        int TargetFrameTimeMs = 33;
+        // Reproject the accumulated image on camera moves instead of starting over.
+        bool TemporalReprojection = false;
+        // Threads used for tracing, 0 uses every hardware thread.
+        int ThreadCount = 4;
+        // Makes every image a function of the scene, camera and settings alone, whatever the thread
+        // count, scheduling or machine speed: features that react to frame times (DynamicResolution,
+        // TemporalReprojection) are off. Samples always come from fixed per-pixel, per-sample streams and
+        // every pixel is accumulated by one thread in frame order, so nothing else depends on timing.
+        bool Deterministic = false;
+        DisplaySettings Display;
+    };
+    // Ray and intersection counts of one frame. Without next event estimation there are no shadow
+    // rays yet. Box tests are the BVH node tests of committed scenes.
+    struct RenderStatistics
+    {
+        uint64_t PrimaryRays = 0;
+        uint64_t SecondaryRays = 0;
+        uint64_t ShadowRays = 0;
+        // Rays that left the scene without a hit.
+        uint64_t EscapedRays = 0;
+        uint64_t BoxTests = 0;
+        uint64_t PrimitiveTests = 0;
+
+        [[nodiscard]] uint64_t GetRays() const { return PrimaryRays + SecondaryRays + ShadowRays; }
+
+        [[nodiscard]] double GetTestsPerRay() const {
+            return GetRays() ? static_cast<double>(BoxTests + PrimitiveTests) / static_cast<double>(GetRays()) : 0.0;
+        }
+
+        // Path segments per camera path.
+        [[nodiscard]] double GetAveragePathLength() const {
+            return PrimaryRays ? static_cast<double>(PrimaryRays + SecondaryRays) / static_cast<double>(PrimaryRays) : 0.0;
+        }
+
+        RenderStatistics& operator+=(const RenderStatistics& other) {
+            PrimaryRays += other.PrimaryRays;
+            SecondaryRays += other.SecondaryRays;
+            ShadowRays += other.ShadowRays;
+            EscapedRays += other.EscapedRays;
+            BoxTests += other.BoxTests;
+            PrimitiveTests += other.PrimitiveTests;
+            return *this;
+        }
     };
     struct RenderingStatus
     {
         uint32_t FrameIndex = 0;
         bool RenderFinished = false;
+        bool Cancelled = false;
         uint64_t SceneRenderTime = 0;
         uint64_t FrameRenderTime = 0;
+        uint32_t ResolutionScale = 1;
+        RenderStatistics Statistics;
     };
 
+    struct FinalImage
+    {
+        std::vector<std::uint32_t> Pixels;
+        uint32_t Width = 0, Height = 0;
+        uint32_t FrameIndex = 0;
+        // Set on the image of a converged render; nothing newer follows until something changes.
+        bool IsFinal = false;
+        // Linear radiance after denoising, before bloom and tone mapping. Only filled with SetRadianceOutput().
+        Image Radiance;
+        // RGBA8 false-color image of DisplaySettings::CostHeatmap, the size of Pixels. Empty while it is off.
+        std::vector<std::uint32_t> CostHeatmap;
+    };
+
+    // Sums of the frames a region of the image accumulated, in the layout of the accumulation buffers
+    // (alpha counts the frames) but sized to the region.
+    struct RegionAccumulation
+    {
+        Image Accumulation;
+        Image Albedo;
+        Image NormalDepth;
+        RenderStatistics Statistics;
+    };
+
+    // Called from the post-processing stage every time a new final image is published.
+    using FrameReadyHandler = std::function<void()>;
+
     explicit Renderer(Camera* activeCamera, Scene* activeScene, glm::vec2 viewportSize);
 
+    ~Renderer();
+
     RenderingStatus Render();
 
-    [[nodiscard]] std::uint32_t* GetFinalImageData() const;
+    // Latest fully post-processed frame, or nullptr if nothing new was published since the last call.
+    // Post-processing runs asynchronously, so this may lag the accumulation by a frame or two.
+    // Must always be called from the same thread.
+    [[nodiscard]] const FinalImage* AcquireFinalImage();
+
+    void SetFrameReadyHandler(const FrameReadyHandler& handler) { m_FrameReadyHandler = handler; }
+
+    // Adds the linear radiance to every final image, e.g. to measure its error. Must be set before Render().
+    void SetRadianceOutput(bool enabled) { m_IsRadianceOutputEnabled = enabled; }
+
+    // Polled once per tile row while tracing. A cancelled frame is discarded, the accumulation is left as it was.
+    void SetCancellationToken(const Utils::CancellationToken* token) { m_CancellationToken = token; }
+
+    // Frames traced while the camera moves may use a reduced resolution (see DynamicResolution). Once it
+    // stops, the renderer snaps back to full resolution and starts accumulating.
+    void SetCameraMoving(bool isMoving) { m_IsCameraMoving = isMoving; }
 
     void OnResize(uint32_t width, uint32_t height);
 
+    // With TemporalReprojection, the next frame reprojects the accumulated image into the new view;
+    // otherwise the accumulation restarts.
+    void OnCameraMoved();
+
     void ResetFrameIndex() {
         m_IsRenderingFinished = false;
+        m_IsHistoryValid = false;
+        m_IsReprojectionPending = false;
         m_FrameIndex = 1;
+        m_SeedFrameOffset = 0;
     }
 
     Settings& GetSettings() { return m_Settings; }
 
-    void SetSettings(Settings settings);
+    void SetSettings(const Settings& settings);
 
+    // Writes every stage of the next frame to folder as PNGs. The files are written in the background;
+    // tracing only waits for the post-processing of that frame.
     void DumpFramesToDisc(const std::string& folder);
 
+    // zlib level of the dumped PNGs, 0 to 9.
+    void SetDumpCompressionLevel(const int level) { m_ImageWriter.SetCompressionLevel(level); }
+
+    // Saves the accumulation to fileName after every intervalFrames frames; 0 turns checkpoints off.
+    // Tracing only waits for the buffers to be copied, the file is written in the background.
+    void SetCheckpoint(const std::string& fileName, uint32_t intervalFrames);
+
+    // Continues the accumulation saved in fileName. Fails, leaving the renderer as it was, if the
+    // checkpoint was made for another scene, camera, size or integrator settings. The frames that follow
+    // are bit-identical to those of a render that was never interrupted.
+    bool ResumeFromCheckpoint(const std::string& fileName);
+
+    // Traces frames 1 .. frameCount of the pixels in [x0, x1) x [y0, y1) and sums them in the order Render()
+    // does, so the result is bit-identical to that part of a local accumulation of frameCount frames.
+    // Meant for distributed renders with Deterministic set; leaves the renderer's own accumulation alone.
+    void AccumulateRegion(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t frameCount,
+        RegionAccumulation& result);
+
+    // Replaces the accumulation with frameCount frames traced elsewhere, e.g. merged from the regions of a
+    // distributed render; Render() then continues from it, or publishes it if that is enough frames.
+    // Fails if the images don't have the renderer's size.
+    bool SetAccumulation(Image accumulation, Image albedo, Image normalDepth, uint32_t frameCount);
+
+    // Blocks until every published snapshot has been post-processed, so that AcquireFinalImage()
+    // returns the latest frame.
+    void WaitForPostProcessing();
+
 private:
-    glm::vec4 perPixel(uint32_t x, uint32_t y) const; // like RayGen shader
+    static constexpr uint32_t TileSize = 32;
+
+    // Reprojected history is capped to this many frames, so it fades out over a few frames of motion.
+    static constexpr float MaxReprojectedFrames = 16.0f;
+    // Disocclusion tests between a reprojected pixel and the surface it lands on.
+    static constexpr float ReprojectionDepthTolerance = 0.05f;
+    static constexpr float ReprojectionNormalTolerance = 0.9f;
+
+    // First hit of a pixel's primary ray.
+    struct PrimarySurface
+    {
+        glm::vec3 Position{0.0f};
+        glm::vec3 Normal{0.0f};
+        glm::vec3 Albedo{1.0f};
+        float Depth = 0.0f;
+        bool IsValid = false;
+    };
+
+    // The cone a ray stands for, which picks the detail textures are sampled at (ray cones, Akenine-Möller
+    // et al.): its width where the ray starts and how fast it widens, in radians.
+    struct RayCone
+    {
+        float Width = 0.0f;
+        float SpreadAngle = 0.0f;
+    };
+
+    // Each tracing thread counts into its own cache line; the counters are summed once per frame.
+    struct alignas(64) ThreadStatistics
+    {
+        RenderStatistics Statistics;
+    };
+
+    // Per-pixel first-hit features for the denoiser, averaged over the pixel's samples.
+    struct PixelFeatures
+    {
+        glm::vec4 Albedo{0.0f};
+        glm::vec4 NormalDepth{0.0f};
+    };
+
+    // Everything the post-processing stage needs, copied out of the tracer's state so that tracing
+    // can continue into m_AccumulationData while the copy is being processed.
+    struct FrameSnapshot
+    {
+        Image Accumulation;
+        // Only filled when the denoiser is enabled.
+        Image Albedo;
+        Image NormalDepth;
+        // Only filled when the cost heatmap is enabled.
+        Image Cost;
+        uint64_t AccumulationVersion = 0;
+        uint32_t FrameIndex = 0;
+        bool IsFinal = false;
+        DisplaySettings Display;
+        bool DumpFramesToDisc = false;
+        std::string DumpFolder;
+    };
+
+    // like RayGen shader; fills primarySurface from the first sample and features from all of them if
+    // given. seedFrame selects the frame's random sequences, m_FrameIndex + m_SeedFrameOffset while
+    // accumulating.
+    glm::vec4 perPixel(uint32_t x, uint32_t y, uint32_t seedFrame, PrimarySurface* primarySurface,
+        PixelFeatures* features, RenderStatistics& statistics) const;
+
+    glm::vec3 rayColor(const Ray& ray, const RayCone& cone, int depth, uint32_t &seed, RenderStatistics& statistics,
+        PrimarySurface* primarySurface = nullptr) const;
+
+    HitPayload traceRay(const Ray& ray, RenderStatistics& statistics) const;
+
+    // Counters of the calling tracing thread.
+    RenderStatistics& threadStatistics();
 
-    glm::vec3 rayColor(const Ray& ray, int depth, uint32_t &seed) const;
+    // Sums and resets the per-thread counters.
+    RenderStatistics collectStatistics();
 
-    HitPayload traceRay(const Ray& ray) const;
+    template<typename Body>
+    void parallelFor(uint32_t count, const Body& body);
 
-    void prepareFrame();
+    void renderTile(uint32_t x0, uint32_t y0, bool writePrimarySurfaces, bool captureFeatures, bool recordCost);
+
+    // Hands a sparse grid of the region's camera rays to Scene::Prefetch(), so streamed meshes read the
+    // pages the region needs ahead of its rays instead of one fault at a time.
+    void prefetchRegion(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const;
+
+    void accumulateFrame(bool captureFeatures, bool recordCost);
+
+    void reprojectHistory(bool recordCost);
+
+    // Reprojects the accumulation on the next frame when possible, restarts it otherwise.
+    void restartAccumulation();
+
+    void setResolutionScale(uint32_t scale);
+
+    [[nodiscard]] bool isDynamicResolutionEnabled() const {
+        return m_Settings.DynamicResolution && !m_Settings.Deterministic;
+    }
+
+    // The denoiser guides are only read by the denoiser, whose layers are also all a dump's EXR gets
+    // of them, and by checkpoints. The first frame always traces them, so enabling the denoiser on a
+    // finished render still has guides to work with.
+    [[nodiscard]] bool needsFeatures() const {
+        return m_FrameIndex == 1 || m_Settings.Display.Denoise.Enabled || !m_CheckpointFileName.empty();
+    }
+
+    [[nodiscard]] bool isTemporalReprojectionEnabled() const {
+        return m_Settings.TemporalReprojection && m_Settings.Accumulate && !m_Settings.Deterministic;
+    }
+
+    [[nodiscard]] bool isCancelled() const {
+        return m_CancellationToken && m_CancellationToken->IsCancelled();
+    }
+
+    void publishSnapshot();
+
+    void postProcessSnapshots();
+
+    void prepareFrame(FrameSnapshot& snapshot, FinalImage& output);
+
+    // Identifies what the accumulation depends on, see Checkpoint::RenderHash.
+    uint64_t renderHash();
+
+    void saveCheckpoint();
 
     Settings m_Settings;
 
-    std::uint32_t*  m_ImageData;
+    // Samples of the frame being traced; only merged into m_AccumulationData once the frame completes.
+    Image m_FrameData;
     Image m_AccumulationData;
+    Image m_ReprojectedData;
+    // Denoiser guides, accumulated like the radiance while needsFeatures(). Albedo keeps the sample
+    // count in alpha, so the guides can average fewer frames than the radiance.
+    Image m_FrameAlbedo;
+    Image m_FrameNormalDepth;
+    Image m_AlbedoData;
+    Image m_NormalDepthData;
+    // Traversal steps, primitive tests, path segments per sample and nanoseconds of every pixel;
+    // m_CostData is their mean over the m_CostFrameCount frames accumulated.
+    Image m_FrameCost;
+    Image m_CostData;
+    uint32_t m_CostFrameCount = 0;
+    uint64_t m_AccumulationVersion = 0;
+    bool m_IsDisplayOutdated = false;
     uint32_t m_Width, m_Height;
+    // Resolution actually traced, m_Width and m_Height divided by m_ResolutionScale.
+    uint32_t m_TraceWidth = 0, m_TraceHeight = 0;
+    uint32_t m_ResolutionScale = 1;
+    bool m_IsCameraMoving = false;
+    ResolutionController m_ResolutionController;
     uint32_t m_FrameIndex = 1;
+    // Added to m_FrameIndex for sample seeds, so frames after a reprojection don't repeat the
+    // random sequences already in the history.
+    uint32_t m_SeedFrameOffset = 0;
+
+    // Primary hits matching m_AccumulationData, and the camera and resolution scale they were traced with.
+    std::vector<PrimarySurface> m_HistorySurfaces;
+    std::vector<PrimarySurface> m_PrimarySurfaces;
+    Camera m_HistoryCamera;
+    uint32_t m_HistoryScale = 1;
+    bool m_IsHistoryValid = false;
+    bool m_IsReprojectionPending = false;
 
     Camera* m_ActiveCamera;
     Scene* m_ActiveScene;
+    const Utils::CancellationToken* m_CancellationToken = nullptr;
+#if MT_RENDERING
+    tbb::task_arena m_TraceArena;
+    tbb::enumerable_thread_specific<ThreadStatistics> m_ThreadStatistics;
+#else
+    ThreadStatistics m_ThreadStatistics;
+#endif
 
     std::unique_ptr<Utils::Timer> m_SceneRenderTimer;
     std::unique_ptr<Utils::Timer> m_FrameRenderTimer;
@@ -87,4 +424,37 @@ private:
     bool m_IsRenderingFinished = false;
     bool m_DumpFramesToDisc = false;
     std::string m_DumpFolder;
+
+    std::string m_CheckpointFileName;
+    uint32_t m_CheckpointInterval = 0;
+    // Scene::Hash() walks the whole scene, so it is only computed once.
+    uint64_t m_SceneHash = 0;
+    bool m_IsSceneHashValid = false;
+    // Set while a checkpoint is queued; a slow disk skips checkpoints rather than queueing copies.
+    std::atomic<bool> m_IsCheckpointPending = false;
+
+    ImageWriter m_ImageWriter;
+
+    // Tracer -> post-processing -> consumer handoffs.
+    Utils::TripleBuffer<FrameSnapshot> m_Snapshots;
+    Utils::TripleBuffer<FinalImage> m_FinalImages;
+    FrameReadyHandler m_FrameReadyHandler;
+    bool m_IsRadianceOutputEnabled = false;
+    std::atomic<bool> m_IsPostProcessing = false;
+#if MT_RENDERING
+    // Post-processing tasks are serialized by m_IsPostProcessing, the extra slots let the filters run in parallel.
+    tbb::task_arena m_PostProcessArena{tbb::task_arena::automatic, 0};
+    tbb::task_group m_PostProcessTasks;
+#endif
+
+    // Owned by the post-processing stage: cached between snapshots, so display-only changes
+    // don't redo them.
+    Image m_AveragedFrame;
+    uint64_t m_AveragedFrameVersion = 0;
+    Image m_DenoisedFrame;
+    uint64_t m_DenoisedFrameVersion = 0;
+    DenoiseSettings m_DenoisedFrameSettings;
+    bool m_IsBloomInputDenoised = false;
+    DenoiseProcessor m_DenoiseProcessor;
+    BloomProcessor m_BloomProcessor;
 };
@@ -0,0 +1,22 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+
+uint32_t ResolutionController::Update(const float frameTimeMs) {
+    // Tracing cost scales with the pixel count, i.e. with the square of the divisor.
+    const auto pixelRatio = static_cast<float>(m_Scale * m_Scale);
+    const float estimate = std::max(frameTimeMs, MinMeasurableTimeMs) * pixelRatio;
+    m_FullResolutionTimeMs = m_FullResolutionTimeMs == 0.0f
+        ? estimate
+        : m_FullResolutionTimeMs + Smoothing * (estimate - m_FullResolutionTimeMs);
+
+    uint32_t scale = 1;
+    while (scale < MaxScale) {
+        const float predicted = m_FullResolutionTimeMs / static_cast<float>(scale * scale);
+        const float budget = scale < m_Scale ? RefineHeadroom * m_TargetFrameTimeMs : m_TargetFrameTimeMs;
+        if (predicted <= budget) break;
+        scale *= 2;
+    }
+    m_Scale = scale;
+    return m_Scale;
+}
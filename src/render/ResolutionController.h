@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Feedback controller for the internal resolution used while the camera is moving. Each traced frame
+// updates an estimate of what a full-resolution frame would cost; the next frame uses the finest
+// divisor (1, 2, 4 or 8 per axis) whose predicted time fits the target. Going back to a finer
+// divisor requires some headroom, so the resolution doesn't oscillate around the target.
+class ResolutionController {
+public:
+    static constexpr uint32_t MaxScale = 8;
+
+    void SetTargetFrameTime(float targetFrameTimeMs) { m_TargetFrameTimeMs = targetFrameTimeMs; }
+
+    // Feeds the measured time of a frame traced at GetScale() and returns the divisor for the next one.
+    uint32_t Update(float frameTimeMs);
+
+    [[nodiscard]] uint32_t GetScale() const { return m_Scale; }
+
+private:
+    // Frame times are measured with millisecond resolution; never trust anything below that.
+    static constexpr float MinMeasurableTimeMs = 1.0f;
+    static constexpr float Smoothing = 0.3f;
+    static constexpr float RefineHeadroom = 0.7f;
+
+    float m_TargetFrameTimeMs = 33.0f;
+    float m_FullResolutionTimeMs = 0.0f;
+    uint32_t m_Scale = 1;
+};
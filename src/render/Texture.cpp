@@ -0,0 +1,437 @@
+#include "Texture.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <glm/gtc/packing.hpp>
+
+#include <stb_image.h>
+#include <tbb/parallel_for.h>
+
+#include "math/ColorUtils.h"
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr std::array<char, 4> Magic = {'D', 'Z', 'T', 'X'};
+    constexpr uint32_t Version = 1;
+    // Where the tiles start; the header comes before.
+    constexpr uint64_t TilesOffset = 4096;
+    constexpr uint32_t TileTexels = Texture::TileSize * Texture::TileSize;
+    constexpr uint64_t TileBytes = Texture::TileValues * sizeof(uint16_t);
+    // The largest finite half float.
+    constexpr float MaxHalf = 65504.0f;
+
+    using Clock = std::chrono::steady_clock;
+    using Level = Texture::Level;
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Header
+    {
+        std::array<char, 4> Magic{};
+        uint32_t Version = 0;
+        // Key of the image file the texture was made from.
+        uint64_t SourceSize = 0;
+        int64_t SourceTime = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t TileSize = 0;
+        uint32_t LevelCount = 0;
+        uint32_t TileCount = 0;
+        uint32_t Padding = 0;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) <= TilesOffset);
+
+    // The mip chain of a width x height image: each level halves the one above, rounding down, until
+    // both sides are 1.
+    std::vector<Level> makeLevels(uint32_t width, uint32_t height) {
+        std::vector<Level> levels;
+        uint64_t tileCount = 0;
+        while (true) {
+            Level level{
+                .Width = width,
+                .Height = height,
+                .TilesX = (width + Texture::TileSize - 1) / Texture::TileSize,
+                .TilesY = (height + Texture::TileSize - 1) / Texture::TileSize,
+                .FirstTile = static_cast<uint32_t>(tileCount),
+            };
+            tileCount += static_cast<uint64_t>(level.TilesX) * level.TilesY;
+            if (tileCount > std::numeric_limits<uint32_t>::max()) return {};
+            levels.push_back(level);
+            if (width == 1 && height == 1) return levels;
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+    }
+
+    uint32_t getTileCount(const std::vector<Level>& levels) {
+        return levels.back().FirstTile + levels.back().TilesX * levels.back().TilesY;
+    }
+
+    // Decodes the image into linear texels, top row first.
+    bool decodeImage(const std::string& fileName, std::vector<glm::vec3>& texels, uint32_t& width, uint32_t& height,
+        std::string& error) {
+        int x = 0, y = 0, channels = 0;
+        const auto fail = [&] {
+            error = fileName + ": " + stbi_failure_reason();
+            return false;
+        };
+        if (stbi_is_hdr(fileName.c_str())) {
+            float* data = stbi_loadf(fileName.c_str(), &x, &y, &channels, 3);
+            if (!data) return fail();
+            texels.resize(static_cast<size_t>(x) * static_cast<size_t>(y));
+            tbb::parallel_for<size_t>(0, texels.size(), [&](const size_t i) {
+                texels[i] = {data[3 * i], data[3 * i + 1], data[3 * i + 2]};
+            });
+            stbi_image_free(data);
+        } else if (stbi_is_16_bit(fileName.c_str())) {
+            stbi_us* data = stbi_load_16(fileName.c_str(), &x, &y, &channels, 3);
+            if (!data) return fail();
+            texels.resize(static_cast<size_t>(x) * static_cast<size_t>(y));
+            tbb::parallel_for<size_t>(0, texels.size(), [&](const size_t i) {
+                for (int c = 0; c < 3; c++) {
+                    texels[i][c] = ColorUtils::SRGBToLinear(static_cast<float>(data[3 * i + c]) / 65535.0f);
+                }
+            });
+            stbi_image_free(data);
+        } else {
+            stbi_uc* data = stbi_load(fileName.c_str(), &x, &y, &channels, 3);
+            if (!data) return fail();
+            std::array<float, 256> toLinear{};
+            for (int value = 0; value < 256; value++) {
+                toLinear[value] = ColorUtils::SRGBToLinear(static_cast<float>(value) / 255.0f);
+            }
+            texels.resize(static_cast<size_t>(x) * static_cast<size_t>(y));
+            tbb::parallel_for<size_t>(0, texels.size(), [&](const size_t i) {
+                texels[i] = {toLinear[data[3 * i]], toLinear[data[3 * i + 1]], toLinear[data[3 * i + 2]]};
+            });
+            stbi_image_free(data);
+        }
+        width = static_cast<uint32_t>(x);
+        height = static_cast<uint32_t>(y);
+        return true;
+    }
+
+    // The next level of the chain: every texel averages the texels of the previous level it covers.
+    std::vector<glm::vec3> downsample(const std::vector<glm::vec3>& texels, const Level& from, const Level& to) {
+        std::vector<glm::vec3> result(static_cast<size_t>(to.Width) * to.Height);
+        tbb::parallel_for<uint32_t>(0, to.Height, [&](const uint32_t y) {
+            // Two texels a side, or three at the end of an odd side, so none is dropped.
+            const size_t y0 = static_cast<size_t>(y) * from.Height / to.Height;
+            const size_t y1 = static_cast<size_t>(y + 1) * from.Height / to.Height;
+            for (uint32_t x = 0; x < to.Width; x++) {
+                const size_t x0 = static_cast<size_t>(x) * from.Width / to.Width;
+                const size_t x1 = static_cast<size_t>(x + 1) * from.Width / to.Width;
+                glm::vec3 sum(0.0f);
+                for (size_t row = y0; row < y1; row++) {
+                    for (size_t column = x0; column < x1; column++) {
+                        sum += texels[row * from.Width + column];
+                    }
+                }
+                result[static_cast<size_t>(y) * to.Width + x] = sum / static_cast<float>((y1 - y0) * (x1 - x0));
+            }
+        });
+        return result;
+    }
+
+    // The level's tiles in half floats, row by row; the part of an edge tile past the level's edges
+    // repeats its last row or column.
+    std::vector<uint16_t> encodeTiles(const std::vector<glm::vec3>& texels, const Level& level) {
+        std::vector<uint16_t> tiles(static_cast<size_t>(level.TilesX) * level.TilesY * Texture::TileValues);
+        tbb::parallel_for<uint32_t>(0, level.TilesX * level.TilesY, [&](const uint32_t tile) {
+            const uint32_t tileX = tile % level.TilesX * Texture::TileSize;
+            const uint32_t tileY = tile / level.TilesX * Texture::TileSize;
+            uint16_t* values = tiles.data() + static_cast<size_t>(tile) * Texture::TileValues;
+            for (uint32_t y = 0; y < Texture::TileSize; y++) {
+                const size_t row = std::min(tileY + y, level.Height - 1);
+                for (uint32_t x = 0; x < Texture::TileSize; x++) {
+                    const glm::vec3& texel = texels[row * level.Width + std::min(tileX + x, level.Width - 1)];
+                    for (int c = 0; c < 3; c++) {
+                        *values++ = glm::packHalf1x16(std::clamp(texel[c], 0.0f, MaxHalf));
+                    }
+                }
+            }
+        });
+        return tiles;
+    }
+
+    bool writeTextureFile(const std::string& fileName, const std::string& path, const uint64_t sourceSize,
+        const int64_t sourceTime, std::string& error, Texture::LoadStatistics& statistics) {
+        DAZHBOG_PROFILE_ZONE("WriteTextureFile");
+        const auto startTime = Clock::now();
+        std::vector<glm::vec3> texels;
+        uint32_t width = 0, height = 0;
+        if (!decodeImage(fileName, texels, width, height, error)) return false;
+        const std::vector<Level> levels = makeLevels(width, height);
+        if (levels.empty()) {
+            error = fileName + ": image too large";
+            return false;
+        }
+        const Header header{
+            .Magic = Magic,
+            .Version = Version,
+            .SourceSize = sourceSize,
+            .SourceTime = sourceTime,
+            .Width = width,
+            .Height = height,
+            .TileSize = Texture::TileSize,
+            .LevelCount = static_cast<uint32_t>(levels.size()),
+            .TileCount = getTileCount(levels),
+        };
+
+        // Like SceneCache, every writer gets its own temporary file, and the rename publishes it whole.
+        const std::string temporaryName = path + "." + std::to_string(std::random_device()()) + ".tmp";
+        FILE* file = std::fopen(temporaryName.c_str(), "wb");
+        if (!file) {
+            error = "Can't write " + path;
+            return false;
+        }
+        std::vector<uint8_t> start(TilesOffset, 0);
+        std::memcpy(start.data(), &header, sizeof(Header));
+        bool isWritten = std::fwrite(start.data(), 1, start.size(), file) == start.size();
+        // One level in memory at a time, next to the texels it was made from.
+        for (size_t i = 0; isWritten && i < levels.size(); i++) {
+            if (i > 0) {
+                texels = downsample(texels, levels[i - 1], levels[i]);
+            }
+            const std::vector<uint16_t> tiles = encodeTiles(texels, levels[i]);
+            isWritten = std::fwrite(tiles.data(), sizeof(uint16_t), tiles.size(), file) == tiles.size();
+        }
+        isWritten = std::fclose(file) == 0 && isWritten;
+
+        std::error_code renameError;
+        if (isWritten) {
+            std::filesystem::rename(temporaryName, path, renameError);
+        }
+        if (!isWritten || renameError) {
+            std::filesystem::remove(temporaryName, renameError);
+            error = "Can't write " + path;
+            return false;
+        }
+        statistics.IsTextureFileWritten = true;
+        statistics.WriteTimeMs = millisecondsSince(startTime);
+        return true;
+    }
+
+    std::atomic<uint64_t> ThreadBudget = TextureCache::DefaultThreadBudget;
+
+    std::mutex RegistryMutex;
+    std::vector<std::unique_ptr<TextureCache>> Registry;
+}
+
+std::atomic<uint32_t> Texture::s_NextId = 1;
+
+std::string Texture::GetTextureFilePath(const std::string& imageFileName) {
+    return imageFileName + ".dzt";
+}
+
+std::shared_ptr<Texture> Texture::Load(const std::string& fileName, std::string& error, LoadStatistics* statistics) {
+    DAZHBOG_PROFILE_ZONE("LoadTexture");
+    std::error_code fileError;
+    const uint64_t sourceSize = std::filesystem::file_size(fileName, fileError);
+    const int64_t sourceTime = fileError ? 0
+        : static_cast<int64_t>(std::filesystem::last_write_time(fileName, fileError).time_since_epoch().count());
+    if (fileError) {
+        error = "Can't read " + fileName;
+        return nullptr;
+    }
+
+    LoadStatistics loadStatistics;
+    const std::string path = GetTextureFilePath(fileName);
+    std::shared_ptr<Texture> texture(new Texture());
+    if (!texture->open(path, sourceSize, sourceTime)) {
+        if (!writeTextureFile(fileName, path, sourceSize, sourceTime, error, loadStatistics)) return nullptr;
+        if (!texture->open(path, sourceSize, sourceTime)) {
+            error = "Can't read back " + path;
+            return nullptr;
+        }
+    }
+    texture->m_Id = s_NextId.fetch_add(1, std::memory_order_relaxed);
+    loadStatistics.Width = texture->GetWidth();
+    loadStatistics.Height = texture->GetHeight();
+    loadStatistics.LevelCount = texture->GetLevelCount();
+    loadStatistics.TextureFileSize = texture->m_File->GetSize();
+    if (statistics) {
+        *statistics = loadStatistics;
+    }
+    return texture;
+}
+
+bool Texture::open(const std::string& textureFileName, const uint64_t sourceSize, const int64_t sourceTime) {
+    auto file = std::make_unique<Utils::MappedFile>();
+    if (!file->Open(textureFileName) || file->GetSize() < TilesOffset) return false;
+    Header header;
+    std::memcpy(&header, file->GetData(), sizeof(Header));
+    if (header.Magic != Magic || header.Version != Version || header.SourceSize != sourceSize
+        || header.SourceTime != sourceTime || header.TileSize != TileSize
+        || header.Width == 0 || header.Height == 0) return false;
+    std::vector<Level> levels = makeLevels(header.Width, header.Height);
+    if (levels.empty() || header.LevelCount != levels.size() || header.TileCount != getTileCount(levels)
+        || header.TileCount > (file->GetSize() - TilesOffset) / TileBytes) return false;
+
+    m_Tiles = reinterpret_cast<const uint16_t*>(file->GetData() + TilesOffset);
+    m_File = std::move(file);
+    m_Levels = std::move(levels);
+    m_SourceSize = sourceSize;
+    m_SourceTime = sourceTime;
+    return true;
+}
+
+void Texture::DecodeTile(const uint32_t tile, glm::vec3* texels) const {
+    const uint16_t* values = m_Tiles + static_cast<size_t>(tile) * TileValues;
+    for (uint32_t i = 0; i < TileTexels; i++) {
+        texels[i] = {glm::unpackHalf1x16(values[3 * i]), glm::unpackHalf1x16(values[3 * i + 1]),
+            glm::unpackHalf1x16(values[3 * i + 2])};
+    }
+}
+
+glm::vec3 Texture::Sample(const glm::vec2& coordinates, const float footprint) const {
+    if (!std::isfinite(coordinates.x) || !std::isfinite(coordinates.y)) return glm::vec3(0.0f);
+    // Images are stored top row first, while v grows upwards as in OBJ files.
+    const glm::vec2 wrapped(coordinates.x - std::floor(coordinates.x), std::ceil(coordinates.y) - coordinates.y);
+    const Level& top = m_Levels.front();
+    const float texels = footprint * static_cast<float>(std::max(top.Width, top.Height));
+    const float lod = texels > 1.0f
+        ? std::min(std::log2(texels), static_cast<float>(m_Levels.size() - 1)) : 0.0f;
+    const auto level = static_cast<uint32_t>(lod);
+    const auto atLevel = [&](const uint32_t index) {
+        return wrapped * glm::vec2(static_cast<float>(m_Levels[index].Width), static_cast<float>(m_Levels[index].Height));
+    };
+    const glm::vec3 color = sampleLevel(level, atLevel(level));
+    const float blend = lod - static_cast<float>(level);
+    if (blend <= 0.0f || level + 1 >= m_Levels.size()) return color;
+    return glm::mix(color, sampleLevel(level + 1, atLevel(level + 1)), blend);
+}
+
+glm::vec3 Texture::sampleLevel(const uint32_t level, const glm::vec2& coordinates) const {
+    const Level& info = m_Levels[level];
+    TextureCache& cache = TextureCache::Local();
+    // Texel centres sit at half-integer coordinates; neighbours past an edge wrap around.
+    const float x = coordinates.x - 0.5f;
+    const float y = coordinates.y - 0.5f;
+    const float floorX = std::floor(x);
+    const float floorY = std::floor(y);
+    const auto wrap = [](const int64_t value, const uint32_t size) {
+        return static_cast<uint32_t>((value % size + size) % size);
+    };
+    const uint32_t xs[2] = {wrap(static_cast<int64_t>(floorX), info.Width), wrap(static_cast<int64_t>(floorX) + 1, info.Width)};
+    const uint32_t ys[2] = {wrap(static_cast<int64_t>(floorY), info.Height), wrap(static_cast<int64_t>(floorY) + 1, info.Height)};
+    glm::vec3 texels[2][2];
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+            const uint32_t tile = info.FirstTile + ys[j] / TileSize * info.TilesX + xs[i] / TileSize;
+            texels[j][i] = cache.GetTile(*this, tile)[ys[j] % TileSize * TileSize + xs[i] % TileSize];
+        }
+    }
+    const float tx = x - floorX;
+    const float ty = y - floorY;
+    return glm::mix(glm::mix(texels[0][0], texels[0][1], tx), glm::mix(texels[1][0], texels[1][1], tx), ty);
+}
+
+void Texture::Hash(Utils::Fnv1a& hash) const {
+    hash.Add('T');
+    hash.Add(m_SourceSize);
+    hash.Add(m_SourceTime);
+    hash.Add(GetWidth());
+    hash.Add(GetHeight());
+    // The levels of a single tile, a few kilobytes that tell images apart beyond their key.
+    for (const Level& level : m_Levels) {
+        if (level.TilesX * level.TilesY == 1) {
+            hash.AddBytes(m_Tiles + static_cast<size_t>(level.FirstTile) * TileValues, TileBytes);
+        }
+    }
+}
+
+void TextureCache::SetThreadBudget(const uint64_t bytes) {
+    ThreadBudget.store(bytes, std::memory_order_relaxed);
+}
+
+uint64_t TextureCache::GetThreadBudget() {
+    return ThreadBudget.load(std::memory_order_relaxed);
+}
+
+TextureCache::Statistics TextureCache::GetStatistics() {
+    std::lock_guard lock(RegistryMutex);
+    Statistics statistics;
+    for (const auto& cache : Registry) {
+        statistics.Lookups += cache->m_Lookups.load(std::memory_order_relaxed);
+        statistics.Misses += cache->m_Misses.load(std::memory_order_relaxed);
+        statistics.Evictions += cache->m_Evictions.load(std::memory_order_relaxed);
+        statistics.ResidentBytes += cache->m_ResidentBytes.load(std::memory_order_relaxed);
+    }
+    statistics.ThreadCount = static_cast<uint32_t>(Registry.size());
+    return statistics;
+}
+
+TextureCache& TextureCache::Local() {
+    thread_local TextureCache* cache = [] {
+        std::lock_guard lock(RegistryMutex);
+        return Registry.emplace_back(new TextureCache()).get();
+    }();
+    return *cache;
+}
+
+const glm::vec3* TextureCache::GetTile(const Texture& texture, const uint32_t tile) {
+    // Only this thread writes the counters, so they need no read-modify-write.
+    m_Lookups.store(m_Lookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    const uint64_t key = static_cast<uint64_t>(texture.GetId()) << 32 | tile;
+    const auto getSet = [&] {
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & m_SetMask;
+    };
+    uint32_t set = getSet();
+    for (uint32_t way = 0; way < Ways && !m_Slots.empty(); way++) {
+        Slot& slot = m_Slots[set * Ways + way];
+        if (slot.Key == key) {
+            slot.LastUse = ++m_Clock;
+            return m_Texels.data() + static_cast<size_t>(set * Ways + way) * TileTexels;
+        }
+    }
+
+    m_Misses.store(m_Misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (const uint64_t budget = GetThreadBudget(); budget != m_Budget || m_Slots.empty()) {
+        resize(budget);
+        set = getSet();
+    }
+    // Empty slots were last used at 0, so they fill up first.
+    uint32_t victim = set * Ways;
+    for (uint32_t way = 1; way < Ways; way++) {
+        if (m_Slots[set * Ways + way].LastUse < m_Slots[victim].LastUse) {
+            victim = set * Ways + way;
+        }
+    }
+    if (m_Slots[victim].Key != 0) {
+        m_Evictions.store(m_Evictions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        m_ResidentBytes.store(m_ResidentBytes.load(std::memory_order_relaxed) + TileTexels * sizeof(glm::vec3),
+            std::memory_order_relaxed);
+    }
+    glm::vec3* texels = m_Texels.data() + static_cast<size_t>(victim) * TileTexels;
+    texture.DecodeTile(tile, texels);
+    m_Slots[victim] = {key, ++m_Clock};
+    return texels;
+}
+
+void TextureCache::resize(const uint64_t budget) {
+    // At least one set; the set count is a power of two, so the budget is kept or undershot.
+    const uint64_t tiles = budget / (TileTexels * sizeof(glm::vec3));
+    uint32_t sets = 1;
+    while (static_cast<uint64_t>(sets) * 2 * Ways <= tiles && sets < (1u << 24)) {
+        sets *= 2;
+    }
+    m_Slots.assign(static_cast<size_t>(sets) * Ways, {});
+    m_Texels.assign(static_cast<size_t>(sets) * Ways * TileTexels, glm::vec3(0.0f));
+    m_Texels.shrink_to_fit();
+    m_SetMask = sets - 1;
+    m_Budget = budget;
+    m_ResidentBytes.store(0, std::memory_order_relaxed);
+}
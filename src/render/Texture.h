@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "utils/Hash.h"
+#include "utils/MappedFile.h"
+
+// Image texture for materials: linear RGB in a mip chain of TileSize x TileSize tiles, read from a
+// texture file through the calling thread's TextureCache instead of being held in memory.
+//
+// The texture file, <image>.dzt, is written the first time an image is loaded. stb_image decodes the
+// image; 8 and 16-bit images are converted from sRGB to linear, HDR images already are. Each level is
+// stored in half floats, tile by tile, so a lookup reads a few kilobytes of the file however large the
+// image is, and images that don't fit in memory together still render. Like page files, the texture
+// file is keyed by the image's size and modification time.
+class Texture {
+public:
+    static constexpr uint32_t TileSize = 32;
+    // Half floats per tile: three channels per texel.
+    static constexpr uint32_t TileValues = TileSize * TileSize * 3;
+
+    struct LoadStatistics
+    {
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t LevelCount = 0;
+        bool IsTextureFileWritten = false;
+        uint64_t TextureFileSize = 0;
+        // Decoding the image and writing the texture file, when it was missing or stale.
+        double WriteTimeMs = 0.0;
+    };
+
+    static std::string GetTextureFilePath(const std::string& imageFileName);
+
+    // Maps the texture file of the image, writing it first if it is missing or stale. Reads what
+    // stb_image reads: PNG, JPEG, TGA, BMP, HDR and a few more.
+    static std::shared_ptr<Texture> Load(const std::string& fileName, std::string& error,
+        LoadStatistics* statistics = nullptr);
+
+    // Trilinear filtered color at the texture coordinates, which repeat outside [0, 1]. footprint is the
+    // width of the area to average, in texture coordinate units; it picks the mip levels, and 0 samples
+    // the full resolution.
+    [[nodiscard]] glm::vec3 Sample(const glm::vec2& coordinates, float footprint) const;
+
+    // Covers the texture file's key, so hashing doesn't read the texels.
+    void Hash(Utils::Fnv1a& hash) const;
+
+    [[nodiscard]] uint32_t GetWidth() const { return m_Levels.front().Width; }
+
+    [[nodiscard]] uint32_t GetHeight() const { return m_Levels.front().Height; }
+
+    [[nodiscard]] uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+
+    // Tells textures apart in TextureCache keys; never reused within a process.
+    [[nodiscard]] uint32_t GetId() const { return m_Id; }
+
+    // Decodes tile, numbered across all levels, into TileSize * TileSize texels in rows.
+    void DecodeTile(uint32_t tile, glm::vec3* texels) const;
+
+    // One level of the mip chain; tiles are numbered row by row from FirstTile.
+    struct Level
+    {
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t TilesX = 0;
+        uint32_t TilesY = 0;
+        uint32_t FirstTile = 0;
+    };
+
+private:
+    Texture() = default;
+
+    // Maps the texture file if it belongs to the image and its size matches the levels.
+    bool open(const std::string& textureFileName, uint64_t sourceSize, int64_t sourceTime);
+
+    // Bilinear filtered color at the coordinates in texels of level.
+    [[nodiscard]] glm::vec3 sampleLevel(uint32_t level, const glm::vec2& coordinates) const;
+
+    static std::atomic<uint32_t> s_NextId;
+
+    uint32_t m_Id = 0;
+    std::unique_ptr<Utils::MappedFile> m_File;
+    const uint16_t* m_Tiles = nullptr;
+    std::vector<Level> m_Levels;
+    uint64_t m_SourceSize = 0;
+    int64_t m_SourceTime = 0;
+};
+
+// Decoded tiles of the textures its thread sampled recently, at most GetThreadBudget() bytes of them.
+// Every thread has its own, so sampling takes no locks; a tile is looked up in a set of Ways slots
+// chosen by its key, and a miss replaces the least recently used one of them.
+//
+// Caches are kept until the process ends, like the profiler's buffers, so GetStatistics() still counts
+// the threads that finished.
+class TextureCache {
+public:
+    static constexpr uint64_t DefaultThreadBudget = 16ull << 20;
+    static constexpr uint32_t Ways = 4;
+
+    struct Statistics
+    {
+        uint64_t Lookups = 0;
+        uint64_t Misses = 0;
+        uint64_t Evictions = 0;
+        uint64_t ResidentBytes = 0;
+        uint32_t ThreadCount = 0;
+    };
+
+    // Bytes of decoded tiles each thread may keep; caches already created shrink or grow on their next
+    // miss. Set it before rendering.
+    static void SetThreadBudget(uint64_t bytes);
+
+    [[nodiscard]] static uint64_t GetThreadBudget();
+
+    // Summed over every thread's cache.
+    [[nodiscard]] static Statistics GetStatistics();
+
+    // The calling thread's cache.
+    static TextureCache& Local();
+
+    // The tile's texels, read from the texture on a miss. Valid until the thread's next lookup.
+    const glm::vec3* GetTile(const Texture& texture, uint32_t tile);
+
+private:
+    struct Slot
+    {
+        // Texture id in the high half, tile in the low one; 0 for an empty slot, as ids start at 1.
+        uint64_t Key = 0;
+        uint64_t LastUse = 0;
+    };
+
+    TextureCache() = default;
+
+    void resize(uint64_t budget);
+
+    std::vector<Slot> m_Slots;
+    std::vector<glm::vec3> m_Texels;
+    uint32_t m_SetMask = 0;
+    uint64_t m_Budget = 0;
+    uint64_t m_Clock = 0;
+    // Written by the owning thread only, read by GetStatistics().
+    std::atomic<uint64_t> m_Lookups = 0;
+    std::atomic<uint64_t> m_Misses = 0;
+    std::atomic<uint64_t> m_Evictions = 0;
+    std::atomic<uint64_t> m_ResidentBytes = 0;
+};
@@ -0,0 +1,200 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <numeric>
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr int BinCount = 16;
+    constexpr uint32_t MaxLeafSize = 4;
+    // Subtrees with more primitives than this are built as separate tasks.
+    constexpr uint32_t ParallelBuildThreshold = 4096;
+    // Cost of visiting a node relative to testing one primitive.
+    constexpr float TraversalCost = 1.0f;
+
+    struct Bin
+    {
+        Aabb Bounds;
+        uint32_t Count = 0;
+    };
+
+    class Builder {
+    public:
+        Builder(const std::vector<Aabb>& bounds, std::vector<Bvh::Node>& nodes, std::vector<uint32_t>& indices)
+            : m_Bounds(bounds), m_Nodes(nodes), m_Indices(indices), m_Centroids(bounds.size()) {
+            tbb::parallel_for<size_t>(0, bounds.size(), [&](const size_t i) {
+                m_Centroids[i] = bounds[i].GetCenter();
+            });
+        }
+
+        void Build(const uint32_t nodeIndex, const uint32_t begin, const uint32_t end, const uint32_t depth) {
+            Bvh::Node& node = m_Nodes[nodeIndex];
+            Aabb centroidBounds;
+            for (uint32_t i = begin; i < end; i++) {
+                node.Bounds.Grow(m_Bounds[m_Indices[i]]);
+                centroidBounds.Grow(m_Centroids[m_Indices[i]]);
+            }
+            const uint32_t count = end - begin;
+            const uint32_t middle = count > 1 && depth + 1 < Bvh::MaxDepth ? split(node, centroidBounds, begin, end) : end;
+            if (middle == end) {
+                node.Index = begin;
+                node.Count = count;
+                return;
+            }
+
+            const uint32_t left = m_NodeCount.fetch_add(2, std::memory_order_relaxed);
+            node.Index = left;
+            node.Count = 0;
+            if (count > ParallelBuildThreshold) {
+                tbb::parallel_invoke(
+                    [&] { Build(left, begin, middle, depth + 1); },
+                    [&] { Build(left + 1, middle, end, depth + 1); });
+            } else {
+                Build(left, begin, middle, depth + 1);
+                Build(left + 1, middle, end, depth + 1);
+            }
+        }
+
+        [[nodiscard]] uint32_t GetNodeCount() const { return m_NodeCount.load(); }
+
+    private:
+        // Partitions the range and returns where the second child starts, or end to make a leaf.
+        uint32_t split(const Bvh::Node& node, const Aabb& centroidBounds, const uint32_t begin, const uint32_t end) {
+            const uint32_t count = end - begin;
+            const glm::vec3 extent = centroidBounds.GetExtent();
+            if (std::max({extent.x, extent.y, extent.z}) <= 0.0f) {
+                // Every centroid in one spot: no plane separates them, so only split to keep leaves small.
+                return count > MaxLeafSize ? begin + count / 2 : end;
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            int bestAxis = -1, bestBin = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                if (extent[axis] <= 0.0f) continue;
+                std::array<Bin, BinCount> bins{};
+                const float scale = BinCount / extent[axis];
+                for (uint32_t i = begin; i < end; i++) {
+                    const uint32_t primitive = m_Indices[i];
+                    Bin& bin = bins[binIndex(m_Centroids[primitive][axis], centroidBounds.Min[axis], scale)];
+                    bin.Bounds.Grow(m_Bounds[primitive]);
+                    bin.Count++;
+                }
+                // Sweep from the right to get the cost of every right-hand side, then from the left.
+                std::array<float, BinCount> rightCost{};
+                Aabb rightBounds;
+                uint32_t rightCount = 0;
+                for (int b = BinCount - 1; b > 0; b--) {
+                    rightBounds.Grow(bins[b].Bounds);
+                    rightCount += bins[b].Count;
+                    rightCost[b] = rightBounds.GetHalfArea() * static_cast<float>(rightCount);
+                }
+                Aabb leftBounds;
+                uint32_t leftCount = 0;
+                for (int b = 1; b < BinCount; b++) {
+                    leftBounds.Grow(bins[b - 1].Bounds);
+                    leftCount += bins[b - 1].Count;
+                    if (leftCount == 0 || leftCount == count) continue;
+                    const float cost = leftBounds.GetHalfArea() * static_cast<float>(leftCount) + rightCost[b];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+
+            const float leafCost = static_cast<float>(count);
+            const float area = node.Bounds.GetHalfArea();
+            const float splitCost = TraversalCost + (area > 0.0f ? bestCost / area : 0.0f);
+            if (bestAxis < 0 || (count <= MaxLeafSize && leafCost <= splitCost)) {
+                return count > MaxLeafSize ? medianSplit(centroidBounds, begin, end) : end;
+            }
+
+            const float scale = BinCount / extent[bestAxis];
+            const float origin = centroidBounds.Min[bestAxis];
+            const auto middle = std::partition(m_Indices.begin() + begin, m_Indices.begin() + end,
+                [&](const uint32_t primitive) {
+                    return binIndex(m_Centroids[primitive][bestAxis], origin, scale) < bestBin;
+                });
+            return static_cast<uint32_t>(middle - m_Indices.begin());
+        }
+
+        uint32_t medianSplit(const Aabb& centroidBounds, const uint32_t begin, const uint32_t end) {
+            const glm::vec3 extent = centroidBounds.GetExtent();
+            const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            const uint32_t middle = begin + (end - begin) / 2;
+            std::nth_element(m_Indices.begin() + begin, m_Indices.begin() + middle, m_Indices.begin() + end,
+                [&](const uint32_t a, const uint32_t b) { return m_Centroids[a][axis] < m_Centroids[b][axis]; });
+            return middle;
+        }
+
+        static int binIndex(const float centroid, const float origin, const float scale) {
+            return std::clamp(static_cast<int>((centroid - origin) * scale), 0, BinCount - 1);
+        }
+
+        const std::vector<Aabb>& m_Bounds;
+        std::vector<Bvh::Node>& m_Nodes;
+        std::vector<uint32_t>& m_Indices;
+        std::vector<glm::vec3> m_Centroids;
+        std::atomic<uint32_t> m_NodeCount = 1;
+    };
+}
+
+Bvh Bvh::View(const std::span<const Node> nodes, const std::span<const uint32_t> primitiveIndices) {
+    Bvh bvh;
+    bvh.m_NodeView = nodes;
+    bvh.m_PrimitiveIndexView = primitiveIndices;
+    return bvh;
+}
+
+void Bvh::Build(const std::vector<Aabb>& bounds) {
+    DAZHBOG_PROFILE_ZONE("BuildBvh");
+    m_Nodes.clear();
+    m_PrimitiveIndices.resize(bounds.size());
+    std::iota(m_PrimitiveIndices.begin(), m_PrimitiveIndices.end(), 0u);
+    m_NodeView = {};
+    m_PrimitiveIndexView = m_PrimitiveIndices;
+    if (bounds.empty()) return;
+
+    // A binary tree with at least one primitive per leaf has at most 2n - 1 nodes.
+    m_Nodes.resize(2 * bounds.size() - 1);
+    Builder builder(bounds, m_Nodes, m_PrimitiveIndices);
+    builder.Build(0, 0, static_cast<uint32_t>(bounds.size()), 0);
+    m_Nodes.resize(builder.GetNodeCount());
+    m_Nodes.shrink_to_fit();
+    m_NodeView = m_Nodes;
+}
+
+bool Bvh::IsValid(const size_t primitiveCount) const {
+    if (m_NodeView.empty()) return m_PrimitiveIndexView.size() == primitiveCount;
+    if (m_PrimitiveIndexView.size() != primitiveCount
+        || std::ranges::any_of(m_PrimitiveIndexView, [&](const uint32_t i) { return i >= primitiveCount; })) {
+        return false;
+    }
+    // Children always come after their parent, so walking down can't loop.
+    struct Entry
+    {
+        uint32_t Node;
+        uint32_t Depth;
+    };
+    std::vector<Entry> stack = {{0, 0}};
+    while (!stack.empty()) {
+        const auto [index, depth] = stack.back();
+        stack.pop_back();
+        const Node& node = m_NodeView[index];
+        if (node.IsLeaf()) {
+            if (node.Index > primitiveCount || node.Count > primitiveCount - node.Index) return false;
+            continue;
+        }
+        if (node.Index <= index || node.Index >= m_NodeView.size() - 1 || depth + 1 >= MaxDepth) return false;
+        stack.push_back({node.Index, depth + 1});
+        stack.push_back({node.Index + 1, depth + 1});
+    }
+    return true;
+}
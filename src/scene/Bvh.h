@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "math/Aabb.h"
+#include "math/Hittable.h"
+
+// Bounding volume hierarchy over primitives known only by their bounds; the caller tests the primitives
+// themselves. Built top-down with a binned surface area heuristic, large subtrees in parallel.
+//
+// Nodes refer to each other and to primitives by index only, so a tree can be written to disk and used
+// from there as it is, see View().
+class Bvh {
+public:
+    // An inner node's children are Nodes[Index] and Nodes[Index + 1]; a leaf holds
+    // PrimitiveIndices[Index .. Index + Count).
+    struct Node
+    {
+        Aabb Bounds;
+        uint32_t Index = 0;
+        uint32_t Count = 0;
+
+        [[nodiscard]] bool IsLeaf() const { return Count > 0; }
+    };
+
+    Bvh() = default;
+
+    // Views point into the moved vectors, so moving is fine but copying is not.
+    Bvh(Bvh&&) = default;
+    Bvh& operator=(Bvh&&) = default;
+    Bvh(const Bvh&) = delete;
+    Bvh& operator=(const Bvh&) = delete;
+
+    // Tree over arrays owned by someone else, such as a mapped file; they must outlive it.
+    static Bvh View(std::span<const Node> nodes, std::span<const uint32_t> primitiveIndices);
+
+    // Replaces the tree with one over bounds[i] for every primitive i.
+    void Build(const std::vector<Aabb>& bounds);
+
+    // Checks that every index stays in range and the tree is no deeper than MaxDepth, so traversal is
+    // safe. Meant for trees that come from a file.
+    [[nodiscard]] bool IsValid(size_t primitiveCount) const;
+
+    // Calls hitPrimitive(primitiveIndex, tMax) for every primitive in a leaf the ray reaches before tMax,
+    // nearer boxes first. hitPrimitive lowers tMax to the distance of any hit it finds, which prunes the
+    // rest of the traversal. Adds the boxes tested to boxTests.
+    template<typename HitPrimitive>
+    void Traverse(const Ray& ray, float& tMax, const HitPrimitive& hitPrimitive, uint64_t& boxTests) const;
+
+    [[nodiscard]] bool IsEmpty() const { return m_NodeView.empty(); }
+
+    [[nodiscard]] std::span<const Node> GetNodes() const { return m_NodeView; }
+
+    [[nodiscard]] std::span<const uint32_t> GetPrimitiveIndices() const { return m_PrimitiveIndexView; }
+
+    // Deeper nodes become leaves whatever their size, which bounds the traversal stack.
+    static constexpr uint32_t MaxDepth = 64;
+
+private:
+    // Empty for views.
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_PrimitiveIndices;
+
+    std::span<const Node> m_NodeView;
+    std::span<const uint32_t> m_PrimitiveIndexView;
+};
+
+template<typename HitPrimitive>
+void Bvh::Traverse(const Ray& ray, float& tMax, const HitPrimitive& hitPrimitive, uint64_t& boxTests) const {
+    constexpr float Miss = std::numeric_limits<float>::infinity();
+    if (m_NodeView.empty()) return;
+    const glm::vec3 inverseDirection = 1.0f / ray.Direction;
+
+    struct Entry
+    {
+        uint32_t Node;
+        float Distance;
+    };
+    Entry stack[MaxDepth];
+    uint32_t stackSize = 0;
+
+    boxTests++;
+    if (m_NodeView[0].Bounds.Intersect(ray.Origin, inverseDirection, tMax) == Miss) return;
+    uint32_t nodeIndex = 0;
+    while (true) {
+        const Node& node = m_NodeView[nodeIndex];
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.Index; i < node.Index + node.Count; i++) {
+                hitPrimitive(m_PrimitiveIndexView[i], tMax);
+            }
+        } else {
+            uint32_t near = node.Index, far = node.Index + 1;
+            float nearDistance = m_NodeView[near].Bounds.Intersect(ray.Origin, inverseDirection, tMax);
+            float farDistance = m_NodeView[far].Bounds.Intersect(ray.Origin, inverseDirection, tMax);
+            boxTests += 2;
+            if (farDistance < nearDistance) {
+                std::swap(near, far);
+                std::swap(nearDistance, farDistance);
+            }
+            if (nearDistance != Miss) {
+                if (farDistance != Miss) {
+                    stack[stackSize++] = {far, farDistance};
+                }
+                nodeIndex = near;
+                continue;
+            }
+        }
+        // Boxes entered beyond a hit found meanwhile can be skipped.
+        while (stackSize > 0 && stack[stackSize - 1].Distance >= tMax) {
+            stackSize--;
+        }
+        if (stackSize == 0) return;
+        nodeIndex = stack[--stackSize].Node;
+    }
+}
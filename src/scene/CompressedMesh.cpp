@@ -0,0 +1,323 @@
+#include "CompressedMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include <tbb/parallel_for.h>
+
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr float QuantizedRange = 65535.0f;
+    constexpr float NormalRange = 32767.0f;
+
+    template<typename T>
+    void reorder(std::vector<T>& values, const std::vector<uint32_t>& newIndices) {
+        if (values.empty()) return;
+        std::vector<T> reordered(values.size());
+        tbb::parallel_for<size_t>(0, values.size(), [&](const size_t i) {
+            reordered[newIndices[i]] = values[i];
+        });
+        values = std::move(reordered);
+    }
+
+    // One vertex per distinct combination of position, normal and texture coordinate indices, so a single
+    // index addresses all three.
+    void unifyIndices(MeshData& data) {
+        if (data.NormalIndices.empty() && data.TextureIndices.empty()) return;
+        DAZHBOG_PROFILE_ZONE("UnifyMeshIndices");
+        struct KeyHash
+        {
+            size_t operator()(const glm::uvec3& key) const {
+                return (static_cast<size_t>(key.x) * 0x9E3779B97F4A7C15ull) ^ (static_cast<size_t>(key.y) << 21)
+                    ^ (static_cast<size_t>(key.z) << 42) ^ key.z;
+            }
+        };
+        std::unordered_map<glm::uvec3, uint32_t, KeyHash> vertices;
+        vertices.reserve(data.Positions.size());
+        MeshData unified;
+        const bool hasNormals = !data.Normals.empty();
+        const bool hasTextures = !data.TextureCoordinates.empty();
+        for (size_t t = 0; t < data.Triangles.size(); t++) {
+            glm::uvec3& triangle = data.Triangles[t];
+            for (int k = 0; k < 3; k++) {
+                const glm::uvec3 key(triangle[k],
+                    data.NormalIndices.empty() ? triangle[k] : data.NormalIndices[t][k],
+                    data.TextureIndices.empty() ? triangle[k] : data.TextureIndices[t][k]);
+                const auto [it, isNew] = vertices.try_emplace(key, static_cast<uint32_t>(unified.Positions.size()));
+                if (isNew) {
+                    unified.Positions.push_back(data.Positions[key.x]);
+                    if (hasNormals) unified.Normals.push_back(data.Normals[key.y]);
+                    if (hasTextures) unified.TextureCoordinates.push_back(data.TextureCoordinates[key.z]);
+                }
+                triangle[k] = it->second;
+            }
+        }
+        data.Positions = std::move(unified.Positions);
+        data.Normals = std::move(unified.Normals);
+        data.TextureCoordinates = std::move(unified.TextureCoordinates);
+        data.NormalIndices.clear();
+        data.TextureIndices.clear();
+    }
+
+    // Octahedral mapping: the unit sphere folded onto the square [-1, 1]^2.
+    std::array<int16_t, 2> encodeNormal(const glm::vec3& normal) {
+        const glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+        glm::vec2 p(n.x, n.y);
+        if (n.z < 0.0f) {
+            p = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return {
+            static_cast<int16_t>(std::lround(std::clamp(p.x, -1.0f, 1.0f) * NormalRange)),
+            static_cast<int16_t>(std::lround(std::clamp(p.y, -1.0f, 1.0f) * NormalRange)),
+        };
+    }
+
+    glm::vec3 decodeNormal(const std::array<int16_t, 2>& encoded) {
+        glm::vec3 n(static_cast<float>(encoded[0]) / NormalRange, static_cast<float>(encoded[1]) / NormalRange, 0.0f);
+        n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+        const float fold = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -fold : fold;
+        n.y += n.y >= 0.0f ? -fold : fold;
+        return glm::normalize(n);
+    }
+
+    uint16_t quantize(const float value, const float origin, const float step) {
+        return step > 0.0f ? static_cast<uint16_t>(std::clamp(std::lround((value - origin) / step), 0l, 65535l)) : 0;
+    }
+}
+
+CompressedMesh::CompressedMesh(MeshData data, const uint32_t materialIndex, const MeshCompression& compression)
+    : m_Compression(compression), m_MaterialIndex(materialIndex), m_TriangleCount(data.Triangles.size()) {
+    DAZHBOG_PROFILE_ZONE("BuildCompressedMesh");
+    if (data.Normals.empty()) {
+        data.Normals = Mesh::ComputeSmoothNormals(data.Positions, data.Triangles);
+        data.NormalIndices.clear();
+    }
+    unifyIndices(data);
+    storeVertices(data);
+
+    // The tree is built over the triangles as they will be decoded.
+    std::vector<Aabb> bounds(data.Triangles.size());
+    tbb::parallel_for<size_t>(0, bounds.size(), [&](const size_t i) {
+        const glm::uvec3& triangle = data.Triangles[i];
+        for (int k = 0; k < 3; k++) {
+            bounds[i].Grow(getPosition(triangle[k]));
+        }
+    });
+    Bvh bvh;
+    bvh.Build(bounds);
+    bounds = {};
+    if (!bvh.IsEmpty()) m_Bounds = bvh.GetNodes()[0].Bounds;
+
+    // Triangles in leaf order, then vertices in order of first use by them.
+    const std::span<const uint32_t> order = bvh.GetPrimitiveIndices();
+    std::vector<glm::uvec3> triangles(order.size());
+    tbb::parallel_for<size_t>(0, order.size(), [&](const size_t i) {
+        triangles[i] = data.Triangles[order[i]];
+    });
+    data.Triangles = {};
+    if (!data.MaterialIndices.empty()) {
+        m_MaterialIndices.resize(order.size());
+        tbb::parallel_for<size_t>(0, order.size(), [&](const size_t i) {
+            m_MaterialIndices[i] = data.MaterialIndices[order[i]];
+        });
+    }
+    const size_t vertexCount = std::max({m_Positions.size(), m_QuantizedPositions.size()});
+    std::vector<uint32_t> newIndices(vertexCount, UINT32_MAX);
+    uint32_t nextIndex = 0;
+    for (glm::uvec3& triangle : triangles) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t& newIndex = newIndices[triangle[k]];
+            if (newIndex == UINT32_MAX) newIndex = nextIndex++;
+            triangle[k] = newIndex;
+        }
+    }
+    // Vertices no triangle uses go to the end.
+    for (uint32_t& newIndex : newIndices) {
+        if (newIndex == UINT32_MAX) newIndex = nextIndex++;
+    }
+    reorder(m_Positions, newIndices);
+    reorder(m_Normals, newIndices);
+    reorder(m_TextureCoordinates, newIndices);
+    reorder(m_QuantizedPositions, newIndices);
+    reorder(m_QuantizedNormals, newIndices);
+    reorder(m_QuantizedTextureCoordinates, newIndices);
+    storeTriangles(triangles);
+
+    if (m_Compression.BoundsBits == 8) {
+        m_Bvh8.Build(bvh);
+    } else {
+        m_Bvh16.Build(bvh);
+    }
+}
+
+void CompressedMesh::storeVertices(MeshData& data) {
+    if (!m_Compression.QuantizeVertices) {
+        m_Positions = std::move(data.Positions);
+        m_Normals = std::move(data.Normals);
+        m_TextureCoordinates = std::move(data.TextureCoordinates);
+        return;
+    }
+
+    Aabb positionBounds;
+    for (const glm::vec3& position : data.Positions) {
+        positionBounds.Grow(position);
+    }
+    m_PositionOrigin = positionBounds.Min;
+    m_PositionStep = positionBounds.GetExtent() / QuantizedRange;
+    glm::vec2 textureMin(std::numeric_limits<float>::max()), textureMax(-std::numeric_limits<float>::max());
+    for (const glm::vec2& coordinates : data.TextureCoordinates) {
+        textureMin = glm::min(textureMin, coordinates);
+        textureMax = glm::max(textureMax, coordinates);
+    }
+    if (!data.TextureCoordinates.empty()) {
+        m_TextureOrigin = textureMin;
+        m_TextureStep = (textureMax - textureMin) / QuantizedRange;
+    }
+
+    m_QuantizedPositions.resize(data.Positions.size());
+    m_QuantizedNormals.resize(data.Normals.size());
+    m_QuantizedTextureCoordinates.resize(data.TextureCoordinates.size());
+    tbb::parallel_for<size_t>(0, data.Positions.size(), [&](const size_t i) {
+        for (int axis = 0; axis < 3; axis++) {
+            m_QuantizedPositions[i][axis] = quantize(data.Positions[i][axis], m_PositionOrigin[axis], m_PositionStep[axis]);
+        }
+        m_QuantizedNormals[i] = encodeNormal(data.Normals[i]);
+        if (!data.TextureCoordinates.empty()) {
+            for (int axis = 0; axis < 2; axis++) {
+                m_QuantizedTextureCoordinates[i][axis] = quantize(data.TextureCoordinates[i][axis],
+                    m_TextureOrigin[axis], m_TextureStep[axis]);
+            }
+        }
+    });
+    data.Positions = {};
+    data.Normals = {};
+    data.TextureCoordinates = {};
+}
+
+void CompressedMesh::storeTriangles(std::vector<glm::uvec3>& triangles) {
+    if (!m_Compression.PackIndices) {
+        m_Triangles = std::move(triangles);
+        return;
+    }
+    constexpr int64_t MaxOffset = std::numeric_limits<int16_t>::max();
+    m_PackedTriangles.resize(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const glm::uvec3& triangle = triangles[i];
+        const int64_t second = static_cast<int64_t>(triangle.y) - triangle.x;
+        const int64_t third = static_cast<int64_t>(triangle.z) - triangle.x;
+        if (std::abs(second) <= MaxOffset && std::abs(third) <= MaxOffset) {
+            m_PackedTriangles[i] = {triangle.x, static_cast<int16_t>(second), static_cast<int16_t>(third)};
+        } else {
+            m_PackedTriangles[i] = {static_cast<uint32_t>(m_WideTriangles.size()), WideTriangle, 0};
+            m_WideTriangles.push_back(triangle);
+        }
+    }
+    triangles = {};
+}
+
+glm::uvec3 CompressedMesh::getTriangle(const uint32_t triangle) const {
+    if (!m_Compression.PackIndices) return m_Triangles[triangle];
+    const PackedTriangle& packed = m_PackedTriangles[triangle];
+    if (packed.Second == WideTriangle) return m_WideTriangles[packed.First];
+    return {packed.First, packed.First + packed.Second, packed.First + packed.Third};
+}
+
+glm::vec3 CompressedMesh::getPosition(const uint32_t vertex) const {
+    if (!m_Compression.QuantizeVertices) return m_Positions[vertex];
+    const std::array<uint16_t, 3>& position = m_QuantizedPositions[vertex];
+    return m_PositionOrigin + glm::vec3(position[0], position[1], position[2]) * m_PositionStep;
+}
+
+glm::vec3 CompressedMesh::getNormal(const uint32_t vertex) const {
+    return m_Compression.QuantizeVertices ? decodeNormal(m_QuantizedNormals[vertex]) : m_Normals[vertex];
+}
+
+glm::vec2 CompressedMesh::getTextureCoordinates(const uint32_t vertex) const {
+    if (!m_Compression.QuantizeVertices) return m_TextureCoordinates[vertex];
+    const std::array<uint16_t, 2>& coordinates = m_QuantizedTextureCoordinates[vertex];
+    return m_TextureOrigin + glm::vec2(coordinates[0], coordinates[1]) * m_TextureStep;
+}
+
+HitPayload CompressedMesh::Hit(const Ray& ray, const Interval tBoundaries) const {
+    return m_Compression.BoundsBits == 8 ? hit(m_Bvh8, ray, tBoundaries) : hit(m_Bvh16, ray, tBoundaries);
+}
+
+template<typename T>
+HitPayload CompressedMesh::hit(const QuantizedBvh<T>& bvh, const Ray& ray, const Interval tBoundaries) const {
+    float tMax = tBoundaries.GetMax();
+    uint32_t hitTriangle = 0;
+    glm::vec2 barycentrics(0.0f);
+    bool didHit = false;
+    uint64_t boxTests = 0;
+    bvh.Traverse(ray, tMax, [&](const uint32_t triangle, float& maxDistance) {
+        const glm::uvec3 indices = getTriangle(triangle);
+        if (Mesh::IntersectTriangle(getPosition(indices.x), getPosition(indices.y), getPosition(indices.z), ray,
+                tBoundaries.GetMin(), maxDistance, barycentrics)) {
+            hitTriangle = triangle;
+            didHit = true;
+        }
+    }, boxTests);
+    if (!didHit) {
+        return {.DidCollide = false};
+    }
+
+    const glm::uvec3 triangle = getTriangle(hitTriangle);
+    const glm::vec3 positions[3] = {getPosition(triangle.x), getPosition(triangle.y), getPosition(triangle.z)};
+    const glm::vec3 normals[3] = {getNormal(triangle.x), getNormal(triangle.y), getNormal(triangle.z)};
+    HitPayload hitRecord = Mesh::MakePayload(ray, tMax, positions, normals, barycentrics);
+    if (!m_TextureCoordinates.empty() || !m_QuantizedTextureCoordinates.empty()) {
+        const glm::vec2 textureCoordinates[3] = {getTextureCoordinates(triangle.x), getTextureCoordinates(triangle.y),
+            getTextureCoordinates(triangle.z)};
+        Mesh::SetTextureCoordinates(hitRecord, positions, textureCoordinates, barycentrics);
+    }
+    hitRecord.MaterialIndex = m_MaterialIndices.empty() ? m_MaterialIndex : m_MaterialIndices[hitTriangle];
+    return hitRecord;
+}
+
+size_t CompressedMesh::GetMemoryUsage() const {
+    const auto bytes = []<typename T>(const std::vector<T>& values) { return values.size() * sizeof(T); };
+    return bytes(m_Positions) + bytes(m_Normals) + bytes(m_TextureCoordinates) + bytes(m_QuantizedPositions)
+        + bytes(m_QuantizedNormals) + bytes(m_QuantizedTextureCoordinates) + bytes(m_Triangles)
+        + bytes(m_PackedTriangles) + bytes(m_WideTriangles) + bytes(m_MaterialIndices)
+        + m_Bvh8.GetMemoryUsage() + m_Bvh16.GetMemoryUsage();
+}
+
+std::unique_ptr<Hittable> CreateMesh(MeshData data, const uint32_t materialIndex, const MeshCompression* compression,
+    size_t& memoryUsage) {
+    if (compression) {
+        auto mesh = std::make_unique<CompressedMesh>(std::move(data), materialIndex, *compression);
+        memoryUsage = mesh->GetMemoryUsage();
+        return mesh;
+    }
+    auto mesh = std::make_unique<Mesh>(std::move(data), materialIndex);
+    memoryUsage = mesh->GetMemoryUsage();
+    return mesh;
+}
+
+void CompressedMesh::Hash(Utils::Fnv1a& hash) const {
+    const auto addArray = [&hash]<typename T>(const std::vector<T>& values) {
+        hash.Add(values.size());
+        hash.AddBytes(values.data(), values.size() * sizeof(T));
+    };
+    hash.Add('C');
+    hash.Add(m_Compression.BoundsBits);
+    addArray(m_Positions);
+    addArray(m_Normals);
+    addArray(m_TextureCoordinates);
+    addArray(m_QuantizedPositions);
+    addArray(m_QuantizedNormals);
+    addArray(m_QuantizedTextureCoordinates);
+    hash.Add(m_PositionOrigin);
+    hash.Add(m_PositionStep);
+    hash.Add(m_TextureOrigin);
+    hash.Add(m_TextureStep);
+    addArray(m_Triangles);
+    addArray(m_PackedTriangles);
+    addArray(m_WideTriangles);
+    addArray(m_MaterialIndices);
+    hash.Add(m_MaterialIndex);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "Mesh.h"
+#include "QuantizedBvh.h"
+
+// How CompressedMesh stores its data.
+struct MeshCompression
+{
+    // Bits per coordinate of the child bounds in the BVH, 8 or 16.
+    uint32_t BoundsBits = 8;
+    // Positions and texture coordinates in 16-bit steps of their range, normals octahedral in 2 x 16 bits:
+    // 10 bytes per vertex instead of 32. Positions snap to 1/65535 of the mesh's extent.
+    bool QuantizeVertices = true;
+    // Triangles as a 32-bit index and two 16-bit offsets from it, 8 bytes instead of 12; the rare triangle
+    // whose corners are further apart keeps full indices in a side table.
+    bool PackIndices = true;
+};
+
+// Mesh for models that don't fit in memory otherwise: a QuantizedBvh instead of a Bvh, triangles in
+// the tree's leaf order so no primitive index array is needed, and optionally quantized vertices and
+// packed indices. Everything is decoded on the fly while tracing, which costs some speed; GetMemoryUsage()
+// against Mesh's tells what it saves.
+//
+// Vertices are reordered by first use in leaf order, which keeps the corners of most triangles close
+// together. Meshes with separate normal or texture coordinate indices are split into one vertex per
+// distinct combination first.
+class CompressedMesh final : public Hittable {
+public:
+    // Data must pass Mesh::Validate().
+    CompressedMesh(MeshData data, uint32_t materialIndex, const MeshCompression& compression);
+
+    HitPayload Hit(const Ray& ray, Interval tBoundaries) const override;
+
+    [[nodiscard]] Aabb GetBounds() const override { return m_Bounds; }
+
+    void Hash(Utils::Fnv1a& hash) const override;
+
+    [[nodiscard]] size_t GetTriangleCount() const { return m_TriangleCount; }
+
+    // Bytes of vertex, index and BVH data.
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+    struct PackedTriangle
+    {
+        uint32_t First;
+        // Offsets of the other corners from First, or WideTriangle when First indexes m_WideTriangles.
+        int16_t Second;
+        int16_t Third;
+    };
+
+    static constexpr int16_t WideTriangle = std::numeric_limits<int16_t>::min();
+
+    template<typename T>
+    HitPayload hit(const QuantizedBvh<T>& bvh, const Ray& ray, Interval tBoundaries) const;
+
+    [[nodiscard]] glm::uvec3 getTriangle(uint32_t triangle) const;
+
+    [[nodiscard]] glm::vec3 getPosition(uint32_t vertex) const;
+
+    [[nodiscard]] glm::vec3 getNormal(uint32_t vertex) const;
+
+    [[nodiscard]] glm::vec2 getTextureCoordinates(uint32_t vertex) const;
+
+    void storeVertices(MeshData& data);
+
+    void storeTriangles(std::vector<glm::uvec3>& triangles);
+
+    MeshCompression m_Compression;
+    uint32_t m_MaterialIndex;
+    size_t m_TriangleCount = 0;
+    Aabb m_Bounds;
+
+    // Either the float arrays or the quantized ones are filled, per MeshCompression::QuantizeVertices.
+    std::vector<glm::vec3> m_Positions;
+    std::vector<glm::vec3> m_Normals;
+    std::vector<glm::vec2> m_TextureCoordinates;
+    std::vector<std::array<uint16_t, 3>> m_QuantizedPositions;
+    std::vector<std::array<int16_t, 2>> m_QuantizedNormals;
+    std::vector<std::array<uint16_t, 2>> m_QuantizedTextureCoordinates;
+    // Decoded values are Origin + q * Step.
+    glm::vec3 m_PositionOrigin{0.0f};
+    glm::vec3 m_PositionStep{0.0f};
+    glm::vec2 m_TextureOrigin{0.0f};
+    glm::vec2 m_TextureStep{0.0f};
+
+    // Either m_Triangles or the packed ones, per MeshCompression::PackIndices.
+    std::vector<glm::uvec3> m_Triangles;
+    std::vector<PackedTriangle> m_PackedTriangles;
+    std::vector<glm::uvec3> m_WideTriangles;
+    std::vector<uint32_t> m_MaterialIndices;
+
+    // One of them is built, per MeshCompression::BoundsBits.
+    QuantizedBvh<uint8_t> m_Bvh8;
+    QuantizedBvh<uint16_t> m_Bvh16;
+};
+
+// A Mesh, or a CompressedMesh if compression isn't null. Stores what its data takes in memoryUsage.
+std::unique_ptr<Hittable> CreateMesh(MeshData data, uint32_t materialIndex, const MeshCompression* compression,
+    size_t& memoryUsage);
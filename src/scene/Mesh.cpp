@@ -0,0 +1,227 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include "utils/Profiler.h"
+
+namespace {
+    // Determinants below this mean the ray runs along the triangle's plane.
+    constexpr float ParallelEpsilon = 1e-12f;
+
+    bool isInRange(const std::vector<glm::uvec3>& indices, const size_t count) {
+        return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, indices.size()), true,
+            [&](const tbb::blocked_range<size_t>& range, bool isValid) {
+                for (size_t i = range.begin(); i < range.end() && isValid; i++) {
+                    isValid = indices[i].x < count && indices[i].y < count && indices[i].z < count;
+                }
+                return isValid;
+            }, std::logical_and<>());
+    }
+
+    glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec2& barycentrics) {
+        return (1.0f - barycentrics.x - barycentrics.y) * a + barycentrics.x * b + barycentrics.y * c;
+    }
+}
+
+Mesh::Mesh(MeshData data, const uint32_t materialIndex)
+    : m_Data(std::move(data)), m_MaterialIndex(materialIndex) {
+    DAZHBOG_PROFILE_ZONE("BuildMesh");
+    if (m_Data.Normals.empty()) {
+        m_Data.Normals = ComputeSmoothNormals(m_Data.Positions, m_Data.Triangles);
+        m_Data.NormalIndices.clear();
+    }
+
+    std::vector<Aabb> bounds(m_Data.Triangles.size());
+    tbb::parallel_for<size_t>(0, bounds.size(), [&](const size_t i) {
+        const glm::uvec3& triangle = m_Data.Triangles[i];
+        bounds[i].Grow(m_Data.Positions[triangle.x]);
+        bounds[i].Grow(m_Data.Positions[triangle.y]);
+        bounds[i].Grow(m_Data.Positions[triangle.z]);
+    });
+    for (const Aabb& triangleBounds : bounds) {
+        m_Bounds.Grow(triangleBounds);
+    }
+    m_Bvh.Build(bounds);
+}
+
+std::vector<glm::vec3> Mesh::ComputeSmoothNormals(const std::vector<glm::vec3>& positions,
+    const std::vector<glm::uvec3>& triangles) {
+    DAZHBOG_PROFILE_ZONE("ComputeSmoothNormals");
+    // Triangles around each vertex, as offsets into one array: count, prefix sum, then fill.
+    const size_t vertexCount = positions.size();
+    auto counts = std::make_unique<std::atomic<uint32_t>[]>(vertexCount + 1);
+    tbb::parallel_for<size_t>(0, triangles.size(), [&](const size_t i) {
+        for (int corner = 0; corner < 3; corner++) {
+            counts[triangles[i][corner]].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + counts[v].load(std::memory_order_relaxed);
+    }
+    std::vector<uint32_t> adjacentTriangles(offsets.back());
+    tbb::parallel_for<size_t>(0, triangles.size(), [&](const size_t i) {
+        for (int corner = 0; corner < 3; corner++) {
+            const uint32_t vertex = triangles[i][corner];
+            adjacentTriangles[offsets[vertex] + counts[vertex].fetch_sub(1, std::memory_order_relaxed) - 1] =
+                static_cast<uint32_t>(i);
+        }
+    });
+
+    std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f));
+    tbb::parallel_for<size_t>(0, vertexCount, [&](const size_t v) {
+        const auto begin = adjacentTriangles.begin() + offsets[v];
+        const auto end = adjacentTriangles.begin() + offsets[v + 1];
+        std::sort(begin, end);
+        glm::vec3 normal(0.0f);
+        for (auto it = begin; it != end; ++it) {
+            const glm::uvec3& triangle = triangles[*it];
+            // The cross product's length is twice the area, which weights the faces.
+            normal += glm::cross(positions[triangle.y] - positions[triangle.x],
+                positions[triangle.z] - positions[triangle.x]);
+        }
+        const float length = glm::length(normal);
+        normals[v] = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    });
+    return normals;
+}
+
+std::string Mesh::Validate(const MeshData& data) {
+    const size_t triangleCount = data.Triangles.size();
+    if (!isInRange(data.Triangles, data.Positions.size())) {
+        return "vertex index out of range";
+    }
+    if (data.NormalIndices.empty() ? !data.Normals.empty() && data.Normals.size() != data.Positions.size()
+        : data.NormalIndices.size() != triangleCount || !isInRange(data.NormalIndices, data.Normals.size())) {
+        return "normal index out of range";
+    }
+    if (data.TextureIndices.empty()
+        ? !data.TextureCoordinates.empty() && data.TextureCoordinates.size() != data.Positions.size()
+        : data.TextureIndices.size() != triangleCount || !isInRange(data.TextureIndices, data.TextureCoordinates.size())) {
+        return "texture coordinate index out of range";
+    }
+    if (!data.MaterialIndices.empty() && data.MaterialIndices.size() != triangleCount) {
+        return "material count doesn't match the triangle count";
+    }
+    return {};
+}
+
+HitPayload Mesh::Hit(const Ray& ray, const Interval tBoundaries) const {
+    float tMax = tBoundaries.GetMax();
+    uint32_t hitTriangle = 0;
+    glm::vec2 barycentrics(0.0f);
+    bool didHit = false;
+    uint64_t boxTests = 0;
+    m_Bvh.Traverse(ray, tMax, [&](const uint32_t triangle, float& maxDistance) {
+        const glm::uvec3& indices = m_Data.Triangles[triangle];
+        if (IntersectTriangle(m_Data.Positions[indices.x], m_Data.Positions[indices.y], m_Data.Positions[indices.z],
+                ray, tBoundaries.GetMin(), maxDistance, barycentrics)) {
+            hitTriangle = triangle;
+            didHit = true;
+        }
+    }, boxTests);
+    if (!didHit) {
+        return {.DidCollide = false};
+    }
+
+    const glm::uvec3& triangle = m_Data.Triangles[hitTriangle];
+    const glm::uvec3& normalIndices = m_Data.NormalIndices.empty() ? triangle : m_Data.NormalIndices[hitTriangle];
+    const glm::vec3 positions[3] = {m_Data.Positions[triangle.x], m_Data.Positions[triangle.y],
+        m_Data.Positions[triangle.z]};
+    const glm::vec3 normals[3] = {m_Data.Normals[normalIndices.x], m_Data.Normals[normalIndices.y],
+        m_Data.Normals[normalIndices.z]};
+    HitPayload hitRecord = MakePayload(ray, tMax, positions, normals, barycentrics);
+    if (!m_Data.TextureCoordinates.empty()) {
+        const glm::uvec3& textureIndices = m_Data.TextureIndices.empty() ? triangle : m_Data.TextureIndices[hitTriangle];
+        const glm::vec2 textureCoordinates[3] = {m_Data.TextureCoordinates[textureIndices.x],
+            m_Data.TextureCoordinates[textureIndices.y], m_Data.TextureCoordinates[textureIndices.z]};
+        SetTextureCoordinates(hitRecord, positions, textureCoordinates, barycentrics);
+    }
+    hitRecord.MaterialIndex = m_Data.MaterialIndices.empty() ? m_MaterialIndex : m_Data.MaterialIndices[hitTriangle];
+    return hitRecord;
+}
+
+bool Mesh::IntersectTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const Ray& ray,
+    const float tMin, float& tMax, glm::vec2& barycentrics) {
+    // Möller-Trumbore, without culling either side.
+    const glm::vec3 edge1 = b - a;
+    const glm::vec3 edge2 = c - a;
+    const glm::vec3 p = glm::cross(ray.Direction, edge2);
+    const float determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < ParallelEpsilon) return false;
+    const float inverseDeterminant = 1.0f / determinant;
+    const glm::vec3 ao = ray.Origin - a;
+    const float u = glm::dot(ao, p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f) return false;
+    const glm::vec3 q = glm::cross(ao, edge1);
+    const float v = glm::dot(ray.Direction, q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    const float t = glm::dot(edge2, q) * inverseDeterminant;
+    if (t <= tMin || t >= tMax) return false;
+    tMax = t;
+    barycentrics = {u, v};
+    return true;
+}
+
+HitPayload Mesh::MakePayload(const Ray& ray, const float distance, const glm::vec3 (&positions)[3],
+    const glm::vec3 (&normals)[3], const glm::vec2& barycentrics) {
+    HitPayload hitRecord{};
+    hitRecord.DidCollide = true;
+    hitRecord.HitDistance = distance;
+    hitRecord.WorldPosition = ray.PointAt(distance);
+    hitRecord.SetFaceNormal(ray, glm::normalize(glm::cross(positions[1] - positions[0], positions[2] - positions[0])));
+
+    glm::vec3 normal = interpolate(normals[0], normals[1], normals[2], barycentrics);
+    // Interpolated normals can lean past the face near silhouettes; keep them on the side that was hit.
+    normal = hitRecord.FrontFace ? normal : -normal;
+    if (const float length = glm::length(normal); length > 0.0f && glm::dot(normal, hitRecord.WorldNormal) > 0.0f) {
+        hitRecord.WorldNormal = normal / length;
+    }
+    return hitRecord;
+}
+
+void Mesh::SetTextureCoordinates(HitPayload& hitRecord, const glm::vec3 (&positions)[3],
+    const glm::vec2 (&textureCoordinates)[3], const glm::vec2& barycentrics) {
+    hitRecord.TextureCoordinates = (1.0f - barycentrics.x - barycentrics.y) * textureCoordinates[0]
+        + barycentrics.x * textureCoordinates[1] + barycentrics.y * textureCoordinates[2];
+    // The square root of the ratio of the triangle's areas, both doubled.
+    const glm::vec2 du = textureCoordinates[1] - textureCoordinates[0];
+    const glm::vec2 dv = textureCoordinates[2] - textureCoordinates[0];
+    const float textureArea = std::abs(du.x * dv.y - du.y * dv.x);
+    const float worldArea = glm::length(glm::cross(positions[1] - positions[0], positions[2] - positions[0]));
+    hitRecord.TextureDensity = worldArea > 0.0f ? std::sqrt(textureArea / worldArea) : 0.0f;
+}
+
+Aabb Mesh::GetBounds() const {
+    return m_Bounds;
+}
+
+size_t Mesh::GetMemoryUsage() const {
+    const auto bytes = []<typename T>(const std::vector<T>& values) { return values.size() * sizeof(T); };
+    return bytes(m_Data.Positions) + bytes(m_Data.Normals) + bytes(m_Data.TextureCoordinates)
+        + bytes(m_Data.Triangles) + bytes(m_Data.NormalIndices) + bytes(m_Data.TextureIndices)
+        + bytes(m_Data.MaterialIndices) + m_Bvh.GetNodes().size_bytes() + m_Bvh.GetPrimitiveIndices().size_bytes();
+}
+
+void Mesh::Hash(Utils::Fnv1a& hash) const {
+    const auto addArray = [&hash]<typename T>(const std::vector<T>& values) {
+        hash.Add(values.size());
+        hash.AddBytes(values.data(), values.size() * sizeof(T));
+    };
+    hash.Add('M');
+    addArray(m_Data.Positions);
+    addArray(m_Data.Normals);
+    addArray(m_Data.TextureCoordinates);
+    addArray(m_Data.Triangles);
+    addArray(m_Data.NormalIndices);
+    addArray(m_Data.TextureIndices);
+    addArray(m_Data.MaterialIndices);
+    hash.Add(m_MaterialIndex);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bvh.h"
+#include "math/Hittable.h"
+
+// Indexed triangles as an importer produces them. Vertices are shared between triangles, so a mesh
+// costs 12 bytes per triangle plus its vertices, instead of a Triangle's 40.
+struct MeshData
+{
+    std::vector<glm::vec3> Positions;
+    // Shading normals; empty to have Mesh compute smooth ones from the faces.
+    std::vector<glm::vec3> Normals;
+    std::vector<glm::vec2> TextureCoordinates;
+    // Three position indices per triangle.
+    std::vector<glm::uvec3> Triangles;
+    // Per triangle indices into Normals and TextureCoordinates, for formats like OBJ that index them
+    // separately. Empty when the position indices are used for them as well.
+    std::vector<glm::uvec3> NormalIndices;
+    std::vector<glm::uvec3> TextureIndices;
+    // Scene material per triangle; empty when every triangle uses the mesh's material.
+    std::vector<uint32_t> MaterialIndices;
+};
+
+// Triangle mesh with its own BVH, so the scene's tree sees the whole mesh as one primitive. Unlike
+// Triangle, both sides of a face are hit: closed meshes are often glass. The normal at a hit is
+// interpolated from the vertex normals.
+class Mesh final : public Hittable {
+public:
+    // Fills in smooth normals if data has none and builds the BVH. Data must pass Validate().
+    explicit Mesh(MeshData data, uint32_t materialIndex);
+
+    HitPayload Hit(const Ray& ray, Interval tBoundaries) const override;
+
+    [[nodiscard]] Aabb GetBounds() const override;
+
+    void Hash(Utils::Fnv1a& hash) const override;
+
+    [[nodiscard]] const MeshData& GetData() const { return m_Data; }
+
+    [[nodiscard]] size_t GetTriangleCount() const { return m_Data.Triangles.size(); }
+
+    // Bytes of vertex, index and BVH data.
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+    // Area weighted vertex normals. Each vertex sums its faces in triangle order, so the result doesn't
+    // depend on the thread count.
+    static std::vector<glm::vec3> ComputeSmoothNormals(const std::vector<glm::vec3>& positions,
+        const std::vector<glm::uvec3>& triangles);
+
+    // Checks every index of data against the array it refers to; returns a description of the first
+    // problem, or an empty string.
+    static std::string Validate(const MeshData& data);
+
+    // Two-sided ray-triangle intersection; on a hit between tMin and tMax, lowers tMax to it and stores
+    // the barycentrics of b and c. Shared with CompressedMesh.
+    static bool IntersectTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const Ray& ray,
+        float tMin, float& tMax, glm::vec2& barycentrics);
+
+    // The payload for a hit at the given distance and barycentrics, shaded with the interpolated normal.
+    // positions and normals are the triangle's corners; the caller fills in texture coordinates and the
+    // material.
+    static HitPayload MakePayload(const Ray& ray, float distance, const glm::vec3 (&positions)[3],
+        const glm::vec3 (&normals)[3], const glm::vec2& barycentrics);
+
+    // Fills in the payload's texture coordinates, interpolated like the normal, and their density over
+    // the triangle.
+    static void SetTextureCoordinates(HitPayload& hitRecord, const glm::vec3 (&positions)[3],
+        const glm::vec2 (&textureCoordinates)[3], const glm::vec2& barycentrics);
+
+private:
+
+    MeshData m_Data;
+    uint32_t m_MaterialIndex;
+    Aabb m_Bounds;
+    Bvh m_Bvh;
+};
@@ -0,0 +1,803 @@
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include "utils/MappedFile.h"
+#include "utils/Profiler.h"
+
+namespace MeshImporter
+{
+    namespace
+    {
+        // Chunks end at the first line break after this many bytes.
+        constexpr size_t ChunkSize = 1u << 20;
+        // Vertices or faces decoded per task.
+        constexpr size_t RecordGrainSize = 1u << 14;
+
+        using Clock = std::chrono::steady_clock;
+
+        double millisecondsSince(const Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        // Whether every triangle's indices equal its position indices, so they don't need their own array.
+        bool matchesPositions(const std::vector<glm::uvec3>& indices, const std::vector<glm::uvec3>& triangles)
+        {
+            return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, triangles.size()), true,
+                [&](const tbb::blocked_range<size_t>& range, bool isSame) {
+                    return isSame && std::equal(triangles.begin() + static_cast<std::ptrdiff_t>(range.begin()),
+                        triangles.begin() + static_cast<std::ptrdiff_t>(range.end()),
+                        indices.begin() + static_cast<std::ptrdiff_t>(range.begin()));
+                }, std::logical_and<>());
+        }
+
+        // --- OBJ ---
+
+        struct ObjChunk
+        {
+            size_t Begin = 0;
+            size_t End = 0;
+
+            // First pass.
+            size_t PositionCount = 0;
+            size_t TextureCount = 0;
+            size_t NormalCount = 0;
+            std::optional<std::string_view> LastMaterial;
+
+            // Second pass. Materials holds a chunk-local id per triangle; id 0 is the material in effect
+            // where the chunk starts.
+            std::vector<glm::uvec3> Triangles;
+            std::vector<glm::uvec3> NormalIndices;
+            std::vector<glm::uvec3> TextureIndices;
+            std::vector<uint32_t> Materials;
+            std::vector<std::string_view> MaterialNames;
+            bool HasFaceWithoutNormals = false;
+            bool HasFaceWithoutTextures = false;
+
+            std::string Error;
+            size_t ErrorOffset = 0;
+
+            void Fail(const size_t offset, std::string message) {
+                if (Error.empty()) {
+                    Error = std::move(message);
+                    ErrorOffset = offset;
+                }
+            }
+        };
+
+        // Where the chunk's vertices of each kind start in the mesh arrays, and how many the file has.
+        struct ObjCounts
+        {
+            size_t Positions = 0;
+            size_t Textures = 0;
+            size_t Normals = 0;
+        };
+
+        class ObjLine {
+        public:
+            ObjLine(const char* begin, const char* end) : m_Position(begin), m_End(end) {}
+
+            std::string_view Word() {
+                skipSpace();
+                const char* start = m_Position;
+                while (m_Position < m_End && !isSpace(*m_Position)) {
+                    m_Position++;
+                }
+                return {start, static_cast<size_t>(m_Position - start)};
+            }
+
+            bool Float(float& value) {
+                skipSpace();
+                if (m_Position < m_End && *m_Position == '+') m_Position++;
+                const auto [end, error] = std::from_chars(m_Position, m_End, value);
+                if (error != std::errc()) return false;
+                m_Position = end;
+                return true;
+            }
+
+            // One face corner, v, v/vt, v//vn or v/vt/vn. Indices are returned as written, 0 when absent.
+            bool Corner(int64_t& position, int64_t& texture, int64_t& normal) {
+                texture = normal = 0;
+                if (!integer(position)) return false;
+                if (m_Position < m_End && *m_Position == '/') {
+                    m_Position++;
+                    if (m_Position < m_End && *m_Position != '/' && !integer(texture)) return false;
+                    if (m_Position < m_End && *m_Position == '/') {
+                        m_Position++;
+                        if (!integer(normal)) return false;
+                    }
+                }
+                return m_Position == m_End || isSpace(*m_Position);
+            }
+
+            bool IsAtEnd() {
+                skipSpace();
+                return m_Position == m_End;
+            }
+
+        private:
+            bool integer(int64_t& value) {
+                const auto [end, error] = std::from_chars(m_Position, m_End, value);
+                if (error != std::errc() || value == 0) return false;
+                m_Position = end;
+                return true;
+            }
+
+            void skipSpace() {
+                while (m_Position < m_End && isSpace(*m_Position)) {
+                    m_Position++;
+                }
+            }
+
+            const char* m_Position;
+            const char* m_End;
+        };
+
+        // Calls handle(line, lineOffset) for every line of the chunk without its comment, until the
+        // chunk fails.
+        template<typename Handler>
+        void forEachLine(const std::string_view text, ObjChunk& chunk, Handler&& handle)
+        {
+            const char* data = text.data();
+            size_t lineBegin = chunk.Begin;
+            while (lineBegin < chunk.End && chunk.Error.empty()) {
+                const char* lineEnd = static_cast<const char*>(std::memchr(data + lineBegin, '\n', chunk.End - lineBegin));
+                if (!lineEnd) lineEnd = data + chunk.End;
+                const char* comment = static_cast<const char*>(std::memchr(data + lineBegin, '#',
+                    lineEnd - (data + lineBegin)));
+                ObjLine line(data + lineBegin, comment ? comment : lineEnd);
+                handle(line, lineBegin);
+                lineBegin = lineEnd - data + 1;
+            }
+        }
+
+        void countObjChunk(const std::string_view text, ObjChunk& chunk)
+        {
+            forEachLine(text, chunk, [&](ObjLine& line, size_t) {
+                const std::string_view keyword = line.Word();
+                if (keyword == "v") {
+                    chunk.PositionCount++;
+                } else if (keyword == "vt") {
+                    chunk.TextureCount++;
+                } else if (keyword == "vn") {
+                    chunk.NormalCount++;
+                } else if (keyword == "usemtl") {
+                    chunk.LastMaterial = line.Word();
+                }
+            });
+        }
+
+        // Turns a 1-based or negative (relative to the last one read) OBJ index into an array index.
+        bool resolveIndex(const int64_t index, const size_t readCount, const size_t totalCount, uint32_t& result)
+        {
+            const int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(readCount) + index;
+            if (resolved < 0 || resolved >= static_cast<int64_t>(totalCount)) return false;
+            result = static_cast<uint32_t>(resolved);
+            return true;
+        }
+
+        void parseObjChunk(const std::string_view text, ObjChunk& chunk, const ObjCounts& start, const ObjCounts& total,
+            MeshData& data)
+        {
+            DAZHBOG_PROFILE_ZONE("ParseObjChunk");
+            ObjCounts read = start;
+            uint32_t material = 0;
+            forEachLine(text, chunk, [&](ObjLine& line, const size_t offset) {
+                const std::string_view keyword = line.Word();
+                bool isValid = true;
+                if (keyword == "v") {
+                    glm::vec3& position = data.Positions[read.Positions++];
+                    // Some exporters append a w or a vertex color; only the position is used.
+                    isValid = line.Float(position.x) && line.Float(position.y) && line.Float(position.z);
+                } else if (keyword == "vt") {
+                    glm::vec2& coordinates = data.TextureCoordinates[read.Textures++];
+                    isValid = line.Float(coordinates.x);
+                    coordinates.y = 0.0f;
+                    if (isValid && !line.IsAtEnd()) isValid = line.Float(coordinates.y);
+                } else if (keyword == "vn") {
+                    glm::vec3& normal = data.Normals[read.Normals++];
+                    isValid = line.Float(normal.x) && line.Float(normal.y) && line.Float(normal.z) && line.IsAtEnd();
+                } else if (keyword == "f") {
+                    // Fan around the first corner: (0, 1, 2), (0, 2, 3), ... Each corner holds its position,
+                    // texture coordinate and normal index.
+                    uint32_t first[3]{}, previous[3]{};
+                    bool hasTextures = true, hasNormals = true;
+                    int cornerCount = 0;
+                    while (!line.IsAtEnd()) {
+                        int64_t position, texture, normal;
+                        uint32_t corner[3] = {0, 0, 0};
+                        if (!line.Corner(position, texture, normal)
+                            || !resolveIndex(position, read.Positions, total.Positions, corner[0])) {
+                            chunk.Fail(offset, "vertex index out of range or malformed");
+                            return;
+                        }
+                        hasTextures = hasTextures && texture != 0;
+                        hasNormals = hasNormals && normal != 0;
+                        if ((texture != 0 && !resolveIndex(texture, read.Textures, total.Textures, corner[1]))
+                            || (normal != 0 && !resolveIndex(normal, read.Normals, total.Normals, corner[2]))) {
+                            chunk.Fail(offset, "texture coordinate or normal index out of range");
+                            return;
+                        }
+                        if (cornerCount >= 2) {
+                            chunk.Triangles.emplace_back(first[0], previous[0], corner[0]);
+                            chunk.TextureIndices.emplace_back(first[1], previous[1], corner[1]);
+                            chunk.NormalIndices.emplace_back(first[2], previous[2], corner[2]);
+                            chunk.Materials.push_back(material);
+                        }
+                        if (cornerCount++ == 0) std::ranges::copy(corner, first);
+                        std::ranges::copy(corner, previous);
+                    }
+                    if (cornerCount < 3) {
+                        chunk.Fail(offset, "a face needs at least three corners");
+                        return;
+                    }
+                    chunk.HasFaceWithoutTextures = chunk.HasFaceWithoutTextures || !hasTextures;
+                    chunk.HasFaceWithoutNormals = chunk.HasFaceWithoutNormals || !hasNormals;
+                } else if (keyword == "usemtl") {
+                    const std::string_view name = line.Word();
+                    const auto it = std::ranges::find(chunk.MaterialNames, name);
+                    material = static_cast<uint32_t>(it - chunk.MaterialNames.begin());
+                    if (it == chunk.MaterialNames.end()) {
+                        chunk.MaterialNames.push_back(name);
+                    }
+                }
+                if (!isValid) {
+                    chunk.Fail(offset, "malformed statement");
+                }
+            });
+        }
+
+        std::string describeObjError(const std::string& fileName, const std::string_view text, const size_t offset,
+            const std::string& message)
+        {
+            const auto line = 1 + std::count(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(offset), '\n');
+            return fileName + ":" + std::to_string(line) + ": " + message;
+        }
+
+        bool loadObj(const std::string_view text, const std::string& fileName, MeshData& data, std::string& error,
+            const MaterialResolver& resolveMaterial)
+        {
+            std::vector<ObjChunk> chunks;
+            for (size_t begin = 0; begin < text.size();) {
+                size_t end = std::min(begin + ChunkSize, text.size());
+                const void* lineBreak = std::memchr(text.data() + end - 1, '\n', text.size() - end + 1);
+                end = lineBreak ? static_cast<const char*>(lineBreak) - text.data() + 1 : text.size();
+                chunks.emplace_back().Begin = begin;
+                chunks.back().End = end;
+                begin = end;
+            }
+            tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+                countObjChunk(text, chunks[i]);
+            });
+
+            std::vector<ObjCounts> starts(chunks.size() + 1);
+            bool hasMaterials = false;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                starts[i + 1] = {
+                    starts[i].Positions + chunks[i].PositionCount,
+                    starts[i].Textures + chunks[i].TextureCount,
+                    starts[i].Normals + chunks[i].NormalCount,
+                };
+                chunks[i].MaterialNames.push_back(i > 0 && chunks[i - 1].LastMaterial
+                    ? *chunks[i - 1].LastMaterial : std::string_view());
+                if (chunks[i].LastMaterial) {
+                    hasMaterials = true;
+                } else if (i > 0) {
+                    chunks[i].LastMaterial = chunks[i - 1].LastMaterial;
+                }
+            }
+            const ObjCounts& total = starts.back();
+            data.Positions.resize(total.Positions);
+            data.TextureCoordinates.resize(total.Textures);
+            data.Normals.resize(total.Normals);
+            tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+                parseObjChunk(text, chunks[i], starts[i], total, data);
+            });
+            for (const ObjChunk& chunk : chunks) {
+                if (!chunk.Error.empty()) {
+                    error = describeObjError(fileName, text, chunk.ErrorOffset, chunk.Error);
+                    return false;
+                }
+            }
+
+            // Scene material of every chunk-local id; names are resolved once each, in file order.
+            const bool useMaterials = hasMaterials && resolveMaterial;
+            std::vector<std::vector<uint32_t>> materialIndices(chunks.size());
+            if (useMaterials) {
+                std::unordered_map<std::string_view, uint32_t> resolved;
+                for (size_t i = 0; i < chunks.size(); i++) {
+                    for (const std::string_view name : chunks[i].MaterialNames) {
+                        auto it = resolved.find(name);
+                        if (it == resolved.end()) {
+                            it = resolved.emplace(name, resolveMaterial(name)).first;
+                        }
+                        materialIndices[i].push_back(it->second);
+                    }
+                }
+            }
+
+            std::vector<size_t> triangleOffsets(chunks.size() + 1, 0);
+            bool hasNormals = !data.Normals.empty();
+            bool hasTextures = !data.TextureCoordinates.empty();
+            for (size_t i = 0; i < chunks.size(); i++) {
+                triangleOffsets[i + 1] = triangleOffsets[i] + chunks[i].Triangles.size();
+                hasNormals = hasNormals && !chunks[i].HasFaceWithoutNormals;
+                hasTextures = hasTextures && !chunks[i].HasFaceWithoutTextures;
+            }
+            data.Triangles.resize(triangleOffsets.back());
+            data.NormalIndices.resize(hasNormals ? data.Triangles.size() : 0);
+            data.TextureIndices.resize(hasTextures ? data.Triangles.size() : 0);
+            data.MaterialIndices.resize(useMaterials ? data.Triangles.size() : 0);
+            tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+                ObjChunk& chunk = chunks[i];
+                const auto offset = static_cast<std::ptrdiff_t>(triangleOffsets[i]);
+                std::ranges::copy(chunk.Triangles, data.Triangles.begin() + offset);
+                if (hasNormals) std::ranges::copy(chunk.NormalIndices, data.NormalIndices.begin() + offset);
+                if (hasTextures) std::ranges::copy(chunk.TextureIndices, data.TextureIndices.begin() + offset);
+                if (useMaterials) {
+                    std::ranges::transform(chunk.Materials, data.MaterialIndices.begin() + offset,
+                        [&](const uint32_t id) { return materialIndices[i][id]; });
+                }
+                chunk = {};
+            });
+
+            // A normal or coordinate missing at any corner leaves them to Mesh, rather than mixing both.
+            if (!hasNormals) {
+                data.Normals.clear();
+            } else if (data.Normals.size() == data.Positions.size() && matchesPositions(data.NormalIndices, data.Triangles)) {
+                data.NormalIndices.clear();
+            }
+            if (!hasTextures) {
+                data.TextureCoordinates.clear();
+            } else if (data.TextureCoordinates.size() == data.Positions.size()
+                && matchesPositions(data.TextureIndices, data.Triangles)) {
+                data.TextureIndices.clear();
+            }
+            return true;
+        }
+
+        // --- PLY ---
+
+        enum class ScalarType : uint8_t { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+        size_t getSize(const ScalarType type)
+        {
+            switch (type) {
+                case ScalarType::Int8: case ScalarType::UInt8: return 1;
+                case ScalarType::Int16: case ScalarType::UInt16: return 2;
+                case ScalarType::Int32: case ScalarType::UInt32: case ScalarType::Float32: return 4;
+                case ScalarType::Float64: return 8;
+            }
+            return 0;
+        }
+
+        bool parseScalarType(const std::string& name, ScalarType& type)
+        {
+            static const std::unordered_map<std::string, ScalarType> Types = {
+                {"char", ScalarType::Int8}, {"int8", ScalarType::Int8},
+                {"uchar", ScalarType::UInt8}, {"uint8", ScalarType::UInt8},
+                {"short", ScalarType::Int16}, {"int16", ScalarType::Int16},
+                {"ushort", ScalarType::UInt16}, {"uint16", ScalarType::UInt16},
+                {"int", ScalarType::Int32}, {"int32", ScalarType::Int32},
+                {"uint", ScalarType::UInt32}, {"uint32", ScalarType::UInt32},
+                {"float", ScalarType::Float32}, {"float32", ScalarType::Float32},
+                {"double", ScalarType::Float64}, {"float64", ScalarType::Float64},
+            };
+            const auto it = Types.find(name);
+            if (it == Types.end()) return false;
+            type = it->second;
+            return true;
+        }
+
+        template<typename T, typename Stored>
+        T convert(const uint8_t* bytes)
+        {
+            Stored value;
+            std::memcpy(&value, bytes, sizeof(Stored));
+            return static_cast<T>(value);
+        }
+
+        // Reads one value of the given type, swapping it to the machine's byte order first if needed.
+        template<typename T>
+        T readScalar(const uint8_t* source, const ScalarType type, const bool isSwapped)
+        {
+            uint8_t bytes[8];
+            const size_t size = getSize(type);
+            std::memcpy(bytes, source, size);
+            if (isSwapped) std::reverse(bytes, bytes + size);
+            switch (type) {
+                case ScalarType::Int8: return convert<T, int8_t>(bytes);
+                case ScalarType::UInt8: return convert<T, uint8_t>(bytes);
+                case ScalarType::Int16: return convert<T, int16_t>(bytes);
+                case ScalarType::UInt16: return convert<T, uint16_t>(bytes);
+                case ScalarType::Int32: return convert<T, int32_t>(bytes);
+                case ScalarType::UInt32: return convert<T, uint32_t>(bytes);
+                case ScalarType::Float32: return convert<T, float>(bytes);
+                case ScalarType::Float64: return convert<T, double>(bytes);
+            }
+            return T{};
+        }
+
+        struct PlyProperty
+        {
+            std::string Name;
+            ScalarType Type = ScalarType::Float32;
+            bool IsList = false;
+            ScalarType CountType = ScalarType::UInt8;
+        };
+
+        struct PlyElement
+        {
+            std::string Name;
+            uint64_t Count = 0;
+            std::vector<PlyProperty> Properties;
+
+            // Byte offset of the named scalar property in a record without lists before it, if any.
+            [[nodiscard]] std::optional<size_t> FindOffset(const std::string_view name) const {
+                size_t offset = 0;
+                for (const PlyProperty& property : Properties) {
+                    if (property.IsList) return std::nullopt;
+                    if (property.Name == name) return offset;
+                    offset += getSize(property.Type);
+                }
+                return std::nullopt;
+            }
+
+            [[nodiscard]] const PlyProperty* Find(const std::string_view name) const {
+                const auto it = std::ranges::find(Properties, name, &PlyProperty::Name);
+                return it == Properties.end() ? nullptr : &*it;
+            }
+        };
+
+        struct PlyHeader
+        {
+            bool IsSwapped = false;
+            std::vector<PlyElement> Elements;
+            size_t Size = 0;
+        };
+
+        bool parsePlyHeader(const std::string_view text, PlyHeader& header, std::string& error)
+        {
+            const size_t end = text.find("end_header");
+            const size_t lineEnd = end == std::string_view::npos ? end : text.find('\n', end);
+            if (!text.starts_with("ply") || lineEnd == std::string_view::npos) {
+                error = "not a PLY file";
+                return false;
+            }
+            header.Size = lineEnd + 1;
+            std::istringstream lines{std::string(text.substr(0, end))};
+            std::string line;
+            bool hasFormat = false;
+            while (std::getline(lines, line)) {
+                std::istringstream words(line);
+                std::string keyword;
+                words >> keyword;
+                if (keyword == "format") {
+                    std::string format;
+                    words >> format;
+                    if (format == "ascii") {
+                        error = "ASCII PLY isn't supported, convert the file to binary";
+                        return false;
+                    }
+                    if (format != "binary_little_endian" && format != "binary_big_endian") {
+                        error = "unknown PLY format '" + format + "'";
+                        return false;
+                    }
+                    header.IsSwapped = (format == "binary_big_endian") != (std::endian::native == std::endian::big);
+                    hasFormat = true;
+                } else if (keyword == "element") {
+                    PlyElement& element = header.Elements.emplace_back();
+                    if (!(words >> element.Name >> element.Count)) {
+                        error = "malformed PLY element '" + line + "'";
+                        return false;
+                    }
+                } else if (keyword == "property") {
+                    PlyProperty property;
+                    std::string type;
+                    words >> type;
+                    bool isValid = !header.Elements.empty();
+                    if (type == "list") {
+                        std::string countType, indexType;
+                        property.IsList = true;
+                        isValid = isValid && words >> countType >> indexType && parseScalarType(countType, property.CountType)
+                            && parseScalarType(indexType, property.Type)
+                            && property.CountType != ScalarType::Float32 && property.CountType != ScalarType::Float64;
+                    } else {
+                        isValid = isValid && parseScalarType(type, property.Type);
+                    }
+                    if (!isValid || !(words >> property.Name)) {
+                        error = "malformed PLY property '" + line + "'";
+                        return false;
+                    }
+                    header.Elements.back().Properties.push_back(std::move(property));
+                }
+            }
+            if (!hasFormat) {
+                error = "PLY header has no format";
+                return false;
+            }
+            return true;
+        }
+
+        // Size of the record at data, lists included; false if it runs past end.
+        bool measureRecord(const uint8_t* data, const uint8_t* end, const PlyElement& element, const bool isSwapped,
+            size_t& size)
+        {
+            size = 0;
+            for (const PlyProperty& property : element.Properties) {
+                if (!property.IsList) {
+                    size += getSize(property.Type);
+                    continue;
+                }
+                const size_t countSize = getSize(property.CountType);
+                if (end - data < static_cast<std::ptrdiff_t>(size + countSize)) return false;
+                const auto count = readScalar<int64_t>(data + size, property.CountType, isSwapped);
+                if (count < 0) return false;
+                size += countSize + static_cast<size_t>(count) * getSize(property.Type);
+            }
+            return end - data >= static_cast<std::ptrdiff_t>(size);
+        }
+
+        bool readPlyVertices(const uint8_t* data, const size_t size, const PlyElement& element, const bool isSwapped,
+            MeshData& mesh, size_t& consumed, std::string& error)
+        {
+            size_t stride = 0;
+            for (const PlyProperty& property : element.Properties) {
+                if (property.IsList) {
+                    error = "PLY vertices with list properties aren't supported";
+                    return false;
+                }
+                stride += getSize(property.Type);
+            }
+            if (element.Count > std::numeric_limits<uint32_t>::max() || element.Count * stride > size) {
+                error = "PLY vertex data is truncated";
+                return false;
+            }
+            consumed = element.Count * stride;
+            const auto offsetOf = [&](const std::string_view name) { return element.FindOffset(name); };
+            const auto typeOf = [&](const std::string_view name) { return element.Find(name)->Type; };
+            const auto x = offsetOf("x"), y = offsetOf("y"), z = offsetOf("z");
+            if (!x || !y || !z) {
+                error = "PLY vertices have no x, y and z";
+                return false;
+            }
+            const auto nx = offsetOf("nx"), ny = offsetOf("ny"), nz = offsetOf("nz");
+            const bool hasNormals = nx && ny && nz;
+            constexpr std::pair<std::string_view, std::string_view> TextureNames[] = {
+                {"u", "v"}, {"s", "t"}, {"texture_u", "texture_v"},
+            };
+            std::optional<size_t> u, v;
+            ScalarType textureTypes[2]{};
+            for (const auto& [uName, vName] : TextureNames) {
+                u = offsetOf(uName);
+                v = offsetOf(vName);
+                if (u && v) {
+                    textureTypes[0] = typeOf(uName);
+                    textureTypes[1] = typeOf(vName);
+                    break;
+                }
+            }
+            const bool hasTextures = u && v;
+
+            const ScalarType positionTypes[3] = {typeOf("x"), typeOf("y"), typeOf("z")};
+            ScalarType normalTypes[3]{};
+            if (hasNormals) {
+                normalTypes[0] = typeOf("nx");
+                normalTypes[1] = typeOf("ny");
+                normalTypes[2] = typeOf("nz");
+            }
+
+            mesh.Positions.resize(element.Count);
+            mesh.Normals.resize(hasNormals ? element.Count : 0);
+            mesh.TextureCoordinates.resize(hasTextures ? element.Count : 0);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, element.Count, RecordGrainSize),
+                [&](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); i++) {
+                        const uint8_t* record = data + i * stride;
+                        mesh.Positions[i] = {
+                            readScalar<float>(record + *x, positionTypes[0], isSwapped),
+                            readScalar<float>(record + *y, positionTypes[1], isSwapped),
+                            readScalar<float>(record + *z, positionTypes[2], isSwapped),
+                        };
+                        if (hasNormals) {
+                            mesh.Normals[i] = {
+                                readScalar<float>(record + *nx, normalTypes[0], isSwapped),
+                                readScalar<float>(record + *ny, normalTypes[1], isSwapped),
+                                readScalar<float>(record + *nz, normalTypes[2], isSwapped),
+                            };
+                        }
+                        if (hasTextures) {
+                            mesh.TextureCoordinates[i] = {
+                                readScalar<float>(record + *u, textureTypes[0], isSwapped),
+                                readScalar<float>(record + *v, textureTypes[1], isSwapped),
+                            };
+                        }
+                    }
+                });
+            return true;
+        }
+
+        bool readPlyFaces(const uint8_t* data, const size_t size, const PlyElement& element, const bool isSwapped,
+            MeshData& mesh, size_t& consumed, std::string& error)
+        {
+            const auto list = std::ranges::find_if(element.Properties, [](const PlyProperty& property) {
+                return property.IsList && (property.Name == "vertex_indices" || property.Name == "vertex_index");
+            });
+            if (list == element.Properties.end()) {
+                error = "PLY faces have no vertex_indices";
+                return false;
+            }
+            // Scalar properties before and after the index list, such as per-face flags or colors.
+            size_t before = 0, after = 0;
+            for (auto it = element.Properties.begin(); it != element.Properties.end(); ++it) {
+                if (it != list && it->IsList) {
+                    error = "PLY faces with more than one list aren't supported";
+                    return false;
+                }
+                (it < list ? before : after) += it == list ? 0 : getSize(it->Type);
+            }
+            const size_t countSize = getSize(list->CountType);
+            const size_t indexSize = getSize(list->Type);
+            const ScalarType countType = list->CountType, indexType = list->Type;
+            const auto readIndex = [&](const uint8_t* record, const size_t k) {
+                return static_cast<uint32_t>(readScalar<int64_t>(record + before + countSize + k * indexSize, indexType,
+                    isSwapped));
+            };
+
+            // Triangle meshes have a fixed stride: check every count, then decode without a scan.
+            const size_t triangleStride = before + countSize + 3 * indexSize + after;
+            const bool isTriangleMesh = element.Count * triangleStride <= size
+                && tbb::parallel_reduce(tbb::blocked_range<size_t>(0, element.Count, RecordGrainSize), true,
+                    [&](const tbb::blocked_range<size_t>& range, bool isTriangles) {
+                        for (size_t i = range.begin(); i < range.end() && isTriangles; i++) {
+                            isTriangles = readScalar<int64_t>(data + i * triangleStride + before, countType, isSwapped) == 3;
+                        }
+                        return isTriangles;
+                    }, std::logical_and<>());
+            if (isTriangleMesh) {
+                consumed = element.Count * triangleStride;
+                mesh.Triangles.resize(element.Count);
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, element.Count, RecordGrainSize),
+                    [&](const tbb::blocked_range<size_t>& range) {
+                        for (size_t i = range.begin(); i < range.end(); i++) {
+                            const uint8_t* record = data + i * triangleStride;
+                            mesh.Triangles[i] = {readIndex(record, 0), readIndex(record, 1), readIndex(record, 2)};
+                        }
+                    });
+                return true;
+            }
+
+            // Polygons: find every record and where its fan goes, then decode the fans in parallel.
+            std::vector<size_t> recordOffsets(element.Count);
+            std::vector<size_t> triangleOffsets(element.Count + 1, 0);
+            size_t offset = 0;
+            for (size_t i = 0; i < element.Count; i++) {
+                size_t recordSize = 0;
+                if (!measureRecord(data + offset, data + size, element, isSwapped, recordSize)) {
+                    error = "PLY face data is truncated";
+                    return false;
+                }
+                const auto count = readScalar<int64_t>(data + offset + before, countType, isSwapped);
+                recordOffsets[i] = offset;
+                triangleOffsets[i + 1] = triangleOffsets[i] + static_cast<size_t>(std::max<int64_t>(count - 2, 0));
+                offset += recordSize;
+            }
+            consumed = offset;
+            mesh.Triangles.resize(triangleOffsets.back());
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, element.Count, RecordGrainSize),
+                [&](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); i++) {
+                        const uint8_t* record = data + recordOffsets[i];
+                        const uint32_t first = readIndex(record, 0);
+                        for (size_t t = triangleOffsets[i]; t < triangleOffsets[i + 1]; t++) {
+                            const size_t k = t - triangleOffsets[i] + 1;
+                            mesh.Triangles[t] = {first, readIndex(record, k), readIndex(record, k + 1)};
+                        }
+                    }
+                });
+            return true;
+        }
+
+        bool loadPly(const std::string_view text, MeshData& data, std::string& error)
+        {
+            PlyHeader header;
+            if (!parsePlyHeader(text, header, error)) return false;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+            const uint8_t* end = bytes + text.size();
+            const uint8_t* position = bytes + header.Size;
+            bool hasVertices = false, hasFaces = false;
+            for (const PlyElement& element : header.Elements) {
+                if (hasVertices && hasFaces) break;
+                const auto remaining = static_cast<size_t>(end - position);
+                size_t consumed = 0;
+                if (element.Name == "vertex") {
+                    if (!readPlyVertices(position, remaining, element, header.IsSwapped, data, consumed, error)) {
+                        return false;
+                    }
+                    hasVertices = true;
+                    position += consumed;
+                } else if (element.Name == "face") {
+                    if (!readPlyFaces(position, remaining, element, header.IsSwapped, data, consumed, error)) {
+                        return false;
+                    }
+                    hasFaces = true;
+                    position += consumed;
+                } else {
+                    // Skipped, but its records still have to be walked when they contain lists.
+                    for (uint64_t i = 0; i < element.Count; i++) {
+                        size_t recordSize = 0;
+                        if (!measureRecord(position, end, element, header.IsSwapped, recordSize)) {
+                            error = "PLY element '" + element.Name + "' is truncated";
+                            return false;
+                        }
+                        position += recordSize;
+                    }
+                }
+            }
+            if (!hasVertices || !hasFaces) {
+                error = "PLY file needs vertex and face elements";
+                return false;
+            }
+            return true;
+        }
+    }
+
+    bool IsMeshFile(const std::string& name)
+    {
+        return name.size() > 4 && (name.ends_with(".obj") || name.ends_with(".ply"));
+    }
+
+    bool Load(const std::string& fileName, MeshData& data, std::string& error, const MaterialResolver& resolveMaterial,
+        Statistics* statistics)
+    {
+        DAZHBOG_PROFILE_ZONE("ImportMesh");
+        const auto startTime = Clock::now();
+        Utils::MappedFile file;
+        if (!file.Open(fileName)) {
+            error = "Can't read " + fileName;
+            return false;
+        }
+        const std::string_view text(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+        data = {};
+        std::string problem;
+        const bool isLoaded = fileName.ends_with(".ply")
+            ? loadPly(text, data, problem)
+            : loadObj(text, fileName, data, error, resolveMaterial);
+        if (!isLoaded) {
+            if (!problem.empty()) error = fileName + ": " + problem;
+            return false;
+        }
+        if (data.Triangles.empty()) {
+            error = fileName + ": no triangles";
+            return false;
+        }
+        if (problem = Mesh::Validate(data); !problem.empty()) {
+            error = fileName + ": " + problem;
+            return false;
+        }
+        if (statistics) {
+            statistics->FileSize = file.GetSize();
+            statistics->VertexCount = data.Positions.size();
+            statistics->TriangleCount = data.Triangles.size();
+            statistics->ParseTimeMs = millisecondsSince(startTime);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "Mesh.h"
+
+// Reads triangle meshes from Wavefront OBJ and binary PLY files into MeshData. Both readers map the file
+// and decode it on all cores straight into the final arrays, which is what makes multi-gigabyte scans
+// load in seconds:
+//
+//  - OBJ is split into chunks at line breaks. A first pass counts the vertex lines of every chunk, so the
+//    second pass knows where each chunk's vertices go and what its relative face indices refer to.
+//    Polygons are triangulated as fans; o, g, s, mtllib and other statements are ignored.
+//  - PLY reads x/y/z, nx/ny/nz and u/v (or s/t, texture_u/texture_v) of the vertex element and the index
+//    list of the face element, in either byte order. Files made only of triangles are decoded without
+//    scanning the face list first. ASCII PLY isn't supported.
+namespace MeshImporter
+{
+    struct Statistics
+    {
+        uint64_t FileSize = 0;
+        uint64_t VertexCount = 0;
+        uint64_t TriangleCount = 0;
+        // Mapping, decoding and checking the file.
+        double ParseTimeMs = 0.0;
+    };
+
+    // Scene material index for an OBJ usemtl name; the name is empty for faces before the first usemtl.
+    using MaterialResolver = std::function<uint32_t(std::string_view name)>;
+
+    // True for names ending in .obj or .ply.
+    bool IsMeshFile(const std::string& name);
+
+    // Fills data from the file. OBJ material names go through resolveMaterial into data.MaterialIndices;
+    // without a resolver, or without usemtl statements, they are left empty. On failure returns false with
+    // a message in error, naming the line at fault for OBJ.
+    bool Load(const std::string& fileName, MeshData& data, std::string& error,
+        const MaterialResolver& resolveMaterial = {}, Statistics* statistics = nullptr);
+}
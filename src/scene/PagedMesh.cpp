@@ -0,0 +1,652 @@
+#include "PagedMesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include "Mesh.h"
+#include "utils/Profiler.h"
+
+namespace {
+    constexpr std::array<char, 4> Magic = {'D', 'Z', 'M', 'P'};
+    constexpr uint32_t Version = 1;
+    // Arrays inside a page start at multiples of this.
+    constexpr uint64_t ArrayAlignment = 16;
+    // Pages built in parallel before they are written, which bounds the memory the writer needs for them.
+    constexpr size_t WriteBatchSize = 256;
+    // Pages each Prefetch() ray asks for: the hit is most likely in the first ones it reaches.
+    constexpr uint32_t PrefetchPagesPerRay = 2;
+
+    using Clock = std::chrono::steady_clock;
+    using PageEntry = PagedMesh::PageEntry;
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Header
+    {
+        std::array<char, 4> Magic{};
+        uint32_t Version = 0;
+        // Key of the mesh file the pages were made from.
+        uint64_t SourceSize = 0;
+        int64_t SourceTime = 0;
+        // Sizes of the stored types, so a build with another memory layout doesn't use the file.
+        uint32_t NodeSize = 0;
+        uint32_t PageEntrySize = 0;
+        uint64_t TriangleCount = 0;
+        uint32_t PageCount = 0;
+        // Local material ids index the names, which are stored one after another, each ending in a zero.
+        uint32_t MaterialCount = 0;
+        uint32_t HasTextureCoordinates = 0;
+        uint32_t Padding = 0;
+        uint64_t PagesOffset = 0;
+        uint64_t NamesOffset = 0;
+        uint64_t NamesSize = 0;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Header> && std::is_trivially_copyable_v<PageEntry>
+        && std::is_trivially_copyable_v<Bvh::Node>);
+
+    // Offsets of a page's arrays from its start.
+    struct PageLayout
+    {
+        uint64_t Nodes = 0;
+        uint64_t Positions = 0;
+        uint64_t Normals = 0;
+        uint64_t TextureCoordinates = 0;
+        uint64_t Triangles = 0;
+        uint64_t Materials = 0;
+        uint64_t Size = 0;
+    };
+
+    uint64_t alignUp(const uint64_t offset, const uint64_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    PageLayout getLayout(const PageEntry& page, const bool hasTextureCoordinates, const bool hasMaterials) {
+        PageLayout layout;
+        const auto place = [&layout](const uint64_t bytes) {
+            const uint64_t offset = layout.Size;
+            layout.Size = alignUp(offset + bytes, ArrayAlignment);
+            return offset;
+        };
+        layout.Nodes = place(page.NodeCount * sizeof(Bvh::Node));
+        layout.Positions = place(page.VertexCount * sizeof(glm::vec3));
+        layout.Normals = place(page.VertexCount * sizeof(glm::vec3));
+        layout.TextureCoordinates = place(hasTextureCoordinates ? page.VertexCount * sizeof(glm::vec2) : 0);
+        layout.Triangles = place(page.TriangleCount * sizeof(std::array<uint16_t, 3>));
+        layout.Materials = place(hasMaterials ? page.TriangleCount * sizeof(uint16_t) : 0);
+        return layout;
+    }
+
+    // Cuts the tree into the largest subtrees of at most MaxPageTriangles triangles, in tree order, so
+    // pages next to each other in the file are close in space too. Leaves that are bigger on their own
+    // are split.
+    std::vector<std::vector<uint32_t>> cutPages(const Bvh& bvh) {
+        const std::span<const Bvh::Node> nodes = bvh.GetNodes();
+        const std::span<const uint32_t> primitives = bvh.GetPrimitiveIndices();
+        std::vector<std::vector<uint32_t>> pages;
+        if (nodes.empty()) return pages;
+        // Triangles under every node; children come after their parent.
+        std::vector<uint64_t> counts(nodes.size());
+        for (size_t i = nodes.size(); i-- > 0;) {
+            const Bvh::Node& node = nodes[i];
+            counts[i] = node.IsLeaf() ? node.Count : counts[node.Index] + counts[node.Index + 1];
+        }
+        std::vector<uint32_t> stack = {0};
+        std::vector<uint32_t> subtree;
+        while (!stack.empty()) {
+            const uint32_t root = stack.back();
+            stack.pop_back();
+            if (counts[root] > PagedMesh::MaxPageTriangles && !nodes[root].IsLeaf()) {
+                stack.push_back(nodes[root].Index + 1);
+                stack.push_back(nodes[root].Index);
+                continue;
+            }
+            std::vector<uint32_t> triangles;
+            subtree = {root};
+            while (!subtree.empty()) {
+                const Bvh::Node& node = nodes[subtree.back()];
+                subtree.pop_back();
+                if (node.IsLeaf()) {
+                    triangles.insert(triangles.end(), primitives.begin() + node.Index,
+                        primitives.begin() + node.Index + node.Count);
+                } else {
+                    subtree.push_back(node.Index + 1);
+                    subtree.push_back(node.Index);
+                }
+            }
+            for (size_t first = 0; first < triangles.size(); first += PagedMesh::MaxPageTriangles) {
+                const size_t last = std::min<size_t>(first + PagedMesh::MaxPageTriangles, triangles.size());
+                pages.emplace_back(triangles.begin() + first, triangles.begin() + last);
+            }
+        }
+        return pages;
+    }
+
+    // The page of the given triangles: one local vertex per distinct combination of position, normal and
+    // texture coordinate indices, a BVH over the triangles and the triangles in its leaf order.
+    std::vector<uint8_t> buildPage(const MeshData& data, const std::vector<uint32_t>& triangleIds, PageEntry& entry) {
+        const auto cornerKey = [&data](const uint32_t triangle, const int k) {
+            const uint32_t position = data.Triangles[triangle][k];
+            return std::array<uint32_t, 3>{
+                position,
+                data.NormalIndices.empty() ? position : data.NormalIndices[triangle][k],
+                data.TextureIndices.empty() ? position : data.TextureIndices[triangle][k],
+            };
+        };
+        std::vector<std::array<uint32_t, 3>> vertices;
+        vertices.reserve(triangleIds.size() * 3);
+        for (const uint32_t triangle : triangleIds) {
+            for (int k = 0; k < 3; k++) {
+                vertices.push_back(cornerKey(triangle, k));
+            }
+        }
+        std::ranges::sort(vertices);
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        const auto localIndex = [&vertices](const std::array<uint32_t, 3>& key) {
+            return static_cast<uint16_t>(std::ranges::lower_bound(vertices, key) - vertices.begin());
+        };
+
+        std::vector<Aabb> bounds(triangleIds.size());
+        for (size_t i = 0; i < triangleIds.size(); i++) {
+            for (int k = 0; k < 3; k++) {
+                bounds[i].Grow(data.Positions[data.Triangles[triangleIds[i]][k]]);
+            }
+        }
+        Bvh bvh;
+        bvh.Build(bounds);
+        const std::span<const Bvh::Node> nodes = bvh.GetNodes();
+        const std::span<const uint32_t> order = bvh.GetPrimitiveIndices();
+
+        const bool hasTextureCoordinates = !data.TextureCoordinates.empty();
+        const bool hasMaterials = !data.MaterialIndices.empty();
+        entry.Bounds = nodes[0].Bounds;
+        entry.TriangleCount = static_cast<uint32_t>(triangleIds.size());
+        entry.VertexCount = static_cast<uint32_t>(vertices.size());
+        entry.NodeCount = static_cast<uint32_t>(nodes.size());
+        const PageLayout layout = getLayout(entry, hasTextureCoordinates, hasMaterials);
+        entry.Size = static_cast<uint32_t>(layout.Size);
+
+        std::vector<uint8_t> page(layout.Size);
+        std::memcpy(page.data() + layout.Nodes, nodes.data(), nodes.size_bytes());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const std::array<uint32_t, 3>& key = vertices[i];
+            std::memcpy(page.data() + layout.Positions + i * sizeof(glm::vec3), &data.Positions[key[0]], sizeof(glm::vec3));
+            std::memcpy(page.data() + layout.Normals + i * sizeof(glm::vec3), &data.Normals[key[1]], sizeof(glm::vec3));
+            if (hasTextureCoordinates) {
+                std::memcpy(page.data() + layout.TextureCoordinates + i * sizeof(glm::vec2),
+                    &data.TextureCoordinates[key[2]], sizeof(glm::vec2));
+            }
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+            const uint32_t triangle = triangleIds[order[i]];
+            const std::array<uint16_t, 3> corners = {
+                localIndex(cornerKey(triangle, 0)), localIndex(cornerKey(triangle, 1)), localIndex(cornerKey(triangle, 2)),
+            };
+            std::memcpy(page.data() + layout.Triangles + i * sizeof(corners), corners.data(), sizeof(corners));
+            if (hasMaterials) {
+                const auto material = static_cast<uint16_t>(data.MaterialIndices[triangle]);
+                std::memcpy(page.data() + layout.Materials + i * sizeof(uint16_t), &material, sizeof(uint16_t));
+            }
+        }
+        return page;
+    }
+
+    bool writeZeros(FILE* file, uint64_t count) {
+        static constexpr std::array<uint8_t, 4096> Zeros{};
+        while (count > 0) {
+            const size_t chunk = std::min<uint64_t>(count, Zeros.size());
+            if (std::fwrite(Zeros.data(), 1, chunk, file) != chunk) return false;
+            count -= chunk;
+        }
+        return true;
+    }
+
+    // Imports the mesh and writes its pages to path. OBJ material names become local ids in the order
+    // they first appear.
+    bool writePageFile(const std::string& fileName, const std::string& path, const uint64_t sourceSize,
+        const int64_t sourceTime, std::string& error, PagedMesh::LoadStatistics& statistics) {
+        MeshData data;
+        std::vector<std::string> names;
+        std::unordered_map<std::string, uint32_t> nameIds;
+        const auto collectName = [&](const std::string_view name) {
+            const auto [it, isNew] = nameIds.try_emplace(std::string(name), static_cast<uint32_t>(names.size()));
+            if (isNew) names.emplace_back(name);
+            return it->second;
+        };
+        if (!MeshImporter::Load(fileName, data, error, collectName, &statistics.Import)) return false;
+        if (names.size() > std::numeric_limits<uint16_t>::max()) {
+            error = fileName + ": too many materials to stream";
+            return false;
+        }
+
+        DAZHBOG_PROFILE_ZONE("WriteMeshPages");
+        const auto startTime = Clock::now();
+        if (data.Normals.empty()) {
+            data.Normals = Mesh::ComputeSmoothNormals(data.Positions, data.Triangles);
+            data.NormalIndices.clear();
+        }
+        std::vector<Aabb> bounds(data.Triangles.size());
+        tbb::parallel_for<size_t>(0, bounds.size(), [&](const size_t i) {
+            for (int k = 0; k < 3; k++) {
+                bounds[i].Grow(data.Positions[data.Triangles[i][k]]);
+            }
+        });
+        Bvh bvh;
+        bvh.Build(bounds);
+        bounds = {};
+        const std::vector<std::vector<uint32_t>> pageTriangles = cutPages(bvh);
+        bvh = Bvh();
+
+        const bool hasMaterials = !data.MaterialIndices.empty();
+        std::string nameBlock;
+        if (hasMaterials) {
+            for (const std::string& name : names) {
+                nameBlock.append(name).push_back('\0');
+            }
+        }
+        Header header{
+            .Magic = Magic,
+            .Version = Version,
+            .SourceSize = sourceSize,
+            .SourceTime = sourceTime,
+            .NodeSize = sizeof(Bvh::Node),
+            .PageEntrySize = sizeof(PageEntry),
+            .TriangleCount = data.Triangles.size(),
+            .PageCount = static_cast<uint32_t>(pageTriangles.size()),
+            .MaterialCount = hasMaterials ? static_cast<uint32_t>(names.size()) : 0,
+            .HasTextureCoordinates = data.TextureCoordinates.empty() ? 0u : 1u,
+        };
+        header.PagesOffset = alignUp(sizeof(Header), ArrayAlignment);
+        header.NamesOffset = header.PagesOffset + pageTriangles.size() * sizeof(PageEntry);
+        header.NamesSize = nameBlock.size();
+        const uint64_t pagesStart = alignUp(header.NamesOffset + header.NamesSize, PagedMesh::PageAlignment);
+
+        // Like SceneCache, every writer gets its own temporary file, and the rename publishes it whole.
+        const std::string temporaryName = path + "." + std::to_string(std::random_device()()) + ".tmp";
+        FILE* file = std::fopen(temporaryName.c_str(), "wb");
+        if (!file) {
+            error = "Can't write " + path;
+            return false;
+        }
+        // The header and the page table are written again once the pages are placed.
+        bool isWritten = writeZeros(file, pagesStart);
+        uint64_t position = pagesStart;
+        std::vector<PageEntry> entries(pageTriangles.size());
+        std::vector<std::vector<uint8_t>> pages(WriteBatchSize);
+        for (size_t first = 0; isWritten && first < pageTriangles.size(); first += WriteBatchSize) {
+            const size_t count = std::min(WriteBatchSize, pageTriangles.size() - first);
+            tbb::parallel_for<size_t>(0, count, [&](const size_t i) {
+                pages[i] = buildPage(data, pageTriangles[first + i], entries[first + i]);
+            });
+            for (size_t i = 0; isWritten && i < count; i++) {
+                entries[first + i].Offset = position;
+                isWritten = std::fwrite(pages[i].data(), 1, pages[i].size(), file) == pages[i].size();
+                const uint64_t next = alignUp(position + pages[i].size(), PagedMesh::PageAlignment);
+                isWritten = isWritten && writeZeros(file, next - position - pages[i].size());
+                position = next;
+                pages[i] = {};
+            }
+        }
+        isWritten = isWritten && std::fseek(file, 0, SEEK_SET) == 0
+            && std::fwrite(&header, sizeof(Header), 1, file) == 1
+            && std::fseek(file, static_cast<long>(header.PagesOffset), SEEK_SET) == 0
+            && (entries.empty() || std::fwrite(entries.data(), sizeof(PageEntry), entries.size(), file) == entries.size())
+            && (nameBlock.empty() || std::fwrite(nameBlock.data(), 1, nameBlock.size(), file) == nameBlock.size())
+            && std::fflush(file) == 0;
+        isWritten = std::fclose(file) == 0 && isWritten;
+
+        std::error_code renameError;
+        if (isWritten) {
+            std::filesystem::rename(temporaryName, path, renameError);
+        }
+        if (!isWritten || renameError) {
+            std::filesystem::remove(temporaryName, renameError);
+            error = "Can't write " + path;
+            return false;
+        }
+        statistics.IsPageFileWritten = true;
+        statistics.WriteTimeMs = millisecondsSince(startTime);
+        return true;
+    }
+}
+
+uint32_t MeshPageCache::AddPages(std::shared_ptr<const Utils::MappedFile> file,
+    const std::span<const std::array<uint64_t, 2>> ranges) {
+    std::lock_guard lock(m_Mutex);
+    const auto first = static_cast<uint32_t>(m_Pages.size());
+    for (const auto& [offset, size] : ranges) {
+        Page& page = m_Pages.emplace_back();
+        page.File = file.get();
+        page.Offset = offset;
+        page.Size = size;
+        m_MappedBytes += size;
+    }
+    m_Files.push_back(std::move(file));
+    return first;
+}
+
+void MeshPageCache::Prefetch(const uint32_t page) {
+    Page& state = m_Pages[page];
+    if (state.IsResident.load(std::memory_order_relaxed) || state.IsPrefetched.exchange(true, std::memory_order_relaxed)) {
+        return;
+    }
+    state.File->Prefetch(state.Offset, state.Size);
+    m_PrefetchedPages.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MeshPageCache::fault(Page& page) {
+    std::lock_guard lock(m_Mutex);
+    if (page.IsResident.load(std::memory_order_relaxed)) return;
+    // One read of the whole page rather than a fault for every memory page of it.
+    page.File->Prefetch(page.Offset, page.Size);
+    m_PageFaults++;
+    if (page.IsPrefetched.exchange(false, std::memory_order_relaxed)) {
+        m_PrefetchHits++;
+    }
+    m_ResidentBytes += page.Size;
+    page.LastUse.store(m_Clock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    page.IsResident.store(true, std::memory_order_release);
+    if (m_ResidentBudget > 0 && m_ResidentBytes > m_ResidentBudget) {
+        evict(page);
+    }
+    m_PeakResidentBytes = std::max(m_PeakResidentBytes, m_ResidentBytes);
+}
+
+void MeshPageCache::evict(const Page& keep) {
+    DAZHBOG_PROFILE_ZONE("EvictMeshPages");
+    const uint64_t target = m_ResidentBudget - m_ResidentBudget / 4;
+    std::vector<std::pair<uint64_t, Page*>> candidates;
+    for (Page& page : m_Pages) {
+        if (&page != &keep && page.IsResident.load(std::memory_order_relaxed)) {
+            candidates.emplace_back(page.LastUse.load(std::memory_order_relaxed), &page);
+        }
+    }
+    std::ranges::sort(candidates, {}, &std::pair<uint64_t, Page*>::first);
+    for (const auto& [lastUse, page] : candidates) {
+        if (m_ResidentBytes <= target) break;
+        page->IsResident.store(false, std::memory_order_relaxed);
+        page->IsPrefetched.store(false, std::memory_order_relaxed);
+        page->File->Release(page->Offset, page->Size);
+        m_ResidentBytes -= page->Size;
+        m_Evictions++;
+    }
+}
+
+MeshPageCache::Statistics MeshPageCache::GetStatistics() const {
+    std::lock_guard lock(m_Mutex);
+    return {
+        .PageCount = m_Pages.size(),
+        .MappedBytes = m_MappedBytes,
+        .ResidentBudget = m_ResidentBudget,
+        .ResidentBytes = m_ResidentBytes,
+        .PeakResidentBytes = m_PeakResidentBytes,
+        .PageFaults = m_PageFaults,
+        .PrefetchHits = m_PrefetchHits,
+        .Evictions = m_Evictions,
+        .PrefetchedPages = m_PrefetchedPages.load(std::memory_order_relaxed),
+    };
+}
+
+std::string PagedMesh::GetPageFilePath(const std::string& meshFileName) {
+    // The mesh's extension stays, so model.obj and model.ply don't share a page file.
+    return meshFileName + ".dzp";
+}
+
+std::unique_ptr<PagedMesh> PagedMesh::Load(const std::string& fileName, const uint32_t materialIndex,
+    const MeshImporter::MaterialResolver& resolveMaterial, std::shared_ptr<MeshPageCache> pageCache,
+    std::string& error, LoadStatistics* statistics) {
+    DAZHBOG_PROFILE_ZONE("LoadPagedMesh");
+    std::error_code fileError;
+    const uint64_t sourceSize = std::filesystem::file_size(fileName, fileError);
+    const int64_t sourceTime = fileError ? 0
+        : static_cast<int64_t>(std::filesystem::last_write_time(fileName, fileError).time_since_epoch().count());
+    if (fileError) {
+        error = "Can't read " + fileName;
+        return nullptr;
+    }
+
+    LoadStatistics loadStatistics;
+    const std::string path = GetPageFilePath(fileName);
+    std::unique_ptr<PagedMesh> mesh(new PagedMesh());
+    std::vector<std::string> names;
+    auto startTime = Clock::now();
+    if (!mesh->open(path, sourceSize, sourceTime, names)) {
+        if (!writePageFile(fileName, path, sourceSize, sourceTime, error, loadStatistics)) return nullptr;
+        startTime = Clock::now();
+        if (!mesh->open(path, sourceSize, sourceTime, names)) {
+            error = "Can't read back " + path;
+            return nullptr;
+        }
+    } else {
+        loadStatistics.Import.FileSize = mesh->m_File->GetSize();
+        loadStatistics.Import.TriangleCount = mesh->m_TriangleCount;
+        for (const PageEntry& page : mesh->m_Pages) {
+            loadStatistics.Import.VertexCount += page.VertexCount;
+        }
+    }
+
+    mesh->m_MaterialIndex = materialIndex;
+    mesh->m_Materials.resize(names.size(), materialIndex);
+    if (resolveMaterial) {
+        std::ranges::transform(names, mesh->m_Materials.begin(), resolveMaterial);
+    }
+    std::vector<Aabb> bounds(mesh->m_Pages.size());
+    std::vector<std::array<uint64_t, 2>> ranges(mesh->m_Pages.size());
+    for (size_t i = 0; i < mesh->m_Pages.size(); i++) {
+        bounds[i] = mesh->m_Pages[i].Bounds;
+        ranges[i] = {mesh->m_Pages[i].Offset, mesh->m_Pages[i].Size};
+        mesh->m_ObjectBounds.Grow(bounds[i]);
+    }
+    mesh->m_PageBvh.Build(bounds);
+    mesh->m_Bounds = mesh->m_ObjectBounds;
+    mesh->m_FirstPage = pageCache->AddPages(mesh->m_File, ranges);
+    mesh->m_PageCache = std::move(pageCache);
+    if (loadStatistics.IsPageFileWritten) {
+        loadStatistics.Import.ParseTimeMs += millisecondsSince(startTime);
+    } else {
+        loadStatistics.Import.ParseTimeMs = millisecondsSince(startTime);
+    }
+    loadStatistics.PageFileSize = mesh->m_File->GetSize();
+    if (statistics) {
+        *statistics = loadStatistics;
+    }
+    return mesh;
+}
+
+bool PagedMesh::open(const std::string& pageFileName, const uint64_t sourceSize, const int64_t sourceTime,
+    std::vector<std::string>& names) {
+    auto file = std::make_shared<Utils::MappedFile>();
+    if (!file->Open(pageFileName) || file->GetSize() < sizeof(Header)) return false;
+    const size_t fileSize = file->GetSize();
+    Header header;
+    std::memcpy(&header, file->GetData(), sizeof(Header));
+    if (header.Magic != Magic || header.Version != Version || header.SourceSize != sourceSize
+        || header.SourceTime != sourceTime || header.NodeSize != sizeof(Bvh::Node)
+        || header.PageEntrySize != sizeof(PageEntry) || header.PagesOffset % ArrayAlignment != 0
+        || header.PagesOffset > fileSize || header.PageCount > (fileSize - header.PagesOffset) / sizeof(PageEntry)
+        || header.NamesOffset > fileSize || header.NamesSize > fileSize - header.NamesOffset
+        || header.MaterialCount > std::numeric_limits<uint16_t>::max()) return false;
+
+    const bool hasMaterials = header.MaterialCount > 0;
+    std::vector<PageEntry> pages(header.PageCount);
+    std::memcpy(pages.data(), file->GetData() + header.PagesOffset, pages.size() * sizeof(PageEntry));
+    uint64_t triangleCount = 0;
+    for (const PageEntry& page : pages) {
+        if (page.Offset % PageAlignment != 0 || page.Offset > fileSize || page.Size > fileSize - page.Offset
+            || page.TriangleCount == 0 || page.TriangleCount > MaxPageTriangles
+            || page.VertexCount > std::numeric_limits<uint16_t>::max() + 1u
+            || getLayout(page, header.HasTextureCoordinates != 0, hasMaterials).Size != page.Size) return false;
+        triangleCount += page.TriangleCount;
+    }
+    if (triangleCount != header.TriangleCount) return false;
+
+    names.clear();
+    const auto* nameData = reinterpret_cast<const char*>(file->GetData() + header.NamesOffset);
+    for (uint64_t begin = 0; begin < header.NamesSize;) {
+        const auto* end = static_cast<const char*>(std::memchr(nameData + begin, '\0', header.NamesSize - begin));
+        if (!end) return false;
+        names.emplace_back(nameData + begin, end);
+        begin = static_cast<uint64_t>(end - nameData) + 1;
+    }
+    if (names.size() != header.MaterialCount) return false;
+
+    m_File = std::move(file);
+    m_Pages = std::move(pages);
+    m_PageChecks = std::make_unique<std::atomic<PageCheck>[]>(m_Pages.size());
+    m_Identity.resize(MaxPageTriangles);
+    std::iota(m_Identity.begin(), m_Identity.end(), 0u);
+    m_HasTextureCoordinates = header.HasTextureCoordinates != 0;
+    m_TriangleCount = header.TriangleCount;
+    m_SourceSize = sourceSize;
+    m_SourceTime = sourceTime;
+    return true;
+}
+
+void PagedMesh::SetPlacement(const glm::vec3& position, const float scale, const float yaw) {
+    m_Rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)));
+    m_Position = position;
+    m_Scale = scale;
+    m_Bounds = {};
+    if (m_ObjectBounds.IsEmpty()) return;
+    for (int corner = 0; corner < 8; corner++) {
+        const glm::vec3 point(
+            corner & 1 ? m_ObjectBounds.Max.x : m_ObjectBounds.Min.x,
+            corner & 2 ? m_ObjectBounds.Max.y : m_ObjectBounds.Min.y,
+            corner & 4 ? m_ObjectBounds.Max.z : m_ObjectBounds.Min.z);
+        m_Bounds.Grow(m_Position + m_Rotation * (m_Scale * point));
+    }
+}
+
+Ray PagedMesh::toObject(const Ray& ray) const {
+    // Not through Ray's constructor: the direction keeps the length that makes distances match.
+    const glm::mat3 inverseRotation = glm::transpose(m_Rotation);
+    Ray objectRay;
+    objectRay.Origin = inverseRotation * (ray.Origin - m_Position) / m_Scale;
+    objectRay.Direction = inverseRotation * ray.Direction / m_Scale;
+    return objectRay;
+}
+
+bool PagedMesh::getPage(const uint32_t page, PageView& view) const {
+    m_PageCache->Touch(m_FirstPage + page);
+    const PageEntry& entry = m_Pages[page];
+    const PageLayout layout = getLayout(entry, m_HasTextureCoordinates, !m_Materials.empty());
+    const uint8_t* data = m_File->GetData() + entry.Offset;
+    view.Nodes = {reinterpret_cast<const Bvh::Node*>(data + layout.Nodes), entry.NodeCount};
+    view.Positions = reinterpret_cast<const glm::vec3*>(data + layout.Positions);
+    view.Normals = reinterpret_cast<const glm::vec3*>(data + layout.Normals);
+    view.TextureCoordinates = m_HasTextureCoordinates ? reinterpret_cast<const glm::vec2*>(data + layout.TextureCoordinates) : nullptr;
+    view.Triangles = reinterpret_cast<const std::array<uint16_t, 3>*>(data + layout.Triangles);
+    view.Materials = m_Materials.empty() ? nullptr : reinterpret_cast<const uint16_t*>(data + layout.Materials);
+    view.TriangleCount = entry.TriangleCount;
+    view.VertexCount = entry.VertexCount;
+
+    std::atomic<PageCheck>& check = m_PageChecks[page];
+    PageCheck state = check.load(std::memory_order_relaxed);
+    if (state == PageCheck::Unchecked) {
+        // Threads that get here at once reach the same verdict.
+        state = isValid(view) ? PageCheck::Valid : PageCheck::Invalid;
+        check.store(state, std::memory_order_relaxed);
+    }
+    return state == PageCheck::Valid;
+}
+
+bool PagedMesh::isValid(const PageView& view) const {
+    if (!Bvh::View(view.Nodes, {m_Identity.data(), view.TriangleCount}).IsValid(view.TriangleCount)) return false;
+    for (uint32_t i = 0; i < view.TriangleCount; i++) {
+        if (std::ranges::any_of(view.Triangles[i], [&](const uint16_t vertex) { return vertex >= view.VertexCount; })
+            || (view.Materials && view.Materials[i] >= m_Materials.size())) return false;
+    }
+    return true;
+}
+
+HitPayload PagedMesh::Hit(const Ray& ray, const Interval tBoundaries) const {
+    const Ray objectRay = toObject(ray);
+    float tMax = tBoundaries.GetMax();
+    uint32_t hitPage = 0, hitTriangle = 0;
+    glm::vec2 barycentrics(0.0f);
+    bool didHit = false;
+    uint64_t boxTests = 0;
+    m_PageBvh.Traverse(objectRay, tMax, [&](const uint32_t page, float& pageMaxDistance) {
+        PageView view;
+        if (!getPage(page, view)) return;
+        const Bvh bvh = Bvh::View(view.Nodes, {m_Identity.data(), view.TriangleCount});
+        bvh.Traverse(objectRay, pageMaxDistance, [&](const uint32_t triangle, float& maxDistance) {
+            const std::array<uint16_t, 3>& corners = view.Triangles[triangle];
+            if (Mesh::IntersectTriangle(view.Positions[corners[0]], view.Positions[corners[1]],
+                    view.Positions[corners[2]], objectRay, tBoundaries.GetMin(), maxDistance, barycentrics)) {
+                hitPage = page;
+                hitTriangle = triangle;
+                didHit = true;
+            }
+        }, boxTests);
+    }, boxTests);
+    if (!didHit) {
+        return {.DidCollide = false};
+    }
+
+    PageView view;
+    getPage(hitPage, view);
+    const std::array<uint16_t, 3>& corners = view.Triangles[hitTriangle];
+    const glm::vec3 positions[3] = {view.Positions[corners[0]], view.Positions[corners[1]], view.Positions[corners[2]]};
+    const glm::vec3 normals[3] = {view.Normals[corners[0]], view.Normals[corners[1]], view.Normals[corners[2]]};
+    HitPayload hitRecord = Mesh::MakePayload(objectRay, tMax, positions, normals, barycentrics);
+    // Rotation keeps lengths and the side that was hit, so only the results need to go back.
+    hitRecord.WorldPosition = ray.PointAt(tMax);
+    hitRecord.WorldNormal = m_Rotation * hitRecord.WorldNormal;
+    if (view.TextureCoordinates) {
+        const glm::vec2 textureCoordinates[3] = {view.TextureCoordinates[corners[0]],
+            view.TextureCoordinates[corners[1]], view.TextureCoordinates[corners[2]]};
+        Mesh::SetTextureCoordinates(hitRecord, positions, textureCoordinates, barycentrics);
+        // The positions are the mesh's own; the placement scales the world areas.
+        hitRecord.TextureDensity /= m_Scale;
+    }
+    hitRecord.MaterialIndex = view.Materials ? m_Materials[view.Materials[hitTriangle]] : m_MaterialIndex;
+    return hitRecord;
+}
+
+void PagedMesh::Prefetch(const std::span<const Ray> rays) const {
+    for (const Ray& ray : rays) {
+        const Ray objectRay = toObject(ray);
+        float tMax = std::numeric_limits<float>::max();
+        uint32_t pageCount = 0;
+        uint64_t boxTests = 0;
+        m_PageBvh.Traverse(objectRay, tMax, [&](const uint32_t page, float& maxDistance) {
+            m_PageCache->Prefetch(m_FirstPage + page);
+            // A distance of 0 ends the traversal.
+            if (++pageCount == PrefetchPagesPerRay) maxDistance = 0.0f;
+        }, boxTests);
+    }
+}
+
+size_t PagedMesh::GetMemoryUsage() const {
+    return m_Pages.size() * (sizeof(PageEntry) + sizeof(std::atomic<PageCheck>))
+        + m_PageBvh.GetNodes().size_bytes() + m_PageBvh.GetPrimitiveIndices().size_bytes()
+        + m_Identity.size() * sizeof(uint32_t) + m_Materials.size() * sizeof(uint32_t);
+}
+
+void PagedMesh::Hash(Utils::Fnv1a& hash) const {
+    hash.Add('P');
+    hash.Add(m_SourceSize);
+    hash.Add(m_SourceTime);
+    hash.Add(m_TriangleCount);
+    hash.Add(m_Pages.size());
+    hash.AddBytes(m_Pages.data(), m_Pages.size() * sizeof(PageEntry));
+    hash.Add(m_Materials.size());
+    hash.AddBytes(m_Materials.data(), m_Materials.size() * sizeof(uint32_t));
+    hash.Add(m_MaterialIndex);
+    hash.Add(m_Rotation);
+    hash.Add(m_Position);
+    hash.Add(m_Scale);
+}
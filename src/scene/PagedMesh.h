@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Bvh.h"
+#include "MeshImporter.h"
+#include "utils/MappedFile.h"
+
+// Decides which pages of streamed meshes stay in memory. Meshes register the byte ranges of their pages
+// in a mapped file; traversal touches a page before reading it, and a page that isn't resident counts
+// as a fault and is read in whole. When the resident pages exceed the budget, the least recently used
+// ones are released back to the file until a quarter of the budget is free again.
+//
+// Pages are read through the mapping, so a page released while another thread still reads it is just
+// read again: the hot path takes no lock, and the budget is kept closely rather than exactly. Meshes
+// sharing a cache share its budget.
+class MeshPageCache {
+public:
+    struct Statistics
+    {
+        uint64_t PageCount = 0;
+        uint64_t MappedBytes = 0;
+        uint64_t ResidentBudget = 0;
+        uint64_t ResidentBytes = 0;
+        uint64_t PeakResidentBytes = 0;
+        // Pages read in because traversal reached them, and how many of those a prefetch had asked for.
+        uint64_t PageFaults = 0;
+        uint64_t PrefetchHits = 0;
+        uint64_t Evictions = 0;
+        uint64_t PrefetchedPages = 0;
+    };
+
+    // A budget of 0 keeps every page once it was touched.
+    explicit MeshPageCache(uint64_t residentBudget) : m_ResidentBudget(residentBudget) {}
+
+    MeshPageCache(const MeshPageCache&) = delete;
+    MeshPageCache& operator=(const MeshPageCache&) = delete;
+
+    // Registers pages of file as [offset, offset + size) ranges and returns the id of the first; the
+    // others follow in order. For loading, not while anything is traced.
+    uint32_t AddPages(std::shared_ptr<const Utils::MappedFile> file,
+        std::span<const std::array<uint64_t, 2>> ranges);
+
+    // Marks the page as used, reading it in and evicting others if it isn't resident.
+    void Touch(const uint32_t page) {
+        Page& state = m_Pages[page];
+        const uint64_t now = m_Clock.load(std::memory_order_relaxed);
+        // Most touches find the stamp current; not writing it then keeps the cache line shared.
+        if (state.LastUse.load(std::memory_order_relaxed) != now) {
+            state.LastUse.store(now, std::memory_order_relaxed);
+        }
+        if (!state.IsResident.load(std::memory_order_acquire)) {
+            fault(state);
+        }
+    }
+
+    // Starts reading the page in the background unless it is resident or already asked for.
+    void Prefetch(uint32_t page);
+
+    [[nodiscard]] Statistics GetStatistics() const;
+
+private:
+    struct Page
+    {
+        const Utils::MappedFile* File = nullptr;
+        uint64_t Offset = 0;
+        uint64_t Size = 0;
+        // m_Clock when the page was last touched.
+        std::atomic<uint64_t> LastUse = 0;
+        std::atomic<bool> IsResident = false;
+        std::atomic<bool> IsPrefetched = false;
+    };
+
+    void fault(Page& page);
+
+    // Releases the least recently used pages but keep until the resident bytes are down to the target.
+    void evict(const Page& keep);
+
+    uint64_t m_ResidentBudget;
+    mutable std::mutex m_Mutex;
+    // A deque, so the atomics never move.
+    std::deque<Page> m_Pages;
+    std::vector<std::shared_ptr<const Utils::MappedFile>> m_Files;
+    // Advances with every fault: the pages touched since the last fault share a stamp, which is all the
+    // order eviction needs.
+    std::atomic<uint64_t> m_Clock = 1;
+    uint64_t m_MappedBytes = 0;
+    uint64_t m_ResidentBytes = 0;
+    uint64_t m_PeakResidentBytes = 0;
+    uint64_t m_PageFaults = 0;
+    uint64_t m_PrefetchHits = 0;
+    uint64_t m_Evictions = 0;
+    std::atomic<uint64_t> m_PrefetchedPages = 0;
+};
+
+// Mesh read from a page file through a MeshPageCache instead of being held in memory, for models larger
+// than the machine's RAM: renders slow down as pages are read again, but don't fail. Only the page table
+// and a BVH over the pages' bounds stay in memory, a few bytes per thousand triangles.
+//
+// The page file, <mesh file>.dzp, is written the first time a mesh is streamed; that import needs the
+// memory of a Mesh once, possibly on another machine. Each page holds up to MaxPageTriangles triangles
+// that are close together, their vertices with normals and texture coordinates, and a BVH over them. Pages
+// start at multiples of PageAlignment, so they can be dropped from memory without touching their
+// neighbours. A page is checked the first time it is read; one that fails is skipped.
+//
+// The file is keyed by the mesh file's size and modification time rather than a hash of its content,
+// which would read all of a file too big for memory on every load.
+class PagedMesh final : public Hittable {
+public:
+    static constexpr uint32_t MaxPageTriangles = 4096;
+    static constexpr uint64_t PageAlignment = 4096;
+
+    struct LoadStatistics
+    {
+        // Without an import, only the counts, the page file's size and the time to map it are filled in.
+        MeshImporter::Statistics Import;
+        bool IsPageFileWritten = false;
+        uint64_t PageFileSize = 0;
+        double WriteTimeMs = 0.0;
+    };
+
+    static std::string GetPageFilePath(const std::string& meshFileName);
+
+    // Maps the page file of the OBJ or PLY file, writing it first if it is missing or stale. OBJ material
+    // names are resolved as MeshImporter::Load() would. The pages are registered with pageCache.
+    static std::unique_ptr<PagedMesh> Load(const std::string& fileName, uint32_t materialIndex,
+        const MeshImporter::MaterialResolver& resolveMaterial, std::shared_ptr<MeshPageCache> pageCache,
+        std::string& error, LoadStatistics* statistics = nullptr);
+
+    // Places the mesh like a scene file's mesh statement: scaled, turned by yaw degrees about +y and moved
+    // to position.
+    void SetPlacement(const glm::vec3& position, float scale, float yaw);
+
+    HitPayload Hit(const Ray& ray, Interval tBoundaries) const override;
+
+    [[nodiscard]] Aabb GetBounds() const override { return m_Bounds; }
+
+    // Covers the page file's key and table, not the pages themselves, so hashing doesn't read the mesh.
+    void Hash(Utils::Fnv1a& hash) const override;
+
+    void Prefetch(std::span<const Ray> rays) const override;
+
+    [[nodiscard]] uint64_t GetTriangleCount() const { return m_TriangleCount; }
+
+    // Bytes held in memory whatever the pages do.
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+    [[nodiscard]] const std::shared_ptr<MeshPageCache>& GetPageCache() const { return m_PageCache; }
+
+    // Where a page is in the file and what it holds. Part of the file format.
+    struct PageEntry
+    {
+        Aabb Bounds;
+        uint64_t Offset = 0;
+        uint32_t Size = 0;
+        uint32_t TriangleCount = 0;
+        uint32_t VertexCount = 0;
+        uint32_t NodeCount = 0;
+    };
+
+private:
+    // A page's arrays inside the mapping.
+    struct PageView
+    {
+        std::span<const Bvh::Node> Nodes;
+        const glm::vec3* Positions = nullptr;
+        const glm::vec3* Normals = nullptr;
+        const glm::vec2* TextureCoordinates = nullptr;
+        const std::array<uint16_t, 3>* Triangles = nullptr;
+        // Local material ids, null when the mesh has one material.
+        const uint16_t* Materials = nullptr;
+        uint32_t TriangleCount = 0;
+        uint32_t VertexCount = 0;
+    };
+
+    enum class PageCheck : uint8_t {
+        Unchecked,
+        Valid,
+        Invalid
+    };
+
+    PagedMesh() = default;
+
+    // Maps the page file if it belongs to the mesh file and its tables are sound; fills in the material
+    // names by local id.
+    bool open(const std::string& pageFileName, uint64_t sourceSize, int64_t sourceTime,
+        std::vector<std::string>& names);
+
+    // Touches the page; false if it failed its check.
+    bool getPage(uint32_t page, PageView& view) const;
+
+    [[nodiscard]] bool isValid(const PageView& view) const;
+
+    // The ray in the mesh's own coordinates, with the same distances along it.
+    [[nodiscard]] Ray toObject(const Ray& ray) const;
+
+    std::shared_ptr<const Utils::MappedFile> m_File;
+    std::shared_ptr<MeshPageCache> m_PageCache;
+    uint32_t m_FirstPage = 0;
+    std::vector<PageEntry> m_Pages;
+    std::unique_ptr<std::atomic<PageCheck>[]> m_PageChecks;
+    // Over the pages' bounds, in the mesh's coordinates.
+    Bvh m_PageBvh;
+    // Page triangles are stored in the order of their BVH's leaves, so its primitive indices are these.
+    std::vector<uint32_t> m_Identity;
+    bool m_HasTextureCoordinates = false;
+    uint64_t m_TriangleCount = 0;
+    uint64_t m_SourceSize = 0;
+    int64_t m_SourceTime = 0;
+
+    uint32_t m_MaterialIndex = 0;
+    // Scene material of every local material id.
+    std::vector<uint32_t> m_Materials;
+
+    Aabb m_ObjectBounds;
+    Aabb m_Bounds;
+    glm::mat3 m_Rotation{1.0f};
+    glm::vec3 m_Position{0.0f};
+    float m_Scale = 1.0f;
+};
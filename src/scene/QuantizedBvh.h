@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <tbb/parallel_invoke.h>
+
+#include "Bvh.h"
+
+// Bvh with the bounds of each node's children stored in T-sized steps of the node's own box instead of
+// as floats. With T = uint8_t both children fit in 24 bytes, against 64 for two Bvh nodes, and leaves
+// live in their parent, so the tree takes about a third of the memory. The boxes are decoded on the way
+// down; rounding always grows them, so the tree stays conservative and only costs a few extra tests.
+//
+// Leaves refer to ranges of the source Bvh's primitive index array: callers store their primitives in
+// that order and drop the array.
+template<typename T>
+class QuantizedBvh {
+public:
+    static_assert(std::is_unsigned_v<T> && sizeof(T) <= 2);
+
+    static constexpr uint32_t Steps = std::numeric_limits<T>::max();
+
+    struct Node
+    {
+        T Min[2][3];
+        T Max[2][3];
+        // Per child: 0 for an inner node, the primitive count for a leaf, EmptyChild for none.
+        uint16_t Counts[2];
+        // Per child: the node index, or the first primitive of a leaf.
+        uint32_t Children[2];
+    };
+
+    // Replaces the tree with a copy of bvh.
+    void Build(const Bvh& bvh);
+
+    template<typename HitPrimitive>
+    void Traverse(const Ray& ray, float& tMax, const HitPrimitive& hitPrimitive, uint64_t& boxTests) const;
+
+    [[nodiscard]] size_t GetMemoryUsage() const { return m_Nodes.size() * sizeof(Node); }
+
+private:
+    static constexpr uint16_t EmptyChild = std::numeric_limits<uint16_t>::max();
+    static constexpr uint32_t MaxLeafSize = EmptyChild - 1;
+
+    // A box the children of a node are quantized in: decoded values are Min + q * Step.
+    struct Frame
+    {
+        glm::vec3 Min{0.0f};
+        glm::vec3 Step{0.0f};
+
+        Frame() = default;
+
+        explicit Frame(const Aabb& box) : Min(box.Min) {
+            for (int axis = 0; axis < 3; axis++) {
+                // A few units in the last place more than the extent, so Min + Steps * Step reaches Max
+                // despite rounding.
+                const float magnitude = std::max(std::abs(box.Min[axis]), std::abs(box.Max[axis]));
+                Step[axis] = (box.Max[axis] - box.Min[axis] + 4.0f * FLT_EPSILON * magnitude) * (1.0f / Steps);
+            }
+        }
+
+        [[nodiscard]] Aabb Decode(const T (&min)[3], const T (&max)[3]) const {
+            Aabb box;
+            for (int axis = 0; axis < 3; axis++) {
+                box.Min[axis] = Min[axis] + static_cast<float>(min[axis]) * Step[axis];
+                box.Max[axis] = Min[axis] + static_cast<float>(max[axis]) * Step[axis];
+            }
+            return box;
+        }
+    };
+
+    // A Bvh node, or part of the primitives of a leaf too big for a count.
+    struct Source
+    {
+        Aabb Bounds;
+        uint32_t Index;
+        uint32_t Count;
+    };
+
+    void convert(const Bvh& bvh, const Source& source, const Frame& frame, uint32_t nodeIndex, uint32_t depth,
+        std::atomic<uint32_t>& nodeCount);
+
+    // Splitting oversized leaves adds levels below Bvh::MaxDepth.
+    static constexpr uint32_t MaxDepth = Bvh::MaxDepth + 32;
+
+    std::vector<Node> m_Nodes;
+    Aabb m_Bounds;
+};
+
+template<typename T>
+void QuantizedBvh<T>::Build(const Bvh& bvh) {
+    const std::span<const Bvh::Node> nodes = bvh.GetNodes();
+    m_Nodes.clear();
+    if (nodes.empty()) return;
+    // Leaves disappear into their parents; leaves too big for a count are split over new nodes.
+    size_t nodeCount = 1;
+    for (const Bvh::Node& node : nodes) {
+        nodeCount += !node.IsLeaf() ? 1 : node.Count > MaxLeafSize ? 2 * (node.Count / MaxLeafSize) + 1 : 0;
+    }
+    m_Nodes.resize(nodeCount);
+    std::atomic<uint32_t> usedNodes = 1;
+    m_Bounds = nodes[0].Bounds;
+    const Source root{nodes[0].Bounds, nodes[0].Index, nodes[0].Count};
+    if (root.Count > 0 && root.Count <= MaxLeafSize) {
+        // A single leaf still needs a node to hold it.
+        Node& node = m_Nodes[0];
+        node = {};
+        node.Max[0][0] = node.Max[0][1] = node.Max[0][2] = static_cast<T>(Steps);
+        node.Counts[0] = static_cast<uint16_t>(root.Count);
+        node.Children[0] = root.Index;
+        node.Counts[1] = EmptyChild;
+    } else {
+        convert(bvh, root, Frame(root.Bounds), 0, 0, usedNodes);
+    }
+    m_Nodes.resize(usedNodes);
+    m_Nodes.shrink_to_fit();
+}
+
+template<typename T>
+void QuantizedBvh<T>::convert(const Bvh& bvh, const Source& source, const Frame& frame, const uint32_t nodeIndex,
+    const uint32_t depth, std::atomic<uint32_t>& nodeCount) {
+    const std::span<const Bvh::Node> nodes = bvh.GetNodes();
+    Source children[2];
+    if (source.Count == 0) {
+        for (int i = 0; i < 2; i++) {
+            const Bvh::Node& child = nodes[source.Index + i];
+            children[i] = {child.Bounds, child.Index, child.Count};
+        }
+    } else {
+        // Halves of an oversized leaf, both with its box.
+        const uint32_t half = source.Count / 2;
+        children[0] = {source.Bounds, source.Index, half};
+        children[1] = {source.Bounds, source.Index + half, source.Count - half};
+    }
+
+    Node& node = m_Nodes[nodeIndex];
+    Frame childFrames[2] = {frame, frame};
+    bool isInner[2];
+    for (int i = 0; i < 2; i++) {
+        const Aabb& bounds = children[i].Bounds;
+        for (int axis = 0; axis < 3; axis++) {
+            // Round outwards, then step further while decoding doesn't cover the box with a unit in the
+            // last place to spare.
+            const float step = frame.Step[axis];
+            const float origin = frame.Min[axis];
+            const float slack = FLT_EPSILON * std::max(std::abs(bounds.Min[axis]), std::abs(bounds.Max[axis]));
+            int64_t low = 0, high = 0;
+            if (step > 0.0f) {
+                low = std::clamp<int64_t>(static_cast<int64_t>(std::floor((bounds.Min[axis] - origin) / step)), 0, Steps);
+                high = std::clamp<int64_t>(static_cast<int64_t>(std::ceil((bounds.Max[axis] - origin) / step)), 0, Steps);
+                while (low > 0 && origin + static_cast<float>(low) * step > bounds.Min[axis] - slack) low--;
+                while (high < Steps && origin + static_cast<float>(high) * step < bounds.Max[axis] + slack) high++;
+            }
+            node.Min[i][axis] = static_cast<T>(low);
+            node.Max[i][axis] = static_cast<T>(high);
+        }
+        isInner[i] = children[i].Count == 0 || children[i].Count > MaxLeafSize;
+        node.Counts[i] = isInner[i] ? 0 : static_cast<uint16_t>(children[i].Count);
+        if (isInner[i]) {
+            node.Children[i] = nodeCount.fetch_add(1, std::memory_order_relaxed);
+            childFrames[i] = Frame(frame.Decode(node.Min[i], node.Max[i]));
+        } else {
+            node.Children[i] = children[i].Index;
+        }
+    }
+
+    const auto convertChild = [&](const int i) {
+        if (isInner[i]) convert(bvh, children[i], childFrames[i], node.Children[i], depth + 1, nodeCount);
+    };
+    // The top levels fan out into tasks; below that each subtree is converted on one thread.
+    if (depth < 12) {
+        tbb::parallel_invoke([&] { convertChild(0); }, [&] { convertChild(1); });
+    } else {
+        convertChild(0);
+        convertChild(1);
+    }
+}
+
+template<typename T>
+template<typename HitPrimitive>
+void QuantizedBvh<T>::Traverse(const Ray& ray, float& tMax, const HitPrimitive& hitPrimitive,
+    uint64_t& boxTests) const {
+    constexpr float Miss = std::numeric_limits<float>::infinity();
+    if (m_Nodes.empty()) return;
+    const glm::vec3 inverseDirection = 1.0f / ray.Direction;
+
+    struct Entry
+    {
+        uint32_t Node;
+        float Distance;
+        Frame NodeFrame;
+    };
+    Entry stack[MaxDepth];
+    uint32_t stackSize = 0;
+
+    boxTests++;
+    if (m_Bounds.Intersect(ray.Origin, inverseDirection, tMax) == Miss) return;
+    uint32_t nodeIndex = 0;
+    Frame frame(m_Bounds);
+    while (true) {
+        const Node& node = m_Nodes[nodeIndex];
+        Aabb boxes[2];
+        float distances[2] = {Miss, Miss};
+        for (int i = 0; i < 2; i++) {
+            if (node.Counts[i] == EmptyChild) continue;
+            boxes[i] = frame.Decode(node.Min[i], node.Max[i]);
+            distances[i] = boxes[i].Intersect(ray.Origin, inverseDirection, tMax);
+            boxTests++;
+        }
+        int near = distances[1] < distances[0] ? 1 : 0;
+        // Leaves are tested right away, nearest first; that may lower tMax before the other child.
+        for (int k = 0; k < 2; k++) {
+            const int i = k == 0 ? near : 1 - near;
+            if (node.Counts[i] == 0 || distances[i] == Miss || distances[i] >= tMax) continue;
+            for (uint32_t p = node.Children[i]; p < node.Children[i] + node.Counts[i]; p++) {
+                hitPrimitive(p, tMax);
+            }
+            distances[i] = Miss;
+        }
+        near = distances[1] < distances[0] ? 1 : 0;
+        const int far = 1 - near;
+        if (distances[near] != Miss) {
+            if (distances[far] != Miss) {
+                stack[stackSize++] = {node.Children[far], distances[far], Frame(boxes[far])};
+            }
+            nodeIndex = node.Children[near];
+            frame = Frame(boxes[near]);
+            continue;
+        }
+        // Boxes entered beyond a hit found meanwhile can be skipped.
+        while (stackSize > 0 && stack[stackSize - 1].Distance >= tMax) {
+            stackSize--;
+        }
+        if (stackSize == 0) return;
+        stackSize--;
+        nodeIndex = stack[stackSize].Node;
+        frame = stack[stackSize].NodeFrame;
+    }
+}
@@ -1,5 +1,7 @@
 #include "Scene.h"
 
+#include <tbb/parallel_for.h>
+
 #include "render/Material.h"
 
 Scene::Scene() {
@@ -9,6 +11,7 @@ Scene::Scene() {
 uint32_t Scene::Add(Hittable* sphere)
 {
     m_HittableObjects.emplace_back(std::unique_ptr<Hittable>(sphere));
+    m_IsCommitted = false;
     return m_HittableObjects.size() - 1;
 }
 
@@ -18,6 +21,71 @@ uint32_t Scene::Add(Material *material)
     return m_Materials.size() - 1;
 }
 
+void Scene::Add(const Sphere& sphere)
+{
+    thaw();
+    m_Spheres.push_back(sphere);
+    updateViews();
+}
+
+void Scene::Add(const Triangle& triangle)
+{
+    thaw();
+    m_Triangles.push_back(triangle);
+    updateViews();
+}
+
+void Scene::AddSpheres(std::vector<Sphere> spheres)
+{
+    thaw();
+    if (m_Spheres.empty()) {
+        m_Spheres = std::move(spheres);
+    } else {
+        m_Spheres.insert(m_Spheres.end(), spheres.begin(), spheres.end());
+    }
+    updateViews();
+}
+
+void Scene::AddTriangles(std::vector<Triangle> triangles)
+{
+    thaw();
+    if (m_Triangles.empty()) {
+        m_Triangles = std::move(triangles);
+    } else {
+        m_Triangles.insert(m_Triangles.end(), triangles.begin(), triangles.end());
+    }
+    updateViews();
+}
+
+void Scene::SetFrozenPrimitives(const std::span<const Sphere> spheres, const std::span<const Triangle> triangles,
+    Bvh bvh, std::shared_ptr<const void> storage)
+{
+    std::lock_guard lock(m_CommitMutex);
+    m_Spheres.clear();
+    m_Triangles.clear();
+    m_SphereView = spheres;
+    m_TriangleView = triangles;
+    m_FrozenStorage = std::move(storage);
+    m_Bvh = std::move(bvh);
+    m_IsCommitted = m_HittableObjects.empty();
+}
+
+void Scene::thaw()
+{
+    if (m_FrozenStorage) {
+        m_Spheres.assign(m_SphereView.begin(), m_SphereView.end());
+        m_Triangles.assign(m_TriangleView.begin(), m_TriangleView.end());
+        m_FrozenStorage.reset();
+    }
+    m_IsCommitted = false;
+}
+
+void Scene::updateViews()
+{
+    m_SphereView = m_Spheres;
+    m_TriangleView = m_Triangles;
+}
+
 std::vector<std::unique_ptr<Hittable>>& Scene::GetHittableObjects()
 {
     return m_HittableObjects;
@@ -27,3 +95,97 @@ std::vector<std::unique_ptr<Material>> & Scene::GetMaterials()
 {
     return m_Materials;
 }
+
+void Scene::Commit()
+{
+    std::lock_guard lock(m_CommitMutex);
+    if (m_IsCommitted) return;
+    std::vector<Aabb> bounds(GetPrimitiveCount());
+    const auto sphereCount = static_cast<uint32_t>(m_SphereView.size());
+    const auto triangleCount = static_cast<uint32_t>(m_TriangleView.size());
+    tbb::parallel_for<size_t>(0, bounds.size(), [&](const size_t i) {
+        if (i < sphereCount) {
+            bounds[i] = m_SphereView[i].GetBounds();
+        } else if (i < sphereCount + triangleCount) {
+            bounds[i] = m_TriangleView[i - sphereCount].GetBounds();
+        } else {
+            bounds[i] = m_HittableObjects[i - sphereCount - triangleCount]->GetBounds();
+        }
+    });
+    m_Bvh.Build(bounds);
+    m_IsCommitted = true;
+}
+
+HitPayload Scene::Intersect(const Ray& ray, IntersectionCounters* counters) const
+{
+    float closestSoFar = std::numeric_limits<float>::max();
+    HitPayload nearestHitPayload = {.DidCollide = false};
+    uint64_t boxTests = 0;
+    uint64_t primitiveTests = 0;
+    if (m_IsCommitted.load(std::memory_order_acquire)) {
+        m_Bvh.Traverse(ray, closestSoFar, [&](const uint32_t primitive, float& tMax) {
+            hitPrimitive(primitive, ray, tMax, nearestHitPayload);
+            primitiveTests++;
+        }, boxTests);
+    } else {
+        primitiveTests = GetPrimitiveCount();
+        for (uint32_t i = 0; i < primitiveTests; i++) {
+            hitPrimitive(i, ray, closestSoFar, nearestHitPayload);
+        }
+    }
+    if (counters) {
+        counters->BoxTests += boxTests;
+        counters->PrimitiveTests += primitiveTests;
+    }
+    return nearestHitPayload;
+}
+
+void Scene::hitPrimitive(uint32_t primitive, const Ray& ray, float& tMax, HitPayload& payload) const
+{
+    HitPayload hit;
+    uint32_t materialIndex = 0;
+    if (primitive < m_SphereView.size()) {
+        hit = m_SphereView[primitive].Hit(ray, Interval(0.0f, tMax));
+        materialIndex = m_SphereView[primitive].GetMaterialIndex();
+    } else if ((primitive -= static_cast<uint32_t>(m_SphereView.size())) < m_TriangleView.size()) {
+        hit = m_TriangleView[primitive].Hit(ray, Interval(0.0f, tMax));
+        materialIndex = m_TriangleView[primitive].GetMaterialIndex();
+    } else {
+        hit = m_HittableObjects[primitive - m_TriangleView.size()]->Hit(ray, Interval(0.0f, tMax));
+        materialIndex = hit.MaterialIndex;
+    }
+    if (hit.DidCollide) {
+        payload = hit;
+        payload.MaterialIndex = materialIndex;
+        tMax = hit.HitDistance;
+    }
+}
+
+void Scene::Prefetch(const std::span<const Ray> rays) const
+{
+    for (const auto& hittable : m_HittableObjects) {
+        hittable->Prefetch(rays);
+    }
+}
+
+uint64_t Scene::Hash() const
+{
+    Utils::Fnv1a hash;
+    hash.Add(m_HittableObjects.size());
+    for (const auto& hittable : m_HittableObjects) {
+        hittable->Hash(hash);
+    }
+    hash.Add(m_SphereView.size());
+    for (const Sphere& sphere : m_SphereView) {
+        sphere.Hash(hash);
+    }
+    hash.Add(m_TriangleView.size());
+    for (const Triangle& triangle : m_TriangleView) {
+        triangle.Hash(hash);
+    }
+    hash.Add(m_Materials.size());
+    for (const auto& material : m_Materials) {
+        material->Hash(hash);
+    }
+    return hash.Get();
+}
@@ -1,11 +1,22 @@
 #pragma once
 
-#include <vector>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
 
+#include "Bvh.h"
 #include "math/Geometry.h"
 #include "render/Material.h"
 
+// Work done by Scene::Intersect(), for statistics. BoxTests stay zero until the scene is committed.
+struct IntersectionCounters
+{
+    uint64_t BoxTests = 0;
+    uint64_t PrimitiveTests = 0;
+};
+
 class Scene {
 public:
     Scene();
@@ -16,11 +27,72 @@ public:
 
     uint32_t Add(Material *material);
 
+    // Spheres and triangles are kept by value in flat arrays instead of one heap object each.
+    void Add(const Sphere& sphere);
+
+    void Add(const Triangle& triangle);
+
+    void AddSpheres(std::vector<Sphere> spheres);
+
+    void AddTriangles(std::vector<Triangle> triangles);
+
+    // Uses primitive arrays and a BVH over them that live in storage, such as a mapped SceneCache file,
+    // in place. Replaces the spheres and triangles added so far; the scene counts as committed unless
+    // more is added.
+    void SetFrozenPrimitives(std::span<const Sphere> spheres, std::span<const Triangle> triangles, Bvh bvh,
+        std::shared_ptr<const void> storage);
+
     [[nodiscard]] std::vector<std::unique_ptr<Hittable> > &GetHittableObjects();
 
+    // Objects other than spheres and triangles, such as cubes.
+    [[nodiscard]] bool HasHittableObjects() const { return !m_HittableObjects.empty(); }
+
     [[nodiscard]] std::vector<std::unique_ptr<Material> > &GetMaterials();
 
+    [[nodiscard]] std::span<const Sphere> GetSpheres() const { return m_SphereView; }
+
+    [[nodiscard]] std::span<const Triangle> GetTriangles() const { return m_TriangleView; }
+
+    [[nodiscard]] size_t GetPrimitiveCount() const {
+        return m_SphereView.size() + m_TriangleView.size() + m_HittableObjects.size();
+    }
+
+    // The tree Commit() built; primitive i is sphere i, then triangle i - sphere count, then object.
+    [[nodiscard]] const Bvh& GetBvh() const { return m_Bvh; }
+
+    // Builds the acceleration structure over everything added so far. Until then Intersect() tests every
+    // primitive. Renderer commits its scene when it is created; does nothing if nothing was added since.
+    void Commit();
+
+    // Closest hit along the ray, with MaterialIndex set to the hit primitive's. Adds the tests it did to counters.
+    [[nodiscard]] HitPayload Intersect(const Ray& ray, IntersectionCounters* counters = nullptr) const;
+
+    // Passes the rays to every object's Hittable::Prefetch().
+    void Prefetch(std::span<const Ray> rays) const;
+
+    // Identifies the scene's content; walks every object, so cache it for large scenes.
+    [[nodiscard]] uint64_t Hash() const;
+
 private:
+    // Tests primitive i of the order spheres, triangles, hittable objects; on a hit closer than tMax,
+    // fills payload and lowers tMax.
+    void hitPrimitive(uint32_t primitive, const Ray& ray, float& tMax, HitPayload& payload) const;
+
+    // Copies frozen primitives into the scene's own arrays before they are changed.
+    void thaw();
+
+    void updateViews();
+
     std::vector<std::unique_ptr<Hittable> > m_HittableObjects;
     std::vector<std::unique_ptr<Material> > m_Materials;
+    std::vector<Sphere> m_Spheres;
+    std::vector<Triangle> m_Triangles;
+    // Point either into the vectors above or into m_FrozenStorage.
+    std::span<const Sphere> m_SphereView;
+    std::span<const Triangle> m_TriangleView;
+    std::shared_ptr<const void> m_FrozenStorage;
+
+    Bvh m_Bvh;
+    std::mutex m_CommitMutex;
+    std::atomic<bool> m_IsCommitted = false;
 };
@@ -0,0 +1,305 @@
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <span>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "utils/Hash.h"
+#include "utils/MappedFile.h"
+#include "utils/Profiler.h"
+
+namespace SceneCache
+{
+    namespace
+    {
+        constexpr std::array<char, 4> Magic = {'D', 'Z', 'S', 'C'};
+        constexpr uint32_t Version = 1;
+        // Sections start at multiples of this, so the arrays are aligned wherever the file is mapped.
+        constexpr uint64_t SectionAlignment = 64;
+        // The scene file is hashed in blocks of this size in parallel.
+        constexpr size_t HashBlockSize = 1u << 20;
+
+        using Clock = std::chrono::steady_clock;
+        using MaterialDescription = SceneFile::MaterialDescription;
+
+        double millisecondsSince(const Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Count elements from Offset bytes into the file.
+        struct Section
+        {
+            uint64_t Offset = 0;
+            uint64_t Count = 0;
+        };
+
+        struct Header
+        {
+            std::array<char, 4> Magic{};
+            uint32_t Version = 0;
+            uint64_t SourceHash = 0;
+            // Sizes of the stored types, so a build with another memory layout doesn't use the cache.
+            uint32_t MaterialSize = 0;
+            uint32_t SphereSize = 0;
+            uint32_t TriangleSize = 0;
+            uint32_t NodeSize = 0;
+
+            glm::vec3 CameraPosition{0.0f};
+            glm::vec3 CameraDirection{0.0f};
+            float VerticalFOV = 0.0f;
+            uint32_t Width = 0;
+            uint32_t Height = 0;
+            int32_t SamplesPerPixel = 0;
+            int32_t RayBounces = 0;
+            int32_t Frames = 0;
+
+            Section Materials;
+            Section Spheres;
+            Section Triangles;
+            Section Nodes;
+            Section PrimitiveIndices;
+        };
+
+        static_assert(std::is_trivially_copyable_v<Header> && std::is_trivially_copyable_v<MaterialDescription>
+            && std::is_trivially_copyable_v<Bvh::Node>);
+
+        uint64_t alignOffset(const uint64_t offset)
+        {
+            return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        }
+
+        uint64_t hashContent(const uint8_t* data, const size_t size)
+        {
+            DAZHBOG_PROFILE_ZONE("HashSceneFile");
+            const size_t blockCount = (size + HashBlockSize - 1) / HashBlockSize;
+            std::vector<uint64_t> blockHashes(blockCount);
+            tbb::parallel_for<size_t>(0, blockCount, [&](const size_t i) {
+                Utils::Fnv1a hash;
+                hash.AddBytes(data + i * HashBlockSize, std::min(HashBlockSize, size - i * HashBlockSize));
+                blockHashes[i] = hash.Get();
+            });
+            Utils::Fnv1a hash;
+            hash.Add(size);
+            hash.AddBytes(blockHashes.data(), blockHashes.size() * sizeof(uint64_t));
+            return hash.Get();
+        }
+
+        template<typename T>
+        bool getSection(const Utils::MappedFile& file, const Section& section, std::span<const T>& elements)
+        {
+            if (section.Offset % SectionAlignment != 0 || section.Offset > file.GetSize()
+                || section.Count > (file.GetSize() - section.Offset) / sizeof(T)) return false;
+            elements = {reinterpret_cast<const T*>(file.GetData() + section.Offset), section.Count};
+            return true;
+        }
+
+        // Every primitive must use a material the scene has; the renderer doesn't check.
+        template<typename T>
+        bool hasValidMaterials(const std::span<const T> primitives, const size_t materialCount)
+        {
+            std::atomic<bool> isValid = true;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, primitives.size()), [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    if (primitives[i].GetMaterialIndex() >= materialCount) {
+                        isValid.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+            });
+            return isValid.load();
+        }
+
+        bool mapCache(const std::string& path, const uint64_t sourceHash, SceneLibrary::Entry& entry,
+            uint64_t& cacheSize)
+        {
+            DAZHBOG_PROFILE_ZONE("MapSceneCache");
+            auto file = std::make_shared<Utils::MappedFile>();
+            if (!file->Open(path) || file->GetSize() < sizeof(Header)) return false;
+            Header header;
+            std::memcpy(&header, file->GetData(), sizeof(Header));
+            if (header.Magic != Magic || header.Version != Version || header.SourceHash != sourceHash
+                || header.MaterialSize != sizeof(MaterialDescription) || header.SphereSize != sizeof(Sphere)
+                || header.TriangleSize != sizeof(Triangle) || header.NodeSize != sizeof(Bvh::Node)) return false;
+
+            std::span<const MaterialDescription> materials;
+            std::span<const Sphere> spheres;
+            std::span<const Triangle> triangles;
+            std::span<const Bvh::Node> nodes;
+            std::span<const uint32_t> primitiveIndices;
+            if (!getSection(*file, header.Materials, materials) || !getSection(*file, header.Spheres, spheres)
+                || !getSection(*file, header.Triangles, triangles) || !getSection(*file, header.Nodes, nodes)
+                || !getSection(*file, header.PrimitiveIndices, primitiveIndices)) return false;
+            Bvh bvh = Bvh::View(nodes, primitiveIndices);
+            // The scene's default material comes first.
+            const size_t materialCount = materials.size() + 1;
+            if (!bvh.IsValid(spheres.size() + triangles.size()) || !hasValidMaterials(spheres, materialCount)
+                || !hasValidMaterials(triangles, materialCount)) return false;
+
+            auto scene = std::make_unique<::Scene>();
+            for (const MaterialDescription& description : materials) {
+                std::unique_ptr<Material> material = SceneFile::CreateMaterial(description);
+                if (!material) return false;
+                scene->Add(material.release());
+            }
+            cacheSize = file->GetSize();
+            scene->SetFrozenPrimitives(spheres, triangles, std::move(bvh), std::move(file));
+
+            entry = {};
+            entry.Scene = std::move(scene);
+            entry.CameraPosition = header.CameraPosition;
+            entry.CameraDirection = header.CameraDirection;
+            entry.VerticalFOV = header.VerticalFOV;
+            entry.Width = header.Width;
+            entry.Height = header.Height;
+            entry.SamplesPerPixel = header.SamplesPerPixel;
+            entry.RayBounces = header.RayBounces;
+            entry.Frames = header.Frames;
+            return true;
+        }
+
+        template<typename T>
+        bool writeSection(FILE* file, uint64_t& position, const Section& section, const std::span<const T> elements)
+        {
+            static constexpr std::array<uint8_t, SectionAlignment> Padding{};
+            if (std::fwrite(Padding.data(), 1, section.Offset - position, file) != section.Offset - position) {
+                return false;
+            }
+            position = section.Offset + elements.size_bytes();
+            return elements.empty() || std::fwrite(elements.data(), sizeof(T), elements.size(), file) == elements.size();
+        }
+
+        bool writeCache(const std::string& path, const uint64_t sourceHash, const SceneLibrary::Entry& entry,
+            const std::vector<MaterialDescription>& materialDescriptions, uint64_t& cacheSize)
+        {
+            DAZHBOG_PROFILE_ZONE("WriteSceneCache");
+            const ::Scene& scene = *entry.Scene;
+            // Meshes aren't stored yet: the key would have to cover their files too.
+            if (scene.HasHittableObjects()) return false;
+            const std::span<const MaterialDescription> materials = materialDescriptions;
+            const std::span<const Sphere> spheres = scene.GetSpheres();
+            const std::span<const Triangle> triangles = scene.GetTriangles();
+            const std::span<const Bvh::Node> nodes = scene.GetBvh().GetNodes();
+            const std::span<const uint32_t> primitiveIndices = scene.GetBvh().GetPrimitiveIndices();
+
+            Header header{
+                .Magic = Magic,
+                .Version = Version,
+                .SourceHash = sourceHash,
+                .MaterialSize = sizeof(MaterialDescription),
+                .SphereSize = sizeof(Sphere),
+                .TriangleSize = sizeof(Triangle),
+                .NodeSize = sizeof(Bvh::Node),
+                .CameraPosition = entry.CameraPosition,
+                .CameraDirection = entry.CameraDirection,
+                .VerticalFOV = entry.VerticalFOV,
+                .Width = entry.Width,
+                .Height = entry.Height,
+                .SamplesPerPixel = entry.SamplesPerPixel,
+                .RayBounces = entry.RayBounces,
+                .Frames = entry.Frames,
+            };
+            Section* sections[] = {
+                &header.Materials, &header.Spheres, &header.Triangles, &header.Nodes, &header.PrimitiveIndices,
+            };
+            const size_t sectionSizes[] = {
+                materials.size_bytes(), spheres.size_bytes(), triangles.size_bytes(), nodes.size_bytes(),
+                primitiveIndices.size_bytes(),
+            };
+            uint64_t offset = sizeof(Header);
+            for (size_t i = 0; i < std::size(sections); i++) {
+                sections[i]->Offset = alignOffset(offset);
+                offset = sections[i]->Offset + sectionSizes[i];
+            }
+            header.Materials.Count = materials.size();
+            header.Spheres.Count = spheres.size();
+            header.Triangles.Count = triangles.size();
+            header.Nodes.Count = nodes.size();
+            header.PrimitiveIndices.Count = primitiveIndices.size();
+
+            // Workers on one machine may load the same scene at once, so every writer gets its own
+            // temporary file; the renames replace each other's identical caches.
+            const std::string temporaryName = path + "." + std::to_string(std::random_device()()) + ".tmp";
+            FILE* file = std::fopen(temporaryName.c_str(), "wb");
+            if (!file) return false;
+            uint64_t position = sizeof(Header);
+            bool isWritten = std::fwrite(&header, sizeof(Header), 1, file) == 1
+                && writeSection(file, position, header.Materials, materials)
+                && writeSection(file, position, header.Spheres, spheres)
+                && writeSection(file, position, header.Triangles, triangles)
+                && writeSection(file, position, header.Nodes, nodes)
+                && writeSection(file, position, header.PrimitiveIndices, primitiveIndices)
+                && std::fflush(file) == 0;
+#if !defined(_WIN32)
+            isWritten = isWritten && fsync(fileno(file)) == 0;
+#endif
+            isWritten = std::fclose(file) == 0 && isWritten;
+
+            std::error_code error;
+            if (isWritten) {
+                std::filesystem::rename(temporaryName, path, error);
+            }
+            if (!isWritten || error) {
+                std::filesystem::remove(temporaryName, error);
+                return false;
+            }
+            cacheSize = position;
+            return true;
+        }
+    }
+
+    std::string GetCachePath(const std::string& sceneFileName)
+    {
+        std::string path = sceneFileName;
+        if (SceneFile::IsSceneFile(path)) {
+            path.resize(path.size() - 4);
+        }
+        return path + ".dzc";
+    }
+
+    bool Load(const std::string& fileName, SceneLibrary::Entry& entry, std::string& error, Statistics* statistics)
+    {
+        DAZHBOG_PROFILE_ZONE("LoadSceneCached");
+        Statistics loadStatistics;
+        const auto startTime = Clock::now();
+        Utils::MappedFile source;
+        if (!source.Open(fileName)) {
+            // Empty or unreadable: there is nothing worth caching, and SceneFile says what is wrong.
+            return SceneFile::Load(fileName, entry, error, statistics ? &statistics->Parse : nullptr);
+        }
+        const uint64_t sourceHash = hashContent(source.GetData(), source.GetSize());
+        loadStatistics.HashTimeMs = millisecondsSince(startTime);
+
+        const std::string cachePath = GetCachePath(fileName);
+        const auto mapTime = Clock::now();
+        if (mapCache(cachePath, sourceHash, entry, loadStatistics.CacheSize)) {
+            loadStatistics.IsHit = true;
+            loadStatistics.MapTimeMs = millisecondsSince(mapTime);
+        } else {
+            std::vector<MaterialDescription> materials;
+            const std::string_view text(reinterpret_cast<const char*>(source.GetData()), source.GetSize());
+            if (!SceneFile::Parse(text, fileName, entry, error, &loadStatistics.Parse, &materials)) return false;
+            // Like meshes, textures would need their files in the key.
+            loadStatistics.IsWritten = loadStatistics.Parse.TextureCount == 0
+                && writeCache(cachePath, sourceHash, entry, materials, loadStatistics.CacheSize);
+        }
+        loadStatistics.TotalTimeMs = millisecondsSince(startTime);
+        if (statistics) {
+            *statistics = loadStatistics;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "SceneFile.h"
+
+// Binary cache of a loaded scene file, written next to it as <name>.dzc. It holds the scene's sphere and
+// triangle arrays and its BVH exactly as they are laid out in memory, at offsets from the start of the
+// file, so loading maps the file and points the scene at it: nothing is parsed, copied or rebuilt. Only
+// the few materials are recreated.
+//
+// The cache is keyed by a hash of the scene file's content; a cache for other content, another format
+// version or another memory layout is ignored and replaced. Like checkpoints, caches are meant for the
+// kind of machine that wrote them. Scenes with mesh statements or textures are always parsed, and their
+// mesh and image files loaded, since the key doesn't cover those files.
+namespace SceneCache
+{
+    struct Statistics
+    {
+        // The parse, when the cache was missing or stale.
+        SceneFile::LoadStatistics Parse;
+        bool IsHit = false;
+        bool IsWritten = false;
+        uint64_t CacheSize = 0;
+        // Mapping and hashing the scene file.
+        double HashTimeMs = 0.0;
+        // Mapping and checking the cache, on a hit.
+        double MapTimeMs = 0.0;
+        // Everything from opening the scene file to a committed scene.
+        double TotalTimeMs = 0.0;
+    };
+
+    std::string GetCachePath(const std::string& sceneFileName);
+
+    // SceneFile::Load() through the cache: uses the cache if it matches the file, else parses the file and
+    // writes a new cache. Failing to write one isn't an error, the next load just parses again.
+    bool Load(const std::string& fileName, SceneLibrary::Entry& entry, std::string& error,
+        Statistics* statistics = nullptr);
+}
@@ -0,0 +1,641 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include "CompressedMesh.h"
+#include "MeshImporter.h"
+#include "PagedMesh.h"
+
+#include "math/Geometry.h"
+#include "render/Material.h"
+#include "render/Texture.h"
+#include "utils/Profiler.h"
+
+namespace SceneFile
+{
+    namespace
+    {
+        // Chunks end at the first line break after this many bytes.
+        constexpr size_t ChunkSize = 1u << 20;
+
+        using Clock = std::chrono::steady_clock;
+
+        double millisecondsSince(const Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Primitives refer to materials by the chunk-local id of the name; Load() maps those ids to scene
+        // material indices once every chunk is parsed.
+        struct SphereRecord
+        {
+            glm::vec3 Center;
+            float Radius;
+            uint32_t Material;
+        };
+
+        struct TriangleRecord
+        {
+            glm::vec3 A, B, C;
+            uint32_t Material;
+        };
+
+        struct BoxRecord
+        {
+            glm::mat4 Transform;
+            uint32_t Material;
+        };
+
+        struct FaceRecord
+        {
+            uint32_t Vertices[3];
+            uint32_t Material;
+            size_t Offset;
+        };
+
+        struct MeshRecord
+        {
+            std::string_view Path;
+            glm::vec3 Position{0.0f};
+            float Scale = 1.0f;
+            float Yaw = 0.0f;
+            uint32_t Material;
+            size_t Offset;
+        };
+
+        struct MaterialRecord
+        {
+            std::string_view Name;
+            MaterialDescription Description;
+            // Image file relative to the scene file, or empty.
+            std::string_view Texture;
+            size_t Offset;
+        };
+
+        struct CameraRecord
+        {
+            glm::vec3 Position;
+            glm::vec3 Direction;
+            std::optional<float> VerticalFOV;
+        };
+
+        struct Chunk
+        {
+            size_t Begin = 0;
+            size_t End = 0;
+
+            std::vector<SphereRecord> Spheres;
+            std::vector<TriangleRecord> Triangles;
+            std::vector<BoxRecord> Boxes;
+            std::vector<FaceRecord> Faces;
+            std::vector<glm::vec3> Vertices;
+            std::vector<MeshRecord> Meshes;
+            std::vector<MaterialRecord> Materials;
+
+            // Material names used in the chunk, by local id, with the first place each is used.
+            std::vector<std::string_view> References;
+            std::vector<size_t> ReferenceOffsets;
+            std::unordered_map<std::string_view, uint32_t> ReferenceIds;
+            // Scene material index of every local id, filled in by Load().
+            std::vector<uint32_t> MaterialIndices;
+
+            // Settings found in the chunk; later statements win, also across chunks.
+            std::optional<CameraRecord> Camera;
+            std::optional<std::pair<uint32_t, uint32_t>> Size;
+            std::optional<int> SamplesPerPixel;
+            std::optional<int> RayBounces;
+            std::optional<int> Frames;
+            std::optional<uint32_t> CompressionBits;
+            std::optional<uint32_t> StreamingBudgetMb;
+
+            std::string Error;
+            size_t ErrorOffset = 0;
+
+            // Triangles this chunk adds to the scene, faces and boxes included.
+            [[nodiscard]] size_t GetTriangleCount() const {
+                return Triangles.size() + 12 * Boxes.size() + Faces.size();
+            }
+
+            uint32_t Reference(const std::string_view name, const size_t offset) {
+                const auto [it, isNew] = ReferenceIds.try_emplace(name, static_cast<uint32_t>(References.size()));
+                if (isNew) {
+                    References.push_back(name);
+                    ReferenceOffsets.push_back(offset);
+                }
+                return it->second;
+            }
+
+            void Fail(const size_t offset, std::string message) {
+                if (Error.empty()) {
+                    Error = std::move(message);
+                    ErrorOffset = offset;
+                }
+            }
+        };
+
+        // Whitespace separated tokens of one line.
+        class LineParser {
+        public:
+            LineParser(const char* begin, const char* end) : m_Position(begin), m_End(end) {}
+
+            bool Word(std::string_view& word) {
+                skipSpace();
+                const char* start = m_Position;
+                while (m_Position < m_End && !isSpace(*m_Position)) {
+                    m_Position++;
+                }
+                word = std::string_view(start, m_Position - start);
+                return !word.empty();
+            }
+
+            bool Float(float& value) {
+                skipSpace();
+                // from_chars doesn't take the leading '+' some exporters write.
+                if (m_Position < m_End && *m_Position == '+') m_Position++;
+                const auto [end, error] = std::from_chars(m_Position, m_End, value);
+                if (error != std::errc() || (end < m_End && !isSpace(*end))) return false;
+                m_Position = end;
+                return true;
+            }
+
+            bool Vector(glm::vec3& value) {
+                return Float(value.x) && Float(value.y) && Float(value.z);
+            }
+
+            template<typename T>
+            bool Integer(T& value, const T minValue) {
+                skipSpace();
+                const auto [end, error] = std::from_chars(m_Position, m_End, value);
+                if (error != std::errc() || (end < m_End && !isSpace(*end)) || value < minValue) return false;
+                m_Position = end;
+                return true;
+            }
+
+            bool IsAtEnd() {
+                skipSpace();
+                return m_Position == m_End;
+            }
+
+        private:
+            static bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+            void skipSpace() {
+                while (m_Position < m_End && isSpace(*m_Position)) {
+                    m_Position++;
+                }
+            }
+
+            const char* m_Position;
+            const char* m_End;
+        };
+
+        bool parseMaterial(const std::string_view type, LineParser& line, MaterialDescription& material,
+            std::string_view& texture)
+        {
+            using Kind = MaterialDescription::Kind;
+            if (type == "lambert") {
+                material.Type = Kind::Lambert;
+                return line.Vector(material.Color) && (line.IsAtEnd() || line.Word(texture));
+            }
+            if (type == "metal") {
+                material.Type = Kind::Metal;
+                return line.Vector(material.Color) && line.Float(material.Value)
+                    && (line.IsAtEnd() || line.Word(texture));
+            }
+            if (type == "light") {
+                material.Type = Kind::Light;
+                return line.Vector(material.Color) && line.Float(material.Value);
+            }
+            if (type == "dielectric") {
+                material.Type = Kind::Dielectric;
+                return line.Float(material.Value);
+            }
+            return false;
+        }
+
+        // Parses one statement into the chunk. Returns false for a malformed line.
+        bool parseLine(Chunk& chunk, LineParser& line, const size_t offset)
+        {
+            std::string_view keyword;
+            if (!line.Word(keyword)) return true;
+
+            std::string_view name;
+            if (keyword == "vertex") {
+                glm::vec3 position;
+                if (!line.Vector(position)) return false;
+                chunk.Vertices.push_back(position);
+            } else if (keyword == "face") {
+                FaceRecord face{.Offset = offset};
+                if (!line.Word(name) || !line.Integer(face.Vertices[0], 0u) || !line.Integer(face.Vertices[1], 0u)
+                    || !line.Integer(face.Vertices[2], 0u)) return false;
+                face.Material = chunk.Reference(name, offset);
+                chunk.Faces.push_back(face);
+            } else if (keyword == "triangle") {
+                TriangleRecord triangle{};
+                if (!line.Word(name) || !line.Vector(triangle.A) || !line.Vector(triangle.B) || !line.Vector(triangle.C)) {
+                    return false;
+                }
+                triangle.Material = chunk.Reference(name, offset);
+                chunk.Triangles.push_back(triangle);
+            } else if (keyword == "sphere") {
+                SphereRecord sphere{};
+                if (!line.Word(name) || !line.Vector(sphere.Center) || !line.Float(sphere.Radius)
+                    || !(sphere.Radius > 0.0f)) return false;
+                sphere.Material = chunk.Reference(name, offset);
+                chunk.Spheres.push_back(sphere);
+            } else if (keyword == "box") {
+                glm::vec3 center, size;
+                float yaw = 0.0f;
+                if (!line.Word(name) || !line.Vector(center) || !line.Vector(size)
+                    || (!line.IsAtEnd() && !line.Float(yaw))) return false;
+                const glm::mat4 transform = glm::translate(glm::mat4(1.0f), center)
+                    * glm::rotate(glm::mat4(1.0f), glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f))
+                    * glm::scale(glm::mat4(1.0f), size);
+                chunk.Boxes.push_back({transform, chunk.Reference(name, offset)});
+            } else if (keyword == "mesh") {
+                MeshRecord mesh{.Offset = offset};
+                if (!line.Word(name) || !line.Word(mesh.Path)) return false;
+                if (!line.IsAtEnd() && (!line.Vector(mesh.Position)
+                    || (!line.IsAtEnd() && (!line.Float(mesh.Scale) || !(mesh.Scale > 0.0f)
+                    || (!line.IsAtEnd() && !line.Float(mesh.Yaw)))))) return false;
+                mesh.Material = chunk.Reference(name, offset);
+                chunk.Meshes.push_back(mesh);
+            } else if (keyword == "material") {
+                std::string_view type;
+                MaterialRecord material{.Offset = offset};
+                if (!line.Word(name) || !line.Word(type)
+                    || !parseMaterial(type, line, material.Description, material.Texture)) return false;
+                material.Name = name;
+                chunk.Materials.push_back(material);
+            } else if (keyword == "camera") {
+                CameraRecord camera{};
+                float fov = 0.0f;
+                if (!line.Vector(camera.Position) || !line.Vector(camera.Direction)) return false;
+                if (!line.IsAtEnd()) {
+                    if (!line.Float(fov) || !(fov > 0.0f && fov < 180.0f)) return false;
+                    camera.VerticalFOV = fov;
+                }
+                chunk.Camera = camera;
+            } else if (keyword == "size") {
+                uint32_t width = 0, height = 0;
+                if (!line.Integer(width, 1u) || !line.Integer(height, 1u)) return false;
+                chunk.Size = {width, height};
+            } else if (keyword == "samples") {
+                if (!line.Integer(chunk.SamplesPerPixel.emplace(), 1)) return false;
+            } else if (keyword == "bounces") {
+                if (!line.Integer(chunk.RayBounces.emplace(), 1)) return false;
+            } else if (keyword == "frames") {
+                if (!line.Integer(chunk.Frames.emplace(), 1)) return false;
+            } else if (keyword == "compress") {
+                uint32_t& bits = chunk.CompressionBits.emplace();
+                if (!line.Integer(bits, 8u) || (bits != 8 && bits != 16)) return false;
+            } else if (keyword == "stream") {
+                if (!line.Integer(chunk.StreamingBudgetMb.emplace(), 1u)) return false;
+            } else {
+                chunk.Fail(offset, "unknown statement '" + std::string(keyword) + "'");
+                return true;
+            }
+            return line.IsAtEnd();
+        }
+
+        void parseChunk(const std::string_view text, Chunk& chunk)
+        {
+            DAZHBOG_PROFILE_ZONE("ParseSceneChunk");
+            const char* data = text.data();
+            size_t lineBegin = chunk.Begin;
+            while (lineBegin < chunk.End && chunk.Error.empty()) {
+                const char* lineEnd = static_cast<const char*>(
+                    std::memchr(data + lineBegin, '\n', chunk.End - lineBegin));
+                if (!lineEnd) lineEnd = data + chunk.End;
+                const char* comment = static_cast<const char*>(std::memchr(data + lineBegin, '#',
+                    lineEnd - (data + lineBegin)));
+                LineParser line(data + lineBegin, comment ? comment : lineEnd);
+                if (!parseLine(chunk, line, lineBegin)) {
+                    chunk.Fail(lineBegin, "malformed statement");
+                }
+                lineBegin = lineEnd - data + 1;
+            }
+        }
+
+        std::vector<Chunk> splitIntoChunks(const std::string_view text)
+        {
+            std::vector<Chunk> chunks;
+            size_t begin = 0;
+            while (begin < text.size()) {
+                size_t end = std::min(begin + ChunkSize, text.size());
+                if (const void* lineBreak = std::memchr(text.data() + end - 1, '\n', text.size() - end + 1)) {
+                    end = static_cast<const char*>(lineBreak) - text.data() + 1;
+                } else {
+                    end = text.size();
+                }
+                chunks.emplace_back().Begin = begin;
+                chunks.back().End = end;
+                begin = end;
+            }
+            return chunks;
+        }
+
+        bool readFile(const std::string& fileName, std::string& text)
+        {
+            FILE* file = std::fopen(fileName.c_str(), "rb");
+            if (!file) return false;
+            bool isRead = std::fseek(file, 0, SEEK_END) == 0;
+            const long size = isRead ? std::ftell(file) : -1;
+            isRead = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+            if (isRead) {
+                text.resize(static_cast<size_t>(size));
+                isRead = std::fread(text.data(), 1, text.size(), file) == text.size();
+            }
+            std::fclose(file);
+            return isRead;
+        }
+
+        std::string describeError(const std::string& fileName, const std::string_view text, const size_t offset,
+            const std::string& message)
+        {
+            const auto line = 1 + std::count(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(offset), '\n');
+            return fileName + ":" + std::to_string(line) + ": " + message;
+        }
+
+        // Gives every material a scene index in file order and maps each chunk's references to them. Loads
+        // the textures, relative to the scene file, once each however many materials use them.
+        bool resolveMaterials(::Scene& scene, std::vector<Chunk>& chunks, const std::string& fileName,
+            std::vector<MaterialDescription>& materials, std::unordered_map<std::string_view, uint32_t>& indices,
+            LoadStatistics& statistics, size_t& errorOffset, std::string& error)
+        {
+            std::unordered_map<std::string_view, std::shared_ptr<const Texture>> textures;
+            for (Chunk& chunk : chunks) {
+                for (MaterialRecord& material : chunk.Materials) {
+                    if (indices.contains(material.Name)) {
+                        errorOffset = material.Offset;
+                        error = "material '" + std::string(material.Name) + "' is defined twice";
+                        return false;
+                    }
+                    std::shared_ptr<const Texture> texture;
+                    if (!material.Texture.empty()) {
+                        auto [it, isNew] = textures.try_emplace(material.Texture);
+                        if (isNew) {
+                            const auto startTime = Clock::now();
+                            const std::filesystem::path path = std::filesystem::path(fileName).parent_path() / material.Texture;
+                            it->second = Texture::Load(path.string(), error);
+                            if (!it->second) {
+                                errorOffset = material.Offset;
+                                return false;
+                            }
+                            statistics.TextureCount++;
+                            statistics.TextureLoadTimeMs += millisecondsSince(startTime);
+                        }
+                        texture = it->second;
+                    }
+                    indices.emplace(material.Name, scene.Add(CreateMaterial(material.Description, texture).release()));
+                    materials.push_back(material.Description);
+                }
+            }
+            for (Chunk& chunk : chunks) {
+                chunk.MaterialIndices.resize(chunk.References.size());
+                for (size_t id = 0; id < chunk.References.size(); id++) {
+                    const auto it = indices.find(chunk.References[id]);
+                    if (it == indices.end()) {
+                        errorOffset = chunk.ReferenceOffsets[id];
+                        error = "unknown material '" + std::string(chunk.References[id]) + "'";
+                        return false;
+                    }
+                    chunk.MaterialIndices[id] = it->second;
+                }
+            }
+            return true;
+        }
+
+        // Imports the mesh file, relative to the scene file, and places it; streams it through pageCache
+        // instead if that isn't null. OBJ materials named like scene materials use them; the others get the
+        // material of the statement.
+        std::unique_ptr<Hittable> loadMesh(const MeshRecord& record, const uint32_t material, const std::string& fileName,
+            const std::unordered_map<std::string_view, uint32_t>& materials, const MeshCompression* compression,
+            const std::shared_ptr<MeshPageCache>& pageCache, std::string& error, MeshImporter::Statistics& statistics,
+            size_t& memoryUsage)
+        {
+            const std::filesystem::path path = std::filesystem::path(fileName).parent_path() / record.Path;
+            MeshData data;
+            const auto resolveMaterial = [&](const std::string_view name) {
+                const auto it = materials.find(name);
+                return it == materials.end() ? material : it->second;
+            };
+            if (pageCache) {
+                PagedMesh::LoadStatistics pagedStatistics;
+                auto mesh = PagedMesh::Load(path.string(), material, resolveMaterial, pageCache, error, &pagedStatistics);
+                if (!mesh) return nullptr;
+                mesh->SetPlacement(record.Position, record.Scale, record.Yaw);
+                statistics = pagedStatistics.Import;
+                memoryUsage = mesh->GetMemoryUsage();
+                return mesh;
+            }
+            if (!MeshImporter::Load(path.string(), data, error, resolveMaterial, &statistics)) return nullptr;
+
+            const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(record.Yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+            const glm::mat4 transform = glm::translate(glm::mat4(1.0f), record.Position) * rotation
+                * glm::scale(glm::mat4(1.0f), glm::vec3(record.Scale));
+            tbb::parallel_for<size_t>(0, data.Positions.size(), [&](const size_t i) {
+                data.Positions[i] = glm::vec3(transform * glm::vec4(data.Positions[i], 1.0f));
+            });
+            // The scale is uniform, so normals only turn.
+            tbb::parallel_for<size_t>(0, data.Normals.size(), [&](const size_t i) {
+                data.Normals[i] = glm::vec3(rotation * glm::vec4(data.Normals[i], 0.0f));
+            });
+            return CreateMesh(std::move(data), material, compression, memoryUsage);
+        }
+
+        void applySettings(const Chunk& chunk, SceneLibrary::Entry& entry)
+        {
+            if (chunk.Camera) {
+                entry.CameraPosition = chunk.Camera->Position;
+                entry.CameraDirection = chunk.Camera->Direction;
+                entry.VerticalFOV = chunk.Camera->VerticalFOV.value_or(entry.VerticalFOV);
+            }
+            if (chunk.Size) {
+                entry.Width = chunk.Size->first;
+                entry.Height = chunk.Size->second;
+            }
+            entry.SamplesPerPixel = chunk.SamplesPerPixel.value_or(entry.SamplesPerPixel);
+            entry.RayBounces = chunk.RayBounces.value_or(entry.RayBounces);
+            entry.Frames = chunk.Frames.value_or(entry.Frames);
+        }
+    }
+
+    std::unique_ptr<Material> CreateMaterial(const MaterialDescription& description,
+        std::shared_ptr<const Texture> albedoTexture)
+    {
+        switch (description.Type) {
+            case MaterialDescription::Kind::Lambert:
+                return std::make_unique<LambertMaterial>(description.Color, std::move(albedoTexture));
+            case MaterialDescription::Kind::Metal:
+                return std::make_unique<MetalMaterial>(description.Color, description.Value, std::move(albedoTexture));
+            case MaterialDescription::Kind::Light:
+                return std::make_unique<DiffuseLightMaterial>(description.Color, description.Value);
+            case MaterialDescription::Kind::Dielectric:
+                return std::make_unique<DielectricMaterial>(description.Value);
+        }
+        return nullptr;
+    }
+
+    bool IsSceneFile(const std::string& name)
+    {
+        constexpr std::string_view Extension = ".dzs";
+        return name.size() > Extension.size() && name.ends_with(Extension);
+    }
+
+    bool Load(const std::string& fileName, SceneLibrary::Entry& entry, std::string& error, LoadStatistics* statistics)
+    {
+        const auto startTime = Clock::now();
+        std::string text;
+        if (!readFile(fileName, text)) {
+            error = "Can't read " + fileName;
+            return false;
+        }
+        const double readTimeMs = millisecondsSince(startTime);
+        if (!Parse(text, fileName, entry, error, statistics)) return false;
+        if (statistics) {
+            statistics->ReadTimeMs = readTimeMs;
+        }
+        return true;
+    }
+
+    bool Parse(const std::string_view text, const std::string& fileName, SceneLibrary::Entry& entry,
+        std::string& error, LoadStatistics* statistics, std::vector<MaterialDescription>* materials)
+    {
+        DAZHBOG_PROFILE_ZONE("ParseSceneFile");
+        LoadStatistics loadStatistics;
+        loadStatistics.FileSize = text.size();
+        auto startTime = Clock::now();
+        std::vector<Chunk> chunks = splitIntoChunks(text);
+        tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+            parseChunk(text, chunks[i]);
+        });
+        for (const Chunk& chunk : chunks) {
+            if (!chunk.Error.empty()) {
+                error = describeError(fileName, text, chunk.ErrorOffset, chunk.Error);
+                return false;
+            }
+        }
+
+        auto scene = std::make_unique<::Scene>();
+        std::vector<MaterialDescription> materialDescriptions;
+        std::unordered_map<std::string_view, uint32_t> materialIndices;
+        size_t errorOffset = 0;
+        if (!resolveMaterials(*scene, chunks, fileName, materialDescriptions, materialIndices, loadStatistics,
+                errorOffset, error)) {
+            error = describeError(fileName, text, errorOffset, error);
+            return false;
+        }
+
+        // Where each chunk's primitives start in the scene arrays, in file order.
+        std::vector<size_t> sphereOffsets(chunks.size() + 1, 0);
+        std::vector<size_t> triangleOffsets(chunks.size() + 1, 0);
+        std::vector<size_t> vertexOffsets(chunks.size() + 1, 0);
+        for (size_t i = 0; i < chunks.size(); i++) {
+            sphereOffsets[i + 1] = sphereOffsets[i] + chunks[i].Spheres.size();
+            triangleOffsets[i + 1] = triangleOffsets[i] + chunks[i].GetTriangleCount();
+            vertexOffsets[i + 1] = vertexOffsets[i] + chunks[i].Vertices.size();
+        }
+        std::vector<glm::vec3> vertices(vertexOffsets.back());
+        tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+            std::ranges::copy(chunks[i].Vertices, vertices.begin() + static_cast<std::ptrdiff_t>(vertexOffsets[i]));
+        });
+
+        std::vector<Sphere> spheres(sphereOffsets.back());
+        std::vector<Triangle> triangles(triangleOffsets.back());
+        tbb::parallel_for<size_t>(0, chunks.size(), [&](const size_t i) {
+            Chunk& chunk = chunks[i];
+            Sphere* sphere = spheres.data() + sphereOffsets[i];
+            for (const SphereRecord& record : chunk.Spheres) {
+                *sphere++ = Sphere(record.Radius, chunk.MaterialIndices[record.Material], record.Center);
+            }
+            Triangle* triangle = triangles.data() + triangleOffsets[i];
+            for (const TriangleRecord& record : chunk.Triangles) {
+                *triangle++ = Triangle(record.A, record.B, record.C, chunk.MaterialIndices[record.Material]);
+            }
+            for (const BoxRecord& record : chunk.Boxes) {
+                triangle = std::ranges::copy(Cube::MakeTriangles(record.Transform,
+                    chunk.MaterialIndices[record.Material]), triangle).out;
+            }
+            for (const FaceRecord& face : chunk.Faces) {
+                if (std::ranges::any_of(face.Vertices, [&](const uint32_t v) { return v >= vertices.size(); })) {
+                    chunk.Fail(face.Offset, "vertex index out of range, the file has "
+                        + std::to_string(vertices.size()) + " vertices");
+                    return;
+                }
+                *triangle++ = Triangle(vertices[face.Vertices[0]], vertices[face.Vertices[1]],
+                    vertices[face.Vertices[2]], chunk.MaterialIndices[face.Material]);
+            }
+        });
+        for (const Chunk& chunk : chunks) {
+            if (!chunk.Error.empty()) {
+                error = describeError(fileName, text, chunk.ErrorOffset, chunk.Error);
+                return false;
+            }
+        }
+        scene->AddSpheres(std::move(spheres));
+        scene->AddTriangles(std::move(triangles));
+        loadStatistics.ParseTimeMs = millisecondsSince(startTime);
+
+        // Each import already runs on all cores, so meshes are loaded one after another.
+        std::optional<MeshCompression> compression;
+        std::shared_ptr<MeshPageCache> pageCache;
+        for (const Chunk& chunk : chunks) {
+            if (chunk.CompressionBits) {
+                compression.emplace().BoundsBits = *chunk.CompressionBits;
+            }
+            if (chunk.StreamingBudgetMb) {
+                pageCache = std::make_shared<MeshPageCache>(static_cast<uint64_t>(*chunk.StreamingBudgetMb) << 20);
+            }
+        }
+        for (const Chunk& chunk : chunks) {
+            for (const MeshRecord& record : chunk.Meshes) {
+                MeshImporter::Statistics meshStatistics;
+                size_t memoryUsage = 0;
+                startTime = Clock::now();
+                std::unique_ptr<Hittable> mesh = loadMesh(record, chunk.MaterialIndices[record.Material], fileName,
+                    materialIndices, compression ? &*compression : nullptr, pageCache, error, meshStatistics, memoryUsage);
+                if (!mesh) {
+                    error = describeError(fileName, text, record.Offset, error);
+                    return false;
+                }
+                loadStatistics.MeshTriangleCount += meshStatistics.TriangleCount;
+                loadStatistics.MeshMemoryUsage += memoryUsage;
+                loadStatistics.MeshImportTimeMs += meshStatistics.ParseTimeMs;
+                loadStatistics.BuildTimeMs += millisecondsSince(startTime) - meshStatistics.ParseTimeMs;
+                scene->Add(mesh.release());
+            }
+        }
+        loadStatistics.PrimitiveCount = scene->GetPrimitiveCount();
+
+        startTime = Clock::now();
+        scene->Commit();
+        loadStatistics.BuildTimeMs += millisecondsSince(startTime);
+
+        entry = {};
+        entry.Scene = std::move(scene);
+        entry.MeshPages = std::move(pageCache);
+        for (const Chunk& chunk : chunks) {
+            applySettings(chunk, entry);
+        }
+        if (statistics) {
+            *statistics = loadStatistics;
+        }
+        if (materials) {
+            *materials = std::move(materialDescriptions);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SceneLibrary.h"
+#include "render/Material.h"
+
+// Text scene descriptions (.dzs), one statement per line, '#' starts a comment:
+//
+//   camera 0 1 3.4  0 0 -1  [fov]        position, view direction, vertical field of view in degrees
+//   size 1280 720                         render settings; the command line overrides them
+//   samples 16
+//   bounces 5
+//   frames 50
+//   compress 8                            store meshes compressed, with 8 or 16-bit BVH bounds
+//   stream 4096                           stream meshes from page files, at most 4096 MB resident
+//   material white lambert 0.73 0.73 0.73  [texture]
+//   material steel metal 0.8 0.8 0.8 0.1  [texture]
+//                                         albedo, fuzziness; an image file relative to this one tints
+//                                         the albedo where meshes have texture coordinates
+//   material lamp light 1 0.85 0.6 15     color, power
+//   material glass dielectric 1.5         refraction index
+//   sphere glass -0.4 0.35 -0.2 0.35      center, radius
+//   triangle white  ax ay az  bx by bz  cx cy cz
+//   box steel 0 0.5 0  1 1 1  [yaw]       center, size, rotation around Y in degrees
+//   vertex x y z                          mesh vertices, numbered from 0 across the whole file
+//   face white 0 1 2                      triangle over three vertices
+//   mesh white bunny.ply  0 0 0  [scale [yaw]]
+//                                         OBJ or PLY file relative to this one, placed like a box
+//
+// Materials may be used before they are defined. The file is parsed in chunks on all cores straight
+// into the scene's flat sphere and triangle arrays, so large meshes don't allocate per primitive.
+// Mesh files are imported by MeshImporter and stay indexed; OBJ usemtl names that match a material
+// here use it, others get the mesh statement's material. With a compress statement anywhere in the
+// file, every mesh becomes a CompressedMesh; with a stream statement, a PagedMesh instead, all of them
+// sharing the entry's MeshPages budget. Textures are loaded as Texture objects, once per image file.
+namespace SceneFile
+{
+    struct LoadStatistics
+    {
+        uint64_t FileSize = 0;
+        uint64_t PrimitiveCount = 0;
+        double ReadTimeMs = 0.0;
+        double ParseTimeMs = 0.0;
+        // Triangles in meshes, which count as one primitive each.
+        uint64_t MeshTriangleCount = 0;
+        // Bytes of the meshes' vertex, index and BVH data.
+        uint64_t MeshMemoryUsage = 0;
+        double MeshImportTimeMs = 0.0;
+        // Building the BVH, see Scene::Commit(), and those of the meshes.
+        double BuildTimeMs = 0.0;
+        // Image files loaded for materials.
+        uint32_t TextureCount = 0;
+        double TextureLoadTimeMs = 0.0;
+    };
+
+    // The parameters of a material statement, kept so SceneCache can store materials and recreate them.
+    // Textures aren't part of it; scenes that use them aren't cached.
+    struct MaterialDescription
+    {
+        enum class Kind : uint32_t { Lambert, Metal, Light, Dielectric };
+
+        Kind Type = Kind::Lambert;
+        glm::vec3 Color{0.0f};
+        // Fuzziness, power or refraction index.
+        float Value = 0.0f;
+    };
+
+    std::unique_ptr<Material> CreateMaterial(const MaterialDescription& description,
+        std::shared_ptr<const Texture> albedoTexture = nullptr);
+
+    // True for names ending in .dzs, which SceneLibrary::Create() loads as files.
+    bool IsSceneFile(const std::string& name);
+
+    // Fills entry from the file and commits the scene. On failure returns false with a message naming
+    // the line at fault in error.
+    bool Load(const std::string& fileName, SceneLibrary::Entry& entry, std::string& error,
+        LoadStatistics* statistics = nullptr);
+
+    // Load() for a file already in memory; fileName only goes into error messages. Also returns the
+    // descriptions of the scene's materials after the default one in materials.
+    bool Parse(std::string_view text, const std::string& fileName, SceneLibrary::Entry& entry, std::string& error,
+        LoadStatistics* statistics = nullptr, std::vector<MaterialDescription>* materials = nullptr);
+}
@@ -0,0 +1,174 @@
+#include "SceneLibrary.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <glm/ext/matrix_transform.hpp>
+
+#include "SceneCache.h"
+
+#include "math/Geometry.h"
+#include "render/Material.h"
+
+namespace SceneLibrary
+{
+    namespace
+    {
+        Entry createDemo()
+        {
+            auto scene = std::make_unique<::Scene>();
+            const auto greenMat = scene->Add(new LambertMaterial({0.8, 0.8, 0.0}));
+            const auto blueMat = scene->Add(new LambertMaterial({0.1, 0.2, 0.5}));
+            const auto silverMat = scene->Add(new MetalMaterial({0.8, 0.8, 0.8}, 0.04));
+            const auto goldenMat = scene->Add(new MetalMaterial({0.8, 0.6, 0.2}, 0.0));
+            const auto lightMat = scene->Add(new DiffuseLightMaterial({1.0, 0.706, 0.422}, 20.0));
+            const auto glass = scene->Add(new DielectricMaterial(1.5f));
+
+            //Floor
+            scene->Add(Triangle(
+                {-1000.0f, 0.0f, 1000.0f},
+                {1000.0f, 0.0f, -1000.0f},
+                {-1000.0f, 0.0f, -1000.0f},
+                greenMat));
+            scene->Add(Triangle(
+                {-1000.0f, 0.0f, 1000.0f},
+                {1000.0f, 0.0f, 1000.0f},
+                {1000.0f, 0.0f, -1000.0f},
+                greenMat));
+
+            scene->Add(Sphere(2.0f, blueMat, glm::vec3(0.0f, 2.0f, 0.0f)));
+            scene->Add(Sphere(2.0f, glass, glm::vec3(-4.2f, 2.0f, 0.0f)));
+            scene->Add(Sphere(4.0f, lightMat, glm::vec3(0.0f, 40.0f, -10.0f)));
+
+            const glm::mat4 scale = glm::scale(glm::mat4(1.0), {10.0f, 10.0f, 10.0f});
+            constexpr glm::mat4 translateSilver = glm::translate(glm::mat4(1.0), {20.0f, 5.0f, 20.0f});
+            constexpr glm::mat4 translateGold = glm::translate(glm::mat4(1.0), {-20.0f, 5.0f, 20.0f});
+            scene->Add(new Cube(translateSilver * scale, silverMat));
+            scene->Add(new Cube(translateGold * scale, goldenMat));
+
+            return {
+                .Scene = std::move(scene),
+                .CameraPosition = {0.4, 2.0, 11},
+                .CameraDirection = {-0.4, 0.0, -11.0},
+            };
+        }
+
+        // Triangles are one-sided: a, b, c, d go counter-clockwise as seen from the front.
+        void addQuad(::Scene& scene, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d,
+            const uint32_t material)
+        {
+            scene.Add(Triangle(a, b, c, material));
+            scene.Add(Triangle(a, c, d, material));
+        }
+
+        // Small closed room lit by one area light: mostly indirect light, so it converges slowly.
+        Entry createCornellBox()
+        {
+            auto scene = std::make_unique<::Scene>();
+            const auto whiteMat = scene->Add(new LambertMaterial({0.73, 0.73, 0.73}));
+            const auto redMat = scene->Add(new LambertMaterial({0.65, 0.05, 0.05}));
+            const auto greenMat = scene->Add(new LambertMaterial({0.12, 0.45, 0.15}));
+            const auto lightMat = scene->Add(new DiffuseLightMaterial({1.0, 0.85, 0.6}, 15.0f));
+            const auto silverMat = scene->Add(new MetalMaterial({0.8, 0.8, 0.8}, 0.1));
+            const auto glass = scene->Add(new DielectricMaterial(1.5f));
+
+            addQuad(*scene, {-1, 0, 1}, {1, 0, 1}, {1, 0, -1}, {-1, 0, -1}, whiteMat);
+            addQuad(*scene, {-1, 2, -1}, {1, 2, -1}, {1, 2, 1}, {-1, 2, 1}, whiteMat);
+            addQuad(*scene, {-1, 0, -1}, {1, 0, -1}, {1, 2, -1}, {-1, 2, -1}, whiteMat);
+            addQuad(*scene, {-1, 0, 1}, {-1, 0, -1}, {-1, 2, -1}, {-1, 2, 1}, redMat);
+            addQuad(*scene, {1, 0, -1}, {1, 0, 1}, {1, 2, 1}, {1, 2, -1}, greenMat);
+            addQuad(*scene, {-0.3, 1.98, -0.3}, {0.3, 1.98, -0.3}, {0.3, 1.98, 0.3}, {-0.3, 1.98, 0.3}, lightMat);
+
+            scene->Add(Sphere(0.35f, glass, glm::vec3(-0.4f, 0.35f, -0.2f)));
+            scene->Add(Sphere(0.35f, silverMat, glm::vec3(0.45f, 0.35f, 0.3f)));
+
+            return {
+                .Scene = std::move(scene),
+                .CameraPosition = {0.0, 1.0, 3.4},
+                .CameraDirection = {0.0, 0.0, -1.0},
+            };
+        }
+    }
+
+    bool CreateFromMesh(const std::string& fileName, Entry& entry, std::string& error,
+        const MeshOptions& options, MeshStatistics* statistics)
+    {
+        auto scene = std::make_unique<::Scene>();
+        const auto greyMat = scene->Add(new LambertMaterial({0.7, 0.7, 0.7}));
+        MeshStatistics meshStatistics;
+        std::unique_ptr<Hittable> mesh;
+        std::shared_ptr<MeshPageCache> pageCache;
+        auto startTime = std::chrono::steady_clock::time_point();
+        if (options.StreamingBudget > 0) {
+            pageCache = std::make_shared<MeshPageCache>(options.StreamingBudget);
+            PagedMesh::LoadStatistics pagedStatistics;
+            auto pagedMesh = PagedMesh::Load(fileName, greyMat, {}, pageCache, error, &pagedStatistics);
+            if (!pagedMesh) return false;
+            meshStatistics.Import = pagedStatistics.Import;
+            meshStatistics.MemoryUsage = pagedMesh->GetMemoryUsage();
+            meshStatistics.PageFileSize = pagedStatistics.PageFileSize;
+            meshStatistics.IsPageFileWritten = pagedStatistics.IsPageFileWritten;
+            mesh = std::move(pagedMesh);
+            // Writing the page file counts as part of the load.
+            startTime = std::chrono::steady_clock::now();
+        } else {
+            MeshData data;
+            if (!MeshImporter::Load(fileName, data, error, {}, &meshStatistics.Import)) return false;
+            startTime = std::chrono::steady_clock::now();
+            size_t memoryUsage = 0;
+            mesh = CreateMesh(std::move(data), greyMat, options.Compression ? &*options.Compression : nullptr,
+                memoryUsage);
+            meshStatistics.MemoryUsage = memoryUsage;
+        }
+        const Aabb bounds = mesh->GetBounds();
+        scene->Add(mesh.release());
+        scene->Commit();
+        meshStatistics.BuildTimeMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startTime).count();
+        if (statistics) {
+            *statistics = meshStatistics;
+        }
+
+        // Far enough back that the bounding sphere fills the view vertically.
+        entry = {};
+        entry.MeshPages = std::move(pageCache);
+        const float radius = glm::length(bounds.GetExtent()) * 0.5f;
+        const float distance = radius / std::sin(glm::radians(entry.VerticalFOV) * 0.5f);
+        entry.Scene = std::move(scene);
+        entry.CameraPosition = bounds.GetCenter() + glm::vec3(0.0f, 0.0f, distance);
+        entry.CameraDirection = {0.0f, 0.0f, -1.0f};
+        return true;
+    }
+
+    Entry Create(const std::string& name, const MeshOptions& meshOptions)
+    {
+        if (SceneFile::IsSceneFile(name)) {
+            Entry entry;
+            if (std::string error; !SceneCache::Load(name, entry, error)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return {};
+            }
+            return entry;
+        }
+        if (MeshImporter::IsMeshFile(name)) {
+            Entry entry;
+            if (std::string error; !CreateFromMesh(name, entry, error, meshOptions)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return {};
+            }
+            return entry;
+        }
+        if (name == "demo") {
+            return createDemo();
+        }
+        if (name == "cornell") {
+            return createCornellBox();
+        }
+        return {};
+    }
+
+    std::vector<std::string> GetNames()
+    {
+        return { "demo", "cornell" };
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "CompressedMesh.h"
+#include "MeshImporter.h"
+#include "PagedMesh.h"
+#include "Scene.h"
+
+// Built-in scenes and scene files, shared by the GUI and the command-line renderer.
+namespace SceneLibrary
+{
+    struct Entry
+    {
+        std::unique_ptr<::Scene> Scene;
+        glm::vec3 CameraPosition{0.0f};
+        glm::vec3 CameraDirection{0.0f, 0.0f, -1.0f};
+        float VerticalFOV = 45.0f;
+        // Render settings the scene asks for; 0 leaves the choice to the caller.
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        int SamplesPerPixel = 0;
+        int RayBounces = 0;
+        int Frames = 0;
+        // Residency of the scene's streamed meshes; null when it has none.
+        std::shared_ptr<MeshPageCache> MeshPages{};
+    };
+
+    // How CreateFromMesh() keeps the mesh; the default is a plain Mesh.
+    struct MeshOptions
+    {
+        // Store it as a CompressedMesh.
+        std::optional<MeshCompression> Compression;
+        // Stream it as a PagedMesh with this many bytes resident at most; wins over Compression.
+        uint64_t StreamingBudget = 0;
+    };
+
+    // Loads names ending in .dzs through SceneCache and mesh files through CreateFromMesh() with
+    // meshOptions, printing what went wrong to stderr. Returns an entry without a scene if the name is
+    // unknown or the file can't be loaded.
+    Entry Create(const std::string& name, const MeshOptions& meshOptions = {});
+
+    struct MeshStatistics
+    {
+        MeshImporter::Statistics Import;
+        // Bytes of the mesh's vertex, index and BVH data; for a streamed mesh, what stays in memory.
+        uint64_t MemoryUsage = 0;
+        double BuildTimeMs = 0.0;
+        // Streamed meshes only: the page file, and whether it was written by this load.
+        uint64_t PageFileSize = 0;
+        bool IsPageFileWritten = false;
+    };
+
+    // A scene of just the OBJ or PLY file, in a grey diffuse material under the sky, with the camera
+    // looking at it from +z.
+    bool CreateFromMesh(const std::string& fileName, Entry& entry, std::string& error,
+        const MeshOptions& options = {}, MeshStatistics* statistics = nullptr);
+
+    std::vector<std::string> GetNames();
+}
@@ -12,6 +12,11 @@ void ImageCanvas::SetImage(const QImage &img) {
     update();
 }
 
+void ImageCanvas::SetOverlay(const QImage &overlay) {
+    m_Overlay = overlay;
+    update();
+}
+
 void ImageCanvas::paintEvent(QPaintEvent *paint_event) {
     QPainter p(this);
     p.fillRect(rect(), Qt::black);
@@ -25,4 +30,8 @@ void ImageCanvas::paintEvent(QPaintEvent *paint_event) {
     );
     p.setRenderHint(QPainter::SmoothPixmapTransform, true);
     p.drawImage(QRect(topLeft, targetSize), m_Image);
+    if (!m_Overlay.isNull()) {
+        p.setOpacity(0.6);
+        p.drawImage(QRect(topLeft, targetSize), m_Overlay);
+    }
 }
@@ -8,8 +8,11 @@ class ImageCanvas final : public QWidget {
 public:
     explicit ImageCanvas(QWidget* parent = nullptr);
     void SetImage(const QImage& img);
+    // Drawn semi-transparently over the image; a null image removes it.
+    void SetOverlay(const QImage& overlay);
 protected:
     void paintEvent(QPaintEvent*) override;
 private:
     QImage m_Image;
+    QImage m_Overlay;
 };
@@ -1,5 +1,7 @@
 #include "MainWindow.h"
 
+#include <algorithm>
+
 #include <qelapsedtimer.h>
 #include <QSplitter>
 #include <QLabel>
@@ -11,6 +13,8 @@
 #include <QTimer>
 #include <QResizeEvent>
 
+#include "utils/Profiler.h"
+
 
 MainWindow::MainWindow(const ResizeHandler &resizeHandler, QWidget* parent) : QMainWindow(parent), m_ResizeHandler(resizeHandler) {
     setupUi();
@@ -27,6 +31,14 @@ void MainWindow::UpdateRenderTime(const int64_t frameRenderTime, const int64_t s
     m_SceneRenderTimeLabel->setText(QString("Scene Render Time: %1 ms").arg(sceneRenderTime));
 }
 
+void MainWindow::UpdateRayStatistics(const Renderer::RenderStatistics& statistics, const int64_t frameRenderTime) {
+    const double seconds = static_cast<double>(std::max<int64_t>(frameRenderTime, 1)) / 1000.0;
+    m_RayRateLabel->setText(QString("Rays: %1 M/s")
+        .arg(static_cast<double>(statistics.GetRays()) / seconds / 1e6, 0, 'f', 2));
+    m_TestsPerRayLabel->setText(QString("Tests per Ray: %1").arg(statistics.GetTestsPerRay(), 0, 'f', 1));
+    m_PathLengthLabel->setText(QString("Average Path Length: %1").arg(statistics.GetAveragePathLength(), 0, 'f', 2));
+}
+
 void MainWindow::UpdateFrame(const uint32_t frameNo) {
     m_FrameLabel->setText(QString("Current Frame: %1").arg(frameNo));
 }
@@ -42,11 +54,18 @@ void MainWindow::UpdateCameraLocation(const glm::vec3& position, const glm::vec3
         .arg(direction.z, 6, 'f', 2));
 }
 
-void MainWindow::ShowImage(const uint32_t *pixels) const {
-    const auto width = m_Canvas->width();
-    const auto height = m_Canvas->height();
-    const QImage img(reinterpret_cast<const uchar*>(pixels), width, height,
-                     width * 4, QImage::Format_RGBA8888);
+void MainWindow::ShowImage(const uint32_t *pixels, const uint32_t width, const uint32_t height,
+    const uint32_t *overlay) const {
+    DAZHBOG_PROFILE_ZONE("ShowImage");
+    const QImage img(reinterpret_cast<const uchar*>(pixels), static_cast<int>(width), static_cast<int>(height),
+                     static_cast<int>(width) * 4, QImage::Format_RGBA8888);
+    if (overlay) {
+        const QImage overlayImg(reinterpret_cast<const uchar*>(overlay), static_cast<int>(width),
+                                static_cast<int>(height), static_cast<int>(width) * 4, QImage::Format_RGBA8888);
+        m_Canvas->SetOverlay(overlayImg.flipped());
+    } else {
+        m_Canvas->SetOverlay({});
+    }
     m_Canvas->SetImage(img.flipped());
 }
 
@@ -104,6 +123,9 @@ void MainWindow::setupUi() {
     m_FrameLabel = new QLabel("Current Frame: -", rightPanel);
     m_FrameRenderTimeLabel = new QLabel("Frame Render time: –", rightPanel);
     m_SceneRenderTimeLabel = new QLabel("Scene Render time: –", rightPanel);
+    m_RayRateLabel = new QLabel("Rays: –", rightPanel);
+    m_TestsPerRayLabel = new QLabel("Tests per Ray: –", rightPanel);
+    m_PathLengthLabel = new QLabel("Average Path Length: –", rightPanel);
     m_CameraPositionLabel = new QLabel("Camera Position: –", rightPanel);
     m_CameraDirectionLabel = new QLabel("Camera Direction: –", rightPanel);
 
@@ -112,6 +134,9 @@ void MainWindow::setupUi() {
     rightLayout->addWidget(m_FrameLabel);
     rightLayout->addWidget(m_FrameRenderTimeLabel);
     rightLayout->addWidget(m_SceneRenderTimeLabel);
+    rightLayout->addWidget(m_RayRateLabel);
+    rightLayout->addWidget(m_TestsPerRayLabel);
+    rightLayout->addWidget(m_PathLengthLabel);
     rightLayout->addWidget(m_CameraPositionLabel);
     rightLayout->addWidget(m_CameraDirectionLabel);
     rightLayout->addStretch(1);
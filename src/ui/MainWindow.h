@@ -29,9 +29,12 @@ public:
 
     void UpdateRenderTime(int64_t frameRenderTime, int64_t sceneRenderTime);
 
+    void UpdateRayStatistics(const Renderer::RenderStatistics& statistics, int64_t frameRenderTime);
+
     void UpdateCameraLocation(const glm::vec3& position, const glm::vec3& direction);
 
-    void ShowImage(const uint32_t* pixels) const;
+    // overlay, if given, is an RGBA8 image of the same size drawn over the frame, e.g. the cost heatmap.
+    void ShowImage(const uint32_t* pixels, uint32_t width, uint32_t height, const uint32_t* overlay = nullptr) const;
 
     [[nodiscard]] glm::vec2 GetCanvasSize() const { return {m_Canvas->width(), m_Canvas->height()}; }
 
@@ -51,6 +54,9 @@ private:
     QLabel* m_FrameLabel = nullptr;
     QLabel* m_FrameRenderTimeLabel = nullptr;
     QLabel* m_SceneRenderTimeLabel = nullptr;
+    QLabel* m_RayRateLabel = nullptr;
+    QLabel* m_TestsPerRayLabel = nullptr;
+    QLabel* m_PathLengthLabel = nullptr;
     QLabel* m_CameraPositionLabel = nullptr;
     QLabel* m_CameraDirectionLabel = nullptr;
     ResizeHandler m_ResizeHandler;
@@ -45,6 +45,27 @@ RenderSettingsWidget::RenderSettingsWidget(QWidget *parent) : QWidget(parent) {
 
     QGroupBox *accumulationGroup = makeGroup(this, "Accumulation", accumLayout);
 
+    //
+    // --- Interactive group ---
+    //
+    m_dynamicResolutionCheck = new QCheckBox("Dynamic resolution", this);
+    m_dynamicResolutionCheck->setChecked(true);
+
+    m_targetFrameTimeSpin = new QSpinBox(this);
+    m_targetFrameTimeSpin->setRange(1, 1000);
+    m_targetFrameTimeSpin->setSuffix(" ms");
+    m_targetFrameTimeSpin->setValue(33);
+
+    m_temporalReprojectionCheck = new QCheckBox("Temporal reprojection", this);
+    m_temporalReprojectionCheck->setChecked(false);
+
+    auto *interactiveLayout = new QFormLayout();
+    interactiveLayout->addRow(m_dynamicResolutionCheck);
+    interactiveLayout->addRow("Target frame time", m_targetFrameTimeSpin);
+    interactiveLayout->addRow(m_temporalReprojectionCheck);
+
+    QGroupBox *interactiveGroup = makeGroup(this, "Interactive", interactiveLayout);
+
     //
     // --- Tone / Color group ---
     //
@@ -78,6 +99,43 @@ RenderSettingsWidget::RenderSettingsWidget(QWidget *parent) : QWidget(parent) {
 
     QGroupBox *toneGroup = makeGroup(this, "Color / Tone", toneLayout);
 
+    //
+    // --- Denoise group ---
+    //
+    m_denoiseCheck = new QCheckBox("Enable Denoiser", this);
+    m_denoiseCheck->setChecked(false);
+
+    m_denoiseIterationsSpin = new QSpinBox(this);
+    m_denoiseIterationsSpin->setRange(1, 8);
+    m_denoiseIterationsSpin->setValue(5);
+
+    m_denoiseColorSigmaSpin = new QDoubleSpinBox(this);
+    m_denoiseColorSigmaSpin->setRange(0.01, 10.0);
+    m_denoiseColorSigmaSpin->setSingleStep(0.05);
+    m_denoiseColorSigmaSpin->setDecimals(2);
+    m_denoiseColorSigmaSpin->setValue(0.5);
+
+    m_denoiseNormalSigmaSpin = new QDoubleSpinBox(this);
+    m_denoiseNormalSigmaSpin->setRange(0.01, 10.0);
+    m_denoiseNormalSigmaSpin->setSingleStep(0.05);
+    m_denoiseNormalSigmaSpin->setDecimals(2);
+    m_denoiseNormalSigmaSpin->setValue(0.1);
+
+    m_denoiseDepthSigmaSpin = new QDoubleSpinBox(this);
+    m_denoiseDepthSigmaSpin->setRange(0.01, 10.0);
+    m_denoiseDepthSigmaSpin->setSingleStep(0.05);
+    m_denoiseDepthSigmaSpin->setDecimals(2);
+    m_denoiseDepthSigmaSpin->setValue(0.1);
+
+    auto *denoiseLayout = new QFormLayout();
+    denoiseLayout->addRow(m_denoiseCheck);
+    denoiseLayout->addRow("Iterations", m_denoiseIterationsSpin);
+    denoiseLayout->addRow("Color sigma", m_denoiseColorSigmaSpin);
+    denoiseLayout->addRow("Normal sigma", m_denoiseNormalSigmaSpin);
+    denoiseLayout->addRow("Depth sigma", m_denoiseDepthSigmaSpin);
+
+    QGroupBox *denoiseGroup = makeGroup(this, "Denoise", denoiseLayout);
+
     //
     // --- Bloom group ---
     //
@@ -120,14 +178,32 @@ RenderSettingsWidget::RenderSettingsWidget(QWidget *parent) : QWidget(parent) {
 
     QGroupBox *bloomGroup = makeGroup(this, "Bloom", bloomLayout);
 
+    //
+    // --- Diagnostics group ---
+    //
+    m_costHeatmapCombo = new QComboBox(this);
+    m_costHeatmapCombo->addItem("Off", static_cast<int>(Renderer::CostChannel::None));
+    m_costHeatmapCombo->addItem("Traversal steps", static_cast<int>(Renderer::CostChannel::TraversalSteps));
+    m_costHeatmapCombo->addItem("Primitive tests", static_cast<int>(Renderer::CostChannel::PrimitiveTests));
+    m_costHeatmapCombo->addItem("Path depth", static_cast<int>(Renderer::CostChannel::PathDepth));
+    m_costHeatmapCombo->addItem("Time", static_cast<int>(Renderer::CostChannel::Time));
+
+    auto *diagnosticsLayout = new QFormLayout();
+    diagnosticsLayout->addRow("Cost heatmap", m_costHeatmapCombo);
+
+    QGroupBox *diagnosticsGroup = makeGroup(this, "Diagnostics", diagnosticsLayout);
+
     auto* mainLayout = new QVBoxLayout();
     mainLayout->setContentsMargins(0,0,0,0);
     mainLayout->setSpacing(8);
 
     mainLayout->addWidget(renderingGroup);
     mainLayout->addWidget(accumulationGroup);
+    mainLayout->addWidget(interactiveGroup);
     mainLayout->addWidget(toneGroup);
+    mainLayout->addWidget(denoiseGroup);
     mainLayout->addWidget(bloomGroup);
+    mainLayout->addWidget(diagnosticsGroup);
     mainLayout->addStretch(1);
 
     mainLayout->addStretch(1);
@@ -152,76 +228,118 @@ RenderSettingsWidget::RenderSettingsWidget(QWidget *parent) : QWidget(parent) {
     connectAll(m_accumulateCheck);
     connectAll(m_accumFramesSpin);
 
+    connectAll(m_dynamicResolutionCheck);
+    connectAll(m_targetFrameTimeSpin);
+    connectAll(m_temporalReprojectionCheck);
+
     connectAll(m_hdrCheck);
     connectAll(m_exposureSpin);
     connectAll(m_tonemapCheck);
     connectAll(m_gammaCheck);
     connectAll(m_gammaSpin);
 
+    connectAll(m_denoiseCheck);
+    connectAll(m_denoiseIterationsSpin);
+    connectAll(m_denoiseColorSigmaSpin);
+    connectAll(m_denoiseNormalSigmaSpin);
+    connectAll(m_denoiseDepthSigmaSpin);
+
     connectAll(m_bloomCheck);
     connectAll(m_bloomThresholdSpin);
     connectAll(m_bloomLevelsSpin);
     connectAll(m_bloomRadiusSpin);
     connectAll(m_bloomSigmaSpin);
     connectAll(m_bloomIntensitySpin);
+
+    connectAll(m_costHeatmapCombo);
 }
 
 void RenderSettingsWidget::SetSettings(const Renderer::Settings &s) {
     // Rendering
     m_renderModeCombo->setCurrentIndex(
-        (s.RenderMode == Renderer::RenderMode::HighPerformance) ? 0 : 1
+        (s.Integrator.RenderMode == Renderer::RenderMode::HighPerformance) ? 0 : 1
     );
-    m_rayBouncesSpin->setValue(s.RayBounces);
-    m_sppSpin->setValue(s.SamplesPerPixel);
+    m_rayBouncesSpin->setValue(s.Integrator.RayBounces);
+    m_sppSpin->setValue(s.Integrator.SamplesPerPixel);
 
     // Accumulation
     m_accumulateCheck->setChecked(s.Accumulate);
     m_accumFramesSpin->setValue(s.FramesToAccumulate);
 
+    // Interactive
+    m_dynamicResolutionCheck->setChecked(s.DynamicResolution);
+    m_targetFrameTimeSpin->setValue(s.TargetFrameTimeMs);
+    m_temporalReprojectionCheck->setChecked(s.TemporalReprojection);
+
     // Tone / Color
-    m_hdrCheck->setChecked(s.HDREnabled);
-    m_exposureSpin->setValue(s.Exposure);
-    m_tonemapCheck->setChecked(s.TonemapEnabled);
-    m_gammaCheck->setChecked(s.GammaCorrectionEnabled);
-    m_gammaSpin->setValue(s.Gamma);
+    m_hdrCheck->setChecked(s.Display.HDREnabled);
+    m_exposureSpin->setValue(s.Display.Exposure);
+    m_tonemapCheck->setChecked(s.Display.TonemapEnabled);
+    m_gammaCheck->setChecked(s.Display.GammaCorrectionEnabled);
+    m_gammaSpin->setValue(s.Display.Gamma);
+
+    // Denoise
+    m_denoiseCheck->setChecked(s.Display.Denoise.Enabled);
+    m_denoiseIterationsSpin->setValue(s.Display.Denoise.Iterations);
+    m_denoiseColorSigmaSpin->setValue(s.Display.Denoise.ColorSigma);
+    m_denoiseNormalSigmaSpin->setValue(s.Display.Denoise.NormalSigma);
+    m_denoiseDepthSigmaSpin->setValue(s.Display.Denoise.DepthSigma);
 
     // Bloom
-    m_bloomCheck->setChecked(s.BloomEnabled);
-    m_bloomThresholdSpin->setValue(s.BloomThreshold);
-    m_bloomLevelsSpin->setValue(s.BloomLevels);
-    m_bloomRadiusSpin->setValue(s.BloomRadius);
-    m_bloomSigmaSpin->setValue(s.BloomSigma);
-    m_bloomIntensitySpin->setValue(s.BloomIntensity);
+    m_bloomCheck->setChecked(s.Display.Bloom.Enabled);
+    m_bloomThresholdSpin->setValue(s.Display.Bloom.Threshold);
+    m_bloomLevelsSpin->setValue(s.Display.Bloom.Levels);
+    m_bloomRadiusSpin->setValue(s.Display.Bloom.Radius);
+    m_bloomSigmaSpin->setValue(s.Display.Bloom.Sigma);
+    m_bloomIntensitySpin->setValue(s.Display.Bloom.Intensity);
+
+    // Diagnostics
+    m_costHeatmapCombo->setCurrentIndex(m_costHeatmapCombo->findData(static_cast<int>(s.Display.CostHeatmap)));
 }
 
 Renderer::Settings RenderSettingsWidget::GetSettings() const {
     Renderer::Settings s;
 
     // Rendering
-    s.RenderMode = (m_renderModeCombo->currentIndex() == 0)
+    s.Integrator.RenderMode = (m_renderModeCombo->currentIndex() == 0)
                        ? Renderer::RenderMode::HighPerformance
                        : Renderer::RenderMode::HighQuality;
-    s.RayBounces = m_rayBouncesSpin->value();
-    s.SamplesPerPixel = m_sppSpin->value();
+    s.Integrator.RayBounces = m_rayBouncesSpin->value();
+    s.Integrator.SamplesPerPixel = m_sppSpin->value();
 
     // Accumulation
     s.Accumulate = m_accumulateCheck->isChecked();
     s.FramesToAccumulate = m_accumFramesSpin->value();
 
+    // Interactive
+    s.DynamicResolution = m_dynamicResolutionCheck->isChecked();
+    s.TargetFrameTimeMs = m_targetFrameTimeSpin->value();
+    s.TemporalReprojection = m_temporalReprojectionCheck->isChecked();
+
     // Tone / Color
-    s.HDREnabled = m_hdrCheck->isChecked();
-    s.Exposure = static_cast<float>(m_exposureSpin->value());
-    s.TonemapEnabled = m_tonemapCheck->isChecked();
-    s.GammaCorrectionEnabled = m_gammaCheck->isChecked();
-    s.Gamma = static_cast<float>(m_gammaSpin->value());
+    s.Display.HDREnabled = m_hdrCheck->isChecked();
+    s.Display.Exposure = static_cast<float>(m_exposureSpin->value());
+    s.Display.TonemapEnabled = m_tonemapCheck->isChecked();
+    s.Display.GammaCorrectionEnabled = m_gammaCheck->isChecked();
+    s.Display.Gamma = static_cast<float>(m_gammaSpin->value());
+
+    // Denoise
+    s.Display.Denoise.Enabled = m_denoiseCheck->isChecked();
+    s.Display.Denoise.Iterations = m_denoiseIterationsSpin->value();
+    s.Display.Denoise.ColorSigma = static_cast<float>(m_denoiseColorSigmaSpin->value());
+    s.Display.Denoise.NormalSigma = static_cast<float>(m_denoiseNormalSigmaSpin->value());
+    s.Display.Denoise.DepthSigma = static_cast<float>(m_denoiseDepthSigmaSpin->value());
 
     // Bloom
-    s.BloomEnabled = m_bloomCheck->isChecked();
-    s.BloomThreshold = static_cast<float>(m_bloomThresholdSpin->value());
-    s.BloomLevels = m_bloomLevelsSpin->value();
-    s.BloomRadius = m_bloomRadiusSpin->value();
-    s.BloomSigma = static_cast<float>(m_bloomSigmaSpin->value());
-    s.BloomIntensity = static_cast<float>(m_bloomIntensitySpin->value());
+    s.Display.Bloom.Enabled = m_bloomCheck->isChecked();
+    s.Display.Bloom.Threshold = static_cast<float>(m_bloomThresholdSpin->value());
+    s.Display.Bloom.Levels = m_bloomLevelsSpin->value();
+    s.Display.Bloom.Radius = m_bloomRadiusSpin->value();
+    s.Display.Bloom.Sigma = static_cast<float>(m_bloomSigmaSpin->value());
+    s.Display.Bloom.Intensity = static_cast<float>(m_bloomIntensitySpin->value());
+
+    // Diagnostics
+    s.Display.CostHeatmap = static_cast<Renderer::CostChannel>(m_costHeatmapCombo->currentData().toInt());
 
     return s;
 }
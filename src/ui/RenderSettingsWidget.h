@@ -38,6 +38,11 @@ private:
     QCheckBox*      m_accumulateCheck;
     QSpinBox*       m_accumFramesSpin;
 
+    // === Interactive ===
+    QCheckBox*      m_dynamicResolutionCheck;
+    QSpinBox*       m_targetFrameTimeSpin;
+    QCheckBox*      m_temporalReprojectionCheck;
+
     // === Tone / Color ===
     QCheckBox*      m_hdrCheck;
     QDoubleSpinBox* m_exposureSpin;
@@ -47,6 +52,13 @@ private:
     QCheckBox*      m_gammaCheck;
     QDoubleSpinBox* m_gammaSpin;
 
+    // === Denoise ===
+    QCheckBox*      m_denoiseCheck;
+    QSpinBox*       m_denoiseIterationsSpin;
+    QDoubleSpinBox* m_denoiseColorSigmaSpin;
+    QDoubleSpinBox* m_denoiseNormalSigmaSpin;
+    QDoubleSpinBox* m_denoiseDepthSigmaSpin;
+
     // === Bloom ===
     QCheckBox*      m_bloomCheck;
     QDoubleSpinBox* m_bloomThresholdSpin;
@@ -54,4 +66,7 @@ private:
     QSpinBox*       m_bloomRadiusSpin;
     QDoubleSpinBox* m_bloomSigmaSpin;
     QDoubleSpinBox* m_bloomIntensitySpin;
+
+    // === Diagnostics ===
+    QComboBox*      m_costHeatmapCombo;
 };
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <atomic>
+
+namespace Utils
+{
+    // Flag shared between the thread that requests cancellation and the workers that poll it.
+    // Polling is a relaxed load, cheap enough to do once per tile row.
+    class CancellationToken
+    {
+    public:
+        void Cancel() { m_IsCancelled.store(true, std::memory_order_relaxed); }
+
+        void Reset() { m_IsCancelled.store(false, std::memory_order_relaxed); }
+
+        [[nodiscard]] bool IsCancelled() const { return m_IsCancelled.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> m_IsCancelled = false;
+    };
+}
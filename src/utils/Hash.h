@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace Utils
+{
+    // 64-bit FNV-1a over the bytes of the values added. Used to tell whether saved state, such as a
+    // checkpoint, still belongs to the scene and settings it was made for; not for security.
+    class Fnv1a
+    {
+    public:
+        void AddBytes(const void* data, const size_t size)
+        {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++) {
+                m_Hash = (m_Hash ^ bytes[i]) * Prime;
+            }
+        }
+
+        template<typename T>
+        void Add(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "hash the members instead");
+            AddBytes(&value, sizeof(T));
+        }
+
+        void Add(const std::string& value)
+        {
+            Add(value.size());
+            AddBytes(value.data(), value.size());
+        }
+
+        [[nodiscard]] uint64_t Get() const { return m_Hash; }
+
+    private:
+        static constexpr uint64_t OffsetBasis = 14695981039346656037ull;
+        static constexpr uint64_t Prime = 1099511628211ull;
+
+        uint64_t m_Hash = OffsetBasis;
+    };
+}
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Utils
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open(const std::string& fileName)
+    {
+        Close();
+#if !defined(_WIN32)
+        const int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        struct stat status{};
+        void* data = MAP_FAILED;
+        if (fstat(file, &status) == 0 && status.st_size > 0) {
+            data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        }
+        // The mapping keeps the file alive by itself.
+        close(file);
+        if (data == MAP_FAILED) return false;
+        m_Data = static_cast<const uint8_t*>(data);
+        m_Size = static_cast<size_t>(status.st_size);
+        return true;
+#else
+        FILE* file = std::fopen(fileName.c_str(), "rb");
+        if (!file) return false;
+        long size = -1;
+        if (std::fseek(file, 0, SEEK_END) == 0) {
+            size = std::ftell(file);
+        }
+        uint8_t* data = size > 0 && std::fseek(file, 0, SEEK_SET) == 0 ? new uint8_t[size] : nullptr;
+        if (data && std::fread(data, 1, static_cast<size_t>(size), file) != static_cast<size_t>(size)) {
+            delete[] data;
+            data = nullptr;
+        }
+        std::fclose(file);
+        if (!data) return false;
+        m_Data = data;
+        m_Size = static_cast<size_t>(size);
+        return true;
+#endif
+    }
+
+    void MappedFile::Prefetch(const size_t offset, const size_t size) const
+    {
+#if !defined(_WIN32)
+        if (!m_Data || offset >= m_Size) return;
+        // madvise() wants page-aligned addresses: widen the range to whole pages.
+        const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t begin = offset / pageSize * pageSize;
+        const size_t end = std::min(offset + size, m_Size);
+        madvise(const_cast<uint8_t*>(m_Data) + begin, end - begin, MADV_WILLNEED);
+#else
+        (void)offset;
+        (void)size;
+#endif
+    }
+
+    void MappedFile::Release(const size_t offset, const size_t size) const
+    {
+#if !defined(_WIN32)
+        if (!m_Data || offset >= m_Size) return;
+        // Only pages entirely inside the range, so neighbouring data stays.
+        const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+        // The mapping covers the last page of the file entirely.
+        const size_t end = offset + size >= m_Size ? (m_Size + pageSize - 1) / pageSize * pageSize
+            : (offset + size) / pageSize * pageSize;
+        if (end <= begin) return;
+        // The mapping is private and never written, so dropped pages come back from the file unchanged.
+        madvise(const_cast<uint8_t*>(m_Data) + begin, end - begin, MADV_DONTNEED);
+#else
+        (void)offset;
+        (void)size;
+#endif
+    }
+
+    void MappedFile::Close()
+    {
+        if (!m_Data) return;
+#if !defined(_WIN32)
+        munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#else
+        delete[] m_Data;
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Utils
+{
+    // Read-only view of a whole file. Mapped into memory where the platform allows, so pages are only
+    // read when touched and stay shared with the page cache; elsewhere the file is read into a buffer.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Fails for missing and empty files.
+        bool Open(const std::string& fileName);
+
+        void Close();
+
+        [[nodiscard]] const uint8_t* GetData() const { return m_Data; }
+
+        [[nodiscard]] size_t GetSize() const { return m_Size; }
+
+        // Asks the system to start reading [offset, offset + size) in the background. A hint: does nothing
+        // where the file isn't mapped.
+        void Prefetch(size_t offset, size_t size) const;
+
+        // Drops the memory pages inside [offset, offset + size); touching them again reads them from the file.
+        // Does nothing where the file isn't mapped.
+        void Release(size_t offset, size_t size) const;
+
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+}
@@ -0,0 +1,109 @@
+#include "Profiler.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Utils
+{
+    namespace
+    {
+        struct Event
+        {
+            const char* Name = nullptr;
+            uint64_t Start = 0;
+            uint64_t Duration = 0;
+        };
+
+        // Written only by its own thread. Count is published with release semantics, so the exporter
+        // sees every event below it.
+        struct ThreadBuffer
+        {
+            std::array<Event, Profiler::EventsPerThread> Events;
+            std::atomic<uint64_t> Count = 0;
+            uint32_t ThreadId = 0;
+            std::string Name;
+        };
+
+        const auto Epoch = std::chrono::steady_clock::now();
+
+        std::mutex RegistryMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> Registry;
+
+        // Buffers outlive their threads, so events of finished threads are still exported.
+        ThreadBuffer& threadBuffer()
+        {
+            thread_local ThreadBuffer* buffer = [] {
+                std::lock_guard lock(RegistryMutex);
+                auto& created = Registry.emplace_back(std::make_unique<ThreadBuffer>());
+                created->ThreadId = static_cast<uint32_t>(Registry.size());
+                return created.get();
+            }();
+            return *buffer;
+        }
+
+        void writeEscaped(FILE* file, const std::string& text)
+        {
+            for (const char c : text) {
+                if (c == '"' || c == '\\') std::fputc('\\', file);
+                std::fputc(c, file);
+            }
+        }
+    }
+
+    uint64_t Profiler::Now()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count());
+    }
+
+    void Profiler::Record(const char* name, const uint64_t start, const uint64_t duration)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        const uint64_t index = buffer.Count.load(std::memory_order_relaxed);
+        buffer.Events[index % EventsPerThread] = { name, start, duration };
+        buffer.Count.store(index + 1, std::memory_order_release);
+    }
+
+    void Profiler::SetThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard lock(RegistryMutex);
+        buffer.Name = name;
+    }
+
+    bool Profiler::WriteChromeTrace(const std::string& fileName)
+    {
+        FILE* file = std::fopen(fileName.c_str(), "w");
+        if (!file) return false;
+
+        std::lock_guard lock(RegistryMutex);
+        std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        bool isFirst = true;
+        for (const auto& buffer : Registry) {
+            if (!buffer->Name.empty()) {
+                std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                    isFirst ? "" : ",\n", buffer->ThreadId);
+                writeEscaped(file, buffer->Name);
+                std::fprintf(file, "\"}}");
+                isFirst = false;
+            }
+            const uint64_t count = buffer->Count.load(std::memory_order_acquire);
+            const uint64_t first = count > EventsPerThread ? count - EventsPerThread : 0;
+            for (uint64_t i = first; i < count; i++) {
+                const Event& event = buffer->Events[i % EventsPerThread];
+                // Chrome trace timestamps are in microseconds; fractions keep the nanoseconds.
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    isFirst ? "" : ",\n", event.Name, buffer->ThreadId,
+                    static_cast<double>(event.Start) / 1000.0, static_cast<double>(event.Duration) / 1000.0);
+                isFirst = false;
+            }
+        }
+        std::fprintf(file, "\n]}\n");
+        return std::fclose(file) == 0;
+    }
+}
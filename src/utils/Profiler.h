@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Scoped profiling zones, compiled in with -DDAZHBOG_PROFILING=ON (see CMakeLists.txt). Every thread
+// records into its own ring buffer without locking; WriteChromeTrace() exports the most recent events
+// of all threads as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open directly.
+//
+//   void Renderer::renderTile(...) {
+//       DAZHBOG_PROFILE_ZONE("RenderTile");
+//       ...
+//   }
+//
+// Zone names must be string literals, only the pointer is stored.
+namespace Utils
+{
+    class Profiler
+    {
+    public:
+        // Events per thread; older ones are overwritten.
+        static constexpr uint32_t EventsPerThread = 1u << 16;
+
+        class Zone
+        {
+        public:
+            explicit Zone(const char* name) : m_Name(name), m_Start(Now()) {}
+
+            ~Zone() { Record(m_Name, m_Start, Now() - m_Start); }
+
+            Zone(const Zone&) = delete;
+            Zone& operator=(const Zone&) = delete;
+
+        private:
+            const char* m_Name;
+            uint64_t m_Start;
+        };
+
+        // Nanoseconds since the profiler's epoch.
+        static uint64_t Now();
+
+        static void Record(const char* name, uint64_t start, uint64_t duration);
+
+        // Shown as the thread's name in the trace viewer.
+        static void SetThreadName(const std::string& name);
+
+        // Meant to be called once the profiled work has stopped: events recorded while exporting
+        // may come out torn.
+        static bool WriteChromeTrace(const std::string& fileName);
+    };
+}
+
+#define DAZHBOG_PROFILE_CONCAT_IMPL(a, b) a##b
+#define DAZHBOG_PROFILE_CONCAT(a, b) DAZHBOG_PROFILE_CONCAT_IMPL(a, b)
+
+#if DAZHBOG_PROFILING
+#define DAZHBOG_PROFILE_ZONE(name) const Utils::Profiler::Zone DAZHBOG_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define DAZHBOG_PROFILE_THREAD(name) Utils::Profiler::SetThreadName(name)
+#else
+#define DAZHBOG_PROFILE_ZONE(name) ((void)0)
+#define DAZHBOG_PROFILE_THREAD(name) ((void)0)
+#endif
@@ -6,7 +6,7 @@ namespace Utils
 {
     void Timer::Start()
     {
-        m_StartTime = std::chrono::high_resolution_clock::now();
+        m_StartTime = std::chrono::steady_clock::now();
         m_IsRunning = true;
     }
 
@@ -14,7 +14,7 @@ namespace Utils
     {
         if (m_IsRunning)
         {
-            std::chrono::steady_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+            std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
             const auto elapsedTime = endTime - m_StartTime;
             m_ElapsedTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTime).count();
             m_IsRunning = false;
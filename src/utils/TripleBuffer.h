@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Utils
+{
+    // Lock-free handoff of the latest value from one producer thread to one consumer thread.
+    // The producer fills Back() and publishes it; the consumer acquires the most recently
+    // published value into Front(). Values published faster than they are consumed are dropped,
+    // so the consumer never falls behind by more than one value.
+    template<typename T>
+    class TripleBuffer
+    {
+    public:
+        // Producer side.
+        T& Back() { return m_Buffers[m_BackIndex]; }
+
+        void Publish()
+        {
+            const uint8_t previous = m_Middle.exchange(m_BackIndex | FreshBit, std::memory_order_acq_rel);
+            m_BackIndex = previous & IndexMask;
+        }
+
+        // Consumer side. Returns false (and leaves Front() untouched) if nothing new was published.
+        bool Acquire()
+        {
+            if (!HasFresh()) return false;
+            const uint8_t previous = m_Middle.exchange(m_FrontIndex, std::memory_order_acq_rel);
+            m_FrontIndex = previous & IndexMask;
+            return true;
+        }
+
+        [[nodiscard]] bool HasFresh() const
+        {
+            return m_Middle.load(std::memory_order_acquire) & FreshBit;
+        }
+
+        T& Front() { return m_Buffers[m_FrontIndex]; }
+
+    private:
+        static constexpr uint8_t IndexMask = 0x3;
+        static constexpr uint8_t FreshBit = 0x4;
+
+        std::array<T, 3> m_Buffers{};
+        uint8_t m_BackIndex = 0;
+        uint8_t m_FrontIndex = 1;
+        std::atomic<uint8_t> m_Middle{2};
+    };
+}